@@ -6,6 +6,7 @@
 
 #include "nbl/application_templates/MonoDeviceApplication.hpp"
 #include "nbl/application_templates/MonoAssetManagerAndBuiltinResourceApplication.hpp"
+#include "CShaderCompileCache.hpp"
 
 using namespace nbl;
 
@@ -16,7 +17,7 @@ public:
 	IntrospectionTesterBase(const std::string& functionToTestName)
 		: m_functionToTestName(functionToTestName) {};
 
-	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr) = 0;
+	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, nbl::examples::CShaderCompileCache* shaderCache) = 0;
 
 	virtual ~IntrospectionTesterBase() {};
 
@@ -24,8 +25,8 @@ protected:
 	const std::string m_functionToTestName = "";
 
 protected:
-	static std::pair<smart_refctd_ptr<ICPUShader>, smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData>> compileHLSLShaderAndTestIntrospection(
-		video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, const std::string& shaderPath, CSPIRVIntrospector& introspector)
+	static smart_refctd_ptr<ICPUShader> compileHLSLShader(
+		video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, nbl::examples::CShaderCompileCache* shaderCache, const std::string& shaderPath)
 	{
 		IAssetLoader::SAssetLoadParams lp = {};
 		lp.logger = logger;
@@ -43,7 +44,6 @@ protected:
 		assert(assets.size() == 1);
 		smart_refctd_ptr<ICPUShader> source = IAsset::castDown<ICPUShader>(assets[0]);
 
-		smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData> introspection;
 		{
 			// The Asset Manager has a Default Compiler Set which contains all built-in compilers (so it can try them all)
 			auto* compilerSet = assetMgr->getCompilerSet();
@@ -64,14 +64,11 @@ protected:
 			options.preprocessorOptions.logger = logger;
 			options.preprocessorOptions.includeFinder = compilerSet->getShaderCompiler(source->getContentType())->getDefaultIncludeFinder();
 
-			auto spirvUnspecialized = compilerSet->compileToSPIRV(source.get(), options);
-			const CSPIRVIntrospector::CStageIntrospectionData::SParams inspctParams = { .entryPoint = "main", .shader = spirvUnspecialized };
-
-			introspection = introspector.introspect(inspctParams);
-			if (!introspection)
+			auto spirvUnspecialized = shaderCache->compileToSPIRV(compilerSet, source.get(), options);
+			if (!spirvUnspecialized)
 			{
-				logFail(logger, "SPIR-V Introspection failed, probably the required SPIR-V compilation failed first!");
-				return std::pair(nullptr, nullptr);
+				logFail(logger, "Failed to compile \"%s\" to SPIR-V!", shaderPath.c_str());
+				return nullptr;
 			}
 
 			{
@@ -91,7 +88,25 @@ protected:
 			source = std::move(spirvUnspecialized);
 		}
 
-		return std::pair(source, introspection);
+		return source;
+	}
+
+	static std::pair<smart_refctd_ptr<ICPUShader>, smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData>> compileHLSLShaderAndTestIntrospection(
+		video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, nbl::examples::CShaderCompileCache* shaderCache, const std::string& shaderPath, CSPIRVIntrospector& introspector)
+	{
+		auto spirvUnspecialized = compileHLSLShader(physicalDevice, device, logger, assetMgr, shaderCache, shaderPath);
+		if (!spirvUnspecialized)
+			return std::pair(nullptr, nullptr);
+
+		const CSPIRVIntrospector::CStageIntrospectionData::SParams inspctParams = { .entryPoint = "main", .shader = spirvUnspecialized };
+		auto introspection = introspector.introspect(inspctParams);
+		if (!introspection)
+		{
+			logFail(logger, "SPIR-V Introspection failed, probably the required SPIR-V compilation failed first!");
+			return std::pair(nullptr, nullptr);
+		}
+
+		return std::pair(spirvUnspecialized, introspection);
 	}
 
 	void confirmExpectedOutput(system::ILogger* logger, bool value, bool expectedValue)
@@ -122,7 +137,7 @@ public:
 	MergeTester(const std::string& functionToTestName)
 		: IntrospectionTesterBase(functionToTestName) {};
 
-	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr)
+	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, nbl::examples::CShaderCompileCache* shaderCache)
 	{
 		constexpr std::array mergeTestShadersPaths = {
 				"app_resources/pplnLayoutMergeTest/shader_0.comp.hlsl",
@@ -137,9 +152,10 @@ public:
 		CSPIRVIntrospector introspector[MERGE_TEST_SHADERS_CNT];
 		smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData> introspections[MERGE_TEST_SHADERS_CNT];
 
+		// deliberately not through `CIntrospectionCache::merge`, a cached outcome would never exercise the merge under test
 		for (uint32_t i = 0u; i < MERGE_TEST_SHADERS_CNT; ++i)
 		{
-			auto sourceIntrospectionPair = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, mergeTestShadersPaths[i], introspector[i]);
+			auto sourceIntrospectionPair = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, mergeTestShadersPaths[i], introspector[i]);
 			introspections[i] = sourceIntrospectionPair.second;
 		}
 
@@ -173,7 +189,7 @@ public:
 	PredefinedLayoutTester(const std::string& functionToTestName)
 		: IntrospectionTesterBase(functionToTestName) {};
 
-	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr)
+	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, nbl::examples::CShaderCompileCache* shaderCache)
 	{
 		constexpr std::array mergeTestShadersPaths = {
 				"app_resources/pplnLayoutCreationWithPredefinedLayoutTest/shader_0.comp.hlsl",
@@ -190,7 +206,7 @@ public:
 
 		for (uint32_t i = 0u; i < MERGE_TEST_SHADERS_CNT; ++i)
 		{
-			auto sourceIntrospectionPair = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, mergeTestShadersPaths[i], introspector[i]);
+			auto sourceIntrospectionPair = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, mergeTestShadersPaths[i], introspector[i]);
 			// TODO: disctinct functions for shader compilation and introspection
 			sources[i] = sourceIntrospectionPair.first;
 		}
@@ -281,10 +297,10 @@ public:
 	SandboxTester(const std::string& functionToTestName)
 		: IntrospectionTesterBase(functionToTestName) {};
 
-	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr)
+	void virtual performTests(video::IPhysicalDevice* physicalDevice, video::ILogicalDevice* device, system::ILogger* logger, asset::IAssetManager* assetMgr, nbl::examples::CShaderCompileCache* shaderCache)
 	{
 		CSPIRVIntrospector introspector;
-		auto sourceIntrospectionPair = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, "app_resources/test.hlsl", introspector);
+		auto sourceIntrospectionPair = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, "app_resources/test.hlsl", introspector);
 		auto pplnIntroData = core::make_smart_refctd_ptr<CSPIRVIntrospector::CPipelineIntrospectionData>();
 		confirmExpectedOutput(logger, pplnIntroData->merge(sourceIntrospectionPair.second.get()), true);
 
@@ -292,17 +308,17 @@ public:
 
 		// TODO
 		/*CSPIRVIntrospector introspector_test1;
-		auto vtx_test1 = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, "app_resources/vtx_test1.hlsl", introspector_test1);
-		auto test1_frag = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, "app_resources/frag_test1.hlsl", introspector_test1);
+		auto vtx_test1 = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, "app_resources/vtx_test1.hlsl", introspector_test1);
+		auto test1_frag = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, "app_resources/frag_test1.hlsl", introspector_test1);
 
 		CSPIRVIntrospector introspector_test2;
-		auto test2_comp = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, "app_resources/comp_test2_nestedStructs.hlsl", introspector_test2);
+		auto test2_comp = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, "app_resources/comp_test2_nestedStructs.hlsl", introspector_test2);
 
 		CSPIRVIntrospector introspector_test3;
-		auto test3_comp = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, "app_resources/comp_test3_ArraysAndMatrices.hlsl", introspector_test3);
+		auto test3_comp = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, "app_resources/comp_test3_ArraysAndMatrices.hlsl", introspector_test3);
 
 		CSPIRVIntrospector introspector_test4;
-		auto test4_comp = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, "app_resources/frag_test4_SamplersTexBuffAndImgStorage.hlsl", introspector_test4);*/
+		auto test4_comp = compileHLSLShaderAndTestIntrospection(physicalDevice, device, logger, assetMgr, shaderCache, "app_resources/frag_test4_SamplersTexBuffAndImgStorage.hlsl", introspector_test4);*/
 	}
 };
 
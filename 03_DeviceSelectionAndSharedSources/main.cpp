@@ -5,6 +5,8 @@
 #include "nbl/application_templates/MonoDeviceApplication.hpp"
 #include "nbl/application_templates/MonoAssetManagerAndBuiltinResourceApplication.hpp"
 #include "CommonPCH/PCH.hpp"
+#include "CShaderCompileCache.hpp"
+#include "CIntrospectionCache.hpp"
 
 using namespace nbl;
 using namespace core;
@@ -19,6 +21,8 @@ using namespace video;
 #include "Testers.h"
 
 constexpr bool ENABLE_TESTS = false;
+// compiles and introspects every compilable `.hlsl` in the repository, cold versus through the caches
+constexpr bool ENABLE_INTROSPECTION_CACHE_BENCHMARK = false;
 
 // This time we create the device in the base class and also use a base class to give us an Asset Manager and an already mounted built-in resource archive
 class DeviceSelectionAndSharedSourcesApp final : public application_templates::MonoDeviceApplication, public application_templates::MonoAssetManagerAndBuiltinResourceApplication
@@ -39,32 +43,48 @@ public:
 		if (!asset_base_t::onAppInitialized(std::move(system)))
 			return false;
 
+		// shared with the other examples, so whoever compiled a shader first saves everyone else the DXC invocation
+		m_shaderCache = std::make_unique<nbl::examples::CShaderCompileCache>(smart_refctd_ptr(m_system), sharedOutputCWD / "shader_cache");
+		// layouts derived from the SPIR-V live right next to it
+		m_introspectionCache = std::make_unique<nbl::examples::CIntrospectionCache>(smart_refctd_ptr(m_system), sharedOutputCWD / "shader_cache" / "introspection");
+
 		if constexpr (ENABLE_TESTS)
 		{
 			MergeTester mergeTester("CSPIRVIntrospector::CPipelineIntrospectionData::merge");
-			mergeTester.performTests(m_physicalDevice, m_device.get(), m_logger.get(), m_assetMgr.get());
+			mergeTester.performTests(m_physicalDevice, m_device.get(), m_logger.get(), m_assetMgr.get(), m_shaderCache.get());
 
 			// testing creation of compute pipeline layouts compatible for multiple shaders
 			PredefinedLayoutTester layoutTester("CPSIRVIntrospector::createApproximateComputePipelineFromIntrospection");
-			layoutTester.performTests(m_physicalDevice, m_device.get(), m_logger.get(), m_assetMgr.get());
+			layoutTester.performTests(m_physicalDevice, m_device.get(), m_logger.get(), m_assetMgr.get(), m_shaderCache.get());
 
 			SandboxTester sandboxTester("unknown");
-			sandboxTester.performTests(m_physicalDevice, m_device.get(), m_logger.get(), m_assetMgr.get());
+			sandboxTester.performTests(m_physicalDevice, m_device.get(), m_logger.get(), m_assetMgr.get(), m_shaderCache.get());
 		}
 
+		if constexpr (ENABLE_INTROSPECTION_CACHE_BENCHMARK)
+			benchmarkIntrospectionCache();
+
 		CSPIRVIntrospector introspector;
-		auto compiledShader = this->compileShaderAndTestIntrospection("app_resources/shader.comp.hlsl", introspector);
-		auto source = compiledShader.first;
-		auto shaderIntrospection = compiledShader.second;
+		auto source = this->compileShader("app_resources/shader.comp.hlsl");
+		if (!source)
+			return false;
 
-		//shaderIntrospection->debugPrint(m_logger.get());
+		auto shaderIntrospection = introspector.introspect({ .entryPoint = "main", .shader = source });
+		if (!shaderIntrospection)
+			return logFail("SPIR-V Introspection failed!");
+		shaderIntrospection->debugPrint(m_logger.get());
 
 		// We've now skipped the manual creation of a descriptor set layout, pipeline layout
 		ICPUShader::SSpecInfo specInfo;
 		specInfo.entryPoint = "main";
 		specInfo.shader = source.get();
 
-		smart_refctd_ptr<nbl::asset::ICPUComputePipeline> cpuPipeline = introspector.createApproximateComputePipelineFromIntrospection(specInfo);
+		// the layout only gets derived through introspection the first time this exact SPIR-V is seen, afterwards it comes from the cache
+		smart_refctd_ptr<nbl::asset::ICPUComputePipeline> cpuPipeline = m_introspectionCache->createApproximateComputePipeline(introspector, specInfo, m_logger.get());
+		if (!cpuPipeline)
+			return logFail("Failed to create an approximate CPU compute pipeline!");
+		m_shaderCache->logStats(m_logger.get());
+		m_introspectionCache->logStats(m_logger.get());
 
 		smart_refctd_ptr<nbl::video::IGPUComputePipeline> pipeline;
 		// Nabla hardcodes the Max number of Descriptor Sets to 4
@@ -236,8 +256,7 @@ public:
 	// Whether to keep invoking the above. In this example because its headless GPU compute, we do all the work in the app initialization.
 	bool keepRunning() override { return false; }
 
-	std::pair<smart_refctd_ptr<ICPUShader>, smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData>> compileShaderAndTestIntrospection(
-		const std::string& shaderPath, CSPIRVIntrospector& introspector)
+	smart_refctd_ptr<ICPUShader> compileShader(const std::string& shaderPath)
 	{
 		IAssetLoader::SAssetLoadParams lp = {};
 		lp.logger = m_logger.get();
@@ -255,7 +274,6 @@ public:
 		assert(assets.size() == 1);
 		smart_refctd_ptr<ICPUShader> source = IAsset::castDown<ICPUShader>(assets[0]);
 		
-		smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData> introspection;
 		{
 			// The Asset Manager has a Default Compiler Set which contains all built-in compilers (so it can try them all)
 			auto* compilerSet = m_assetMgr->getCompilerSet();
@@ -276,16 +294,11 @@ public:
 			options.preprocessorOptions.logger = m_logger.get();
 			options.preprocessorOptions.includeFinder = compilerSet->getShaderCompiler(source->getContentType())->getDefaultIncludeFinder();
 
-			auto spirvUnspecialized = compilerSet->compileToSPIRV(source.get(), options);
-			const CSPIRVIntrospector::CStageIntrospectionData::SParams inspctParams = { .entryPoint = "main", .shader = spirvUnspecialized };
-
-			introspection = introspector.introspect(inspctParams);
-			introspection->debugPrint(m_logger.get());
-
-			if (!introspection)
+			auto spirvUnspecialized = m_shaderCache->compileToSPIRV(compilerSet, source.get(), options);
+			if (!spirvUnspecialized)
 			{
-				logFail("SPIR-V Introspection failed, probably the required SPIR-V compilation failed first!");
-				return std::pair(nullptr, nullptr);
+				logFail("Failed to compile \"%s\" to SPIR-V!", shaderPath.c_str());
+				return nullptr;
 			}
 
 			{
@@ -305,8 +318,100 @@ public:
 			source = std::move(spirvUnspecialized);
 		}
 
-		return std::pair(source, introspection);
+		return source;
+	}
+
+	// For every `.hlsl` in the repository that compiles on its own (plenty are just headers or need another example's builtin resources),
+	// measures recompiling with debug info plus reflection and layout derivation against getting the same layout through both caches.
+	void benchmarkIntrospectionCache()
+	{
+		using clock_t = std::chrono::steady_clock;
+		auto elapsedMs = [](const clock_t::time_point start) -> double { return std::chrono::duration<double, std::milli>(clock_t::now() - start).count(); };
+
+		auto* compilerSet = m_assetMgr->getCompilerSet();
+		const auto repoRoot = localInputCWD / "..";
+
+		uint32_t fileCount = 0u, benchmarkedCount = 0u, warmHits = 0u;
+		double coldMs = 0.0, warmMs = 0.0;
+		std::error_code ec;
+		for (auto it = std::filesystem::recursive_directory_iterator(repoRoot, std::filesystem::directory_options::skip_permission_denied, ec); it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+		{
+			const auto& path = it->path();
+			if (it->is_directory(ec) && path.filename().string().starts_with("."))
+			{
+				it.disable_recursion_pending();
+				continue;
+			}
+			if (!it->is_regular_file(ec) || path.extension() != ".hlsl")
+				continue;
+			fileCount++;
+
+			IAssetLoader::SAssetLoadParams lp = {};
+			lp.workingDirectory = path.parent_path();
+			const auto assets = m_assetMgr->getAsset(path.string(), lp).getContents();
+			if (assets.empty())
+				continue;
+			const auto source = IAsset::castDown<ICPUShader>(assets[0]);
+			if (!source || source->getContentType() != IShader::E_CONTENT_TYPE::ECT_HLSL)
+				continue;
+
+			// same options as `compileShader`, minus the logger since most files are expected to fail
+			IShaderCompiler::SCompilerOptions options = {};
+			options.stage = source->getStage();
+			options.targetSpirvVersion = m_device->getPhysicalDevice()->getLimits().spirvVersion;
+			options.spirvOptimizer = nullptr;
+			options.debugInfoFlags |= IShaderCompiler::E_DEBUG_INFO_FLAGS::EDIF_SOURCE_BIT;
+			options.preprocessorOptions.sourceIdentifier = source->getFilepathHint();
+			options.preprocessorOptions.includeFinder = compilerSet->getShaderCompiler(source->getContentType())->getDefaultIncludeFinder();
+
+			// cold: what every run used to pay
+			auto start = clock_t::now();
+			auto spirv = compilerSet->compileToSPIRV(source.get(), options);
+			if (!spirv)
+				continue;
+			CSPIRVIntrospector coldIntrospector;
+			auto introspection = coldIntrospector.introspect({ .entryPoint = "main", .shader = spirv });
+			if (!introspection)
+				continue;
+			auto pipelineData = make_smart_refctd_ptr<CSPIRVIntrospector::CPipelineIntrospectionData>();
+			if (pipelineData->merge(introspection.get()))
+				pipelineData->createApproximatePipelineLayoutFromIntrospection(introspection);
+			const double cold = elapsedMs(start);
+
+			// make sure both caches are populated, then time a warm lookup
+			CSPIRVIntrospector warmIntrospector;
+			smart_refctd_ptr<const CSPIRVIntrospector::CStageIntrospectionData> warmIntrospection;
+			auto cachedLayout = [&]() -> bool
+			{
+				auto cachedSpirv = m_shaderCache->compileToSPIRV(compilerSet, source.get(), options);
+				if (!cachedSpirv)
+					return false;
+				const auto stage = nbl::examples::CIntrospectionCache::hashStage(cachedSpirv.get(), "main");
+				m_introspectionCache->merge({ &stage,1 }, [&](const size_t) {
+					warmIntrospection = warmIntrospector.introspect({ .entryPoint = "main", .shader = cachedSpirv });
+					return warmIntrospection.get();
+				});
+				return true;
+			};
+			if (!cachedLayout())
+				continue;
+			const auto hitsBefore = m_introspectionCache->getStats().hits;
+			start = clock_t::now();
+			cachedLayout();
+			const double warm = elapsedMs(start);
+			warmHits += m_introspectionCache->getStats().hits - hitsBefore;
+
+			m_logger->log("%s: %.3f ms cold, %.3f ms cached", ILogger::ELL_DEBUG, path.string().c_str(), cold, warm);
+			benchmarkedCount++;
+			coldMs += cold;
+			warmMs += warm;
+		}
+		m_logger->log("Introspection cache benchmark: %u of %u .hlsl files compile standalone, %.3f ms compiling and introspecting, %.3f ms through the caches (%u layout hits, %.1fx faster)",
+			ILogger::ELL_PERFORMANCE, benchmarkedCount, fileCount, coldMs, warmMs, warmHits, warmMs > 0.0 ? coldMs / warmMs : 0.0);
 	}
+
+	std::unique_ptr<nbl::examples::CShaderCompileCache> m_shaderCache;
+	std::unique_ptr<nbl::examples::CIntrospectionCache> m_introspectionCache;
 };
 
 NBL_MAIN_FUNC(DeviceSelectionAndSharedSourcesApp)
@@ -18,6 +18,13 @@ using namespace video;
 #include "app_resources/common.hlsl"
 #include "nbl/builtin/hlsl/bit.hlsl"
 
+#include "CStreamingBufferTelemetry.hpp"
+#include "ParallelSelect.hpp"
+
+// Every iteration "receives" a random amount of work, with this off it's dispatched as one job no matter how full the streaming buffers are,
+// with it on the work queues up and jobs get sized to keep the streaming buffers around `TargetOccupancy`.
+constexpr bool ENABLE_ADAPTIVE_BATCHING = true;
+
 
 // In this application we'll cover buffer streaming, Buffer Device Address (BDA) and push constants 
 class StreamingAndBufferDeviceAddressApp final : public application_templates::MonoDeviceApplication, public application_templates::MonoAssetManagerAndBuiltinResourceApplication
@@ -59,6 +66,10 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 		// When choosing the memory properties of a mapped buffer consider which processor (CPU or GPU) needs faster access in event of a cache-miss.
 		nbl::video::StreamingTransientDataBufferMT<>* m_upStreamingBuffer;
 		StreamingTransientDataBufferMT<>* m_downStreamingBuffer;
+		// We route all our (de)allocations through these to see how full the buffers get, how long we wait on them and how much is stuck in deferred frees.
+		using telemetry_t = nbl::examples::CStreamingBufferTelemetry<StreamingTransientDataBufferMT<>>;
+		std::unique_ptr<telemetry_t> m_upTelemetry;
+		std::unique_ptr<telemetry_t> m_downTelemetry;
 
 		// These are Buffer Device Addresses
 		uint64_t m_upStreamingBufferAddress;
@@ -75,6 +86,13 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 		smart_refctd_ptr<ISemaphore> m_timeline;
 		uint64_t m_iteration = 0;
 		constexpr static inline uint64_t MaxIterations = 200;
+		constexpr static inline uint64_t TelemetryLogPeriod = 50;
+
+		// Work received but not dispatched yet, only ever non-zero with adaptive batching
+		uint64_t m_pendingElements = 0;
+		constexpr static inline float TargetOccupancy = 0.5f;
+		// The shader has no upper limit on the element count, but the dispatch size does
+		nbl::examples::CAdaptiveBatchSizer m_batchSizer = nbl::examples::CAdaptiveBatchSizer(TargetOccupancy,WorkgroupSize*64,MaxPossibleElementCount*4);
 
 	public:
 		// Yay thanks to multiple inheritance we cannot forward ctors anymore
@@ -125,6 +143,8 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 			m_downStreamingBuffer = m_utils->getDefaultDownStreamingBuffer();
 			m_upStreamingBufferAddress = m_upStreamingBuffer->getBuffer()->getDeviceAddress();
 			m_downStreamingBufferAddress = m_downStreamingBuffer->getBuffer()->getDeviceAddress();
+			m_upTelemetry = std::make_unique<telemetry_t>(m_upStreamingBuffer);
+			m_downTelemetry = std::make_unique<telemetry_t>(m_downStreamingBuffer);
 
 			// People love Reflection but I prefer Shader Sources instead!
 			const nbl::asset::SPushConstantRange pcRange = {.stageFlags=IShader::E_SHADER_STAGE::ESS_COMPUTE,.offset=0,.size=sizeof(PushConstantData)};
@@ -166,7 +186,8 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 		}
 
 		// Ok this time we'll actually have a work loop (maybe just for the sake of future WASM so we don't timeout a Browser Tab with an unresponsive script)
-		bool keepRunning() override { return m_iteration<MaxIterations; }
+		// With adaptive batching we keep going until all the work received during the `MaxIterations` got dispatched
+		bool keepRunning() override { return m_iteration<MaxIterations || m_pendingElements; }
 
 		// Finally the first actual work-loop
 		void workLoopBody() override
@@ -177,7 +198,19 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 			auto rng = nbl::hlsl::Xoroshiro64StarStar::construct({m_iteration^0xdeadbeefu,std::hash<string>()(_NBL_APP_NAME_)});
 
 			// we dynamically choose the number of elements for each iteration
-			const auto elementCount = rng()%MaxPossibleElementCount;
+			uint32_t elementCount = m_iteration<MaxIterations ? (rng()%MaxPossibleElementCount):0u;
+			if constexpr (ENABLE_ADAPTIVE_BATCHING)
+			{
+				// Deferred frees count as in-use, we're trying to not need them to signal before we can allocate
+				const auto upStats = m_upTelemetry->getStats();
+				const auto downStats = m_downTelemetry->getStats();
+				m_pendingElements += elementCount;
+				elementCount = m_batchSizer.next(m_pendingElements,{
+					{.totalBytes=upStats.totalBytes,.inUseBytes=upStats.inUseBytes,.bytesPerElement=sizeof(input_t)},
+					{.totalBytes=downStats.totalBytes,.inUseBytes=downStats.inUseBytes,.bytesPerElement=sizeof(output_t)}
+				});
+				m_pendingElements -= elementCount;
+			}
 			const uint32_t inputSize = sizeof(input_t)*elementCount;
 
 			// The allocators can do multiple allocations at once for efficiency
@@ -191,7 +224,7 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 			// Freeing of Streaming Buffer Allocations can and should be deferred until an associated polled event signals done (more on that later).
 			std::chrono::steady_clock::time_point waitTill(std::chrono::years(45));
 			// note that the API takes a time-point not a duration, because there are multiple waits and preemptions possible, so the durations wouldn't add up properly
-			m_upStreamingBuffer->multi_allocate(waitTill,AllocationCount,&inputOffset,&inputSize,&m_alignment);
+			m_upTelemetry->multi_allocate(waitTill,AllocationCount,&inputOffset,&inputSize,&m_alignment);
 
 			// Generate our data in-place on the allocated staging buffer
 			{
@@ -222,7 +255,7 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 			const uint32_t outputSize = sizeof(output_t)*elementCount;
 
 			auto outputOffset = m_downStreamingBuffer->invalid_value;
-			m_downStreamingBuffer->multi_allocate(waitTill,AllocationCount,&outputOffset,&outputSize,&m_alignment);
+			m_downTelemetry->multi_allocate(waitTill,AllocationCount,&outputOffset,&outputSize,&m_alignment);
 
 			smart_refctd_ptr<IGPUCommandBuffer> cmdbuf;
 			{
@@ -237,8 +270,9 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 					.dataElementCount=elementCount
 				};
 				cmdbuf->pushConstants(m_pipeline->getLayout(),IShader::E_SHADER_STAGE::ESS_COMPUTE,0u,sizeof(pc),&pc);
-				// Good old trick to get rounded up divisions, in case you're not familiar
-				cmdbuf->dispatch((elementCount-1)/WorkgroupSize+1,1,1);
+				// Good old trick to get rounded up divisions, in case you're not familiar (it underflows for zero, random jobs and the batcher can both be empty)
+				if (elementCount)
+					cmdbuf->dispatch((elementCount-1)/WorkgroupSize+1,1,1);
 				cmdbuf->end();
 			}
 
@@ -278,7 +312,7 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 
 			// As promised, we can defer an upstreaming buffer deallocation until a fence is signalled
 			// You can also attach an additional optional IReferenceCounted derived object to hold onto until deallocation.
-			m_upStreamingBuffer->multi_deallocate(AllocationCount,&inputOffset,&inputSize,futureWait);
+			m_upTelemetry->multi_deallocate(AllocationCount,&inputOffset,&inputSize,futureWait);
 
 			// Now a new and even more advanced usage of the latched events, we make our own refcounted object with a custom destructor and latch that like we did the commandbuffer.
 			// Instead of making our own and duplicating logic, we'll use one from IUtilities meant for down-staging memory.
@@ -292,12 +326,15 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 					// But here we're sure we can get the whole thing in one go because we allocated the whole range ourselves.
 					assert(dstOffset==0 && size==outputSize);
 
-					// I can const cast, we know the mapping is just a pointer
-					output_t* const data = reinterpret_cast<output_t*>(const_cast<void*>(bufSrc));
-					auto median = data+elementCount/2;
-					std::nth_element(data,median,data+elementCount);
+					// Quick-select is inherently serial, so we radix select on all cores instead (this runs while we poll frees, so we'd be blocked anyway).
+					// It doesn't even need to write to the mapping anymore.
+					// an empty job has no median
+					if (elementCount==0u)
+						return;
+					const output_t* const data = reinterpret_cast<const output_t*>(bufSrc);
+					const output_t median = nbl::examples::parallelNthElement<output_t>({data,elementCount},elementCount/2);
 
-					m_logger->log("Iteration %d Median of Minimum Distances is %f",ILogger::ELL_PERFORMANCE,savedIterNum,*median);
+					m_logger->log("Iteration %d Median of Minimum Distances is %f",ILogger::ELL_PERFORMANCE,savedIterNum,median);
 				},
 				// Its also necessary to hold onto the commandbuffer, even though we take care to not reset the parent pool, because if it
 				// hits its destructor, our automated reference counting will drop all references to objects used in the recorded commands.
@@ -305,14 +342,25 @@ class StreamingAndBufferDeviceAddressApp final : public application_templates::M
 				std::move(cmdbuf),m_downStreamingBuffer
 			);
 			// We put a function we want to execute 
-			m_downStreamingBuffer->multi_deallocate(AllocationCount,&outputOffset,&outputSize,futureWait,&latchedConsumer.get());
+			m_downTelemetry->multi_deallocate(AllocationCount,&outputOffset,&outputSize,futureWait,&latchedConsumer.get());
+
+			if (m_iteration%TelemetryLogPeriod==0)
+			{
+				m_upTelemetry->logStats(m_logger.get(),"Upstreaming");
+				m_downTelemetry->logStats(m_logger.get(),"Downstreaming");
+			}
 		}
 
 		bool onAppTerminated() override
 		{
 			// Need to make sure that there are no events outstanding if we want all lambdas to eventually execute before `onAppTerminated`
 			// (the destructors of the Command Pool Cache and Streaming buffers will still wait for all lambda events to drain)
-			while (m_downStreamingBuffer->cull_frees()) {}
+			// The telemetry objects also need every free they latched to have happened before they die
+			while (m_downStreamingBuffer->cull_frees() || m_upStreamingBuffer->cull_frees()) {}
+			m_upTelemetry->logStats(m_logger.get(),"Upstreaming");
+			m_downTelemetry->logStats(m_logger.get(),"Downstreaming");
+			if constexpr (ENABLE_ADAPTIVE_BATCHING)
+				m_batchSizer.logStats(m_logger.get());
 			return device_base_t::onAppTerminated();
 		}
 };
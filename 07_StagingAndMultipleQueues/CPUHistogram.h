@@ -0,0 +1,155 @@
+// Copyright (C) 2018-2024 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_CPU_HISTOGRAM_H_INCLUDED_
+#define _NBL_CPU_HISTOGRAM_H_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define _NBL_CPU_HISTOGRAM_SSE2_
+#include <emmintrin.h>
+#endif
+
+#include "ParallelFor.hpp"
+
+using namespace nbl;
+
+// CPU backend of `app_resources/comp_shader.hlsl`, same bins and same channel layout in the output. Texels of sRGB formats get decoded
+// and requantized through a table, because that's what sampling them through an image view does on the GPU.
+// Scattered increments don't vectorize without conflict detection, so instead every worker counts consecutive texels into separate
+// banks which breaks the store-to-load dependency on runs of equal texels, and SIMD is used where it does pay off: reducing the banks.
+class CPUHistogram
+{
+public:
+	static constexpr uint32_t ChannelCount = 3u;
+	static constexpr uint32_t BinCount = 256u;
+	static constexpr uint32_t Size = ChannelCount * BinCount;
+
+	CPUHistogram()
+	{
+		for (uint32_t i = 0u; i < BinCount; ++i)
+		{
+			m_unormToBin[0][i] = static_cast<uint8_t>(i);
+			// same decode as the sampler, then the same `value*255+0.5` quantization as the shader
+			const float encoded = float(i) / 255.f;
+			const float linear = encoded <= 0.04045f ? (encoded / 12.92f) : std::pow((encoded + 0.055f) / 1.055f, 2.4f);
+			m_unormToBin[1][i] = static_cast<uint8_t>(std::min(linear * 255.f + 0.5f, 255.f));
+		}
+	}
+
+	//! Adds the counts of the first mip level of `image` to `histogram` which holds `Size` counters, channels one after the other.
+	//! Returns false for formats which aren't 8 bits per channel.
+	bool accumulate(const asset::ICPUImage* image, uint32_t* histogram, uint32_t workerCount = 0u) const
+	{
+		SLayout layout;
+		if (!image || !getLayout(image->getCreationParameters().format, layout) || !image->getBuffer())
+			return false;
+		if (workerCount == 0u)
+			workerCount = nbl::examples::getDefaultWorkerCount();
+
+		// flatten every row of every mip 0 region into one list, so tall and wide images split the same way
+		struct SRow
+		{
+			const uint8_t* texels;
+			uint32_t width;
+		};
+		std::vector<SRow> rows;
+		const auto* data = static_cast<const uint8_t*>(image->getBuffer()->getPointer());
+		for (const auto& region : image->getRegions())
+		{
+			if (region.imageSubresource.mipLevel != 0u || region.imageSubresource.baseArrayLayer != 0u)
+				continue;
+			const uint32_t rowLength = region.bufferRowLength ? region.bufferRowLength : region.imageExtent.width;
+			const uint32_t imageHeight = region.bufferImageHeight ? region.bufferImageHeight : region.imageExtent.height;
+			for (uint32_t z = 0u; z < region.imageExtent.depth; ++z)
+			for (uint32_t y = 0u; y < region.imageExtent.height; ++y)
+				rows.push_back({ data + region.bufferOffset + (size_t(z) * imageHeight + y) * rowLength * layout.texelBytes, region.imageExtent.width });
+		}
+
+		std::vector<uint32_t> banks(size_t(workerCount) * BankCount * Size, 0u);
+		const uint8_t* lut = m_unormToBin[layout.srgb].data();
+		nbl::examples::parallelFor(rows.size(), [&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+		{
+			uint32_t* workerBanks = banks.data() + size_t(workerIx) * BankCount * Size;
+			for (size_t r = begin; r < end; ++r)
+			for (uint32_t c = 0u; c < ChannelCount; ++c)
+			{
+				const auto& row = rows[r];
+				uint32_t* channelBanks = workerBanks + c * BinCount;
+				// channels the format doesn't have read as 0 on the GPU
+				if (layout.channelOffset[c] < 0)
+				{
+					channelBanks[0] += row.width;
+					continue;
+				}
+				const uint8_t* texel = row.texels + layout.channelOffset[c];
+				const uint32_t stride = layout.texelBytes;
+				uint32_t x = 0u;
+				for (; x + BankCount <= row.width; x += BankCount, texel += BankCount * stride)
+				for (uint32_t b = 0u; b < BankCount; ++b)
+					channelBanks[b * Size + lut[texel[b * stride]]]++;
+				for (; x < row.width; ++x, texel += stride)
+					channelBanks[lut[*texel]]++;
+			}
+		}, workerCount, RowsPerChunk);
+
+		for (uint32_t bank = 0u; bank < workerCount * BankCount; ++bank)
+		{
+			const uint32_t* src = banks.data() + size_t(bank) * Size;
+			uint32_t i = 0u;
+#ifdef _NBL_CPU_HISTOGRAM_SSE2_
+			for (; i + 4u <= Size; i += 4u)
+			{
+				const __m128i sum = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(histogram + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(histogram + i), sum);
+			}
+#endif
+			for (; i < Size; ++i)
+				histogram[i] += src[i];
+		}
+		return true;
+	}
+
+private:
+	static constexpr uint32_t BankCount = 4u;
+	// even for small images a few rows per chunk are plenty to amortize the chunk fetch
+	static constexpr size_t RowsPerChunk = 16ull;
+
+	struct SLayout
+	{
+		uint32_t texelBytes;
+		std::array<int8_t, ChannelCount> channelOffset; // negative if the format has no such channel
+		bool srgb;
+	};
+	static bool getLayout(const asset::E_FORMAT format, SLayout& layout)
+	{
+		switch (format)
+		{
+			case asset::EF_R8_UNORM: layout = { 1u,{0,-1,-1},false }; return true;
+			case asset::EF_R8_SRGB: layout = { 1u,{0,-1,-1},true }; return true;
+			case asset::EF_R8G8_UNORM: layout = { 2u,{0,1,-1},false }; return true;
+			case asset::EF_R8G8_SRGB: layout = { 2u,{0,1,-1},true }; return true;
+			case asset::EF_R8G8B8_UNORM: layout = { 3u,{0,1,2},false }; return true;
+			case asset::EF_R8G8B8_SRGB: layout = { 3u,{0,1,2},true }; return true;
+			case asset::EF_B8G8R8_UNORM: layout = { 3u,{2,1,0},false }; return true;
+			case asset::EF_B8G8R8_SRGB: layout = { 3u,{2,1,0},true }; return true;
+			case asset::EF_R8G8B8A8_UNORM: layout = { 4u,{0,1,2},false }; return true;
+			case asset::EF_R8G8B8A8_SRGB: layout = { 4u,{0,1,2},true }; return true;
+			case asset::EF_B8G8R8A8_UNORM: layout = { 4u,{2,1,0},false }; return true;
+			case asset::EF_B8G8R8A8_SRGB: layout = { 4u,{2,1,0},true }; return true;
+			default: return false;
+		}
+	}
+
+	// [0] for UNORM, [1] for sRGB
+	std::array<std::array<uint8_t, BinCount>, 2> m_unormToBin;
+};
+
+#endif
@@ -10,6 +10,8 @@
 // get asset converter
 #include "CommonPCH/PCH.hpp"
 
+#include <charconv>
+
 using namespace nbl;
 using namespace core;
 using namespace system;
@@ -17,6 +19,18 @@ using namespace asset;
 using namespace video;
 
 #include "app_resources/common.hlsl"
+#include "CPUHistogram.h"
+
+// which device computes the histograms, the CPU backend goes through the exact same load/histogram/CSV pipeline without recording any GPU work
+enum class E_HISTOGRAM_BACKEND : uint8_t
+{
+	GPU,
+	CPU
+};
+constexpr E_HISTOGRAM_BACKEND HISTOGRAM_BACKEND = E_HISTOGRAM_BACKEND::GPU;
+// after the regular run, pushes `BENCHMARK_IMAGE_CNT` images through the pipeline with the CPU backend and reports images/sec and how busy every stage was
+constexpr bool ENABLE_PIPELINE_BENCHMARK = false;
+constexpr uint32_t BENCHMARK_IMAGE_CNT = 256u;
 
 // This time we let the new base class score and pick queue families, as well as initialize `nbl::video::IUtilities` for us
 class StagingAndMultipleQueuesApp final : public application_templates::BasicMultiQueueApplication, public application_templates::MonoAssetManagerAndBuiltinResourceApplication
@@ -52,23 +66,13 @@ public:
 		if (!asset_base_t::onAppInitialized(std::move(system)))
 			return false;
 
-		constexpr size_t TIMELINE_SEMAPHORE_STARTING_VALUE = 0;
-		m_imagesLoadedSemaphore = m_device->createSemaphore(TIMELINE_SEMAPHORE_STARTING_VALUE);
-		m_imagesProcessedSemaphore = m_device->createSemaphore(TIMELINE_SEMAPHORE_STARTING_VALUE);
-		m_histogramSavedSemaphore = m_device->createSemaphore(TIMELINE_SEMAPHORE_STARTING_VALUE);
-
 		// TODO: create/initialize array of atomic pointers to IGPUImage* and IGPUBuffer* to hold results
 
-		// TODO: Change the capture start/end to become methods of IAPIConnection, because our current API is not how renderdoc works
-		m_api->startCapture();
-		std::thread loadImagesThread(&StagingAndMultipleQueuesApp::loadImages, this);
-		std::thread saveHistogramsThread(&StagingAndMultipleQueuesApp::saveHistograms, this);
-
-		calculateHistograms();
+		runPipeline(HISTOGRAM_BACKEND, IMAGE_CNT, "", IAssetLoader::ECF_CACHE_EVERYTHING);
 
-		loadImagesThread.join();
-		saveHistogramsThread.join();
-		m_api->endCapture();
+		// don't let the asset cache turn the load stage into a lookup, every image gets decoded
+		if constexpr (ENABLE_PIPELINE_BENCHMARK)
+			runPipeline(E_HISTOGRAM_BACKEND::CPU, BENCHMARK_IMAGE_CNT, localOutputCWD / "pipeline_benchmark", IAssetLoader::ECF_DONT_CACHE_TOP_LEVEL);
 
 		return true;
 	}
@@ -94,29 +98,131 @@ protected:
 	}
 
 private:
+	// the stages only count the time they spend working, not the time they're blocked on the stages before or after them
+	enum E_STAGE : uint8_t
+	{
+		ES_LOAD,
+		ES_HISTOGRAM,
+		ES_READBACK,
+		ES_CSV,
+		ES_COUNT
+	};
+	struct SStageTimer
+	{
+		SStageTimer(std::atomic<uint64_t>& _busyNs) : busyNs(_busyNs), start(std::chrono::steady_clock::now()) {}
+		~SStageTimer() { stop(); }
+
+		// for when the stage is about to block before the scope ends
+		void stop()
+		{
+			if (stopped)
+				return;
+			busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			stopped = true;
+		}
+
+		std::atomic<uint64_t>& busyNs;
+		const std::chrono::steady_clock::time_point start;
+		bool stopped = false;
+	};
+
 	// first = image loaded and ready for use, second = histogram computed and ready for access, third = histogram consumed and ready for re-use
 	smart_refctd_ptr<ISemaphore> m_imagesLoadedSemaphore, m_imagesProcessedSemaphore, m_histogramSavedSemaphore;
 	std::atomic<uint32_t> imageHandlesCreated = 0u;
 	// protect us from an out-of-order submit on a single queue
 	std::atomic<uint32_t> transfersSubmitted = 0u;
-	// protect us from annoying renderdoc with signal-after-submit
+	// protect us from annoying renderdoc with signal-after-submit, also tells the CSV writers which histograms they can format
 	std::atomic<uint32_t> histogramsSaved = 0u;
-	std::array<core::smart_refctd_ptr<IGPUImage>, IMAGE_CNT> images;
-
-	// these could actually be different numbers for each thread
-	static constexpr uint32_t SUBMITS_IN_FLIGHT = 3u;
+	// next histogram a CSV writer should pick up
+	std::atomic<uint32_t> csvsClaimed = 0u;
+	E_HISTOGRAM_BACKEND m_backend = HISTOGRAM_BACKEND;
+	uint32_t m_imageCount = 0u;
+	IAssetLoader::E_CACHING_FLAGS m_loadCachingFlags = IAssetLoader::ECF_CACHE_EVERYTHING;
+	std::vector<core::smart_refctd_ptr<IGPUImage>> images;
+	std::vector<core::smart_refctd_ptr<ICPUImage>> m_cpuImages;
+	std::array<std::atomic<uint64_t>, ES_COUNT> m_stageBusyNs = {};
+
+	// how deep the pipeline is, the histogram buffer has a slot for every submit in flight
+	static constexpr uint32_t SUBMITS_IN_FLIGHT = FRAMES_IN_FLIGHT;
+	static_assert(SUBMITS_IN_FLIGHT * HISTOGRAM_BYTE_SIZE == COMBINED_HISTOGRAM_BUFFER_BYTE_SIZE);
+	static_assert(CPUHistogram::Size == HISTOGRAM_SIZE);
 
 	smart_refctd_ptr<IGPUBuffer> histogramBuffer = nullptr;
 	nbl::video::IDeviceMemoryAllocator::SAllocation m_histogramBufferAllocation = {};
-	// TODO: make sure ranges are ok
 	std::array<ILogicalDevice::MappedMemoryRange, SUBMITS_IN_FLIGHT> m_histogramBufferMemoryRanges;
-	uint32_t* m_histogramBufferMemPtrs[3];
+	std::array<uint32_t*, SUBMITS_IN_FLIGHT> m_histogramBufferMemPtrs;
+	// the slots of the CPU backend
+	std::vector<uint32_t> m_hostHistograms;
+	// the readback copies every histogram here, so its slot can be reused while the CSV writers are still formatting it
+	std::vector<uint32_t> m_savedHistograms;
 
-	void loadImages()
+	void runPipeline(const E_HISTOGRAM_BACKEND backend, const uint32_t imageCount, const path& outputDir, const IAssetLoader::E_CACHING_FLAGS loadCachingFlags)
 	{
-		IAssetLoader::SAssetLoadParams lp;
-		lp.logger = m_logger.get();
+		// timeline values start from 0 for every run
+		constexpr size_t TIMELINE_SEMAPHORE_STARTING_VALUE = 0;
+		m_imagesLoadedSemaphore = m_device->createSemaphore(TIMELINE_SEMAPHORE_STARTING_VALUE);
+		m_imagesProcessedSemaphore = m_device->createSemaphore(TIMELINE_SEMAPHORE_STARTING_VALUE);
+		m_histogramSavedSemaphore = m_device->createSemaphore(TIMELINE_SEMAPHORE_STARTING_VALUE);
+		imageHandlesCreated = 0u;
+		transfersSubmitted = 0u;
+		histogramsSaved = 0u;
+		csvsClaimed = 0u;
+		for (auto& busyNs : m_stageBusyNs)
+			busyNs = 0u;
+
+		m_backend = backend;
+		m_imageCount = imageCount;
+		m_loadCachingFlags = loadCachingFlags;
+		images.assign(imageCount, nullptr);
+		m_cpuImages.assign(imageCount, nullptr);
+		m_savedHistograms.assign(size_t(imageCount) * HISTOGRAM_SIZE, 0u);
+		if (backend == E_HISTOGRAM_BACKEND::CPU)
+		{
+			m_hostHistograms.assign(size_t(SUBMITS_IN_FLIGHT) * HISTOGRAM_SIZE, 0u);
+			for (uint32_t i = 0u; i < SUBMITS_IN_FLIGHT; ++i)
+				m_histogramBufferMemPtrs[i] = m_hostHistograms.data() + i * HISTOGRAM_SIZE;
+		}
+		if (!outputDir.empty())
+			std::filesystem::create_directories(outputDir);
+
+		const auto start = std::chrono::steady_clock::now();
+		// TODO: Change the capture start/end to become methods of IAPIConnection, because our current API is not how renderdoc works
+		if (backend == E_HISTOGRAM_BACKEND::GPU)
+			m_api->startCapture();
+		std::thread loadImagesThread(backend == E_HISTOGRAM_BACKEND::GPU ? &StagingAndMultipleQueuesApp::loadImages : &StagingAndMultipleQueuesApp::loadCPUImages, this);
+		std::thread saveHistogramsThread(&StagingAndMultipleQueuesApp::saveHistograms, this);
+		// formatting and writing the CSVs is the one stage that can be made wider than a single thread
+		const uint32_t csvWriterCount = std::min(nbl::examples::getDefaultWorkerCount(), 4u);
+		std::vector<std::thread> csvWriterThreads;
+		for (uint32_t i = 0u; i < csvWriterCount; ++i)
+			csvWriterThreads.emplace_back(&StagingAndMultipleQueuesApp::writeCSVs, this, outputDir);
+
+		if (backend == E_HISTOGRAM_BACKEND::GPU)
+			calculateHistograms();
+		else
+			calculateCPUHistograms();
 
+		loadImagesThread.join();
+		saveHistogramsThread.join();
+		for (auto& thread : csvWriterThreads)
+			thread.join();
+		if (backend == E_HISTOGRAM_BACKEND::GPU)
+			m_api->endCapture();
+		const double wallNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+		m_logger->log("%s histogram pipeline: %u images in %.3f ms, %.1f images/s, %u submits in flight", ILogger::ELL_PERFORMANCE,
+			backend == E_HISTOGRAM_BACKEND::GPU ? "GPU" : "CPU", imageCount, wallNs * 1e-6, double(imageCount) * 1e9 / wallNs, SUBMITS_IN_FLIGHT);
+		// for the GPU backend the histogram stage is only the recording and submission, the dispatches themselves overlap with everything
+		constexpr const char* stageNames[ES_COUNT] = { "load", "histogram", "readback", "CSV" };
+		for (uint32_t stage = 0u; stage < ES_COUNT; ++stage)
+		{
+			const uint32_t threads = stage == ES_CSV ? csvWriterCount : 1u;
+			m_logger->log("\t%s stage: %.1f%% occupancy over %u thread(s)", ILogger::ELL_PERFORMANCE, stageNames[stage], 100.0 * double(m_stageBusyNs[stage].load()) / (wallNs * threads), threads);
+		}
+	}
+
+	void loadImages()
+	{
 		auto transferUpQueue = getTransferUpQueue();
 
 		// intialize command buffers
@@ -188,10 +294,11 @@ private:
 		params.transfer = &transfer;
 		params.utilities = m_utils.get();
 
-		for (uint32_t imageIdx = 0; imageIdx < IMAGE_CNT; ++imageIdx)
+		for (uint32_t imageIdx = 0; imageIdx < m_imageCount; ++imageIdx)
 		{
-			const auto imagePathToLoad = imagesToLoad[imageIdx];
-			auto cpuImage = loadFistAssetInBundle<ICPUImage>(imagePathToLoad);
+			const auto imagePathToLoad = imagesToLoad[imageIdx % IMAGE_CNT];
+			SStageTimer decodeTimer(m_stageBusyNs[ES_LOAD]);
+			auto cpuImage = loadFistAssetInBundle<ICPUImage>(imagePathToLoad, m_loadCachingFlags);
 			if (!cpuImage)
 				logFailAndTerminate("Failed to load image from path %s",ILogger::ELL_ERROR,imagePathToLoad);
 
@@ -203,12 +310,14 @@ private:
 			images[imageIdx] = reservation.getGPUObjects<ICPUImage>().front().value;
 			if (!images[imageIdx])
 				logFailAndTerminate("Failed to convert %s into an IGPUImage handle",ILogger::ELL_ERROR,imagePathToLoad);
+			decodeTimer.stop();
 			// notify
 			imageHandlesCreated++;
 			imageHandlesCreated.notify_one();
 
 			// handle not resetting a pending cmdbuf
 			waitForResourceAvailability(m_imagesLoadedSemaphore.get(),imageIdx);
+			SStageTimer uploadTimer(m_stageBusyNs[ES_LOAD]);
 			// debug log about overflows
 			transfer.overflowCallback = [&](const ISemaphore::SWaitInfo&)->void
 			{
@@ -233,6 +342,23 @@ private:
 		}
 	}
 
+	// the load stage of the CPU backend, only decodes and hands the images over to the histogram stage
+	void loadCPUImages()
+	{
+		for (uint32_t imageIdx = 0; imageIdx < m_imageCount; ++imageIdx)
+		{
+			// don't decode further ahead than there are histogram slots, or the whole dataset would end up in memory
+			waitForResourceAvailability(m_imagesProcessedSemaphore.get(), imageIdx);
+
+			SStageTimer timer(m_stageBusyNs[ES_LOAD]);
+			const auto imagePathToLoad = imagesToLoad[imageIdx % IMAGE_CNT];
+			m_cpuImages[imageIdx] = loadFistAssetInBundle<ICPUImage>(imagePathToLoad, m_loadCachingFlags);
+			if (!m_cpuImages[imageIdx])
+				logFailAndTerminate("Failed to load image from path %s", imagePathToLoad);
+			m_imagesLoadedSemaphore->signal(imageIdx + 1);
+		}
+	}
+
 	void calculateHistograms()
 	{
 		// INITIALIZE COMMON DATA
@@ -339,15 +465,14 @@ private:
 
 			auto memoryRange = IDeviceMemoryAllocation::MemoryRange(0, m_histogramBufferAllocation.memory->getAllocationSize());
 
-			m_histogramBufferMemoryRanges[0] = ILogicalDevice::MappedMemoryRange(histogramBuffer->getBoundMemory().memory, 0, HISTOGRAM_BYTE_SIZE);
-			m_histogramBufferMemoryRanges[1] = ILogicalDevice::MappedMemoryRange(histogramBuffer->getBoundMemory().memory, HISTOGRAM_BYTE_SIZE, HISTOGRAM_BYTE_SIZE);
-			m_histogramBufferMemoryRanges[2] = ILogicalDevice::MappedMemoryRange(histogramBuffer->getBoundMemory().memory, HISTOGRAM_BYTE_SIZE * 2, HISTOGRAM_BYTE_SIZE);
-
-			m_histogramBufferMemPtrs[0] = static_cast<uint32_t*>(m_histogramBufferAllocation.memory->map(memoryRange, IDeviceMemoryAllocation::EMCAF_READ_AND_WRITE));
-			if (!m_histogramBufferMemPtrs[0])
+			auto* mappedHistograms = static_cast<uint32_t*>(m_histogramBufferAllocation.memory->map(memoryRange, IDeviceMemoryAllocation::EMCAF_READ_AND_WRITE));
+			if (!mappedHistograms)
 				logFailAndTerminate("Failed to map the Device Memory!\n");
-			m_histogramBufferMemPtrs[1] = m_histogramBufferMemPtrs[0] + HISTOGRAM_SIZE;
-			m_histogramBufferMemPtrs[2] = m_histogramBufferMemPtrs[1] + HISTOGRAM_SIZE;
+			for (uint32_t i = 0u; i < SUBMITS_IN_FLIGHT; ++i)
+			{
+				m_histogramBufferMemoryRanges[i] = ILogicalDevice::MappedMemoryRange(histogramBuffer->getBoundMemory().memory, HISTOGRAM_BYTE_SIZE * i, HISTOGRAM_BYTE_SIZE);
+				m_histogramBufferMemPtrs[i] = mappedHistograms + HISTOGRAM_SIZE * i;
+			}
 		}
 
 		// could have actually put the offset into histogram buffer in the desc set instead of push constants
@@ -364,7 +489,7 @@ private:
 		}
 
 		// PROCESS IMAGES
-		for (uint32_t imageToProcessId = 0; imageToProcessId < IMAGE_CNT; imageToProcessId++)
+		for (uint32_t imageToProcessId = 0; imageToProcessId < m_imageCount; imageToProcessId++)
 		{
 			// UPDATE DESCRIPTOR SET WRITES
 			IGPUDescriptorSet::SDescriptorInfo imgInfo;
@@ -392,6 +517,7 @@ private:
 			auto& commandPool = commandPools[resourceIdx];
 
 			auto isResourceReused = waitForResourceAvailability(m_imagesProcessedSemaphore.get(), imageToProcessId);
+			SStageTimer recordTimer(m_stageBusyNs[ES_HISTOGRAM]);
 			if (isResourceReused)
 				commandPool->reset();
 
@@ -430,6 +556,7 @@ private:
 			submitInfo[0].commandBuffers = cmdBuffSubmitInfo;
 			submitInfo[0].signalSemaphores = signalSemaphoreSubmitInfo;
 			submitInfo[0].waitSemaphores = waitSemaphoreSubmitInfo;
+			recordTimer.stop();
 			// there's no save to wait on, or need to prevent signal-after-submit because Renderdoc freezes because it
 			// starts capturing immediately upon a submit and can't defer a capture till semaphores signal.
 			if (imageToProcessId<SUBMITS_IN_FLIGHT || m_api->isRunningInRenderdoc())
@@ -449,58 +576,95 @@ private:
 		}
 	}
 
-	void saveHistograms()
+	// the histogram stage of the CPU backend, same slots and same semaphores as the GPU one, just signalled from the host
+	void calculateCPUHistograms()
 	{
-		std::array<std::ofstream, IMAGE_CNT> files;
-		for (auto& file : files)
+		const CPUHistogram histogram;
+		for (uint32_t imageToProcessId = 0; imageToProcessId < m_imageCount; imageToProcessId++)
 		{
-			static uint32_t i = 0u;
-			file.open("histogram_" + std::to_string(i++) + ".csv", std::ios::out | std::ios::trunc);
-		}
+			waitForPreviousStep(m_imagesLoadedSemaphore.get(), imageToProcessId + 1);
+			// the slot has to have been read back
+			waitForResourceAvailability(m_histogramSavedSemaphore.get(), imageToProcessId);
 
+			SStageTimer timer(m_stageBusyNs[ES_HISTOGRAM]);
+			const auto resourceIdx = imageToProcessId % SUBMITS_IN_FLIGHT;
+			if (!histogram.accumulate(m_cpuImages[imageToProcessId].get(), m_histogramBufferMemPtrs[resourceIdx]))
+				logFailAndTerminate("Image nr %d has a format the CPU histogram backend can't read", imageToProcessId);
+			m_cpuImages[imageToProcessId] = nullptr;
+			m_imagesProcessedSemaphore->signal(imageToProcessId + 1);
+
+			std::string msg = std::string("Image nr ") + std::to_string(imageToProcessId) + " processed. Resource idx: " + std::to_string(resourceIdx);
+			m_logger->log(msg);
+		}
+	}
 
-		for (uint32_t imageHistogramIdx = 0; imageHistogramIdx < IMAGE_CNT; ++imageHistogramIdx)
+	// copies the histograms out of their slots as soon as they're done and recycles the slots, formatting them is left to the CSV writers
+	void saveHistograms()
+	{
+		for (uint32_t imageHistogramIdx = 0; imageHistogramIdx < m_imageCount; ++imageHistogramIdx)
 		{
 			waitForPreviousStep(m_imagesProcessedSemaphore.get(), imageHistogramIdx + 1);
+			SStageTimer timer(m_stageBusyNs[ES_READBACK]);
 			images[imageHistogramIdx] = nullptr;
 
 			const uint32_t resourceIdx = imageHistogramIdx % SUBMITS_IN_FLIGHT;
 			uint32_t* histogramBuff = m_histogramBufferMemPtrs[resourceIdx];
 
-			if(!m_device->invalidateMappedMemoryRanges(1, &m_histogramBufferMemoryRanges[resourceIdx]))
+			const bool deviceMemory = m_backend == E_HISTOGRAM_BACKEND::GPU;
+			if (deviceMemory && !m_device->invalidateMappedMemoryRanges(1, &m_histogramBufferMemoryRanges[resourceIdx]))
 				logFailAndTerminate("Failed to invalidate the Device Memory!\n");
 
+			std::copy_n(histogramBuff, HISTOGRAM_SIZE, m_savedHistograms.data() + size_t(imageHistogramIdx) * HISTOGRAM_SIZE);
+			std::fill_n(histogramBuff, HISTOGRAM_SIZE, 0u);
+
+			if (deviceMemory && !m_device->flushMappedMemoryRanges(1, &m_histogramBufferMemoryRanges[resourceIdx]))
+				logFailAndTerminate("Failed to flush the Device Memory!\n");
+
+			m_histogramSavedSemaphore->signal(imageHistogramIdx+1);
+			// notify, the histogram stage and the CSV writers might both be waiting
+			histogramsSaved++;
+			histogramsSaved.notify_all();
+			
+			std::string msg = std::string("Image nr ") + std::to_string(imageHistogramIdx) + " saved. Resource idx: " + std::to_string(resourceIdx);
+			m_logger->log(msg);
+		}
+
+		if (m_backend == E_HISTOGRAM_BACKEND::GPU)
+			m_histogramBufferAllocation.memory->unmap();
+	}
+
+	// every writer claims the next histogram, so the CSVs get written in parallel but still roughly in the order they become ready
+	void writeCSVs(const path outputDir)
+	{
+		std::string csv;
+		for (uint32_t imageHistogramIdx = csvsClaimed++; imageHistogramIdx < m_imageCount; imageHistogramIdx = csvsClaimed++)
+		{
+			for (auto old = histogramsSaved.load(); old <= imageHistogramIdx; old = histogramsSaved.load())
+				histogramsSaved.wait(old);
+
+			SStageTimer timer(m_stageBusyNs[ES_CSV]);
+			const uint32_t* histogramBuff = m_savedHistograms.data() + size_t(imageHistogramIdx) * HISTOGRAM_SIZE;
+			csv.clear();
 			size_t offset = 0;
-			auto& file = files[imageHistogramIdx];
 			for (uint32_t i = 0u; i < CHANEL_CNT; ++i)
 			{
 				constexpr const char* channelNames[] = {"RED","GREEN","BLUE"};
-				file << channelNames[i] << ',';
+				csv += channelNames[i];
+				csv += ',';
 				for (uint32_t j = 0u; j < VAL_PER_CHANEL_CNT; ++j)
 				{
-					file << histogramBuff[offset] << ',';
-					histogramBuff[offset] = 0;
-					offset++;
+					char digits[16];
+					const auto result = std::to_chars(digits, digits + sizeof(digits), histogramBuff[offset++]);
+					csv.append(digits, result.ptr);
+					csv += ',';
 				}
 
-				file << '\n';
+				csv += '\n';
 			}
 
-			if(!m_device->flushMappedMemoryRanges(1, &m_histogramBufferMemoryRanges[resourceIdx]))
-				logFailAndTerminate("Failed to flush the Device Memory!\n");
-
-			m_histogramSavedSemaphore->signal(imageHistogramIdx+1);
-			// notify
-			histogramsSaved++;
-			histogramsSaved.notify_one();
-			
-			std::string msg = std::string("Image nr ") + std::to_string(imageHistogramIdx) + " saved. Resource idx: " + std::to_string(resourceIdx);
-			m_logger->log(msg);
+			std::ofstream file(outputDir / ("histogram_" + std::to_string(imageHistogramIdx) + ".csv"), std::ios::out | std::ios::trunc);
+			file.write(csv.data(), csv.size());
 		}
-
-		m_histogramBufferAllocation.memory->unmap();
-		for (auto& file : files)
-			file.close();
 	}
 
 	inline void waitForPreviousStep(ISemaphore* semaphore, uint32_t waitVal)
@@ -538,9 +702,9 @@ private:
 	}
 
 	template<typename AssetType>
-	core::smart_refctd_ptr<AssetType> loadFistAssetInBundle(const std::string& path)
+	core::smart_refctd_ptr<AssetType> loadFistAssetInBundle(const std::string& path, const IAssetLoader::E_CACHING_FLAGS cachingFlags = IAssetLoader::ECF_CACHE_EVERYTHING)
 	{
-		IAssetLoader::SAssetLoadParams lp;
+		IAssetLoader::SAssetLoadParams lp(0ull, nullptr, cachingFlags);
 		SAssetBundle bundle = m_assetMgr->getAsset(path, lp);
 		if (bundle.getContents().empty())
 			logFailAndTerminate("Couldn't load an asset.",ILogger::ELL_ERROR);
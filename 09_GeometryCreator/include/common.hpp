@@ -15,6 +15,8 @@
 #include "geometry/creator/spirv/builtin/builtinResources.h"
 
 #include "CGeomtryCreatorScene.hpp"
+#include "CMeshletBuilder.hpp"
+#include "CMeshSimplifier.hpp"
 
 using namespace nbl;
 using namespace core;
@@ -217,7 +217,9 @@ class GeometryCreatorApp final : public examples::SimpleWindowedApplication
 			//using Builder = typename CScene::CreateResourcesDirectlyWithDevice::Builder;
 			using Builder = typename CScene::CreateResourcesWithAssetConverter::Builder;
 			auto oneRunCmd = CScene::createCommandBuffer(m_utils->getLogicalDevice(), m_utils->getLogger(), gQueue->getFamilyIndex());
-			Builder builder(m_utils.get(), oneRunCmd.get(), m_logger.get(), geometry);
+			const bool optimizeMeshes = std::find(argv.begin(), argv.end(), "-no_mesh_optimization") == argv.end();
+			const bool optimizeOverdraw = std::find(argv.begin(), argv.end(), "-optimize_overdraw") != argv.end();
+			Builder builder(m_utils.get(), oneRunCmd.get(), m_logger.get(), geometry, optimizeMeshes, optimizeOverdraw);
 
 			// gpu resources
 			if (builder.build())
@@ -228,6 +230,13 @@ class GeometryCreatorApp final : public examples::SimpleWindowedApplication
 			else
 				m_logger->log("Could not build resource objects!", ILogger::ELL_ERROR);
 
+			if (std::find(argv.begin(), argv.end(), "-mesh_optimizer_benchmark") != argv.end())
+				runMeshOptimizerBenchmark(geometry);
+			if (std::find(argv.begin(), argv.end(), "-meshlet_benchmark") != argv.end())
+				runMeshletBenchmark(geometry);
+			if (std::find(argv.begin(), argv.end(), "-lod_benchmark") != argv.end())
+				runLoDBenchmark(geometry);
+
 			// camera
 			{
 				core::vectorSIMDf cameraPosition(-5.81655884, 2.58630896, -4.23974705);
@@ -455,6 +464,151 @@ class GeometryCreatorApp final : public examples::SimpleWindowedApplication
 			return device_base_t::onAppTerminated();
 		}
 
+		// times every optimizer stage on a ~2M triangle sphere, once on one thread and once on all of them
+		void runMeshOptimizerBenchmark(const IGeometryCreator* geometry)
+		{
+			using optimizer_t = examples::CMeshOptimizer;
+
+			const auto sphere = geometry->createSphereMesh(2.f, 1024u, 1024u);
+			const auto& vertexBinding = sphere.bindings[0];
+			const uint32_t vertexStride = sphere.inputParams.bindings[0].stride;
+			const uint32_t vertexCount = static_cast<uint32_t>((vertexBinding.buffer->getSize() - vertexBinding.offset) / vertexStride);
+			const auto* indexData = reinterpret_cast<const uint8_t*>(sphere.indexBuffer.buffer->getPointer()) + sphere.indexBuffer.offset;
+
+			std::vector<uint32_t> originalIndices(sphere.indexCount);
+			if (sphere.indexType == EIT_16BIT)
+				std::copy_n(reinterpret_cast<const uint16_t*>(indexData), originalIndices.size(), originalIndices.begin());
+			else
+				std::copy_n(reinterpret_cast<const uint32_t*>(indexData), originalIndices.size(), originalIndices.begin());
+			const auto before = optimizer_t::analyzeVertexCache(originalIndices, vertexCount);
+
+			auto run = [&](const uint32_t workerCount) -> void
+			{
+				auto indices = originalIndices;
+				std::vector<uint8_t> vertices(size_t(vertexCount) * vertexStride);
+				memcpy(vertices.data(), reinterpret_cast<const uint8_t*>(vertexBinding.buffer->getPointer()) + vertexBinding.offset, vertices.size());
+
+				auto elapsedMs = [](const clock_t::time_point since) { return std::chrono::duration<double, std::milli>(clock_t::now() - since).count(); };
+				auto start = clock_t::now();
+				const auto clusters = optimizer_t::optimizeVertexCache(indices, vertexCount, { .workerCount = workerCount });
+				const double cacheTime = elapsedMs(start);
+				start = clock_t::now();
+				optimizer_t::optimizeOverdraw(indices, clusters, vertices.data() + sphere.inputParams.attributes[0].relativeOffset, vertexStride);
+				const double overdrawTime = elapsedMs(start);
+				start = clock_t::now();
+				const auto remap = optimizer_t::optimizeVertexFetch(indices, vertexCount, workerCount);
+				optimizer_t::remapVertices(vertices.data(), vertexStride, remap, workerCount);
+				const double fetchTime = elapsedMs(start);
+
+				const auto after = optimizer_t::analyzeVertexCache(indices, vertexCount);
+				m_logger->log("Mesh optimizer, %d triangles on %d threads: vertex cache %f ms, overdraw %f ms, vertex fetch %f ms. ACMR %f -> %f, ATVR %f -> %f", ILogger::ELL_PERFORMANCE,
+					static_cast<uint32_t>(indices.size() / 3), workerCount, cacheTime, overdrawTime, fetchTime, before.acmr, after.acmr, before.atvr, after.atvr);
+			};
+			run(1u);
+			run(examples::getDefaultWorkerCount());
+		}
+
+		// clusters the same ~2M triangle sphere for mesh shading and cluster culling, after vertex cache optimization like a real asset pipeline would
+		void runMeshletBenchmark(const IGeometryCreator* geometry)
+		{
+			using builder_t = examples::CMeshletBuilder;
+
+			const auto sphere = geometry->createSphereMesh(2.f, 1024u, 1024u);
+			const auto& vertexBinding = sphere.bindings[0];
+			const uint32_t vertexStride = sphere.inputParams.bindings[0].stride;
+			const uint32_t vertexCount = static_cast<uint32_t>((vertexBinding.buffer->getSize() - vertexBinding.offset) / vertexStride);
+			const auto* positions = reinterpret_cast<const uint8_t*>(vertexBinding.buffer->getPointer()) + vertexBinding.offset + sphere.inputParams.attributes[0].relativeOffset;
+			const auto* indexData = reinterpret_cast<const uint8_t*>(sphere.indexBuffer.buffer->getPointer()) + sphere.indexBuffer.offset;
+
+			std::vector<uint32_t> indices(sphere.indexCount);
+			if (sphere.indexType == EIT_16BIT)
+				std::copy_n(reinterpret_cast<const uint16_t*>(indexData), indices.size(), indices.begin());
+			else
+				std::copy_n(reinterpret_cast<const uint32_t*>(indexData), indices.size(), indices.begin());
+			examples::CMeshOptimizer::optimizeVertexCache(indices, vertexCount);
+
+			auto run = [&](const uint32_t workerCount) -> void
+			{
+				const auto start = clock_t::now();
+				const auto meshlets = builder_t::build(indices, positions, vertexStride, vertexCount, { .workerCount = workerCount });
+				const double seconds = std::chrono::duration<double>(clock_t::now() - start).count();
+
+				// what a cluster culling pass would get rid of from the default camera position without even looking at the frustum
+				const float cameraPosition[3] = { -5.81655884f, 2.58630896f, -4.23974705f };
+				uint32_t backfacing = 0u;
+				for (const auto& bounds : meshlets.bounds)
+				if (builder_t::isBackfacing(bounds, cameraPosition))
+					backfacing++;
+
+				const uint32_t clusterCount = static_cast<uint32_t>(meshlets.meshlets.size());
+				m_logger->log("Meshlet builder, %d triangles on %d threads: %d clusters in %f ms (%f clusters/s), %f vertices and %f triangles per cluster, %d backfacing clusters", ILogger::ELL_PERFORMANCE,
+					static_cast<uint32_t>(indices.size() / 3), workerCount, clusterCount, seconds * 1000.0, double(clusterCount) / seconds,
+					double(meshlets.vertices.size()) / clusterCount, double(meshlets.triangles.size()) / clusterCount, backfacing);
+			};
+			run(1u);
+			run(examples::getDefaultWorkerCount());
+		}
+
+		// Generates LoD chains for every geometry creator mesh plus a dense sphere through the on-disk cache in `localOutputCWD`,
+		// run it twice to see the second run load everything instead of simplifying.
+		void runLoDBenchmark(const IGeometryCreator* geometry)
+		{
+			using simplifier_t = examples::CMeshSimplifier;
+
+			const IGeometryCreator::return_type sources[] = {
+				geometry->createCubeMesh(nbl::core::vector3df(1.f, 1.f, 1.f)),
+				geometry->createSphereMesh(2, 16, 16),
+				geometry->createCylinderMesh(2, 2, 20),
+				geometry->createDiskMesh(2, 30),
+				geometry->createArrowMesh(),
+				geometry->createConeMesh(2, 3, 10),
+				geometry->createIcoSphere(1, 3, true),
+				geometry->createSphereMesh(2.f, 512u, 512u)
+			};
+			constexpr uint32_t MeshCount = sizeof(sources) / sizeof(sources[0]);
+
+			// the simplifier wants 32 bit triangle lists, the positions get used in place
+			std::array<std::vector<uint32_t>, MeshCount> indices;
+			std::vector<simplifier_t::SMesh> meshes;
+			for (uint32_t i = 0u; i < MeshCount; i++)
+			{
+				const auto& source = sources[i];
+				if (source.assemblyParams.primitiveType != EPT_TRIANGLE_LIST || source.indexType == EIT_UNKNOWN)
+					continue;
+				const auto* indexData = reinterpret_cast<const uint8_t*>(source.indexBuffer.buffer->getPointer()) + source.indexBuffer.offset;
+				indices[i].resize(source.indexCount);
+				if (source.indexType == EIT_16BIT)
+					std::copy_n(reinterpret_cast<const uint16_t*>(indexData), source.indexCount, indices[i].begin());
+				else
+					std::copy_n(reinterpret_cast<const uint32_t*>(indexData), source.indexCount, indices[i].begin());
+
+				const auto& vertexBinding = source.bindings[0];
+				const uint32_t vertexStride = source.inputParams.bindings[0].stride;
+				meshes.push_back({
+					.indices = indices[i],
+					.positions = reinterpret_cast<const uint8_t*>(vertexBinding.buffer->getPointer()) + vertexBinding.offset + source.inputParams.attributes[0].relativeOffset,
+					.positionStride = vertexStride,
+					.vertexCount = static_cast<uint32_t>((vertexBinding.buffer->getSize() - vertexBinding.offset) / vertexStride)
+				});
+			}
+
+			const simplifier_t::CChainCache cache(localOutputCWD / "lod_cache");
+			const simplifier_t::SChainParams params = {};
+			uint32_t hits = 0u;
+			const auto start = clock_t::now();
+			const auto chains = cache.getOrBuild(meshes, params, examples::getDefaultWorkerCount(), &hits);
+			const double elapsedMs = std::chrono::duration<double, std::milli>(clock_t::now() - start).count();
+			m_logger->log("LoD chains for %d meshes in %f ms, %d loaded from the cache", ILogger::ELL_PERFORMANCE, static_cast<uint32_t>(meshes.size()), elapsedMs, hits);
+
+			const auto& denseChain = chains.back();
+			for (uint32_t level = 0u; level < denseChain.size(); level++)
+				m_logger->log("Dense sphere LoD %d: %d triangles, error %f", ILogger::ELL_INFO, level, static_cast<uint32_t>(denseChain[level].indices.size() / 3), denseChain[level].error);
+			// same 60 degree vertical FOV as the camera, allowing one pixel of error
+			const float pixelsPerUnit = float(WIN_H) * 0.5f / std::tan(core::radians(60.0f) * 0.5f);
+			for (const float distance : { 2.f, 10.f, 50.f, 250.f })
+				m_logger->log("Dense sphere at distance %f selects LoD %d", ILogger::ELL_INFO, distance, simplifier_t::selectLevel(denseChain, distance, pixelsPerUnit, 1.f));
+		}
+
 	private:
 		smart_refctd_ptr<IWindow> m_window;
 		smart_refctd_ptr<CSimpleResizeSurface<CSwapchainFramebuffersAndDepth>> m_surface;
@@ -1,6 +1,7 @@
 #include "nbl/application_templates/MonoDeviceApplication.hpp"
 #include "nbl/application_templates/MonoAssetManagerAndBuiltinResourceApplication.hpp"
 #include "CommonPCH/PCH.hpp"
+#include "CShaderVariantArchive.hpp"
 
 using namespace nbl;
 using namespace core;
@@ -37,7 +38,15 @@ class CountingSortApp final : public application_templates::MonoDeviceApplicatio
 			const uint32_t bucket_count = std::min((uint32_t)3000, MaxBucketCount);
 			const uint32_t elements_per_thread = ceil((float)ceil((float)element_count / limits.computeUnits) / WorkgroupSize);
 
-			auto prepShader = [&](const core::string& path) -> smart_refctd_ptr<IGPUShader>
+			// variants precompiled by `71_ShaderVariantPrecompiler`, only usable if the device can consume the SPIR-V version they were compiled for
+			auto variantArchive = nbl::examples::CShaderVariantArchive::open(m_system.get(),sharedOutputCWD/"shader_variants.nsva");
+			if (variantArchive && variantArchive->getSpirvVersion()>limits.spirvVersion)
+				variantArchive = nullptr;
+			const std::string WorkgroupSizeStr = std::to_string(WorkgroupSize);
+			const std::string BucketCountStr = std::to_string(bucket_count);
+			const nbl::examples::CShaderVariantArchive::SDefine variantDefines[] = {{"WorkgroupSize",WorkgroupSizeStr},{"BucketCount",BucketCountStr}};
+
+			auto prepShader = [&](const core::string& variantName, const core::string& path) -> smart_refctd_ptr<IGPUShader>
 			{
 				// this time we load a shader directly from a file
 				IAssetLoader::SAssetLoadParams lp = {};
@@ -54,6 +63,30 @@ class CountingSortApp final : public application_templates::MonoDeviceApplicatio
 				auto source = IAsset::castDown<ICPUShader>(assets[0]);
 				// The down-cast should not fail!
 				assert(source);
+
+				// a precompiled variant is only good if it got compiled from what the shader and its includes say now, so preprocess the same way the precompiler does
+				if (variantArchive)
+				{
+					const auto* compiler = m_assetMgr->getCompilerSet()->getShaderCompiler(source->getContentType());
+					const IShaderCompiler::SMacroDefinition macros[] = {{"WorkgroupSize",WorkgroupSizeStr},{"BucketCount",BucketCountStr}};
+					IShaderCompiler::SCompilerOptions options = {};
+					options.stage = IShader::E_SHADER_STAGE::ESS_COMPUTE;
+					options.targetSpirvVersion = variantArchive->getSpirvVersion();
+					options.preprocessorOptions.sourceIdentifier = path;
+					options.preprocessorOptions.logger = m_logger.get();
+					options.preprocessorOptions.includeFinder = compiler->getDefaultIncludeFinder();
+					options.preprocessorOptions.extraDefines = macros;
+					const auto sourceHash = nbl::examples::CShaderVariantArchive::computeSourceHash(compiler,reinterpret_cast<const char*>(source->getContent()->getPointer()),options);
+					bool stale = false;
+					if (sourceHash)
+					if (auto spirv=variantArchive->find(variantName,variantDefines,*sourceHash,&stale); spirv)
+					{
+						m_logger->log("Using precompiled variant of %s",ILogger::ELL_INFO,variantName.c_str());
+						return m_device->createShader(spirv.get());
+					}
+					if (stale)
+						m_logger->log("Precompiled variant of %s is out of date, compiling it instead, rerun 71_ShaderVariantPrecompiler",ILogger::ELL_WARNING,variantName.c_str());
+				}
 			
 				// There's two ways of doing stuff like this:
 				// 1. this - modifying the asset after load
@@ -72,8 +105,8 @@ class CountingSortApp final : public application_templates::MonoDeviceApplicatio
 				}
 				return shader;
 			};
-			auto prefixSumShader = prepShader("app_resources/prefix_sum_shader.comp.hlsl");
-			auto scatterShader = prepShader("app_resources/scatter_shader.comp.hlsl");
+			auto prefixSumShader = prepShader("10_CountingSort/prefix_sum","app_resources/prefix_sum_shader.comp.hlsl");
+			auto scatterShader = prepShader("10_CountingSort/scatter","app_resources/scatter_shader.comp.hlsl");
 
 			// People love Reflection but I prefer Shader Sources instead!
 			const nbl::asset::SPushConstantRange pcRange = { .stageFlags = IShader::E_SHADER_STAGE::ESS_COMPUTE,.offset = 0,.size = sizeof(CountingPushData) };
@@ -19,6 +19,8 @@ using namespace video;
 #include "nbl/builtin/hlsl/bit.hlsl"
 #include "nbl/builtin/hlsl/random/xoroshiro.hlsl"
 
+#include "CCPUFFT.hpp"
+
 
 // Simple showcase of how to run FFT on a 1D array
 class FFT_Test final : public application_templates::MonoDeviceApplication, public application_templates::MonoAssetManagerAndBuiltinResourceApplication
@@ -46,6 +48,11 @@ class FFT_Test final : public application_templates::MonoDeviceApplication, publ
 	smart_refctd_ptr<ISemaphore> m_timeline;
 	uint64_t semaphorValue = 0;
 
+	// FFT followed by IFFT should give back the input, the GPU and CPU roundtrips may only differ by this much relative to the largest input magnitude
+	constexpr static inline scalar_t MaxAbsErrorTolerance = 1e-4f;
+	// set by the download consumer, so whenever the GPU result came back
+	bool m_gpuMatchesCPU = true;
+
 	inline core::smart_refctd_ptr<video::IGPUShader> createShader(
 		const char* includeMainName)
 	{
@@ -55,6 +62,42 @@ class FFT_Test final : public application_templates::MonoDeviceApplication, publ
 		return m_device->createShader(CPUShader.get());
 	}
 
+	// Same batched engine 28_FFTBloom and 39_DenoiserTonemapper can fall back to, we use it to get a throughput baseline (pass `--cpu-benchmark`)
+	void runCPUBenchmark()
+	{
+		using cpu_fft_t = examples::fft::CCPUFFT<scalar_t>;
+		cpu_fft_t cpuFFT;
+
+		struct SCase
+		{
+			const char* name;
+			typename cpu_fft_t::SDimensions dims;
+			uint32_t batchCount;
+		};
+		const SCase cases[] = {
+			{"1D 512 (workgroup size) x 16384",{{WorkgroupSizeLog2+ElementsPerThreadLog2,0u,0u}},16384u},
+			{"1D 65536 x 64",{{16u,0u,0u}},64u},
+			{"2D 1024x1024 x 4",{{10u,10u,0u}},4u},
+			{"3D 128x128x128",{{7u,7u,7u}},1u}
+		};
+		for (const auto& testCase : cases)
+		{
+			core::vector<scalar_t> data(testCase.dims.elementCount()*testCase.batchCount*2ull,scalar_t(1));
+			// warm up the twiddle cache and the per-worker scratch, we only want to time the transforms
+			cpuFFT.forward(data.data(),testCase.dims,testCase.batchCount);
+			constexpr uint32_t Iterations = 4u;
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i=0u; i<Iterations; i++)
+			{
+				cpuFFT.forward(data.data(),testCase.dims,testCase.batchCount);
+				cpuFFT.inverse(data.data(),testCase.dims,testCase.batchCount);
+			}
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+			const double gflops = 2.0*Iterations*cpu_fft_t::flopCount(testCase.dims,testCase.batchCount)/seconds*1e-9;
+			m_logger->log("CPU FFT %s on %u threads: %f GFLOPS",ILogger::ELL_PERFORMANCE,testCase.name,cpuFFT.getWorkerCount(),gflops);
+		}
+	}
+
 public:
 	// Yay thanks to multiple inheritance we cannot forward ctors anymore
 	FFT_Test(const path& _localInputCWD, const path& _localOutputCWD, const path& _sharedInputCWD, const path& _sharedOutputCWD) :
@@ -172,6 +215,7 @@ public:
 		m_upStreamingBuffer->multi_allocate(waitTill, AllocationCount, &inputOffset, &inputSize, &m_alignment);
 
 		// Generate our data in-place on the allocated staging buffer. Packing is interleaved in this example!
+		core::vector<scalar_t> cpuReference;
 		{
 			auto* const inputPtr = reinterpret_cast<scalar_t*>(reinterpret_cast<uint8_t*>(m_upStreamingBuffer->getBufferPointer()) + inputOffset);
 			std::cout << "Begin array CPU\n";
@@ -200,6 +244,15 @@ public:
 				std::cout << "(" << x << ", " << y << "), ";
 			}
 			std::cout << "\nEnd array CPU\n";
+
+			// Run the same FFT followed by IFFT on the CPU to check the GPU result against
+			cpuReference.assign(inputPtr,inputPtr+scalarElementCount);
+			{
+				examples::fft::CCPUFFT<scalar_t> cpuFFT(1u);
+				const decltype(cpuFFT)::SDimensions dims = {{WorkgroupSizeLog2+ElementsPerThreadLog2,0u,0u}};
+				cpuFFT.forward(cpuReference.data(),dims);
+				cpuFFT.inverse(cpuReference.data(),dims);
+			}
 			// Always remember to flush!
 			if (m_upStreamingBuffer->needsManualFlushOrInvalidate())
 			{
@@ -290,7 +343,7 @@ public:
 		auto latchedConsumer = make_smart_refctd_ptr<IUtilities::CDownstreamingDataConsumer>(
 			IDeviceMemoryAllocation::MemoryRange(outputOffset, outputSize),
 			// Note the use of capture by-value [=] and not by-reference [&] because this lambda will be called asynchronously whenever the event signals
-			[=](const size_t dstOffset, const void* bufSrc, const size_t size)->void
+			[=,this,cpuReference=std::move(cpuReference)](const size_t dstOffset, const void* bufSrc, const size_t size)->void
 			{
 				// The unused variable is used for letting the consumer know the subsection of the output we've managed to download
 				// But here we're sure we can get the whole thing in one go because we allocated the whole range ourselves.
@@ -303,6 +356,20 @@ public:
 				}
 
 				std::cout << "\nEnd array GPU\n";
+
+				scalar_t maxError = 0;
+				scalar_t maxMagnitude = 1;
+				for (auto i=0u; i<2*complexElementCount; i++)
+				{
+					maxError = core::max<scalar_t>(maxError,std::abs(data[i]-cpuReference[i]));
+					maxMagnitude = core::max<scalar_t>(maxMagnitude,std::abs(cpuReference[i]));
+				}
+				std::cout << "Max abs difference between GPU and CPU: " << maxError << "\n";
+				if (!(maxError<=MaxAbsErrorTolerance*maxMagnitude))
+				{
+					m_logger->log("GPU FFT result differs from the CPU reference by %f, more than the tolerance of %f!",ILogger::ELL_ERROR,maxError,MaxAbsErrorTolerance*maxMagnitude);
+					m_gpuMatchesCPU = false;
+				}
 			},
 			// Its also necessary to hold onto the commandbuffer, even though we take care to not reset the parent pool, because if it
 			// hits its destructor, our automated reference counting will drop all references to objects used in the recorded commands.
@@ -312,6 +379,10 @@ public:
 		// We put a function we want to execute 
 		m_downStreamingBuffer->multi_deallocate(AllocationCount, &outputOffset, &outputSize, futureWait, &latchedConsumer.get());
 
+		// takes a while and has nothing to do with the GPU result, so only on demand
+		if (std::find(argv.begin(),argv.end(),"--cpu-benchmark")!=argv.end())
+			runCPUBenchmark();
+
 		return true;
 	}
 
@@ -327,7 +398,8 @@ public:
 		// Need to make sure that there are no events outstanding if we want all lambdas to eventually execute before `onAppTerminated`
 		// (the destructors of the Command Pool Cache and Streaming buffers will still wait for all lambda events to drain)
 		while (m_downStreamingBuffer->cull_frees()) {}
-		return device_base_t::onAppTerminated();
+		// the GPU and CPU mismatching is a failure of the whole run
+		return device_base_t::onAppTerminated() && m_gpuMatchesCPU;
 	}
 };
 
@@ -270,12 +270,17 @@ int main(int argc, char** argv)
 		
 		asset::CQuantNormalCache* qnc = am->getMeshManipulator()->getQuantNormalCache();
 
+		// warm when a previous run already left its quantized normals behind, so the per scene timings of `test_scenes.txt` runs can be compared
+		const bool warmLoad = std::filesystem::exists("../../tmp/normalCache101010.sse");
+		const auto loadStart = std::chrono::steady_clock::now();
 		//! read cache results -- speeds up mesh generation
 		qnc->loadCacheFromFile<asset::EF_A2B10G10R10_SNORM_PACK32>(fs, "../../tmp/normalCache101010.sse");
 		//! load the mitsuba scene
 		meshes = am->getAsset(filePath, {});
 		//! cache results -- speeds up mesh generation on second run
 		qnc->saveCacheToFile<asset::EF_A2B10G10R10_SNORM_PACK32>(fs, "../../tmp/normalCache101010.sse");
+		const double loadMilliseconds = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-loadStart).count();
+		std::cout << "Scene load took " << loadMilliseconds << " ms (" << (warmLoad ? "warm":"cold") << ")" << std::endl;
 		
 		auto contents = meshes.getContents();
 		if (!contents.size()) {
@@ -0,0 +1,218 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_C_WHITTED_TASK_CPU_HPP_INCLUDED_
+#define _NBL_EXAMPLES_C_WHITTED_TASK_CPU_HPP_INCLUDED_
+
+#include "nbl/builtin/hlsl/cpp_compat.hlsl"
+#include "CWorkStealingScheduler.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace nbl::examples
+{
+
+// Line by line port of `WhittedTask::__impl_call` from `app_resources/shader.comp.hlsl`, that one can't be compiled as C++ as-is
+// (HLSL `this` is a value, `groupshared` scheduler, `RWTexture2D` output). Keep the two in sync!
+// Differences: full precision throughput and contribution instead of `float16_t3`, an uncompressed ray direction instead of octahedral.
+struct SWhittedTaskCPU
+{
+	using float32_t3 = hlsl::float32_t3;
+
+	static constexpr inline uint32_t MaxDepth = (1<<5)-1;
+
+	// RGB9E5 CAS loops are a GPU thing, over here we can just have float atomics
+	struct SFramebuffer
+	{
+		SFramebuffer(const uint32_t _width, const uint32_t _height) : width(_width), height(_height), texels(size_t(_width)*_height*3u) {}
+
+		inline void add(const uint32_t x, const uint32_t y, const float32_t3 value)
+		{
+			std::atomic<float>* texel = texels.data()+(size_t(y)*width+x)*3u;
+			texel[0].fetch_add(value.x,std::memory_order_relaxed);
+			texel[1].fetch_add(value.y,std::memory_order_relaxed);
+			texel[2].fetch_add(value.z,std::memory_order_relaxed);
+		}
+
+		uint32_t width, height;
+		std::vector<std::atomic<float>> texels;
+	};
+
+	enum E_MATERIAL : uint32_t
+	{
+		EM_EMISSION = 0,
+		EM_METAL,
+		EM_GLASS
+	};
+	struct SSphere
+	{
+		inline float intersect(const float32_t3 rayOrigin, const float32_t3 rayDir) const
+		{
+			const float32_t3 relOrigin = rayOrigin-position;
+			const float relOriginLen2 = dot(relOrigin,relOrigin);
+
+			const float dirDotRelOrigin = dot(rayDir,relOrigin);
+			const float det = radius2-relOriginLen2+dirDotRelOrigin*dirDotRelOrigin;
+
+			// do some speculative math here, NaN on a miss fails every comparison the caller does
+			const float detsqrt = std::sqrt(det);
+			return -dirDotRelOrigin+(relOriginLen2>radius2 ? (-detsqrt):detsqrt);
+		}
+
+		float32_t3 position;
+		float radius2;
+		float32_t3 color;
+		E_MATERIAL material;
+	};
+	static constexpr inline uint32_t SphereCount = 5;
+	static inline const SSphere Spheres[SphereCount] = {
+		{float32_t3(0,5,0),0.5f,float32_t3(1,0,0),EM_EMISSION},
+		{float32_t3(-1,1,0),0.6f,float32_t3(1,1,0),EM_METAL},
+		{float32_t3(1,1,0),0.8f,float32_t3(0,1,1),EM_METAL},
+		// Glass balls need to be monochromatic, cause the GPU task payload has no RGB
+		{float32_t3(-2,3,0),0.7f,float32_t3(1,1,1),EM_GLASS},
+		{float32_t3(2,3,0),0.7f,float32_t3(0,511.f/1023.f,0),EM_GLASS}
+	};
+
+	// same as the GPU `main`, one primary ray per pixel
+	static inline SWhittedTaskCPU createPrimary(SFramebuffer* framebuffer, const uint32_t x, const uint32_t y)
+	{
+		SWhittedTaskCPU task = {};
+		task.framebuffer = framebuffer;
+		task.origin = float32_t3(0,2.5,6);
+		task.throughput = float32_t3(1,1,1);
+		task.contribution = float32_t3(0,0,0);
+		task.outputX = x;
+		task.outputY = y;
+		{
+			const float totalX = float(framebuffer->width);
+			const float totalY = float(framebuffer->height);
+			float32_t3 ndc;
+			ndc.x = float(x)*2.f/totalX-1.f+1.f/totalX;
+			ndc.y = float(y)*-2.f/totalY+1.f+1.f/totalY;
+			ndc.y *= totalY/totalX; // aspect ratio
+			ndc.z = -1.f; // FOV of 90 degrees
+			task.setRayDir(ndc);
+		}
+		task.depth = 0;
+		return task;
+	}
+
+	inline void setRayDir(const float32_t3 _dir) {dir = _dir*(1.f/std::sqrt(dot(_dir,_dir)));}
+	inline float32_t3 getRayDir() const {return dir;}
+
+	// `Scheduler` is `CWorkStealingScheduler<SWhittedTaskCPU>::CWorker`, templated because this type is incomplete here
+	template<class Scheduler>
+	inline void operator()(Scheduler& scheduler) const
+	{
+		const float32_t3 rayDir = getRayDir();
+
+		// intersect with spheres
+		uint32_t closestIx = SphereCount;
+		const float NoHit = std::numeric_limits<float>::infinity();
+		float closestD = NoHit;
+		if (depth<MaxDepth)
+		for (uint32_t i=0; i<SphereCount; i++)
+		{
+			const float d = Spheres[i].intersect(origin,rayDir);
+			if (d>0 && d<closestD)
+			{
+				closestIx = i;
+				closestD = d;
+			}
+		}
+
+		float32_t3 newContribution = contribution;
+		if (closestD<NoHit)
+		{
+			const SSphere& sphere = Spheres[closestIx];
+			const float32_t3 color = sphere.color;
+			if (sphere.material!=EM_EMISSION)
+			{
+				const float32_t3 hitPoint = origin+rayDir*closestD;
+				const float32_t3 normal = (hitPoint-sphere.position)*(1.f/std::sqrt(sphere.radius2));
+				const float NdotV = dot(-rayDir,normal);
+				float orientedEta, rcpOrientedEta;
+				const bool backside = getOrientedEtas(orientedEta,rcpOrientedEta,NdotV,1.333f);
+
+				const bool isGlass = sphere.material==EM_GLASS;
+				SWhittedTaskCPU newTask = *this;
+				newTask.depth++;
+				newTask.origin = hitPoint+normal*0.0001f;
+
+				// deal with reflection
+				float32_t3 newThroughput = throughput;
+				// fresnel
+				if (isGlass)
+				{
+					const float fresnel = fresnelDielectricCommon(orientedEta*orientedEta,std::abs(NdotV));
+					newThroughput *= fresnel;
+				}
+				// push reflection ray
+				{
+					const float32_t3 reflected = 2.f*normal+rayDir;
+
+					newTask.throughput = newThroughput;
+					if (!isGlass)
+						newTask.throughput *= color;
+					newTask.setRayDir(reflected);
+					scheduler.push(newTask);
+				}
+				// refraction is disabled on the GPU too
+				(void)backside;
+				(void)rcpOrientedEta;
+				// we'll keep counting up the contribution
+				return;
+			}
+			else
+				newContribution += throughput*color;
+		}
+		else // miss
+			newContribution += throughput*(rayDir.y<0.f ? float32_t3(0.1f,0.7f,0.03f):float32_t3(0.05f,0.25f,1.0f));
+
+		if (newContribution.x+newContribution.y+newContribution.z<1.f/2047.f)
+			return;
+		framebuffer->add(outputX,outputY,newContribution);
+	}
+
+	SFramebuffer* framebuffer;
+	float32_t3 origin;
+	float32_t3 dir;
+	float32_t3 throughput;
+	float32_t3 contribution;
+	uint32_t outputX : 14;
+	uint32_t outputY : 13;
+	uint32_t depth : 5;
+
+private:
+	static inline float dot(const float32_t3 a, const float32_t3 b) {return a.x*b.x+a.y*b.y+a.z*b.z;}
+
+	static inline bool getOrientedEtas(float& orientedEta, float& rcpOrientedEta, const float NdotI, const float eta)
+	{
+		const bool backside = NdotI<0.0;
+		const float rcpEta = 1.0/eta;
+		orientedEta = backside ? rcpEta:eta;
+		rcpOrientedEta = backside ? eta:rcpEta;
+		return backside;
+	}
+	static inline float fresnelDielectricCommon(const float orientedEta2, const float AbsCosTheta)
+	{
+		const float SinTheta2 = 1.0-AbsCosTheta*AbsCosTheta;
+
+		// the max() clamping can handle TIR when orientedEta2<1.0
+		const float t0 = std::sqrt(std::max(orientedEta2-SinTheta2,0.f));
+		const float rs = (AbsCosTheta-t0)/(AbsCosTheta+t0);
+
+		const float t2 = orientedEta2*AbsCosTheta;
+		const float rp = (t0-t2)/(t0+t2);
+
+		return (rs*rs+rp*rp)*0.5;
+	}
+};
+using whitted_scheduler_t = CWorkStealingScheduler<SWhittedTaskCPU>;
+
+}
+
+#endif
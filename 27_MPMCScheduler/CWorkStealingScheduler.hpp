@@ -0,0 +1,374 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_C_WORK_STEALING_SCHEDULER_HPP_INCLUDED_
+#define _NBL_EXAMPLES_C_WORK_STEALING_SCHEDULER_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace nbl::examples
+{
+
+// Chase-Lev deque without growth: the owner pushes and pops at the bottom, thieves take from the top.
+// Payloads are copied in and out of plain slots, a thief that loses the CAS just throws its copy away.
+template<typename T, uint32_t CapacityLog2>
+class CBoundedWorkStealingDeque
+{
+		static_assert(std::is_trivially_copyable_v<T>);
+	public:
+		constexpr static inline int64_t Capacity = 0x1ll<<CapacityLog2;
+
+		// owner only, returns false when full
+		inline bool push(const T& val)
+		{
+			const int64_t b = m_bottom.load(std::memory_order_relaxed);
+			const int64_t t = m_top.load(std::memory_order_acquire);
+			if (b-t>=Capacity)
+				return false;
+			m_storage[b&(Capacity-1)] = val;
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(b+1,std::memory_order_relaxed);
+			return true;
+		}
+
+		// owner only, LIFO so the task that was just spawned runs while its data is hot
+		inline bool pop(T& out)
+		{
+			const int64_t b = m_bottom.load(std::memory_order_relaxed)-1;
+			m_bottom.store(b,std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = m_top.load(std::memory_order_relaxed);
+			if (t>b)
+			{
+				m_bottom.store(b+1,std::memory_order_relaxed);
+				return false;
+			}
+			out = m_storage[b&(Capacity-1)];
+			if (t==b) // last element, race the thieves for it
+			{
+				const bool won = m_top.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,std::memory_order_relaxed);
+				m_bottom.store(b+1,std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		// anyone, FIFO so thieves take the oldest (usually biggest) piece of work
+		inline bool steal(T& out)
+		{
+			int64_t t = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t b = m_bottom.load(std::memory_order_acquire);
+			if (t>=b)
+				return false;
+			const T tmp = m_storage[t&(Capacity-1)];
+			if (!m_top.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,std::memory_order_relaxed))
+				return false;
+			out = tmp;
+			return true;
+		}
+
+		// only approximate when called concurrently with thieves
+		inline int64_t size() const
+		{
+			return std::max<int64_t>(m_bottom.load(std::memory_order_relaxed)-m_top.load(std::memory_order_relaxed),0);
+		}
+
+	private:
+		alignas(64) std::atomic<int64_t> m_top = 0;
+		alignas(64) std::atomic<int64_t> m_bottom = 0;
+		std::array<T,Capacity> m_storage;
+};
+
+// Bounded MPMC ring buffer with per-slot sequence numbers (Vyukov), the CPU counterpart of the global `MPMCQueue` in `mpmc_queue.hlsl`
+template<typename T, uint32_t CapacityLog2>
+class CBoundedMPMCQueue
+{
+	public:
+		constexpr static inline uint64_t Capacity = 0x1ull<<CapacityLog2;
+
+		CBoundedMPMCQueue() : m_slots(Capacity)
+		{
+			for (uint64_t i=0; i<Capacity; i++)
+				m_slots[i].sequence.store(i,std::memory_order_relaxed);
+		}
+
+		inline bool push(const T& val)
+		{
+			uint64_t pos = m_reserved.load(std::memory_order_relaxed);
+			while (true)
+			{
+				auto& slot = m_slots[pos&(Capacity-1)];
+				const int64_t diff = int64_t(slot.sequence.load(std::memory_order_acquire))-int64_t(pos);
+				if (diff==0)
+				{
+					if (m_reserved.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+					{
+						slot.value = val;
+						slot.sequence.store(pos+1,std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff<0) // full
+					return false;
+				else
+					pos = m_reserved.load(std::memory_order_relaxed);
+			}
+		}
+
+		inline bool pop(T& out)
+		{
+			uint64_t pos = m_popped.load(std::memory_order_relaxed);
+			while (true)
+			{
+				auto& slot = m_slots[pos&(Capacity-1)];
+				const int64_t diff = int64_t(slot.sequence.load(std::memory_order_acquire))-int64_t(pos+1);
+				if (diff==0)
+				{
+					if (m_popped.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+					{
+						out = slot.value;
+						slot.sequence.store(pos+Capacity,std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff<0) // empty
+					return false;
+				else
+					pos = m_popped.load(std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		struct SSlot
+		{
+			std::atomic<uint64_t> sequence;
+			T value;
+		};
+		alignas(64) std::atomic<uint64_t> m_reserved = 0;
+		alignas(64) std::atomic<uint64_t> m_popped = 0;
+		std::vector<SSlot> m_slots;
+};
+
+// CPU executor for the same task model as `schedulers::MPMC` in `mpmc.hlsl`: a task is a trivially copyable payload with `void operator()(CWorker&)`
+// which may `push` follow-up tasks. Every worker has a `next` slot it runs first (like every GPU invocation does), then a bounded local deque
+// others can steal from, which spills into one bounded global queue the way the workgroup stack spills into the global `MPMCQueue`.
+// Unlike the GPU (which mustn't overflow) a push that finds the global queue full too gets executed inline and counted.
+template<typename Task, uint32_t LocalCapacityLog2=8, uint32_t GlobalCapacityLog2=16>
+class CWorkStealingScheduler
+{
+		using this_t = CWorkStealingScheduler<Task,LocalCapacityLog2,GlobalCapacityLog2>;
+
+	public:
+		struct SWorkerStats
+		{
+			uint64_t executed = 0;
+			uint64_t pushedLocal = 0;
+			uint64_t spilledToGlobal = 0;
+			uint64_t executedInline = 0; // both the local deque and the global queue were full
+			uint64_t poppedGlobal = 0;
+			uint64_t stealAttempts = 0;
+			uint64_t steals = 0;
+			int64_t maxLocalDepth = 0;
+		};
+		struct SStats
+		{
+			std::vector<SWorkerStats> workers;
+			SWorkerStats total;
+			double seconds;
+
+			inline double getTasksPerSecond() const {return double(total.executed)/seconds;}
+			inline double getStealRate() const {return total.stealAttempts ? double(total.steals)/double(total.stealAttempts):0.0;}
+			// max over min tasks executed by a worker, 1 is perfectly fair
+			inline double getImbalance() const
+			{
+				uint64_t minExecuted = ~0ull, maxExecuted = 0ull;
+				for (const auto& worker : workers)
+				{
+					minExecuted = std::min(minExecuted,worker.executed);
+					maxExecuted = std::max(maxExecuted,worker.executed);
+				}
+				return minExecuted ? double(maxExecuted)/double(minExecuted):double(maxExecuted);
+			}
+		};
+
+		// what a task gets to call `push` on, same as the `scheduler` global in the GPU version
+		class CWorker
+		{
+			public:
+				inline void push(const Task& payload)
+				{
+					m_scheduler->m_alive.fetch_add(1,std::memory_order_relaxed);
+					if (!m_nextValid)
+					{
+						m_next = payload;
+						m_nextValid = true;
+						return;
+					}
+					if (m_deque.push(payload))
+					{
+						m_stats.pushedLocal++;
+						m_stats.maxLocalDepth = std::max(m_stats.maxLocalDepth,m_deque.size());
+						return;
+					}
+					if (m_scheduler->m_global.push(payload))
+					{
+						m_stats.spilledToGlobal++;
+						return;
+					}
+					m_stats.executedInline++;
+					execute(payload);
+				}
+
+				inline uint32_t getIndex() const {return m_index;}
+
+			private:
+				friend this_t;
+
+				inline void execute(const Task& task)
+				{
+					task(*this);
+					m_stats.executed++;
+					m_scheduler->m_alive.fetch_sub(1,std::memory_order_release);
+				}
+
+				this_t* m_scheduler;
+				uint32_t m_index;
+				Task m_next;
+				bool m_nextValid = false;
+				CBoundedWorkStealingDeque<Task,LocalCapacityLog2> m_deque;
+				SWorkerStats m_stats;
+		};
+
+		// Runs all `roots` and everything they push, returns once no task is left anywhere.
+		// Roots get handed out in chunks of `rootGrainSize` to whichever worker runs out of work, the calling thread is worker 0.
+		inline SStats run(std::span<const Task> roots, uint32_t workerCount, const uint32_t rootGrainSize=64u)
+		{
+			workerCount = std::max(workerCount,1u);
+			m_alive.store(0,std::memory_order_relaxed);
+			m_nextRoot.store(0,std::memory_order_relaxed);
+
+			// deques are big and need stable addresses for the thieves
+			std::vector<std::unique_ptr<CWorker>> workers(workerCount);
+			for (uint32_t i=0; i<workerCount; i++)
+			{
+				workers[i] = std::make_unique<CWorker>();
+				workers[i]->m_scheduler = this;
+				workers[i]->m_index = i;
+			}
+
+			auto work = [&](const uint32_t workerIx) -> void
+			{
+				CWorker& self = *workers[workerIx];
+				std::minstd_rand victimRng(workerIx+1u);
+				Task task;
+				while (true)
+				{
+					// ensure by-value semantics, the task may push work itself
+					if (self.m_nextValid)
+					{
+						task = self.m_next;
+						self.m_nextValid = false;
+						self.execute(task);
+						continue;
+					}
+					if (self.m_deque.pop(task))
+					{
+						self.execute(task);
+						continue;
+					}
+					// only start new roots once our own subtrees are done, keeps the queues shallow
+					// count them as alive before claiming, so nobody can see no roots left and nothing alive while we're between the two
+					m_alive.fetch_add(rootGrainSize,std::memory_order_relaxed);
+					const size_t rootBegin = m_nextRoot.fetch_add(rootGrainSize,std::memory_order_relaxed);
+					const size_t rootEnd = std::min<size_t>(rootBegin+rootGrainSize,roots.size());
+					m_alive.fetch_sub(int64_t(rootGrainSize)-int64_t(rootEnd>rootBegin ? (rootEnd-rootBegin):0ull),std::memory_order_relaxed);
+					if (rootBegin<rootEnd)
+					{
+						for (size_t i=rootBegin; i<rootEnd; i++)
+						{
+							self.execute(roots[i]);
+							// drain the chain the root started so the deque doesn't fill up with a whole chunk's worth of work
+							while (self.m_nextValid)
+							{
+								task = self.m_next;
+								self.m_nextValid = false;
+								self.execute(task);
+							}
+						}
+						continue;
+					}
+					if (m_global.pop(task))
+					{
+						self.m_stats.poppedGlobal++;
+						self.execute(task);
+						continue;
+					}
+					if (workerCount>1u)
+					{
+						const uint32_t victimIx = (workerIx+1u+victimRng()%(workerCount-1u))%workerCount;
+						self.m_stats.stealAttempts++;
+						if (workers[victimIx]->m_deque.steal(task))
+						{
+							self.m_stats.steals++;
+							self.execute(task);
+							continue;
+						}
+					}
+					// every root is handed out, so once nothing is alive nothing can push anymore
+					if (m_alive.load(std::memory_order_acquire)==0)
+						break;
+					std::this_thread::yield();
+				}
+			};
+
+			const auto start = std::chrono::steady_clock::now();
+			{
+				std::vector<std::thread> threads;
+				threads.reserve(workerCount-1u);
+				for (uint32_t i=1u; i<workerCount; i++)
+					threads.emplace_back(work,i);
+				work(0u);
+				for (auto& thread : threads)
+					thread.join();
+			}
+
+			SStats retval = {};
+			retval.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+			retval.workers.reserve(workerCount);
+			for (const auto& worker : workers)
+			{
+				const auto& stats = worker->m_stats;
+				retval.workers.push_back(stats);
+				retval.total.executed += stats.executed;
+				retval.total.pushedLocal += stats.pushedLocal;
+				retval.total.spilledToGlobal += stats.spilledToGlobal;
+				retval.total.executedInline += stats.executedInline;
+				retval.total.poppedGlobal += stats.poppedGlobal;
+				retval.total.stealAttempts += stats.stealAttempts;
+				retval.total.steals += stats.steals;
+				retval.total.maxLocalDepth = std::max(retval.total.maxLocalDepth,stats.maxLocalDepth);
+			}
+			return retval;
+		}
+
+	private:
+		// tasks that got pushed or handed out as roots but haven't finished executing yet
+		alignas(64) std::atomic<int64_t> m_alive = 0;
+		alignas(64) std::atomic<size_t> m_nextRoot = 0;
+		CBoundedMPMCQueue<Task,GlobalCapacityLog2> m_global;
+};
+
+}
+
+#endif
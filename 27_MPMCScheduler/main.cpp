@@ -4,6 +4,8 @@
 #include "nabla.h"
 #include "nbl/application_templates/MonoAssetManagerAndBuiltinResourceApplication.hpp"
 #include "SimpleWindowedApplication.hpp"
+#include "ParallelFor.hpp"
+#include "CWhittedTaskCPU.hpp"
 
 using namespace nbl;
 using namespace nbl::core;
@@ -69,6 +71,9 @@ class MPMCSchedulerApp final : public examples::SimpleWindowedApplication, publi
 			if (!asset_base_t::onAppInitialized(std::move(system)))
 				return false;
 
+			if (std::find(argv.begin(),argv.end(),"-cpu_scheduler")!=argv.end())
+				runCPUScheduler();
+
 			smart_refctd_ptr<IGPUShader> shader;
 			{
 				IAssetLoader::SAssetLoadParams lp = {};
@@ -425,6 +430,36 @@ class MPMCSchedulerApp final : public examples::SimpleWindowedApplication, publi
 		}
 
 	private:
+		// Runs the same Whitted task graph as the shader through the CPU work-stealing executor, single threaded first to have a baseline
+		inline void runCPUScheduler()
+		{
+			using task_t = examples::SWhittedTaskCPU;
+			task_t::SFramebuffer framebuffer(WIN_W,WIN_H);
+			std::vector<task_t> roots;
+			roots.reserve(WIN_W*WIN_H);
+			for (uint32_t y=0; y<WIN_H; y++)
+			for (uint32_t x=0; x<WIN_W; x++)
+				roots.push_back(task_t::createPrimary(&framebuffer,x,y));
+
+			const uint32_t workerCounts[] = {1u,examples::getDefaultWorkerCount()};
+			for (const auto workerCount : workerCounts)
+			{
+				examples::whitted_scheduler_t scheduler;
+				const auto stats = scheduler.run(roots,workerCount);
+				m_logger->log(
+					"CPU scheduler with %u workers: %llu tasks in %.3f ms, %.2f Mtasks/s, steal success rate %.1f%% (%llu steals), max local queue depth %lld, %llu spilled to global queue, %llu executed inline on overflow, worker imbalance %.2fx",
+					ILogger::ELL_PERFORMANCE,workerCount,stats.total.executed,stats.seconds*1000.0,stats.getTasksPerSecond()*1e-6,stats.getStealRate()*100.0,
+					stats.total.steals,stats.total.maxLocalDepth,stats.total.spilledToGlobal,stats.total.executedInline,stats.getImbalance()
+				);
+			}
+
+			// every run accumulated into the same framebuffer, so this is the average over the runs
+			double sum = 0.0;
+			for (const auto& texel : framebuffer.texels)
+				sum += texel.load(std::memory_order_relaxed);
+			m_logger->log("CPU scheduler average pixel value %f",ILogger::ELL_INFO,sum/double(framebuffer.texels.size()*std::size(workerCounts)));
+		}
+
 		// Maximum frames which can be simultaneously submitted, used to cycle through our per-frame resources like command buffers
 		constexpr static inline uint32_t MaxFramesInFlight = 3u;
 		smart_refctd_ptr<IWindow> m_window;
@@ -7,6 +7,8 @@
 #include "nbl/ext/FullScreenTriangle/FullScreenTriangle.h"
 #include "nbl/builtin/hlsl/surface_transform.h"
 
+#include "CPacketRayTracer.hpp"
+
 using namespace nbl;
 using namespace core;
 using namespace hlsl;
@@ -879,6 +881,9 @@ class ComputeShaderPathtracer final : public examples::SimpleWindowedApplication
 				m_camera = Camera(cameraPosition, core::vectorSIMDf(0, 0, 0), proj);
 			}
 
+			if (std::find(argv.begin(), argv.end(), "-cpu_reference") != argv.end())
+				runCPUReference();
+
 			m_winMgr->setWindowSize(m_window.get(), WindowDimensions.x, WindowDimensions.y);
 			m_surface->recreateSwapchain();
 			m_winMgr->show(m_window.get());
@@ -1211,6 +1216,51 @@ class ComputeShaderPathtracer final : public examples::SimpleWindowedApplication
 			m_ui.manager->update(params);
 		}
 
+		// Traces the primary rays of every `litBy*` scene from the initial camera on the CPU, first one ray at a time and then in SIMD packets.
+		// The two must agree bit for bit, the image hashes and Mrays/s are meant as a regression and performance baseline.
+		void runCPUReference()
+		{
+			using namespace examples::packet;
+
+			std::array<float, 16> invMVP;
+			{
+				matrix4SIMD tmp;
+				m_camera.getConcatenatedMatrix().getInverseTransform(tmp);
+				memcpy(invMVP.data(), tmp.pointer(), sizeof(invMVP));
+			}
+
+			const uint32_t workerCount = examples::getDefaultWorkerCount();
+			const double rayCount = double(WindowDimensions.x) * WindowDimensions.y;
+			for (uint8_t i = 0; i < E_LIGHT_GEOMETRY::ELG_COUNT; i++)
+			{
+				const auto scene = SScene::create(static_cast<SScene::E_LIGHT_GEOMETRY>(i));
+
+				auto timed = [&](auto&& render) -> std::pair<SPrimaryHitImage, double>
+				{
+					const auto start = clock_t::now();
+					auto image = render();
+					return { std::move(image), std::chrono::duration<double>(clock_t::now() - start).count() };
+				};
+				const auto [reference, referenceTime] = timed([&]() { return CReferenceRenderer::render<false>(scene, invMVP, WindowDimensions.x, WindowDimensions.y, 1u); });
+				const auto [packetST, packetSTTime] = timed([&]() { return CReferenceRenderer::render<true>(scene, invMVP, WindowDimensions.x, WindowDimensions.y, 1u); });
+				const auto [packetMT, packetMTTime] = timed([&]() { return CReferenceRenderer::render<true>(scene, invMVP, WindowDimensions.x, WindowDimensions.y, workerCount); });
+
+				if (!(packetST == reference) || !(packetMT == reference))
+					m_logger->log("CPU reference: %s packets don't match the scalar reference!", ILogger::ELL_ERROR, shaderNames[i]);
+
+				core::blake3_hasher hasher;
+				hasher.update(reference.intersectionT.data(), reference.intersectionT.size() * sizeof(float));
+				hasher.update(reference.objectID.data(), reference.objectID.size() * sizeof(int32_t));
+				const auto hash = static_cast<core::blake3_hash_t>(hasher);
+				uint64_t hashPrefix = 0ull;
+				for (uint32_t b = 0; b < sizeof(hashPrefix); b++)
+					hashPrefix = (hashPrefix << 8ull) | hash.data[b];
+
+				m_logger->log("CPU reference: %s image hash %016llx, scalar %f Mrays/s, %d wide packets %f Mrays/s on 1 thread and %f Mrays/s on %d threads", ILogger::ELL_PERFORMANCE,
+					shaderNames[i], static_cast<unsigned long long>(hashPrefix), rayCount / referenceTime * 1e-6, SFloatPacket::Width, rayCount / packetSTTime * 1e-6, rayCount / packetMTTime * 1e-6, workerCount);
+			}
+		}
+
 	private:
 		smart_refctd_ptr<IWindow> m_window;
 		smart_refctd_ptr<CSimpleResizeSurface<CDefaultSwapchainFramebuffers>> m_surface;
@@ -7,6 +7,10 @@
 
 #include "CCamera.hpp"
 #include "../common/CommonAPI.h"
+#include "CCPUTransformTree.hpp"
+#include "CKeyframeAnimation.hpp"
+
+#include <random>
 
 using namespace nbl;
 using namespace core;
@@ -120,6 +124,130 @@ static core::smart_refctd_ptr<asset::ICPUMeshBuffer> createMeshBufferFromGeomCre
 
 }
 
+// Propagation throughput of `CCPUTransformTree` on a synthetic scene graph, a full recompute and sparse edits touching 1% of the nodes,
+// once on every hardware thread and once on a single one to show the scaling
+static void benchmarkCPUTransformTree(system::ILogger* logger, const uint32_t nodeCount)
+{
+	using clock_t = std::chrono::steady_clock;
+	std::mt19937 rng(0x54u);
+
+	// bushy but deep, every level is 4x wider than the previous one until the node budget runs out
+	examples::CCPUTransformTree tree;
+	tree.reserve(nodeCount);
+	auto randomTransform = [&rng]() -> core::matrix3x4SIMD
+	{
+		std::uniform_real_distribution<float> dist(-1.f,1.f);
+		core::matrix3x4SIMD tform;
+		tform.setRotation(core::quaternion(dist(rng),dist(rng),dist(rng)));
+		tform.setTranslation(core::vectorSIMDf(dist(rng),dist(rng),dist(rng)));
+		return tform;
+	};
+	uint32_t levelBegin = 0u, levelEnd = 0u;
+	for (uint32_t i=0u; i<64u && i<nodeCount; i++)
+		tree.addNode(randomTransform());
+	levelEnd = tree.getNodeCount();
+	while (tree.getNodeCount()<nodeCount)
+	{
+		const uint32_t levelSize = std::min((levelEnd-levelBegin)*4u,nodeCount-tree.getNodeCount());
+		std::uniform_int_distribution<uint32_t> parentDist(levelBegin,levelEnd-1u);
+		for (uint32_t i=0u; i<levelSize; i++)
+			tree.addNode(randomTransform(),parentDist(rng));
+		levelBegin = levelEnd;
+		levelEnd = tree.getNodeCount();
+	}
+	// first propagation also lays the tree out
+	tree.propagate();
+
+	std::uniform_int_distribution<uint32_t> nodeDist(0u,nodeCount-1u);
+	const core::matrix3x4SIMD edit = randomTransform();
+	auto run = [&](const uint32_t workerCount, const uint32_t editCount, const char* name) -> void
+	{
+		constexpr uint32_t Iterations = 16u;
+		double seconds = 0.0;
+		uint64_t recomputed = 0ull;
+		for (uint32_t it=0u; it<Iterations; it++)
+		{
+			for (uint32_t i=0u; i<editCount; i++)
+				tree.setRelativeTransform(editCount==nodeCount ? i:nodeDist(rng),edit);
+			const auto start = clock_t::now();
+			recomputed += tree.propagate(workerCount).recomputedNodes;
+			seconds += std::chrono::duration<double>(clock_t::now()-start).count();
+		}
+		logger->log("%s on %u threads: %.2f propagations/s, %.2f M recomputed nodes/s, %llu nodes per propagation",system::ILogger::ELL_PERFORMANCE,
+			name,workerCount,double(Iterations)/seconds,double(recomputed)/seconds*1e-6,recomputed/Iterations);
+	};
+	logger->log("CPU transform tree benchmark: %u nodes in %u levels",system::ILogger::ELL_PERFORMANCE,tree.getNodeCount(),tree.getLevelCount());
+	const uint32_t workerCount = examples::getDefaultWorkerCount();
+	run(workerCount,nodeCount,"Full propagation");
+	run(1u,nodeCount,"Full propagation");
+	run(workerCount,nodeCount/100u,"1% sparse edits");
+	run(1u,nodeCount/100u,"1% sparse edits");
+}
+
+// Sampling throughput of the SoA keyframe runtime on a crowd of characters, every character plays one of a few glTF-like clips
+// (linear translations, slerped rotations, cubic spline scales) at its own time offset and speed, once on every hardware thread and once on a single one
+static void benchmarkKeyframeAnimation(system::ILogger* logger, const uint32_t characterCount, const uint32_t jointsPerCharacter)
+{
+	using clock_t = std::chrono::steady_clock;
+	using namespace nbl::examples::animation;
+	std::mt19937 rng(0x12u);
+	std::uniform_real_distribution<float> dist(-1.f,1.f);
+
+	constexpr uint32_t ClipCount = 8u;
+	constexpr uint32_t KeyCount = 48u;
+	constexpr float ClipDuration = 2.f;
+	std::vector<CAnimationClip> clips(ClipCount);
+	{
+		std::vector<float> times(KeyCount);
+		for (uint32_t k=0u; k<KeyCount; k++)
+			times[k] = ClipDuration*float(k)/float(KeyCount-1u);
+		std::vector<core::vectorSIMDf> values;
+		for (auto& clip : clips)
+		for (uint32_t joint=0u; joint<jointsPerCharacter; joint++)
+		{
+			values.resize(KeyCount);
+			for (auto& value : values)
+				value = core::vectorSIMDf(dist(rng),dist(rng),dist(rng));
+			clip.addChannel(joint,EPath::TRANSLATION,EInterpolation::LINEAR,times,values);
+			for (auto& value : values)
+				value = core::normalize(core::vectorSIMDf(dist(rng),dist(rng),dist(rng),dist(rng)));
+			clip.addChannel(joint,EPath::ROTATION,EInterpolation::LINEAR,times,values);
+			// only some joints squash and stretch
+			if (joint%4u==0u)
+			{
+				values.resize(KeyCount*3u);
+				for (auto& value : values)
+					value = core::vectorSIMDf(1.f)+core::vectorSIMDf(dist(rng),dist(rng),dist(rng))*0.25f;
+				clip.addChannel(joint,EPath::SCALE,EInterpolation::CUBIC_SPLINE,times,values);
+			}
+		}
+	}
+
+	CAnimationRuntime runtime(characterCount*jointsPerCharacter);
+	{
+		std::uniform_int_distribution<uint32_t> clipDist(0u,ClipCount-1u);
+		std::uniform_real_distribution<float> timeDist(0.f,ClipDuration);
+		std::uniform_real_distribution<float> speedDist(0.75f,1.25f);
+		for (uint32_t i=0u; i<characterCount; i++)
+			runtime.addInstance(&clips[clipDist(rng)],i*jointsPerCharacter,timeDist(rng),speedDist(rng));
+	}
+
+	auto run = [&](const uint32_t workerCount) -> void
+	{
+		constexpr uint32_t Frames = 240u;
+		constexpr float FrameDelta = 1.f/60.f;
+		const auto start = clock_t::now();
+		for (uint32_t frame=0u; frame<Frames; frame++)
+			runtime.evaluate(FrameDelta,workerCount);
+		const double milliseconds = std::chrono::duration<double,std::milli>(clock_t::now()-start).count();
+		logger->log("Keyframe evaluation on %u threads: %.2f ms per frame, %.1f animated joints/ms",system::ILogger::ELL_PERFORMANCE,
+			workerCount,milliseconds/double(Frames),double(characterCount)*double(jointsPerCharacter)*double(Frames)/milliseconds);
+	};
+	logger->log("Keyframe animation benchmark: %u characters with %u joints, %u clips of %u keys",system::ILogger::ELL_PERFORMANCE,characterCount,jointsPerCharacter,ClipCount,KeyCount);
+	run(examples::getDefaultWorkerCount());
+	run(1u);
+}
+
 class TransformationApp : public ApplicationBase
 {
 		_NBL_STATIC_INLINE_CONSTEXPR uint32_t WIN_W = 1280;
@@ -133,6 +261,14 @@ class TransformationApp : public ApplicationBase
 
 		_NBL_STATIC_INLINE_CONSTEXPR float SimulationSpeedScale = 0.03f; //! Instance Data
 
+		// runs `benchmarkCPUTransformTree` before the demo starts
+		_NBL_STATIC_INLINE_CONSTEXPR bool BenchmarkCPUTransformTree = false;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t BenchmarkNodeCount = 1u<<20u;
+		// runs `benchmarkKeyframeAnimation` before the demo starts
+		_NBL_STATIC_INLINE_CONSTEXPR bool BenchmarkKeyframeAnimation = false;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t BenchmarkCharacterCount = 4096u;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t BenchmarkJointsPerCharacter = 64u;
+
 	public:
 		void setWindow(core::smart_refctd_ptr<nbl::ui::IWindow>&& wnd) override
 		{
@@ -216,6 +352,11 @@ class TransformationApp : public ApplicationBase
 			logger = std::move(initOutput.logger);
 			inputSystem = std::move(initOutput.inputSystem);
 			m_swapchainCreationParams = std::move(initOutput.swapchainCreationParams);
+
+			if constexpr (BenchmarkCPUTransformTree)
+				benchmarkCPUTransformTree(logger.get(),BenchmarkNodeCount);
+			if constexpr (BenchmarkKeyframeAnimation)
+				benchmarkKeyframeAnimation(logger.get(),BenchmarkCharacterCount,BenchmarkJointsPerCharacter);
 			
 			auto* transferUpQueue = queues[decltype(initOutput)::EQT_TRANSFER_UP];
 
@@ -0,0 +1,180 @@
+#include "CPUStageProfiler.h"
+
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+// all trivially destructible, so they're safe to touch from `operator new` at any point of a thread's life
+thread_local bool tl_enabled = false;
+thread_local CPUStageProfiler::stats_t tl_stats = {};
+thread_local CPUStageProfiler::SStageStats* tl_currentStage = nullptr;
+thread_local std::chrono::steady_clock::time_point tl_segmentStart = {};
+
+void closeSegment(const std::chrono::steady_clock::time_point now)
+{
+	if (tl_currentStage)
+		tl_currentStage->milliseconds += std::chrono::duration<double, std::milli>(now - tl_segmentStart).count();
+	tl_segmentStart = now;
+}
+}
+
+CPUStageProfiler::ScopedStage::ScopedStage(CPUStage stage) : m_parent(tl_currentStage), m_active(tl_enabled)
+{
+	// a scope nested in one of the same stage (i.e. the inner overloads of `drawPolyline`) is still the same call of that stage
+	if (m_active && m_parent == &tl_stats[static_cast<size_t>(stage)])
+		m_active = false;
+	if (!m_active)
+		return;
+	closeSegment(std::chrono::steady_clock::now());
+	tl_currentStage = &tl_stats[static_cast<size_t>(stage)];
+	tl_currentStage->calls++;
+}
+
+CPUStageProfiler::ScopedStage::~ScopedStage()
+{
+	if (!m_active)
+		return;
+	closeSegment(std::chrono::steady_clock::now());
+	tl_currentStage = m_parent;
+}
+
+void CPUStageProfiler::setEnabled(bool enabled)
+{
+	tl_enabled = enabled;
+}
+
+bool CPUStageProfiler::isEnabled()
+{
+	return tl_enabled;
+}
+
+void CPUStageProfiler::reset()
+{
+	tl_stats = {};
+}
+
+CPUStageProfiler::stats_t CPUStageProfiler::getStats()
+{
+	return tl_stats;
+}
+
+const char* CPUStageProfiler::getStageName(CPUStage stage)
+{
+	switch (stage)
+	{
+	case CPUStage::POLYLINE:
+		return "polyline";
+	case CPUStage::HATCH:
+		return "hatch";
+	case CPUStage::MSDF:
+		return "msdf";
+	case CPUStage::PACKING:
+		return "packing";
+	default:
+		return "unknown";
+	}
+}
+
+void CPUStageProfiler::onAllocation(size_t size)
+{
+	// the replacements are linked into the windowed mode too, where this is all they cost
+	if (tl_enabled && tl_currentStage)
+	{
+		tl_currentStage->allocations++;
+		tl_currentStage->allocatedBytes += size;
+	}
+}
+
+// Counting replacements of the global allocation functions. The default nothrow variants are specified to call these, the aligned ones get replaced as well.
+void* operator new(std::size_t size)
+{
+	CPUStageProfiler::onAllocation(size);
+	if (void* ptr = std::malloc(size ? size : 1u))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+void* alignedAllocate(std::size_t size, std::align_val_t alignment)
+{
+	const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1u, align);
+#else
+	// `aligned_alloc` wants the size to be a multiple of the alignment
+	return std::aligned_alloc(align, ((size ? size : 1u) + align - 1u) & ~(align - 1u));
+#endif
+}
+
+void alignedFree(void* ptr)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	CPUStageProfiler::onAllocation(size);
+	if (void* ptr = alignedAllocate(size, alignment))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return ::operator new(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
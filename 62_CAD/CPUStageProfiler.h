@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/// Attributes CPU time and heap allocations to the stages the CAD example goes through when it builds a frame.
+/// Scopes nest, time is exclusive so a hatch's MSDF generation doesn't also count as packing the hatch, and a scope inside one of the same stage isn't another call.
+/// Everything is per thread and off by default, the headless benchmark enables it on the thread that builds the frames and allocations only get counted while it is.
+enum class CPUStage : uint8_t
+{
+	POLYLINE, // polyline construction and preprocessing (curve approximation, stipples, offsets)
+	HATCH, // hatch construction (splitting into monotonic segments and intersecting them)
+	MSDF, // hatch fill pattern and glyph MSDF generation
+	PACKING, // `DrawResourcesFiller` packing objects into the CPU side draw buffers
+	COUNT
+};
+
+class CPUStageProfiler
+{
+public:
+	struct SStageStats
+	{
+		double milliseconds;
+		uint64_t calls;
+		uint64_t allocations;
+		uint64_t allocatedBytes;
+	};
+	using stats_t = std::array<SStageStats, static_cast<size_t>(CPUStage::COUNT)>;
+
+	class ScopedStage
+	{
+	public:
+		ScopedStage(CPUStage stage);
+		~ScopedStage();
+
+		ScopedStage(const ScopedStage&) = delete;
+		ScopedStage& operator=(const ScopedStage&) = delete;
+
+	private:
+		SStageStats* m_parent;
+		bool m_active;
+	};
+
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+	static void reset();
+	static stats_t getStats();
+
+	static const char* getStageName(CPUStage stage);
+
+	// called from the replaced global `operator new`, must not allocate
+	static void onAllocation(size_t size);
+};
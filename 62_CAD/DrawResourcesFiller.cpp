@@ -120,6 +120,8 @@ void DrawResourcesFiller::allocateMSDFTextures(ILogicalDevice* logicalDevice, ui
 {
 	msdfLRUCache = std::unique_ptr<MSDFsLRUCache>(new MSDFsLRUCache(maxMSDFs));
 	msdfTextureArrayIndexAllocator = core::make_smart_refctd_ptr<IndexAllocator>(core::smart_refctd_ptr<ILogicalDevice>(logicalDevice), maxMSDFs);
+	msdfResolution = msdfsExtent;
+	msdfMipLevels = MSDFMips;
 
 	asset::E_FORMAT msdfFormat = MSDFTextureFormat;
 	asset::VkExtent3D MSDFsExtent = { msdfsExtent.x, msdfsExtent.y, 1u }; 
@@ -165,8 +167,34 @@ void DrawResourcesFiller::allocateMSDFTextures(ILogicalDevice* logicalDevice, ui
 	}
 }
 
+void DrawResourcesFiller::allocateHeadless(uint32_t maxIndices, uint32_t mainObjects, uint32_t drawObjects, size_t geometryBufferSize, uint32_t lineStylesCount, uint32_t maxMSDFs, uint32_t2 msdfsExtent)
+{
+	m_headless = true;
+
+	maxIndexCount = maxIndices;
+	maxMainObjects = mainObjects;
+	maxDrawObjects = drawObjects;
+	maxGeometryBufferSize = geometryBufferSize;
+	maxLineStyles = lineStylesCount;
+	geometryBufferAddress = 0ull;
+
+	cpuDrawBuffers.mainObjectsBuffer = ICPUBuffer::create({ maxMainObjects * sizeof(MainObject) });
+	cpuDrawBuffers.drawObjectsBuffer = ICPUBuffer::create({ maxDrawObjects * sizeof(DrawObject) });
+	cpuDrawBuffers.geometryBuffer = ICPUBuffer::create({ geometryBufferSize });
+	cpuDrawBuffers.lineStylesBuffer = ICPUBuffer::create({ lineStylesCount * sizeof(LineStyle) });
+
+	msdfLRUCache = std::unique_ptr<MSDFsLRUCache>(new MSDFsLRUCache(maxMSDFs));
+	headlessMaxMSDFs = maxMSDFs;
+	headlessMSDFIndexCount = 0u;
+	headlessFreeMSDFIndices.clear();
+	msdfResolution = msdfsExtent;
+	msdfMipLevels = MSDFMips;
+}
+
 void DrawResourcesFiller::drawPolyline(const CPolylineBase& polyline, const LineStyleInfo& lineStyleInfo, SIntendedSubmitInfo& intendedNextSubmit)
 {
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
 	if (!lineStyleInfo.isVisible())
 		return;
 
@@ -179,6 +207,8 @@ void DrawResourcesFiller::drawPolyline(const CPolylineBase& polyline, const Line
 
 void DrawResourcesFiller::drawPolyline(const CPolylineBase& polyline, uint32_t polylineMainObjIdx, SIntendedSubmitInfo& intendedNextSubmit)
 {
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
 	if (polylineMainObjIdx == InvalidMainObjectIdx)
 	{
 		// TODO: assert or log error here
@@ -205,17 +235,57 @@ void DrawResourcesFiller::drawPolyline(const CPolylineBase& polyline, uint32_t p
 			submitCurrentDrawObjectsAndReset(intendedNextSubmit, polylineMainObjIdx);
 	}
 
-	if (!polyline.getConnectors().empty())
+	addPolylineConnectors_SubmitIfNeeded(polyline.getConnectors(), polylineMainObjIdx, intendedNextSubmit);
+}
+
+void DrawResourcesFiller::drawPolylineSections(const CPolylineBase& polyline, const LineStyleInfo& lineStyleInfo, std::span<const uint32_t> sectionIndices, const float64_t2& connectorCullMin, const float64_t2& connectorCullMax, SIntendedSubmitInfo& intendedNextSubmit)
+{
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
+	if (!lineStyleInfo.isVisible() || sectionIndices.empty())
+		return;
+
+	uint32_t styleIdx = addLineStyle_SubmitIfNeeded(lineStyleInfo, intendedNextSubmit);
+
+	uint32_t mainObjIdx = addMainObject_SubmitIfNeeded(styleIdx, intendedNextSubmit);
+
+	drawPolylineSections(polyline, mainObjIdx, sectionIndices, connectorCullMin, connectorCullMax, intendedNextSubmit);
+}
+
+void DrawResourcesFiller::drawPolylineSections(const CPolylineBase& polyline, uint32_t polylineMainObjIdx, std::span<const uint32_t> sectionIndices, const float64_t2& connectorCullMin, const float64_t2& connectorCullMax, SIntendedSubmitInfo& intendedNextSubmit)
+{
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
+	if (polylineMainObjIdx == InvalidMainObjectIdx)
 	{
-		uint32_t currentConnectorPolylineObject = 0u;
-		while (currentConnectorPolylineObject < polyline.getConnectors().size())
-		{
-			addPolylineConnectors_Internal(polyline, currentConnectorPolylineObject, polylineMainObjIdx);
+		assert(false);
+		return;
+	}
 
-			if (currentConnectorPolylineObject < polyline.getConnectors().size())
-				submitCurrentDrawObjectsAndReset(intendedNextSubmit, polylineMainObjIdx);
+	uint32_t currentIndexInList = 0u;
+	uint32_t currentObjectInSection = 0u;
+	while (currentIndexInList < sectionIndices.size())
+	{
+		const auto& currentSection = polyline.getSectionInfoAt(sectionIndices[currentIndexInList]);
+		addPolylineObjects_Internal(polyline, currentSection, currentObjectInSection, polylineMainObjIdx);
+
+		if (currentObjectInSection >= currentSection.count)
+		{
+			currentIndexInList++;
+			currentObjectInSection = 0u;
 		}
+		else
+			submitCurrentDrawObjectsAndReset(intendedNextSubmit, polylineMainObjIdx);
+	}
+
+	visibleConnectorsScratch.clear();
+	for (const auto& connector : polyline.getConnectors())
+	{
+		const float64_t2 center = connector.circleCenter;
+		if (center.x >= connectorCullMin.x && center.y >= connectorCullMin.y && center.x <= connectorCullMax.x && center.y <= connectorCullMax.y)
+			visibleConnectorsScratch.push_back(connector);
 	}
+	addPolylineConnectors_SubmitIfNeeded(visibleConnectorsScratch, polylineMainObjIdx, intendedNextSubmit);
 }
 
 // TODO[Erfan]: Makes more sense if parameters are: solidColor + fillPattern + patternColor
@@ -245,14 +315,22 @@ void DrawResourcesFiller::drawHatch(
 	if (color.a == 0.0f) // not visible
 		return;
 
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
 	uint32_t textureIdx = InvalidTextureIdx;
 	if (fillPattern != HatchFillPattern::SOLID_FILL)
 	{
 		MSDFInputInfo msdfInfo = MSDFInputInfo(fillPattern);
 		textureIdx = getMSDFIndexFromInputInfo(msdfInfo, intendedNextSubmit);
 		if (textureIdx == InvalidTextureIdx)
-			textureIdx = addMSDFTexture(msdfInfo, getHatchFillPatternMSDF(fillPattern), InvalidMainObjectIdx, intendedNextSubmit);
-		_NBL_DEBUG_BREAK_IF(textureIdx == InvalidTextureIdx); // probably getHatchFillPatternMSDF returned nullptr
+		{
+			auto msdf = getHatchFillPatternMSDF(fillPattern);
+			if (msdf)
+				textureIdx = addMSDFTexture(msdfInfo, std::move(msdf), InvalidMainObjectIdx, intendedNextSubmit);
+			else // not generated yet, same as glyphs: draw the placeholder and ask again next time
+				textureIdx = getPlaceholderMSDFIndex(InvalidMainObjectIdx, intendedNextSubmit);
+		}
+		_NBL_DEBUG_BREAK_IF(textureIdx == InvalidTextureIdx); // probably getHatchFillPatternMSDF returned an ICPUImage of the wrong size
 	}
 
 	LineStyleInfo lineStyle = {};
@@ -285,11 +363,19 @@ void DrawResourcesFiller::drawFontGlyph(
 		uint32_t mainObjIdx,
 		SIntendedSubmitInfo& intendedNextSubmit)
 {
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
 	uint32_t textureIdx = InvalidTextureIdx;
 	const MSDFInputInfo msdfInput = MSDFInputInfo(fontFace->getHash(), glyphIdx);
 	textureIdx = getMSDFIndexFromInputInfo(msdfInput, intendedNextSubmit);
 	if (textureIdx == InvalidTextureIdx)
-		textureIdx = addMSDFTexture(msdfInput, getGlyphMSDF(fontFace, glyphIdx), mainObjIdx, intendedNextSubmit);
+	{
+		auto msdf = getGlyphMSDF(fontFace, glyphIdx);
+		if (msdf)
+			textureIdx = addMSDFTexture(msdfInput, std::move(msdf), mainObjIdx, intendedNextSubmit);
+		else // not generated yet, we don't insert the glyph into the cache so the next draw asks again and swaps the real MSDF in
+			textureIdx = getPlaceholderMSDFIndex(mainObjIdx, intendedNextSubmit);
+	}
 
 	if (textureIdx != InvalidTextureIdx)
 	{
@@ -304,13 +390,16 @@ void DrawResourcesFiller::drawFontGlyph(
 	}
 	else
 	{
-		// TODO: Log, probably getGlyphMSDF(face,glyphIdx) returned nullptr ICPUImage ptr
+		// TODO: Log, probably getGlyphMSDF(face,glyphIdx) returned an ICPUImage of the wrong size
 		_NBL_DEBUG_BREAK_IF(true);
 	}
 }
 
 bool DrawResourcesFiller::finalizeAllCopiesToGPU(SIntendedSubmitInfo& intendedNextSubmit)
 {
+	if (m_headless)
+		return finalizeHeadlessCopies();
+
 	bool success = true;
 	success &= finalizeMainObjectCopiesToGPU(intendedNextSubmit);
 	success &= finalizeGeometryCopiesToGPU(intendedNextSubmit);
@@ -319,6 +408,28 @@ bool DrawResourcesFiller::finalizeAllCopiesToGPU(SIntendedSubmitInfo& intendedNe
 	return success;
 }
 
+bool DrawResourcesFiller::finalizeHeadlessCopies()
+{
+	// Same ranges the `finalize*CopiesToGPU` functions would upload, minus the upload
+	m_headlessStats.uploadedBytes += (currentMainObjectCount - inMemMainObjectCount) * sizeof(MainObject);
+	m_headlessStats.uploadedBytes += (currentDrawObjectCount - inMemDrawObjectCount) * sizeof(DrawObject);
+	m_headlessStats.uploadedBytes += currentGeometryBufferSize - inMemGeometryBufferSize;
+	m_headlessStats.uploadedBytes += (currentLineStylesCount - inMemLineStylesCount) * sizeof(LineStyle);
+	inMemMainObjectCount = currentMainObjectCount;
+	inMemDrawObjectCount = currentDrawObjectCount;
+	inMemGeometryBufferSize = currentGeometryBufferSize;
+	inMemLineStylesCount = currentLineStylesCount;
+
+	for (const auto& copy : msdfTextureCopies)
+	{
+		m_headlessStats.uploadedBytes += copy.image->getBuffer()->getSize();
+		m_headlessStats.uploadedMSDFs++;
+	}
+	msdfTextureCopies.clear();
+	msdfTextureArrayIndicesUsed.clear();
+	return true;
+}
+
 uint32_t DrawResourcesFiller::addLineStyle_SubmitIfNeeded(const LineStyleInfo& lineStyle, SIntendedSubmitInfo& intendedNextSubmit)
 {
 	uint32_t outLineStyleIdx = addLineStyle_Internal(lineStyle);
@@ -736,7 +847,19 @@ void DrawResourcesFiller::addPolylineObjects_Internal(const CPolylineBase& polyl
 		assert(false); // we don't handle other object types
 }
 
-void DrawResourcesFiller::addPolylineConnectors_Internal(const CPolylineBase& polyline, uint32_t& currentPolylineConnectorObj, uint32_t mainObjIdx)
+void DrawResourcesFiller::addPolylineConnectors_SubmitIfNeeded(std::span<const PolylineConnector> connectors, uint32_t mainObjIdx, SIntendedSubmitInfo& intendedNextSubmit)
+{
+	uint32_t currentConnectorPolylineObject = 0u;
+	while (currentConnectorPolylineObject < connectors.size())
+	{
+		addPolylineConnectors_Internal(connectors, currentConnectorPolylineObject, mainObjIdx);
+
+		if (currentConnectorPolylineObject < connectors.size())
+			submitCurrentDrawObjectsAndReset(intendedNextSubmit, mainObjIdx);
+	}
+}
+
+void DrawResourcesFiller::addPolylineConnectors_Internal(std::span<const PolylineConnector> connectors, uint32_t& currentPolylineConnectorObj, uint32_t mainObjIdx)
 {
 	const uint32_t maxGeometryBufferConnectors = static_cast<uint32_t>((maxGeometryBufferSize - currentGeometryBufferSize) / sizeof(PolylineConnector));
 
@@ -744,7 +867,7 @@ void DrawResourcesFiller::addPolylineConnectors_Internal(const CPolylineBase& po
 	uploadableObjects = core::min(uploadableObjects, maxGeometryBufferConnectors);
 	uploadableObjects = core::min(uploadableObjects, maxDrawObjects - currentDrawObjectCount);
 
-	const uint32_t connectorCount = static_cast<uint32_t>(polyline.getConnectors().size());
+	const uint32_t connectorCount = static_cast<uint32_t>(connectors.size());
 	const uint32_t remainingObjects = connectorCount - currentPolylineConnectorObj;
 
 	const uint32_t objectsToUpload = core::min(uploadableObjects, remainingObjects);
@@ -767,7 +890,7 @@ void DrawResourcesFiller::addPolylineConnectors_Internal(const CPolylineBase& po
 	{
 		const auto connectorsByteSize = sizeof(PolylineConnector) * objectsToUpload;
 		void* dst = reinterpret_cast<char*>(cpuDrawBuffers.geometryBuffer->getPointer()) + currentGeometryBufferSize;
-		auto& connector = polyline.getConnectors()[currentPolylineConnectorObj];
+		auto& connector = connectors[currentPolylineConnectorObj];
 		memcpy(dst, &connector, connectorsByteSize);
 		currentGeometryBufferSize += connectorsByteSize;
 	}
@@ -940,6 +1063,60 @@ void DrawResourcesFiller::setHatchFillMSDFTextureFunction(const GetHatchFillPatt
 	getHatchFillPatternMSDF = func;
 }
 
+uint32_t DrawResourcesFiller::getPlaceholderMSDFIndex(uint32_t mainObjIdx, SIntendedSubmitInfo& intendedNextSubmit)
+{
+	const MSDFInputInfo placeholderInput = MSDFInputInfo::createPlaceholder();
+	uint32_t textureIdx = getMSDFIndexFromInputInfo(placeholderInput, intendedNextSubmit);
+	if (textureIdx == InvalidTextureIdx)
+		textureIdx = addMSDFTexture(placeholderInput, createPlaceholderMSDF(), mainObjIdx, intendedNextSubmit);
+	return textureIdx;
+}
+
+core::smart_refctd_ptr<ICPUImage> DrawResourcesFiller::createPlaceholderMSDF()
+{
+	const uint32_t2 resolution = getMSDFResolution();
+	const uint32_t mipLevels = getMSDFMips();
+	constexpr uint32_t TexelSize = 4u; // RGBA8
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<IImage::SBufferCopy>>(mipLevels);
+	size_t bufferSize = 0ull;
+	for (uint32_t mip = 0u; mip < mipLevels; mip++)
+	{
+		const uint32_t2 mipExtent = uint32_t2(core::max(resolution.x >> mip, 1u), core::max(resolution.y >> mip, 1u));
+		auto& region = (*regions)[mip];
+		region.bufferOffset = bufferSize;
+		region.bufferRowLength = 0u;
+		region.bufferImageHeight = 0u;
+		region.imageSubresource.aspectMask = asset::IImage::E_ASPECT_FLAGS::EAF_COLOR_BIT;
+		region.imageSubresource.mipLevel = mip;
+		region.imageSubresource.baseArrayLayer = 0u;
+		region.imageSubresource.layerCount = 1u;
+		region.imageOffset = { 0u,0u,0u };
+		region.imageExtent = { mipExtent.x, mipExtent.y, 1u };
+		bufferSize += mipExtent.x * mipExtent.y * TexelSize;
+	}
+
+	ICPUBuffer::SCreationParams bparams;
+	bparams.size = bufferSize;
+	auto buffer = ICPUBuffer::create(std::move(bparams));
+	// -1 in SNORM on every channel is as far outside of the shape as an MSDF can say
+	memset(buffer->getPointer(), 0x81, bufferSize);
+
+	ICPUImage::SCreationParams imgParams;
+	{
+		imgParams.flags = static_cast<ICPUImage::E_CREATE_FLAGS>(0u); // no flags
+		imgParams.type = ICPUImage::ET_2D;
+		imgParams.format = nbl::ext::TextRendering::TextRenderer::MSDFTextureFormat;
+		imgParams.extent = { resolution.x, resolution.y, 1u };
+		imgParams.mipLevels = mipLevels;
+		imgParams.arrayLayers = 1u;
+		imgParams.samples = ICPUImage::ESCF_1_BIT;
+	}
+	auto image = ICPUImage::create(std::move(imgParams));
+	image->setBufferAndRegions(std::move(buffer), std::move(regions));
+	return image;
+}
+
 uint32_t DrawResourcesFiller::addMSDFTexture(const MSDFInputInfo& msdfInput, core::smart_refctd_ptr<ICPUImage>&& cpuImage, uint32_t mainObjIdx, SIntendedSubmitInfo& intendedNextSubmit)
 {
 	if (!cpuImage)
@@ -960,7 +1137,10 @@ uint32_t DrawResourcesFiller::addMSDFTexture(const MSDFInputInfo& msdfInput, cor
 		if (msdfTextureArrayIndicesUsed.contains(evicted.alloc_idx)) 
 		{
 			// Dealloc once submission is finished
-			msdfTextureArrayIndexAllocator->multi_deallocate(1u, &evicted.alloc_idx, nextSemaSignal);
+			if (m_headless)
+				headlessFreeMSDFIndices.push_back(evicted.alloc_idx);
+			else
+				msdfTextureArrayIndexAllocator->multi_deallocate(1u, &evicted.alloc_idx, nextSemaSignal);
 
 			// If we reset main objects will cause an auto submission bug, where adding an msdf texture while constructing glyphs will have wrong main object references (See how SingleLineTexts add Glyphs with a single mainObject)
 			// for the same reason we don't reset line styles
@@ -970,7 +1150,10 @@ uint32_t DrawResourcesFiller::addMSDFTexture(const MSDFInputInfo& msdfInput, cor
 		else
 		{
 			// We didn't use it this frame, so it's safe to dealloc now, withou needing to "overflow" submit
-			msdfTextureArrayIndexAllocator->multi_deallocate(1u, &evicted.alloc_idx);
+			if (m_headless)
+				headlessFreeMSDFIndices.push_back(evicted.alloc_idx);
+			else
+				msdfTextureArrayIndexAllocator->multi_deallocate(1u, &evicted.alloc_idx);
 		}
 	};
 	
@@ -982,7 +1165,18 @@ uint32_t DrawResourcesFiller::addMSDFTexture(const MSDFInputInfo& msdfInput, cor
 	{
 		// New insertion == cache miss happened and insertion was successfull
 		inserted->alloc_idx = IndexAllocator::AddressAllocator::invalid_address;
-		msdfTextureArrayIndexAllocator->multi_allocate(std::chrono::time_point<std::chrono::steady_clock>::max(), 1u, &inserted->alloc_idx); // if the prev submit causes DEVICE_LOST then we'll get a deadlock here since we're using max timepoint
+		if (m_headless)
+		{
+			if (!headlessFreeMSDFIndices.empty())
+			{
+				inserted->alloc_idx = headlessFreeMSDFIndices.back();
+				headlessFreeMSDFIndices.pop_back();
+			}
+			else if (headlessMSDFIndexCount < headlessMaxMSDFs)
+				inserted->alloc_idx = headlessMSDFIndexCount++;
+		}
+		else
+			msdfTextureArrayIndexAllocator->multi_allocate(std::chrono::time_point<std::chrono::steady_clock>::max(), 1u, &inserted->alloc_idx); // if the prev submit causes DEVICE_LOST then we'll get a deadlock here since we're using max timepoint
 
 		if (inserted->alloc_idx != IndexAllocator::AddressAllocator::invalid_address)
 		{
@@ -2,6 +2,7 @@
 #include "Polyline.h"
 #include "Hatch.h"
 #include "IndexAllocator.h"
+#include "CPUStageProfiler.h"
 #include <nbl/video/utilities/SIntendedSubmitInfo.h>
 #include <nbl/core/containers/LRUCache.h>  
 #include <nbl/ext/TextRendering/TextRendering.h>
@@ -59,7 +60,19 @@ public:
 	
 	void allocateMSDFTextures(ILogicalDevice* logicalDevice, uint32_t maxMSDFs, uint32_t2 msdfsExtent);
 
+	// Allocates only the CPU side of the draw buffers, for measuring the packing without a device.
+	// Copies to the GPU and MSDF uploads just get counted, overflow still calls the submit function so the caller can count those.
+	void allocateHeadless(uint32_t maxIndices, uint32_t mainObjects, uint32_t drawObjects, size_t geometryBufferSize, uint32_t lineStylesCount, uint32_t maxMSDFs, uint32_t2 msdfsExtent);
+
+	struct HeadlessStats
+	{
+		uint64_t uploadedBytes = 0ull;
+		uint32_t uploadedMSDFs = 0u;
+	};
+	const HeadlessStats& getHeadlessStats() const { return m_headlessStats; }
+
 	// functions that user should set to get MSDF texture if it's not available in cache.
+	// the glyph function may return nullptr while the MSDF is still being generated, a blank placeholder gets drawn until it stops doing so
 	// it's up to user to return cached or generate on the fly.
 	typedef std::function<core::smart_refctd_ptr<ICPUImage>(nbl::ext::TextRendering::FontFace* /*face*/, uint32_t /*glyphIdx*/)> GetGlyphMSDFTextureFunc;
 	typedef std::function<core::smart_refctd_ptr<ICPUImage>(HatchFillPattern/*pattern*/)> GetHatchFillPatternMSDFTextureFunc;
@@ -75,6 +88,12 @@ public:
 	void drawPolyline(const CPolylineBase& polyline, const LineStyleInfo& lineStyleInfo, SIntendedSubmitInfo& intendedNextSubmit);
 
 	void drawPolyline(const CPolylineBase& polyline, uint32_t polylineMainObjIdx, SIntendedSubmitInfo& intendedNextSubmit);
+
+	//! Same as `drawPolyline` but only packs the sections in `sectionIndices` and the connectors whose joint lies in [`connectorCullMin`,`connectorCullMax`],
+	//! for long polylines of which a spatial query (see `SpatialIndex`) found only some sections visible. The cull rect should be padded by the line width.
+	void drawPolylineSections(const CPolylineBase& polyline, const LineStyleInfo& lineStyleInfo, std::span<const uint32_t> sectionIndices, const float64_t2& connectorCullMin, const float64_t2& connectorCullMax, SIntendedSubmitInfo& intendedNextSubmit);
+
+	void drawPolylineSections(const CPolylineBase& polyline, uint32_t polylineMainObjIdx, std::span<const uint32_t> sectionIndices, const float64_t2& connectorCullMin, const float64_t2& connectorCullMax, SIntendedSubmitInfo& intendedNextSubmit);
 	
 	// ! Convinience function for Hatch with MSDF Pattern and a solid background
 	void drawHatch(
@@ -114,6 +133,8 @@ public:
 		float32_t rotation,
 		SIntendedSubmitInfo& intendedNextSubmit)
 	{
+		CPUStageProfiler::ScopedStage profilerScope(CPUStage::PACKING);
+
 		auto addImageObject_Internal = [&](const ImageObjectInfo& imageObjectInfo, uint32_t mainObjIdx) -> bool
 			{
 				const uint32_t maxGeometryBufferImageObjects = static_cast<uint32_t>((maxGeometryBufferSize - currentGeometryBufferSize) / sizeof(ImageObjectInfo));
@@ -215,13 +236,8 @@ public:
 
 	smart_refctd_ptr<IGPUImageView> getMSDFsTextureArray() { return msdfTextureArray; }
 
-	uint32_t2 getMSDFResolution() {
-		auto extents = msdfTextureArray->getCreationParameters().image->getCreationParameters().extent;
-		return uint32_t2(extents.width, extents.height);
-	}
-	uint32_t getMSDFMips() {
-		return msdfTextureArray->getCreationParameters().image->getCreationParameters().mipLevels;
-	}
+	uint32_t2 getMSDFResolution() { return msdfResolution; }
+	uint32_t getMSDFMips() { return msdfMipLevels; }
 
 protected:
 	
@@ -273,7 +289,9 @@ protected:
 
 	void addPolylineObjects_Internal(const CPolylineBase& polyline, const CPolylineBase::SectionInfo& section, uint32_t& currentObjectInSection, uint32_t mainObjIdx);
 
-	void addPolylineConnectors_Internal(const CPolylineBase& polyline, uint32_t& currentPolylineConnectorObj, uint32_t mainObjIdx);
+	void addPolylineConnectors_Internal(std::span<const PolylineConnector> connectors, uint32_t& currentPolylineConnectorObj, uint32_t mainObjIdx);
+
+	void addPolylineConnectors_SubmitIfNeeded(std::span<const PolylineConnector> connectors, uint32_t mainObjIdx, SIntendedSubmitInfo& intendedNextSubmit);
 
 	void addLines_Internal(const CPolylineBase& polyline, const CPolylineBase::SectionInfo& section, uint32_t& currentObjectInSection, uint32_t mainObjIdx);
 
@@ -322,6 +340,7 @@ protected:
 	{
 		HATCH_FILL_PATTERN,
 		FONT_GLYPH,
+		PLACEHOLDER,
 	};
 
 	struct MSDFInputInfo
@@ -343,6 +362,9 @@ protected:
 		{
 			computeBlake3Hash();
 		}
+
+		// Stand-in for glyphs whose MSDF isn't available yet, there's only ever one
+		static MSDFInputInfo createPlaceholder() { return MSDFInputInfo(); }
 		
 		bool operator==(const MSDFInputInfo& rhs) const
 		{ return hash == rhs.hash && glyphIndex == rhs.glyphIndex && type == rhs.type;
@@ -363,6 +385,14 @@ protected:
 
 
 	private:
+
+		MSDFInputInfo()
+			: type(MSDFType::PLACEHOLDER)
+			, faceHash({})
+			, glyphIndex(0u)
+		{
+			computeBlake3Hash();
+		}
 		
 		void computeBlake3Hash()
 		{
@@ -406,6 +436,10 @@ protected:
 	// ! mainObjIdx: make sure to pass your mainObjIdx to it if you want it to stay synced/updated if some overflow submit occured which would potentially erase what your mainObject points at.
 	// If you haven't created a mainObject yet, then pass InvalidMainObjectIdx
 	uint32_t addMSDFTexture(const MSDFInputInfo& msdfInput, core::smart_refctd_ptr<ICPUImage>&& cpuImage, uint32_t mainObjIdx, SIntendedSubmitInfo& intendedNextSubmit);
+
+	// Index of a fully "outside" MSDF, so glyphs still waiting on their MSDF keep their slot in the draw but stay invisible
+	uint32_t getPlaceholderMSDFIndex(uint32_t mainObjIdx, SIntendedSubmitInfo& intendedNextSubmit);
+	core::smart_refctd_ptr<ICPUImage> createPlaceholderMSDF();
 	
 	// Members
 	smart_refctd_ptr<IUtilities> m_utilities;
@@ -434,6 +468,8 @@ protected:
 	std::deque<ClipProjectionData> clipProjections; // stack of clip projectios stored so we can resubmit them if geometry buffer got reset.
 	std::deque<uint64_t> clipProjectionAddresses; // stack of clip projection gpu addresses in geometry buffer. to keep track of them in push/pops
 
+	std::vector<PolylineConnector> visibleConnectorsScratch; // reused by `drawPolylineSections` so culling connectors doesn't allocate every call
+
 	// MSDF
 	GetGlyphMSDFTextureFunc getGlyphMSDF;
 	GetHatchFillPatternMSDFTextureFunc getHatchFillPatternMSDF;
@@ -447,5 +483,16 @@ protected:
 	static constexpr asset::E_FORMAT	MSDFTextureFormat = asset::E_FORMAT::EF_R8G8B8A8_SNORM;
 
 	bool m_hasInitializedMSDFTextureArrays = false;
+	uint32_t2 msdfResolution = uint32_t2(0u, 0u);
+	uint32_t msdfMipLevels = 0u;
+
+	// Headless, see `allocateHeadless`. MSDF array layers come from a free list instead of `msdfTextureArrayIndexAllocator` since there are no semaphores to defer frees on
+	bool m_headless = false;
+	HeadlessStats m_headlessStats = {};
+	std::vector<uint32_t> headlessFreeMSDFIndices = {};
+	uint32_t headlessMSDFIndexCount = 0u;
+	uint32_t headlessMaxMSDFs = 0u;
+
+	bool finalizeHeadlessCopies();
 };
 
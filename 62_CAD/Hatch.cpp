@@ -135,6 +135,8 @@ std::array<double, 2> Hatch::Segment::intersect(const Segment& other) const
 
 Hatch::Hatch(std::span<CPolyline> lines, const MajorAxis majorAxis, nbl::system::logger_opt_smart_ptr logger, int32_t* debugStepPtr, const std::function<void(CPolyline, LineStyleInfo)>& debugOutput)
 {
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::HATCH);
+
 	// this threshsold is used to decide when to consider minor position to be 
 	// the same and check tangents because intersection algorithms has rounding 
 	// errors
@@ -1170,6 +1172,8 @@ void shaded(std::vector<CPolyline>& polylines, const float64_t2& offset)
 
 core::smart_refctd_ptr<asset::ICPUImage> Hatch::generateHatchFillPatternMSDF(nbl::ext::TextRendering::TextRenderer* textRenderer, HatchFillPattern fillPattern, uint32_t2 msdfExtents)
 {
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::MSDF);
+
 	std::array<float64_t2, 9u> offsets = {};
 	uint32_t idx = 0u;
 	for (int32_t i = -1; i <= 1; ++i)
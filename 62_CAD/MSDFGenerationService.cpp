@@ -0,0 +1,265 @@
+#include "MSDFGenerationService.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#include "AtomicFileWrite.hpp"
+
+namespace
+{
+	// bump `Version` whenever the layout below or the MSDF generation itself changes, stale files then just get regenerated
+	struct SMSDFFileHeader
+	{
+		static constexpr uint32_t Magic = 0x4644534Du; // "MSDF"
+		static constexpr uint32_t Version = 1u;
+
+		uint32_t magic = Magic;
+		uint32_t version = Version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		uint32_t regionCount;
+		uint32_t pad = 0u;
+		uint64_t bufferSize;
+	};
+}
+
+MSDFGenerationService::MSDFGenerationService(const std::filesystem::path& cacheDirectory, uint32_t workerCount)
+	: m_cacheDirectory(cacheDirectory / ("v" + std::to_string(CacheVersion)))
+{
+	std::error_code ec;
+	// entries of older versions can't be trusted, drop them instead of letting them pile up, but leave anything else alone (newer versions belong to other builds)
+	for (std::filesystem::directory_iterator it(cacheDirectory, ec), end; !ec && it != end; it.increment(ec))
+	{
+		std::error_code typeEc;
+		if (!it->is_directory(typeEc))
+			continue;
+		const auto name = it->path().filename().string();
+		if (name.size() < 2u || name[0] != 'v' || !std::all_of(name.begin() + 1, name.end(), [](const char c) -> bool { return c >= '0' && c <= '9'; }))
+			continue;
+		const auto version = std::strtoull(name.c_str() + 1, nullptr, 10);
+		if (version < CacheVersion)
+		{
+			std::error_code removeEc;
+			std::filesystem::remove_all(it->path(), removeEc);
+		}
+	}
+	ec.clear();
+	std::filesystem::create_directories(m_cacheDirectory, ec);
+	// if we can't create the directory we'll just fail to load and save, generation still works
+
+	workerCount = std::max(workerCount, 1u);
+	m_workers.reserve(workerCount);
+	for (uint32_t i = 0u; i < workerCount; i++)
+		m_workers.emplace_back(&MSDFGenerationService::workerLoop, this, i);
+}
+
+MSDFGenerationService::~MSDFGenerationService()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_quit = true;
+		m_jobs.clear();
+	}
+	m_jobAvailable.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+core::blake3_hash_t MSDFGenerationService::computeGlyphKey(const core::blake3_hash_t& faceHash, uint32_t glyphIdx, nbl::hlsl::uint32_t2 resolution, uint32_t mipLevels, float pixelRange)
+{
+	core::blake3_hasher hasher;
+	hasher.update(&faceHash, sizeof(core::blake3_hash_t));
+	hasher.update(&glyphIdx, sizeof(uint32_t));
+	hasher.update(&resolution, sizeof(resolution));
+	hasher.update(&mipLevels, sizeof(uint32_t));
+	hasher.update(&pixelRange, sizeof(float));
+	return static_cast<core::blake3_hash_t>(hasher);
+}
+
+core::blake3_hash_t MSDFGenerationService::computeHatchFillPatternKey(uint32_t fillPattern, nbl::hlsl::uint32_t2 resolution, uint32_t mipLevels, float pixelRange)
+{
+	// bump when the pattern shapes in `Hatch::generateHatchFillPatternMSDF` change, so stale files on disk stop matching
+	constexpr uint32_t PatternVersion = 1u;
+	constexpr char Domain[] = "HatchFillPattern"; // keeps these from colliding with glyph keys
+
+	core::blake3_hasher hasher;
+	hasher.update(Domain, sizeof(Domain));
+	hasher.update(&PatternVersion, sizeof(uint32_t));
+	hasher.update(&fillPattern, sizeof(uint32_t));
+	hasher.update(&resolution, sizeof(resolution));
+	hasher.update(&mipLevels, sizeof(uint32_t));
+	hasher.update(&pixelRange, sizeof(float));
+	return static_cast<core::blake3_hash_t>(hasher);
+}
+
+core::smart_refctd_ptr<ICPUImage> MSDFGenerationService::request(const core::blake3_hash_t& key, GenerateFunc&& generate)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		auto found = m_ready.find(key);
+		if (found != m_ready.end())
+		{
+			auto retval = std::move(found->second);
+			m_ready.erase(found);
+			return retval;
+		}
+	}
+	enqueue_impl(key, std::move(generate));
+	return nullptr;
+}
+
+void MSDFGenerationService::prefetch(const core::blake3_hash_t& key, GenerateFunc&& generate)
+{
+	enqueue_impl(key, std::move(generate));
+}
+
+MSDFGenerationService::SStats MSDFGenerationService::getStats() const
+{
+	std::lock_guard lock(m_mutex);
+	return {
+		.loadedFromDisk = m_loadedFromDisk,
+		.generated = m_generated,
+		.failed = static_cast<uint32_t>(m_failed.size()),
+		.pending = static_cast<uint32_t>(m_inFlight.size()),
+	};
+}
+
+bool MSDFGenerationService::enqueue_impl(const core::blake3_hash_t& key, GenerateFunc&& generate)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_quit || m_ready.contains(key) || m_inFlight.contains(key) || m_failed.contains(key))
+			return false;
+		m_inFlight.insert(key);
+		m_jobs.push_back({ .key = key, .generate = std::move(generate) });
+	}
+	m_jobAvailable.notify_one();
+	return true;
+}
+
+void MSDFGenerationService::workerLoop(uint32_t workerIx)
+{
+	while (true)
+	{
+		SJob job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_jobAvailable.wait(lock, [&]() { return m_quit || !m_jobs.empty(); });
+			if (m_quit)
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		const auto cachePath = getCachePath(job.key);
+		bool fromDisk = true;
+		auto image = loadFromDisk(cachePath);
+		if (!image)
+		{
+			fromDisk = false;
+			image = job.generate(workerIx);
+			if (image)
+				saveToDisk(cachePath, image.get());
+		}
+
+		std::lock_guard lock(m_mutex);
+		m_inFlight.erase(job.key);
+		if (image)
+		{
+			m_ready[job.key] = std::move(image);
+			(fromDisk ? m_loadedFromDisk : m_generated)++;
+		}
+		else
+			m_failed.insert(job.key);
+	}
+}
+
+std::filesystem::path MSDFGenerationService::getCachePath(const core::blake3_hash_t& key) const
+{
+	constexpr char HexDigits[] = "0123456789abcdef";
+	const auto* bytes = reinterpret_cast<const uint8_t*>(&key);
+	std::string name;
+	name.reserve(sizeof(core::blake3_hash_t) * 2u + 5u);
+	for (size_t i = 0u; i < sizeof(core::blake3_hash_t); i++)
+	{
+		name += HexDigits[bytes[i] >> 4u];
+		name += HexDigits[bytes[i] & 0xfu];
+	}
+	name += ".msdf";
+	return m_cacheDirectory / name;
+}
+
+core::smart_refctd_ptr<ICPUImage> MSDFGenerationService::loadFromDisk(const std::filesystem::path& path) const
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return nullptr;
+
+	std::error_code ec;
+	const uint64_t fileSize = std::filesystem::file_size(path, ec);
+	if (ec)
+		return nullptr;
+
+	SMSDFFileHeader header = {};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return nullptr;
+	if (header.magic != SMSDFFileHeader::Magic || header.version != SMSDFFileHeader::Version || header.regionCount == 0u || header.bufferSize == 0ull)
+		return nullptr;
+	// don't let a corrupt header make us allocate and read whatever it claims, the payload has to be exactly what's left of the file
+	const uint64_t payloadSize = fileSize - sizeof(header);
+	if (header.regionCount > payloadSize / sizeof(IImage::SBufferCopy) || header.bufferSize != payloadSize - sizeof(IImage::SBufferCopy) * uint64_t(header.regionCount))
+		return nullptr;
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<IImage::SBufferCopy>>(header.regionCount);
+	if (!file.read(reinterpret_cast<char*>(regions->data()), sizeof(IImage::SBufferCopy) * header.regionCount))
+		return nullptr;
+
+	ICPUBuffer::SCreationParams bparams;
+	bparams.size = header.bufferSize;
+	auto buffer = ICPUBuffer::create(std::move(bparams));
+	if (!file.read(reinterpret_cast<char*>(buffer->getPointer()), header.bufferSize))
+		return nullptr;
+
+	ICPUImage::SCreationParams imgParams;
+	{
+		imgParams.flags = static_cast<ICPUImage::E_CREATE_FLAGS>(0u); // no flags
+		imgParams.type = ICPUImage::ET_2D;
+		imgParams.format = static_cast<E_FORMAT>(header.format);
+		imgParams.extent = { header.width, header.height, 1u };
+		imgParams.mipLevels = header.mipLevels;
+		imgParams.arrayLayers = 1u;
+		imgParams.samples = ICPUImage::ESCF_1_BIT;
+	}
+	auto image = ICPUImage::create(std::move(imgParams));
+	if (!image || !image->setBufferAndRegions(std::move(buffer), std::move(regions)))
+		return nullptr;
+	return image;
+}
+
+bool MSDFGenerationService::saveToDisk(const std::filesystem::path& path, const ICPUImage* image) const
+{
+	const auto* buffer = image->getBuffer();
+	const auto regions = image->getRegions();
+	if (!buffer || regions.empty())
+		return false;
+
+	const auto& params = image->getCreationParameters();
+	SMSDFFileHeader header = {};
+	header.format = static_cast<uint32_t>(params.format);
+	header.width = params.extent.width;
+	header.height = params.extent.height;
+	header.mipLevels = params.mipLevels;
+	header.regionCount = static_cast<uint32_t>(regions.size());
+	header.bufferSize = buffer->getSize();
+
+	// through a unique temporary so neither a crash nor a concurrent run ever leaves a truncated file under the real name
+	return nbl::examples::writeFileAtomically(path, [&](std::ofstream& file) -> void
+	{
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(regions.data()), sizeof(IImage::SBufferCopy) * regions.size());
+		file.write(reinterpret_cast<const char*>(buffer->getPointer()), header.bufferSize);
+	});
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <nbl/asset/ICPUImage.h>
+#include <nbl/core/hash/blake.h>
+#include <nbl/builtin/hlsl/cpp_compat.hlsl>
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace nbl;
+using namespace nbl::core;
+using namespace nbl::asset;
+
+/// Generates MSDFs on a pool of background threads so the render thread never waits on msdfgen.
+/// Finished MSDFs get persisted into `cacheDirectory` (one file per key) so later runs only have to read them back.
+/// Files live in a subdirectory per `CacheVersion`, the `v<N>` subdirectories of older versions get deleted, newer ones are left to the builds using them.
+class MSDFGenerationService
+{
+public:
+	// bump when keys stop describing what's in the files, e.g. version 1 saved MSDFs of the default font under other faces' keys
+	static constexpr uint32_t CacheVersion = 2u;
+
+	// `workerIx` is in `[0,getWorkerCount())` so the generator can use per-worker state (i.e. a FreeType face per thread)
+	using GenerateFunc = std::function<core::smart_refctd_ptr<ICPUImage>(uint32_t /*workerIx*/)>;
+
+	MSDFGenerationService(const std::filesystem::path& cacheDirectory, uint32_t workerCount);
+	~MSDFGenerationService();
+
+	// Identifies the MSDF on disk, anything that changes the generated texels must go in here
+	static core::blake3_hash_t computeGlyphKey(const core::blake3_hash_t& faceHash, uint32_t glyphIdx, nbl::hlsl::uint32_t2 resolution, uint32_t mipLevels, float pixelRange);
+	// Hatch fill patterns are fixed shapes, so the pattern enum value stands in for the face and glyph
+	static core::blake3_hash_t computeHatchFillPatternKey(uint32_t fillPattern, nbl::hlsl::uint32_t2 resolution, uint32_t mipLevels, float pixelRange);
+
+	// Never blocks, returns the MSDF if it finished since the last call (handing over ownership) otherwise nullptr.
+	// If `key` isn't ready, in flight or known to fail, `generate` gets queued up for the workers.
+	core::smart_refctd_ptr<ICPUImage> request(const core::blake3_hash_t& key, GenerateFunc&& generate);
+
+	// Same as `request` but doesn't pick up the result, use to warm up glyphs you know will be drawn soon
+	void prefetch(const core::blake3_hash_t& key, GenerateFunc&& generate);
+
+	uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	struct SStats
+	{
+		uint32_t loadedFromDisk;
+		uint32_t generated;
+		uint32_t failed;
+		uint32_t pending;
+	};
+	SStats getStats() const;
+
+protected:
+	struct SJob
+	{
+		core::blake3_hash_t key;
+		GenerateFunc generate;
+	};
+
+	// returns whether the job needed to be queued
+	bool enqueue_impl(const core::blake3_hash_t& key, GenerateFunc&& generate);
+	void workerLoop(uint32_t workerIx);
+
+	std::filesystem::path getCachePath(const core::blake3_hash_t& key) const;
+	core::smart_refctd_ptr<ICPUImage> loadFromDisk(const std::filesystem::path& path) const;
+	bool saveToDisk(const std::filesystem::path& path, const ICPUImage* image) const;
+
+	std::filesystem::path m_cacheDirectory;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	std::deque<SJob> m_jobs;
+	std::unordered_set<core::blake3_hash_t> m_inFlight; // queued or being worked on
+	std::unordered_set<core::blake3_hash_t> m_failed; // so we don't retry a broken glyph every frame
+	std::unordered_map<core::blake3_hash_t, core::smart_refctd_ptr<ICPUImage>> m_ready;
+	uint32_t m_loadedFromDisk = 0u;
+	uint32_t m_generated = 0u;
+	bool m_quit = false;
+
+	std::vector<std::thread> m_workers;
+};
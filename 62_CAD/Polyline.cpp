@@ -4,6 +4,8 @@ void CPolyline::preprocessPolylineWithStyle(const LineStyleInfo& lineStyle, floa
 {
 	if (lineStyle.skipPreprocess())
 		return;
+
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::POLYLINE);
 	const float64_t2 DiscontinuityErrorTolerance = float64_t2(discontinuityErrorTolerance, discontinuityErrorTolerance);
 	// We allow for discontinuity now, so no need to enable this unless testing.
 	// DISCONNECTION DETECTED, will break styling and offsetting the polyline, if you don't care about those then ignore discontinuity.
@@ -446,6 +448,8 @@ CPolyline CPolyline::generateParallelPolyline(float64_t offset, const float64_t
 
 void CPolyline::makeWideWhole(CPolyline& outOffset1, CPolyline& outOffset2, float64_t offset, const float64_t maxError) const
 {
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::POLYLINE);
+
 	outOffset1 = generateParallelPolyline(offset, maxError);
 	outOffset2 = generateParallelPolyline(-1.0 * offset, maxError);
 
@@ -470,6 +474,8 @@ void CPolyline::stippleBreakDown(const LineStyleInfo& lineStyle, const OutputPol
 	if (!lineStyle.isVisible())
 		return;
 
+	CPUStageProfiler::ScopedStage profilerScope(CPUStage::POLYLINE);
+
 	// currently only works for road styles with only 2 stipple values (1 draw, 1 gap)
 	assert(lineStyle.stipplePatternSize <= 1);
 
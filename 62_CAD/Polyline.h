@@ -6,6 +6,7 @@
 #include <nbl/builtin/hlsl/math/geometry.hlsl>
 #include <nbl/builtin/hlsl/shapes/util.hlsl>
 #include "Curves.h"
+#include "CPUStageProfiler.h"
 
 struct PolylineSettings
 {
@@ -439,6 +440,8 @@ public:
 		if (linePoints.size() <= 1u)
 			return;
 
+		CPUStageProfiler::ScopedStage profilerScope(CPUStage::POLYLINE);
+
 		const uint32_t oldLinePointSize = m_linePoints.size();
 		const uint32_t newLinePointSize = oldLinePointSize + linePoints.size();
 		m_linePoints.resize(newLinePointSize);
@@ -459,6 +462,8 @@ public:
 
 	void addEllipticalArcs(const std::span<curves::EllipticalArcInfo> ellipses, double errorThreshold)
 	{
+		CPUStageProfiler::ScopedStage profilerScope(CPUStage::POLYLINE);
+
 		nbl::core::vector<nbl::hlsl::shapes::QuadraticBezier<double>> beziersArray;
 		for (const auto& ellipticalInfo : ellipses)
 		{
@@ -478,6 +483,8 @@ public:
 		if (quadBeziers.empty())
 			return;
 
+		CPUStageProfiler::ScopedStage profilerScope(CPUStage::POLYLINE);
+
 		constexpr QuadraticBezierInfo EMPTY_QUADRATIC_BEZIER_INFO = {};
 		const uint32_t oldQuadBezierSize = m_quadBeziers.size();
 		const uint32_t newQuadBezierSize = oldQuadBezierSize + quadBeziers.size();
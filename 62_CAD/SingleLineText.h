@@ -11,15 +11,26 @@ using namespace nbl::ext::TextRendering;
 class SingleLineText
 {
 public:
-	// constructs and fills the `glyphBoxes`
-	SingleLineText(nbl::ext::TextRendering::FontFace* face, const std::string& text);
-	
+	struct GlyphBox
+	{
+		float64_t2 topLeft;
+		float32_t2 size;
+		uint32_t glyphIdx;
+		uint32_t pad;
+	};
+
 	struct BoundingBox
 	{
 		float64_t2 min;
 		float64_t2 max;
 	};
 
+	// constructs and fills the `glyphBoxes`, goes through FreeType for every character, use `TextLayoutCache` for repeated or multi-line text
+	SingleLineText(nbl::ext::TextRendering::FontFace* face, const std::string& text);
+	// takes an already laid out text (see `TextLayoutCache`)
+	SingleLineText(std::vector<GlyphBox>&& glyphBoxes, const BoundingBox& boundingBox)
+		: m_boundingBox(boundingBox), m_glyphBoxes(std::move(glyphBoxes)) {}
+
 	BoundingBox GetAABB() const { return m_boundingBox; }
 
 	// iterates over `glyphBoxes` generates textures msdfs if failed to add to cache (through that lambda you put)
@@ -39,16 +50,10 @@ public:
 		const float32_t italicTilt = 0.0f,
 		const float32_t boldInPixels = 0.0f) const;
 
+	const std::vector<GlyphBox>& getGlyphBoxes() const { return m_glyphBoxes; }
+
 protected:
 	
-	struct GlyphBox
-	{
-		float64_t2 topLeft;
-		float32_t2 size;
-		uint32_t glyphIdx;
-		uint32_t pad;
-	};
-	
 	BoundingBox m_boundingBox = {};
 	std::vector<GlyphBox> m_glyphBoxes;
 };
\ No newline at end of file
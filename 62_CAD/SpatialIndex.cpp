@@ -0,0 +1,326 @@
+#include "SpatialIndex.h"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t HilbertGridBits = 16u;
+
+	// distance along the Hilbert curve filling a 2^16 x 2^16 grid, neighbours along the curve are neighbours in the plane
+	uint32_t hilbertIndex(uint32_t x, uint32_t y)
+	{
+		constexpr uint32_t GridSize = 0x1u << HilbertGridBits;
+		uint32_t d = 0u;
+		for (uint32_t s = GridSize >> 1u; s > 0u; s >>= 1u)
+		{
+			const uint32_t rx = (x & s) ? 1u : 0u;
+			const uint32_t ry = (y & s) ? 1u : 0u;
+			d += s * s * ((3u * rx) ^ ry);
+			// orient the quadrant so the curve enters and leaves it where the previous level expects
+			if (ry == 0u)
+			{
+				if (rx == 1u)
+				{
+					x = GridSize - 1u - x;
+					y = GridSize - 1u - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return d;
+	}
+
+	// sorts a run per worker, then merges the runs pairwise with every merge of a round on its own thread
+	void parallelSort(std::vector<uint64_t>& keys, const uint32_t workerCount)
+	{
+		// below this a run isn't worth a thread
+		constexpr size_t MinRunLength = 0x1ull << 12u;
+		const size_t count = keys.size();
+		const size_t runCount = std::min<size_t>(std::bit_ceil(workerCount), std::max<size_t>(count / MinRunLength, 1ull));
+		size_t width = (count + runCount - 1ull) / runCount;
+		nbl::examples::parallelFor(runCount, [&](const size_t begin, const size_t end, const uint32_t) -> void
+			{
+				for (size_t run = begin; run < end; run++)
+					std::sort(keys.begin() + std::min<size_t>(run * width, count), keys.begin() + std::min<size_t>((run + 1ull) * width, count));
+			}, workerCount, 1ull);
+
+		std::vector<uint64_t> scratch(count);
+		for (; width < count; width *= 2ull)
+		{
+			const size_t pairCount = (count + 2ull * width - 1ull) / (2ull * width);
+			nbl::examples::parallelFor(pairCount, [&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t pair = begin; pair < end; pair++)
+					{
+						const size_t first = pair * 2ull * width;
+						const size_t middle = std::min<size_t>(first + width, count);
+						const size_t last = std::min<size_t>(first + 2ull * width, count);
+						std::merge(keys.begin() + first, keys.begin() + middle, keys.begin() + middle, keys.begin() + last, scratch.begin() + first);
+					}
+				}, workerCount, 1ull);
+			keys.swap(scratch);
+		}
+	}
+
+	SpatialIndex::AABB emptyAABB()
+	{
+		constexpr float64_t Max = std::numeric_limits<float64_t>::max();
+		constexpr float64_t Lowest = std::numeric_limits<float64_t>::lowest();
+		return { float64_t2(Max, Max), float64_t2(Lowest, Lowest) };
+	}
+
+	void extend(SpatialIndex::AABB& aabb, const SpatialIndex::AABB& other)
+	{
+		aabb.min = float64_t2(std::min(aabb.min.x, other.min.x), std::min(aabb.min.y, other.min.y));
+		aabb.max = float64_t2(std::max(aabb.max.x, other.max.x), std::max(aabb.max.y, other.max.y));
+	}
+}
+
+void SpatialIndex::build(std::span<const AABB> bounds, uint32_t workerCount)
+{
+	m_bounds.assign(bounds.begin(), bounds.end());
+	m_location.assign(bounds.size(), 0u);
+	m_liveCount = static_cast<uint32_t>(bounds.size());
+	m_inPlaceUpdates = 0ull;
+	m_deferredUpdates = 0ull;
+	m_rebuilds = 0u;
+	rebuild(workerCount);
+}
+
+uint32_t SpatialIndex::insert(const AABB& bounds)
+{
+	const uint32_t id = static_cast<uint32_t>(m_bounds.size());
+	m_bounds.push_back(bounds);
+	m_location.push_back(0u);
+	moveToDelta(id);
+	m_liveCount++;
+	return id;
+}
+
+void SpatialIndex::update(uint32_t id, const AABB& bounds)
+{
+	const uint32_t location = m_location[id];
+	assert(location != Removed);
+	m_bounds[id] = bounds;
+	// the delta list reads `m_bounds` directly
+	if (location & InDeltaFlag)
+		return;
+
+	// every ancestor contains the leaf, so a box which stays inside it doesn't invalidate anything
+	if (contains(m_nodes[location / NodeCapacity].bounds, bounds))
+	{
+		m_slotBounds[location] = bounds;
+		m_inPlaceUpdates++;
+	}
+	else
+	{
+		m_order[location] = InvalidItem;
+		m_tombstones++;
+		moveToDelta(id);
+		m_deferredUpdates++;
+	}
+}
+
+void SpatialIndex::remove(uint32_t id)
+{
+	const uint32_t location = m_location[id];
+	assert(location != Removed);
+	if (location & InDeltaFlag)
+	{
+		const uint32_t deltaIx = location & ~InDeltaFlag;
+		m_delta[deltaIx] = m_delta.back();
+		m_location[m_delta[deltaIx]] = InDeltaFlag | deltaIx;
+		m_delta.pop_back();
+	}
+	else
+	{
+		m_order[location] = InvalidItem;
+		m_tombstones++;
+	}
+	m_location[id] = Removed;
+	m_liveCount--;
+}
+
+bool SpatialIndex::commit(uint32_t workerCount)
+{
+	if ((uint64_t(m_delta.size()) + m_tombstones) * RebuildRatio <= m_liveCount)
+		return false;
+	rebuild(workerCount);
+	m_rebuilds++;
+	return true;
+}
+
+void SpatialIndex::query(const AABB& view, std::vector<uint32_t>& outIds) const
+{
+	if (!m_nodes.empty())
+	{
+		std::array<uint32_t, MaxTraversalStack> stack;
+		uint32_t stackSize = 0u;
+		stack[stackSize++] = static_cast<uint32_t>(m_nodes.size()) - 1u;
+		while (stackSize > 0u)
+		{
+			const SNode& node = m_nodes[stack[--stackSize]];
+			if (!overlaps(view, node.bounds))
+				continue;
+
+			const uint32_t slotEnd = node.firstSlot + node.slotCount;
+			if (contains(view, node.bounds))
+			{
+				// everything below is visible, and it's all in one range
+				for (uint32_t slot = node.firstSlot; slot < slotEnd; slot++)
+					if (m_order[slot] != InvalidItem)
+						outIds.push_back(m_order[slot]);
+			}
+			else if (node.childCount == 0u)
+			{
+				for (uint32_t slot = node.firstSlot; slot < slotEnd; slot++)
+					if (m_order[slot] != InvalidItem && overlaps(view, m_slotBounds[slot]))
+						outIds.push_back(m_order[slot]);
+			}
+			else
+			{
+				assert(stackSize + node.childCount <= MaxTraversalStack);
+				for (uint32_t child = 0u; child < node.childCount; child++)
+					stack[stackSize++] = node.firstChild + child;
+			}
+		}
+	}
+
+	for (const uint32_t id : m_delta)
+		if (overlaps(view, m_bounds[id]))
+			outIds.push_back(id);
+}
+
+SpatialIndex::SStats SpatialIndex::getStats() const
+{
+	SStats stats = {};
+	stats.items = m_liveCount;
+	stats.nodes = static_cast<uint32_t>(m_nodes.size());
+	stats.depth = m_depth;
+	stats.deltaItems = static_cast<uint32_t>(m_delta.size());
+	stats.tombstones = m_tombstones;
+	stats.inPlaceUpdates = m_inPlaceUpdates;
+	stats.deferredUpdates = m_deferredUpdates;
+	stats.rebuilds = m_rebuilds;
+	return stats;
+}
+
+void SpatialIndex::rebuild(uint32_t workerCount)
+{
+	if (workerCount == 0u)
+		workerCount = nbl::examples::getDefaultWorkerCount();
+
+	// sort keys are the Hilbert index of the box center in the high and the id in the low bits
+	std::vector<uint64_t> keys;
+	keys.reserve(m_liveCount);
+	for (uint32_t id = 0u; id < m_location.size(); id++)
+		if (m_location[id] != Removed)
+			keys.push_back(id);
+	const uint32_t itemCount = static_cast<uint32_t>(keys.size());
+
+	// the curve only needs to cover the centers
+	std::vector<AABB> workerCenterBounds(workerCount, emptyAABB());
+	nbl::examples::parallelFor(itemCount, [&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+		{
+			AABB& centerBounds = workerCenterBounds[workerIx];
+			for (size_t i = begin; i < end; i++)
+			{
+				const AABB& bounds = m_bounds[keys[i]];
+				const float64_t2 center = (bounds.min + bounds.max) * 0.5;
+				extend(centerBounds, { center, center });
+			}
+		}, workerCount);
+	AABB centerBounds = emptyAABB();
+	for (const auto& bounds : workerCenterBounds)
+		extend(centerBounds, bounds);
+
+	const float64_t2 extent = centerBounds.max - centerBounds.min;
+	constexpr float64_t MaxGridCoord = float64_t((0x1u << HilbertGridBits) - 1u);
+	const float64_t2 scale = float64_t2(extent.x > 0.0 ? MaxGridCoord / extent.x : 0.0, extent.y > 0.0 ? MaxGridCoord / extent.y : 0.0);
+	nbl::examples::parallelFor(itemCount, [&](const size_t begin, const size_t end, const uint32_t) -> void
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const AABB& bounds = m_bounds[keys[i]];
+				const float64_t2 gridCoord = ((bounds.min + bounds.max) * 0.5 - centerBounds.min) * scale;
+				keys[i] |= uint64_t(hilbertIndex(static_cast<uint32_t>(gridCoord.x), static_cast<uint32_t>(gridCoord.y))) << 32u;
+			}
+		}, workerCount);
+	parallelSort(keys, workerCount);
+
+	m_order.resize(itemCount);
+	m_slotBounds.resize(itemCount);
+	nbl::examples::parallelFor(itemCount, [&](const size_t begin, const size_t end, const uint32_t) -> void
+		{
+			for (size_t slot = begin; slot < end; slot++)
+			{
+				const uint32_t id = static_cast<uint32_t>(keys[slot]);
+				m_order[slot] = id;
+				m_slotBounds[slot] = m_bounds[id];
+				m_location[id] = static_cast<uint32_t>(slot);
+			}
+		}, workerCount);
+
+	m_nodes.clear();
+	m_delta.clear();
+	m_tombstones = 0u;
+	m_depth = 0u;
+	if (itemCount == 0u)
+		return;
+
+	// leaves take consecutive slots, every level above takes consecutive nodes of the one below, so every node covers one range of slots
+	const uint32_t leafCount = (itemCount + NodeCapacity - 1u) / NodeCapacity;
+	m_nodes.resize(leafCount);
+	nbl::examples::parallelFor(leafCount, [&](const size_t begin, const size_t end, const uint32_t) -> void
+		{
+			for (size_t leaf = begin; leaf < end; leaf++)
+			{
+				SNode& node = m_nodes[leaf];
+				node.bounds = emptyAABB();
+				node.firstChild = 0u;
+				node.childCount = 0u;
+				node.firstSlot = static_cast<uint32_t>(leaf) * NodeCapacity;
+				node.slotCount = std::min(NodeCapacity, itemCount - node.firstSlot);
+				for (uint32_t slot = node.firstSlot; slot < node.firstSlot + node.slotCount; slot++)
+					extend(node.bounds, m_slotBounds[slot]);
+			}
+		}, workerCount);
+	m_depth = 1u;
+
+	for (uint32_t levelBegin = 0u, levelCount = leafCount; levelCount > 1u; m_depth++)
+	{
+		const uint32_t parentBegin = levelBegin + levelCount;
+		const uint32_t parentCount = (levelCount + NodeCapacity - 1u) / NodeCapacity;
+		m_nodes.resize(parentBegin + parentCount);
+		nbl::examples::parallelFor(parentCount, [&](const size_t begin, const size_t end, const uint32_t) -> void
+			{
+				for (size_t parent = begin; parent < end; parent++)
+				{
+					const uint32_t firstChildInLevel = static_cast<uint32_t>(parent) * NodeCapacity;
+					SNode& node = m_nodes[parentBegin + parent];
+					node.bounds = emptyAABB();
+					node.firstChild = levelBegin + firstChildInLevel;
+					node.childCount = std::min(NodeCapacity, levelCount - firstChildInLevel);
+					node.firstSlot = m_nodes[node.firstChild].firstSlot;
+					node.slotCount = 0u;
+					for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; child++)
+					{
+						extend(node.bounds, m_nodes[child].bounds);
+						node.slotCount += m_nodes[child].slotCount;
+					}
+				}
+			}, workerCount);
+		levelBegin = parentBegin;
+		levelCount = parentCount;
+	}
+}
+
+void SpatialIndex::moveToDelta(uint32_t id)
+{
+	m_location[id] = InDeltaFlag | static_cast<uint32_t>(m_delta.size());
+	m_delta.push_back(id);
+}
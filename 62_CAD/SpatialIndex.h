@@ -0,0 +1,99 @@
+#pragma once
+#include <nabla.h>
+#include <nbl/builtin/hlsl/cpp_compat.hlsl>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace nbl;
+using namespace nbl::hlsl;
+
+/// Retained 2D index over the world space (float64) bounding boxes of a drawing's objects, so a frame only packs what the view can see.
+/// It's a packed R-tree bulk loaded in Hilbert order of the box centers: every node covers a contiguous range of the sorted items, which keeps
+/// leaves cache friendly and lets a query emit a whole range without testing the items once a node lies fully inside the view.
+/// Edits don't touch the tree structure: a box that still fits its leaf gets updated in place, anything else goes to a small linearly scanned
+/// delta list and leaves a tombstone behind, `commit` rebuilds once those pile up. Queries are const and can run concurrently, edits can't.
+class SpatialIndex
+{
+public:
+	struct AABB
+	{
+		float64_t2 min;
+		float64_t2 max;
+	};
+
+	static constexpr uint32_t NodeCapacity = 16u;
+
+	// Replaces everything, `bounds[i]` gets the id `i`. Sorting and computing the node bounds runs on `workerCount` threads.
+	void build(std::span<const AABB> bounds, uint32_t workerCount = 0u);
+
+	// Ids are never reused, a removed id stays invalid
+	uint32_t insert(const AABB& bounds);
+	void update(uint32_t id, const AABB& bounds);
+	void remove(uint32_t id);
+	// Rebuilds the tree over the live items (keeping their ids) if the delta list and tombstones got too big for queries to ignore, returns whether it did
+	bool commit(uint32_t workerCount = 0u);
+
+	// Appends the ids of all items whose bounds overlap `view` to `outIds`, in no particular order
+	void query(const AABB& view, std::vector<uint32_t>& outIds) const;
+
+	const AABB& getBounds(uint32_t id) const { return m_bounds[id]; }
+	uint32_t getItemCount() const { return m_liveCount; }
+
+	struct SStats
+	{
+		uint32_t items;
+		uint32_t nodes;
+		uint32_t depth;
+		uint32_t deltaItems;
+		uint32_t tombstones;
+		uint64_t inPlaceUpdates;
+		uint64_t deferredUpdates; // ones that didn't fit their leaf and went to the delta list
+		uint32_t rebuilds;
+	};
+	SStats getStats() const;
+
+protected:
+	struct SNode
+	{
+		AABB bounds;
+		uint32_t firstChild; // leaves have no child nodes, their children are the slots
+		uint32_t childCount;
+		uint32_t firstSlot;
+		uint32_t slotCount;
+	};
+
+	// `m_location` entries, the low bits are the slot in the tree or the position in `m_delta`
+	static constexpr uint32_t InDeltaFlag = 0x1u << 31u;
+	static constexpr uint32_t Removed = ~0u;
+	// in `m_order` for slots whose item got removed or moved to the delta list
+	static constexpr uint32_t InvalidItem = ~0u;
+	// rebuild once more than 1/8th of the live items are in the delta list or left tombstones behind
+	static constexpr uint32_t RebuildRatio = 8u;
+	// a node only pushes its children once it's popped, so this covers trees far deeper than 32bit ids can make
+	static constexpr uint32_t MaxTraversalStack = 8u * NodeCapacity;
+
+	static bool overlaps(const AABB& a, const AABB& b) { return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y; }
+	static bool contains(const AABB& outer, const AABB& inner) { return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && inner.max.x <= outer.max.x && inner.max.y <= outer.max.y; }
+
+	void rebuild(uint32_t workerCount);
+	void moveToDelta(uint32_t id);
+
+	// indexed by id
+	std::vector<AABB> m_bounds;
+	std::vector<uint32_t> m_location;
+	// indexed by slot, `m_slotBounds` duplicates `m_bounds` in tree order so leaves get scanned linearly
+	std::vector<uint32_t> m_order;
+	std::vector<AABB> m_slotBounds;
+	// levels one after the other starting with the leaves, the root is last
+	std::vector<SNode> m_nodes;
+	std::vector<uint32_t> m_delta;
+	uint32_t m_liveCount = 0u;
+	uint32_t m_tombstones = 0u;
+	uint32_t m_depth = 0u;
+	uint64_t m_inPlaceUpdates = 0ull;
+	uint64_t m_deferredUpdates = 0ull;
+	uint32_t m_rebuilds = 0u;
+};
@@ -0,0 +1,208 @@
+#include "TextLayoutCache.h"
+#include "ParallelFor.hpp"
+
+TextLayoutCache::SLayoutKey::SLayoutKey(const core::blake3_hash_t& faceHash, std::string_view text, const SLayoutParams& params)
+{
+	const uint8_t kerning = params.kerning ? 1u : 0u;
+	core::blake3_hasher hasher;
+	hasher.update(&faceHash, sizeof(core::blake3_hash_t));
+	hasher.update(&params.lineSpacing, sizeof(float64_t));
+	hasher.update(&kerning, sizeof(uint8_t));
+	hasher.update(text.data(), text.size());
+	hash = static_cast<core::blake3_hash_t>(hasher);
+	lookupHash = std::hash<core::blake3_hash_t>{}(hash);
+}
+
+std::shared_ptr<const SingleLineText> TextLayoutCache::layout(FontFace* face, std::string_view text, const SLayoutParams& params)
+{
+	const SLayoutKey key(face->getHash(), text, params);
+
+	std::lock_guard lock(m_mutex);
+	if (auto* found = m_layouts->get(key))
+	{
+		m_hits++;
+		return *found;
+	}
+	m_misses++;
+	auto retval = layout_impl(shape_impl(face, text, params.kerning), text, params);
+	m_layouts->insert(key, retval);
+	return retval;
+}
+
+void TextLayoutCache::layoutBatch(std::span<const SLayoutRequest> requests, std::span<std::shared_ptr<const SingleLineText>> outLayouts, uint32_t workerCount)
+{
+	assert(outLayouts.size() >= requests.size());
+
+	struct SMiss
+	{
+		uint32_t requestIx;
+		const SFaceGlyphs* faceGlyphs;
+	};
+
+	std::lock_guard lock(m_mutex);
+
+	// serial pass: resolve hits and do all the FreeType work, identical requests within the batch only get laid out once
+	std::vector<SMiss> misses;
+	std::vector<std::pair<uint32_t, uint32_t>> duplicates; // (request, request it duplicates)
+	std::unordered_map<SLayoutKey, uint32_t, SLayoutKeyHash> firstMiss;
+	std::vector<SLayoutKey> missKeys;
+	for (uint32_t i = 0u; i < requests.size(); i++)
+	{
+		const auto& request = requests[i];
+		SLayoutKey key(request.face->getHash(), request.text, request.params);
+		if (auto* found = m_layouts->get(key))
+		{
+			m_hits++;
+			outLayouts[i] = *found;
+			continue;
+		}
+		m_misses++;
+
+		auto [it, inserted] = firstMiss.try_emplace(key, i);
+		if (inserted)
+		{
+			misses.push_back({ .requestIx = i, .faceGlyphs = &shape_impl(request.face, request.text, request.params.kerning) });
+			missKeys.push_back(std::move(key));
+		}
+		else
+			duplicates.emplace_back(i, it->second);
+	}
+
+	// parallel pass: the layout only reads the face tables, which nothing can modify while we hold the lock
+	nbl::examples::parallelFor(misses.size(),
+		[&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+		{
+			for (size_t j = begin; j < end; j++)
+			{
+				const auto& request = requests[misses[j].requestIx];
+				outLayouts[misses[j].requestIx] = layout_impl(*misses[j].faceGlyphs, request.text, request.params);
+			}
+		},
+		workerCount
+	);
+
+	for (size_t j = 0u; j < misses.size(); j++)
+		m_layouts->insert(missKeys[j], outLayouts[misses[j].requestIx]);
+	for (const auto& [requestIx, originalIx] : duplicates)
+		outLayouts[requestIx] = outLayouts[originalIx];
+}
+
+TextLayoutCache::SStats TextLayoutCache::getStats() const
+{
+	std::lock_guard lock(m_mutex);
+	uint32_t shapedGlyphs = 0u;
+	for (const auto& [faceHash, faceGlyphs] : m_faces)
+		shapedGlyphs += static_cast<uint32_t>(faceGlyphs.glyphs.size());
+	return { .hits = m_hits, .misses = m_misses, .shapedGlyphs = shapedGlyphs };
+}
+
+void TextLayoutCache::clear()
+{
+	std::lock_guard lock(m_mutex);
+	m_layouts = std::make_unique<LayoutLRUCache>(m_maxLayouts);
+	m_faces.clear();
+	m_hits = 0ull;
+	m_misses = 0ull;
+}
+
+const TextLayoutCache::SFaceGlyphs& TextLayoutCache::shape_impl(FontFace* face, std::string_view text, bool kerning)
+{
+	auto [faceIt, newFace] = m_faces.try_emplace(face->getHash());
+	SFaceGlyphs& faceGlyphs = faceIt->second;
+
+	FT_Face ftFace = face->getFreetypeFace();
+	if (newFace && ftFace->size)
+		faceGlyphs.lineHeight = static_cast<float64_t>(ftFace->size->metrics.height) / 64.0; // 26.6 fixed point, same units as the glyph metrics
+
+	kerning = kerning && FT_HAS_KERNING(ftFace);
+	uint32_t prevGlyphIdx = 0u;
+	for (const char c : text)
+	{
+		if (c == '\n')
+		{
+			prevGlyphIdx = 0u;
+			continue;
+		}
+
+		const wchar_t charCode = toCharCode(c);
+		auto glyphIt = faceGlyphs.glyphs.find(charCode);
+		if (glyphIt == faceGlyphs.glyphs.end())
+		{
+			const auto glyphIndex = face->getGlyphIndex(charCode);
+			const auto glyphMetrics = face->getGlyphMetrics(glyphIndex);
+			SGlyph glyph = {
+				.index = glyphIndex,
+				.horizontalBearing = glyphMetrics.horizontalBearing,
+				.size = glyphMetrics.size,
+				.advance = glyphMetrics.advance,
+			};
+			glyphIt = faceGlyphs.glyphs.emplace(charCode, glyph).first;
+		}
+
+		const uint32_t glyphIdx = glyphIt->second.index;
+		if (kerning && prevGlyphIdx != 0u && glyphIdx != 0u)
+		{
+			const uint64_t pairKey = getKerningPairKey(prevGlyphIdx, glyphIdx);
+			if (!faceGlyphs.kerning.contains(pairKey))
+			{
+				FT_Vector delta = {};
+				const bool success = FT_Get_Kerning(ftFace, prevGlyphIdx, glyphIdx, FT_KERNING_DEFAULT, &delta) == 0;
+				faceGlyphs.kerning.emplace(pairKey, success ? static_cast<float64_t>(delta.x) / 64.0 : 0.0);
+			}
+		}
+		prevGlyphIdx = glyphIdx;
+	}
+	return faceGlyphs;
+}
+
+std::shared_ptr<const SingleLineText> TextLayoutCache::layout_impl(const SFaceGlyphs& faceGlyphs, std::string_view text, const SLayoutParams& params)
+{
+	std::vector<SingleLineText::GlyphBox> glyphBoxes;
+	glyphBoxes.reserve(text.length());
+
+	SingleLineText::BoundingBox boundingBox = {};
+	boundingBox.min = float64_t2(0.0, 0.0);
+	boundingBox.max = float64_t2(0.0, 0.0);
+
+	float64_t2 currentPos = float64_t2(0.0, 0.0);
+	uint32_t prevGlyphIdx = 0u;
+	for (const char c : text)
+	{
+		if (c == '\n')
+		{
+			currentPos = float64_t2(0.0, currentPos.y - faceGlyphs.lineHeight * params.lineSpacing);
+			prevGlyphIdx = 0u;
+			continue;
+		}
+
+		const SGlyph& glyph = faceGlyphs.glyphs.at(toCharCode(c));
+		if (params.kerning && prevGlyphIdx != 0u && glyph.index != 0u)
+		{
+			auto found = faceGlyphs.kerning.find(getKerningPairKey(prevGlyphIdx, glyph.index));
+			if (found != faceGlyphs.kerning.end())
+				currentPos.x += found->second;
+		}
+
+		const bool skipGenerateGlyph = (glyph.index == 0 || (glyph.size.x == 0.0 && glyph.size.y == 0.0));
+		if (!skipGenerateGlyph)
+		{
+			SingleLineText::GlyphBox glyphBbox =
+			{
+				.topLeft = currentPos + glyph.horizontalBearing,
+				.size = glyph.size,
+				.glyphIdx = glyph.index,
+			};
+
+			boundingBox.min.x = nbl::core::min(boundingBox.min.x, glyphBbox.topLeft.x);
+			boundingBox.min.y = nbl::core::min(boundingBox.min.y, glyphBbox.topLeft.y - glyphBbox.size.y);
+			boundingBox.max.x = nbl::core::max(boundingBox.max.x, glyphBbox.topLeft.x + glyphBbox.size.x);
+			boundingBox.max.y = nbl::core::max(boundingBox.max.y, glyphBbox.topLeft.y);
+
+			glyphBoxes.push_back(glyphBbox);
+		}
+		currentPos += glyph.advance;
+		prevGlyphIdx = glyph.index;
+	}
+
+	return std::make_shared<const SingleLineText>(std::move(glyphBoxes), boundingBox);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "SingleLineText.h"
+#include <nbl/core/containers/LRUCache.h>
+
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+/// Shapes text (glyph indices, metrics and kerning from FreeType) and lays it out into `SingleLineText`s, caching the results.
+/// Repeated labels, which CAD annotations are full of, then cost a hash lookup instead of a FreeType trip for every character.
+/// Everything FreeType told us is memoized per face, the layout itself only reads those tables which lets `layoutBatch` run it on many threads.
+class TextLayoutCache
+{
+public:
+	struct SLayoutParams
+	{
+		// multiplier on the font's line height between the baselines of consecutive lines
+		float64_t lineSpacing = 1.0;
+		bool kerning = true;
+	};
+
+	struct SLayoutRequest
+	{
+		FontFace* face;
+		std::string_view text;
+		SLayoutParams params = {};
+	};
+
+	TextLayoutCache(uint32_t maxLayouts) : m_maxLayouts(maxLayouts), m_layouts(std::make_unique<LayoutLRUCache>(maxLayouts)) {}
+
+	// '\n' starts a new line. The layout is in font units just like `SingleLineText`'s, size is only a transform at draw time so it's not part of the key.
+	std::shared_ptr<const SingleLineText> layout(FontFace* face, std::string_view text, const SLayoutParams& params = {});
+
+	// Fills `outLayouts[i]` with the layout of `requests[i]`, cache misses get shaped serially and then laid out on `workerCount` threads.
+	// Holds the cache exclusively for the whole batch.
+	void layoutBatch(std::span<const SLayoutRequest> requests, std::span<std::shared_ptr<const SingleLineText>> outLayouts, uint32_t workerCount = 0u);
+
+	struct SStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint32_t shapedGlyphs; // over all faces
+	};
+	SStats getStats() const;
+
+	void clear();
+
+protected:
+	struct SGlyph
+	{
+		uint32_t index;
+		float64_t2 horizontalBearing;
+		float32_t2 size;
+		float64_t2 advance;
+	};
+
+	struct SFaceGlyphs
+	{
+		std::unordered_map<wchar_t, SGlyph> glyphs;
+		std::unordered_map<uint64_t, float64_t> kerning; // keyed by `(leftGlyphIdx<<32)|rightGlyphIdx`, has zeroes too so we don't ask FreeType again
+		float64_t lineHeight = 0.0;
+	};
+
+	struct SLayoutKey
+	{
+		SLayoutKey(const core::blake3_hash_t& faceHash, std::string_view text, const SLayoutParams& params);
+
+		bool operator==(const SLayoutKey& rhs) const { return hash == rhs.hash; }
+
+		core::blake3_hash_t hash = {};
+		size_t lookupHash = 0ull; // for containers expecting size_t hash
+	};
+	struct SLayoutKeyHash { std::size_t operator()(const SLayoutKey& key) const { return key.lookupHash; } };
+
+	static wchar_t toCharCode(const char c) { return wchar_t(static_cast<uint8_t>(c)); }
+	static uint64_t getKerningPairKey(uint32_t left, uint32_t right) { return (uint64_t(left) << 32u) | right; }
+
+	// `m_mutex` needs to be held, makes sure every glyph and kerning pair `text` needs is in the face's tables
+	const SFaceGlyphs& shape_impl(FontFace* face, std::string_view text, bool kerning);
+	// only reads `faceGlyphs`, so can run concurrently
+	static std::shared_ptr<const SingleLineText> layout_impl(const SFaceGlyphs& faceGlyphs, std::string_view text, const SLayoutParams& params);
+
+	using LayoutLRUCache = core::LRUCache<SLayoutKey, std::shared_ptr<const SingleLineText>, SLayoutKeyHash>;
+
+	mutable std::mutex m_mutex;
+	uint32_t m_maxLayouts;
+	std::unique_ptr<LayoutLRUCache> m_layouts;
+	std::unordered_map<core::blake3_hash_t, SFaceGlyphs> m_faces;
+	uint64_t m_hits = 0ull;
+	uint64_t m_misses = 0ull;
+};
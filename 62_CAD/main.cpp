@@ -30,6 +30,12 @@ using namespace video;
 
 #include "HatchGlyphBuilder.h"
 #include "GeoTexture.h"
+#include "MSDFGenerationService.h"
+#include "TextLayoutCache.h"
+#include "SpatialIndex.h"
+#include "ParallelFor.hpp"
+#include "CPUStageProfiler.h"
+#include "nlohmann/json.hpp"
 
 #include <nbl/builtin/hlsl/tgmath.hlsl>
 
@@ -38,9 +44,16 @@ using namespace video;
 #include <nbl/builtin/hlsl/concepts/vector.hlsl>
 #include <nbl/builtin/hlsl/concepts/matrix.hlsl>
 
+#include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <fstream>
+#include <limits>
+#include <random>
 #define BENCHMARK_TILL_FIRST_FRAME
 
+using json = nlohmann::json;
+
 static constexpr bool DebugModeWireframe = false;
 static constexpr bool DebugRotatingViewProj = false;
 static constexpr bool FragmentShaderPixelInterlock = true;
@@ -57,6 +70,7 @@ enum class ExampleMode
 	CASE_6, // Custom Clip Projections
 	CASE_7, // Images
 	CASE_8, // MSDF and Text
+	CASE_9, // Large retained drawing culled through a spatial index
 	CASE_COUNT
 };
 
@@ -71,9 +85,11 @@ constexpr std::array<float, (uint32_t)ExampleMode::CASE_COUNT> cameraExtents =
 	10.0,	// CASE_6
 	10.0,	// CASE_7
 	600.0,	// CASE_8
+	600.0,	// CASE_9
 };
 
-constexpr ExampleMode mode = ExampleMode::CASE_4;
+// can be overriden with `--mode <0..9>`
+ExampleMode mode = ExampleMode::CASE_4;
 
 class Camera2D
 {
@@ -101,6 +117,12 @@ public:
 		return m_bounds;
 	}
 
+	// the view projection maps `origin -/+ bounds/2` onto the screen
+	float64_t2 getOrigin() const
+	{
+		return m_origin;
+	}
+
 	float64_t3x3 constructViewProjection()
 	{
 		auto ret = float64_t3x3();
@@ -280,6 +302,13 @@ class ComputerAidedDesign final : public examples::SimpleWindowedApplication, pu
 	constexpr static uint32_t WindowHeightRequest = 900u;
 	constexpr static uint32_t MaxFramesInFlight = 3u;
 	constexpr static uint32_t MaxSubmitsInFlight = 16u;
+	constexpr static uint32_t MaxCachedTextLayouts = 8192u;
+	// CASE_9, see `buildRetainedScene`
+	constexpr static uint32_t SceneBlocksPerSide = 100u;
+	constexpr static float64_t SceneBlockSize = 100.0;
+	constexpr static uint32_t SceneRoadPointsPerBlock = 8u;
+	constexpr static uint32_t SceneMovingLabelCount = 64u;
+	constexpr static float SceneRoadWidth = 4.0f;
 public:
 
 	void allocateResources(uint32_t maxObjects)
@@ -644,6 +673,58 @@ public:
 
 	inline bool onAppInitialized(smart_refctd_ptr<ISystem>&& system) override
 	{
+		// the whole string has to be a decimal number fitting 32 bits, `strtoul` alone would take "3x" as 3, " -1" as ULONG_MAX and "" as 0
+		auto parseUint = [](const std::string& str, uint32_t& out) -> bool
+		{
+			if (str.empty() || !std::isdigit(static_cast<unsigned char>(str.front())))
+				return false;
+			errno = 0;
+			char* end = nullptr;
+			const unsigned long value = std::strtoul(str.c_str(), &end, 10);
+			if (errno == ERANGE || *end != '\0' || value > std::numeric_limits<uint32_t>::max())
+				return false;
+			out = static_cast<uint32_t>(value);
+			return true;
+		};
+
+		// `--mode all` is only meaningful for the headless benchmark, the windowed app keeps the default then
+		std::vector<ExampleMode> benchmarkModes = { mode };
+		if (const auto modeArg = std::find(argv.begin(), argv.end(), "--mode"); modeArg != argv.end() && std::next(modeArg) != argv.end())
+		{
+			const std::string& value = *std::next(modeArg);
+			if (value == "all")
+			{
+				benchmarkModes.clear();
+				for (uint32_t i = 0u; i < uint32_t(ExampleMode::CASE_COUNT); i++)
+					benchmarkModes.push_back(ExampleMode(i));
+			}
+			else
+			{
+				uint32_t modeIx = 0u;
+				if (!parseUint(value, modeIx) || modeIx >= uint32_t(ExampleMode::CASE_COUNT))
+					return logFail("Invalid --mode \"%s\", expected 0 to %u or \"all\"", value.c_str(), uint32_t(ExampleMode::CASE_COUNT) - 1u);
+				mode = ExampleMode(modeIx);
+				benchmarkModes = { mode };
+			}
+		}
+
+		if (std::find(argv.begin(), argv.end(), "--headless-benchmark") != argv.end())
+		{
+			m_headlessBenchmark = true;
+			if (!asset_base_t::onAppInitialized(std::move(system)))
+				return false;
+
+			uint32_t frameCount = 10u;
+			if (const auto arg = std::find(argv.begin(), argv.end(), "--benchmark-frames"); arg != argv.end() && std::next(arg) != argv.end())
+				if (!parseUint(*std::next(arg), frameCount) || frameCount == 0u)
+					return logFail("Invalid --benchmark-frames \"%s\", expected a positive integer", std::next(arg)->c_str());
+			system::path outputPath = localOutputCWD / "cad_benchmark.json";
+			if (const auto arg = std::find(argv.begin(), argv.end(), "--benchmark-output"); arg != argv.end() && std::next(arg) != argv.end())
+				outputPath = *std::next(arg);
+
+			return runHeadlessBenchmark(benchmarkModes, frameCount, outputPath);
+		}
+
 		m_inputSystem = make_smart_refctd_ptr<InputSystem>(logger_opt_smart_ptr(smart_refctd_ptr(m_logger)));
 
 		// Remember to call the base class initialization!
@@ -1041,32 +1122,76 @@ public:
 
 		m_timeElapsed = 0.0;
 		
-		// Loading font stuff
-		m_textRenderer = nbl::core::make_smart_refctd_ptr<TextRenderer>();
-
-		m_font = FontFace::create(core::smart_refctd_ptr(m_textRenderer), std::string("C:\\Windows\\Fonts\\arial.ttf"));
-	
-		if (m_font->getFreetypeFace()->num_charmaps > 0)
-			FT_Set_Charmap(m_font->getFreetypeFace(), m_font->getFreetypeFace()->charmaps[0]);
+		loadFont();
 		
-		const auto str = "MSDF: ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnoprstuvwxyz '1234567890-=\"!@#$%&*()_+";
-		singleLineText = std::unique_ptr<SingleLineText>(new SingleLineText(
-			m_font.get(),
-			std::string(str)));
-
+		{
+			m_msdfWorkerCount = std::max(nbl::examples::getDefaultWorkerCount() / 2u, 1u);
+			addMSDFWorkerFaces(m_font.get(), DefaultFontPath);
+			m_msdfGenerationService = std::make_unique<MSDFGenerationService>(localOutputCWD / "msdf_cache", m_msdfWorkerCount);
+		}
+		
+		if (std::find(argv.begin(), argv.end(), "--text-layout-benchmark") != argv.end())
+			runTextLayoutBenchmark();
+		if (std::find(argv.begin(), argv.end(), "--spatial-index-benchmark") != argv.end())
+			runSpatialIndexBenchmark();
+
+		// Glyph MSDFs get generated (or read back from the disk cache) in the background, until then `DrawResourcesFiller` draws a blank placeholder
+		// the job generates from the worker's copy of the very face the key was computed from, so what lands on disk matches its key
+		auto makeGlyphMSDFJob = [](const std::vector<smart_refctd_ptr<FontFace>>* workerFaces, const uint32_t glyphIdx, const uint32_t2 resolution) -> MSDFGenerationService::GenerateFunc
+		{
+			return [workerFaces, glyphIdx, resolution](uint32_t workerIx) -> core::smart_refctd_ptr<asset::ICPUImage>
+			{
+				return (*workerFaces)[workerIx]->generateGlyphMSDF(MSDFPixelRange, glyphIdx, resolution, MSDFMips);
+			};
+		};
 		drawResourcesFiller.setGlyphMSDFTextureFunction(
-			[&](nbl::ext::TextRendering::FontFace* face, uint32_t glyphIdx) -> core::smart_refctd_ptr<asset::ICPUImage>
+			[&, makeGlyphMSDFJob](nbl::ext::TextRendering::FontFace* face, uint32_t glyphIdx) -> core::smart_refctd_ptr<asset::ICPUImage>
 			{
-				return face->generateGlyphMSDF(MSDFPixelRange, glyphIdx, drawResourcesFiller.getMSDFResolution(), MSDFMips);
+				const auto resolution = drawResourcesFiller.getMSDFResolution();
+				const auto* workerFaces = getMSDFWorkerFaces(face);
+				// faces the workers have no copy of can only be used from this thread, and don't go through the disk cache either
+				if (!workerFaces)
+					return face->generateGlyphMSDF(MSDFPixelRange, glyphIdx, resolution, MSDFMips);
+				const auto key = MSDFGenerationService::computeGlyphKey(face->getHash(), glyphIdx, resolution, MSDFMips, MSDFPixelRange);
+				return m_msdfGenerationService->request(key, makeGlyphMSDFJob(workerFaces, glyphIdx, resolution));
 			}
 		);
 
+		// we know which glyphs we'll draw, get the workers going on all of them before the first frame asks
+		for (const char c : std::string(SampleText))
+		{
+			const auto glyphIdx = m_font->getGlyphIndex(wchar_t(c));
+			const auto resolution = drawResourcesFiller.getMSDFResolution();
+			m_msdfGenerationService->prefetch(MSDFGenerationService::computeGlyphKey(m_font->getHash(), glyphIdx, resolution, MSDFMips, MSDFPixelRange), makeGlyphMSDFJob(getMSDFWorkerFaces(m_font.get()), glyphIdx, resolution));
+		}
+
+		// Fill patterns go through the same workers and disk cache as glyphs, there's few enough of them to queue all up front
+		auto makeHatchFillPatternMSDFJob = [this](const HatchFillPattern pattern, const uint32_t2 resolution) -> MSDFGenerationService::GenerateFunc
+		{
+			return [this, pattern, resolution](uint32_t workerIx) -> core::smart_refctd_ptr<asset::ICPUImage>
+			{
+				return Hatch::generateHatchFillPatternMSDF(m_textRenderer.get(), pattern, resolution);
+			};
+		};
+		auto hatchFillPatternKey = [](const HatchFillPattern pattern, const uint32_t2 resolution) -> core::blake3_hash_t
+		{
+			return MSDFGenerationService::computeHatchFillPatternKey(static_cast<uint32_t>(pattern), resolution, MSDFMips, MSDFPixelRange);
+		};
 		drawResourcesFiller.setHatchFillMSDFTextureFunction(
-			[&](HatchFillPattern pattern) -> core::smart_refctd_ptr<asset::ICPUImage>
+			[&, makeHatchFillPatternMSDFJob, hatchFillPatternKey](HatchFillPattern pattern) -> core::smart_refctd_ptr<asset::ICPUImage>
 			{
-				return Hatch::generateHatchFillPatternMSDF(m_textRenderer.get(), pattern, drawResourcesFiller.getMSDFResolution());
+				const auto resolution = drawResourcesFiller.getMSDFResolution();
+				return m_msdfGenerationService->request(hatchFillPatternKey(pattern, resolution), makeHatchFillPatternMSDFJob(pattern, resolution));
 			}
 		);
+		for (uint32_t i = 0u; i < static_cast<uint32_t>(HatchFillPattern::COUNT); i++)
+		{
+			const auto pattern = static_cast<HatchFillPattern>(i);
+			if (pattern == HatchFillPattern::SOLID_FILL)
+				continue;
+			const auto resolution = drawResourcesFiller.getMSDFResolution();
+			m_msdfGenerationService->prefetch(hatchFillPatternKey(pattern, resolution), makeHatchFillPatternMSDFJob(pattern, resolution));
+		}
 		
 		m_geoTextureRenderer = std::unique_ptr<GeoTextureRenderer>(new GeoTextureRenderer(smart_refctd_ptr(m_device), smart_refctd_ptr(m_logger)));
 		m_geoTextureRenderer->initialize(geoTexturePipelineShaders[0].get(), geoTexturePipelineShaders[1].get(), compatibleRenderPass.get(), m_globalsBuffer);
@@ -1100,7 +1225,7 @@ public:
 		dt = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastTime).count();
 		lastTime = now;
 		m_timeElapsed += dt;
-		if constexpr (mode == ExampleMode::CASE_0)
+		if (mode == ExampleMode::CASE_0)
 		{
 			m_Camera.setSize(20.0 + abs(cos(m_timeElapsed * 0.001)) * 600);
 		}
@@ -1456,6 +1581,9 @@ public:
 
 	inline bool keepRunning() override
 	{
+		if (m_headlessBenchmark)
+			return false;
+
 		if (duration_cast<decltype(timeout)>(clock_t::now()-start)>timeout)
 			return false;
 
@@ -1464,6 +1592,9 @@ public:
 
 	virtual bool onAppTerminated() override
 	{
+		if (m_headlessBenchmark)
+			return asset_base_t::onAppTerminated();
+
 		m_currentRecordingCommandBufferInfo->cmdbuf->end();
 
 		// We actually want to wait for all the frames to finish rendering, otherwise our destructors will run out of order late
@@ -1492,6 +1623,303 @@ public:
 		retval.synchronizationValidation = true;
 		return retval;
 	}
+
+	// Lays out a drawing's worth of repeated annotation labels with uncached `SingleLineText`s, then with a cold and a warm `TextLayoutCache`
+	void runTextLayoutBenchmark()
+	{
+		constexpr uint32_t LabelCount = 50000u;
+		constexpr uint32_t UniqueLabelCount = 2000u;
+
+		std::vector<std::string> labels(LabelCount);
+		for (uint32_t i = 0u; i < LabelCount; i++)
+		{
+			const uint32_t labelIx = i % UniqueLabelCount;
+			labels[i] = "PIPE DN" + std::to_string(50u + labelIx) + ((labelIx % 3u) ? " PVC" : "\nSteel, Sch. 40");
+		}
+		std::vector<TextLayoutCache::SLayoutRequest> requests(LabelCount);
+		for (uint32_t i = 0u; i < LabelCount; i++)
+			requests[i] = { .face = m_font.get(), .text = labels[i] };
+		std::vector<std::shared_ptr<const SingleLineText>> layouts(LabelCount);
+
+		auto measure = [&](const char* name, auto&& work) -> void
+		{
+			const auto start = std::chrono::steady_clock::now();
+			work();
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			m_logger->log("Text layout benchmark, %s: %.3f ms, %.0f labels/sec", ILogger::ELL_PERFORMANCE, name, seconds * 1000.0, double(LabelCount) / seconds);
+		};
+
+		size_t glyphCount = 0ull; // so the uncached layouts don't get optimized away
+		measure("uncached SingleLineText", [&]() -> void
+			{
+				for (const auto& label : labels)
+					glyphCount += SingleLineText(m_font.get(), label).getGlyphBoxes().size();
+			}
+		);
+
+		TextLayoutCache serialCache(UniqueLabelCount);
+		measure("cold cache, serial", [&]() -> void
+			{
+				for (uint32_t i = 0u; i < LabelCount; i++)
+					layouts[i] = serialCache.layout(m_font.get(), labels[i]);
+			}
+		);
+
+		TextLayoutCache batchCache(UniqueLabelCount);
+		measure("cold cache, batched", [&]() -> void { batchCache.layoutBatch(requests, layouts); });
+		measure("warm cache, batched", [&]() -> void { batchCache.layoutBatch(requests, layouts); });
+
+		const auto stats = batchCache.getStats();
+		m_logger->log("Text layout benchmark: %zu glyphs uncached, cache hits %llu misses %llu, %u glyphs shaped", ILogger::ELL_PERFORMANCE,
+			glyphCount, stats.hits, stats.misses, stats.shapedGlyphs);
+	}
+
+	// Indexes a million boxes spread like the details of a large drawing (mostly small, some big outlines), then times building the index serially and in parallel,
+	// querying views of several sizes against a linear scan, and moving a percent of the boxes around
+	void runSpatialIndexBenchmark()
+	{
+		constexpr uint32_t ObjectCount = 1u << 20u;
+		constexpr float64_t WorldSize = 1.0e6;
+		constexpr uint32_t QueriesPerViewSize = 1000u;
+		constexpr uint32_t LinearScanQueries = 20u;
+		constexpr uint32_t MovedObjectCount = ObjectCount / 100u;
+
+		std::mt19937 rng(0x45u);
+		std::uniform_real_distribution<float64_t> position(0.0, WorldSize);
+		std::uniform_real_distribution<float64_t> sizeExponent(-1.0, 3.0); // 0.1 to 1000 units, log-uniform
+		std::vector<SpatialIndex::AABB> bounds(ObjectCount);
+		for (auto& aabb : bounds)
+		{
+			aabb.min = float64_t2(position(rng), position(rng));
+			aabb.max = aabb.min + float64_t2(std::pow(10.0, sizeExponent(rng)), std::pow(10.0, sizeExponent(rng)));
+		}
+
+		auto measure = [&](const char* name, auto&& work) -> double
+		{
+			const auto start = std::chrono::steady_clock::now();
+			work();
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			m_logger->log("Spatial index benchmark, %s: %.3f ms", ILogger::ELL_PERFORMANCE, name, seconds * 1000.0);
+			return seconds;
+		};
+
+		SpatialIndex index;
+		measure("serial build", [&]() -> void { index.build(bounds, 1u); });
+		measure("parallel build", [&]() -> void { index.build(bounds); });
+		{
+			const auto stats = index.getStats();
+			m_logger->log("Spatial index benchmark: %u objects, %u nodes, depth %u", ILogger::ELL_PERFORMANCE, stats.items, stats.nodes, stats.depth);
+		}
+
+		auto makeViews = [&](const float64_t viewSize, const uint32_t count) -> std::vector<SpatialIndex::AABB>
+		{
+			std::vector<SpatialIndex::AABB> views(count);
+			for (auto& view : views)
+			{
+				view.min = float64_t2(position(rng), position(rng));
+				view.max = view.min + float64_t2(viewSize * 16.0 / 9.0, viewSize);
+			}
+			return views;
+		};
+		std::vector<uint32_t> results;
+		for (const float64_t viewSize : { 1.0e3, 1.0e4, 1.0e5 })
+		{
+			const auto views = makeViews(viewSize, QueriesPerViewSize);
+			size_t resultCount = 0ull;
+			const std::string name = "querying " + std::to_string(QueriesPerViewSize) + " views " + std::to_string(uint32_t(viewSize)) + " units tall";
+			const double seconds = measure(name.c_str(), [&]() -> void
+				{
+					for (const auto& view : views)
+					{
+						results.clear();
+						index.query(view, results);
+						resultCount += results.size();
+					}
+				}
+			);
+			m_logger->log("Spatial index benchmark: %.3f us per query, %.1f objects visible on average", ILogger::ELL_PERFORMANCE,
+				seconds * 1.0e6 / QueriesPerViewSize, double(resultCount) / QueriesPerViewSize);
+		}
+
+		// what every frame did before the index
+		{
+			const auto views = makeViews(1.0e4, LinearScanQueries);
+			size_t resultCount = 0ull;
+			const double seconds = measure("linear scan of views 10000 units tall", [&]() -> void
+				{
+					for (const auto& view : views)
+						for (const auto& aabb : bounds)
+							if (aabb.min.x <= view.max.x && view.min.x <= aabb.max.x && aabb.min.y <= view.max.y && view.min.y <= aabb.max.y)
+								resultCount++;
+				}
+			);
+			m_logger->log("Spatial index benchmark: %.3f us per linear scan, %.1f objects visible on average", ILogger::ELL_PERFORMANCE,
+				seconds * 1.0e6 / LinearScanQueries, double(resultCount) / LinearScanQueries);
+		}
+
+		// objects getting dragged a bit, most stay within their leaf
+		std::uniform_int_distribution<uint32_t> pickObject(0u, ObjectCount - 1u);
+		std::uniform_real_distribution<float64_t> offset(-10.0, 10.0);
+		measure("moving 1% of the objects", [&]() -> void
+			{
+				for (uint32_t i = 0u; i < MovedObjectCount; i++)
+				{
+					const uint32_t id = pickObject(rng);
+					const float64_t2 delta = float64_t2(offset(rng), offset(rng));
+					bounds[id].min += delta;
+					bounds[id].max += delta;
+					index.update(id, bounds[id]);
+				}
+			}
+		);
+		const auto statsBeforeCommit = index.getStats();
+		measure("commit", [&]() -> void { index.commit(); });
+		m_logger->log("Spatial index benchmark: %llu updates in place, %llu went to the delta list, %u rebuilds", ILogger::ELL_PERFORMANCE,
+			static_cast<unsigned long long>(statsBeforeCommit.inPlaceUpdates), static_cast<unsigned long long>(statsBeforeCommit.deferredUpdates), index.getStats().rebuilds);
+	}
+
+	// FreeType faces can't be used from multiple threads at once, so every MSDF worker gets its own copy of every face glyphs get requested with.
+	// Copies are found by the hash of the face they were made from, call this before drawing with `face` so its glyphs get generated in the background.
+	void addMSDFWorkerFaces(FontFace* face, const std::string& path)
+	{
+		std::vector<smart_refctd_ptr<FontFace>> workerFaces;
+		for (uint32_t i = 0u; i < m_msdfWorkerCount; i++)
+		{
+			auto workerFace = FontFace::create(core::smart_refctd_ptr(m_textRenderer), std::string(path));
+			// a different file under the same path would poison the disk cache with MSDFs of the wrong face
+			if (!workerFace || workerFace->getHash() != face->getHash())
+			{
+				m_logger->log("Couldn't load a copy of the font \"%s\" for the MSDF workers, its glyphs will be generated on the render thread", ILogger::ELL_WARNING, path.c_str());
+				return;
+			}
+			workerFaces.push_back(std::move(workerFace));
+		}
+		std::lock_guard lock(m_msdfWorkerFacesMutex);
+		m_msdfWorkerFaces.try_emplace(face->getHash(), std::move(workerFaces));
+	}
+
+	// null if `addMSDFWorkerFaces` wasn't called for `face`, the vector itself stays put once added
+	const std::vector<smart_refctd_ptr<FontFace>>* getMSDFWorkerFaces(FontFace* face)
+	{
+		std::lock_guard lock(m_msdfWorkerFacesMutex);
+		auto found = m_msdfWorkerFaces.find(face->getHash());
+		return found != m_msdfWorkerFaces.end() ? &found->second : nullptr;
+	}
+
+	void loadFont()
+	{
+		m_textRenderer = nbl::core::make_smart_refctd_ptr<TextRenderer>();
+
+		m_font = FontFace::create(core::smart_refctd_ptr(m_textRenderer), std::string(DefaultFontPath));
+	
+		if (m_font->getFreetypeFace()->num_charmaps > 0)
+			FT_Set_Charmap(m_font->getFreetypeFace(), m_font->getFreetypeFace()->charmaps[0]);
+
+		m_textLayoutCache = std::make_unique<TextLayoutCache>(MaxCachedTextLayouts);
+		singleLineText = m_textLayoutCache->layout(m_font.get(), SampleText);
+	}
+
+	// Builds `frameCount` frames of every mode in `modes` on this thread without creating a device, and writes per stage CPU time and heap allocations to `outputPath` as JSON.
+	// Packing goes into the CPU side of the draw buffers only, overflow submits and the bytes that would have been uploaded get counted. MSDFs get generated synchronously.
+	bool runHeadlessBenchmark(const std::vector<ExampleMode>& modes, const uint32_t frameCount, const system::path& outputPath)
+	{
+		m_Camera.setOrigin({ 0.0, 0.0 });
+		m_Camera.setAspectRatio(double(WindowWidthRequest) / WindowHeightRequest);
+
+		// same sizes `allocateResources(1024 * 1024u)` uses
+		constexpr uint32_t MaxObjects = 1024u * 1024u;
+		drawResourcesFiller = DrawResourcesFiller();
+		drawResourcesFiller.allocateHeadless(MaxObjects * 6u * 2u, MaxObjects, MaxObjects * 5u, MaxObjects * sizeof(QuadraticBezierInfo) * 3 + 128 * sizeof(ClipProjectionData), 512u, 256u, uint32_t2(MSDFSize, MSDFSize));
+
+		loadFont();
+		drawResourcesFiller.setGlyphMSDFTextureFunction(
+			[&](nbl::ext::TextRendering::FontFace* face, uint32_t glyphIdx) -> core::smart_refctd_ptr<asset::ICPUImage>
+			{
+				CPUStageProfiler::ScopedStage profilerScope(CPUStage::MSDF);
+				return face->generateGlyphMSDF(MSDFPixelRange, glyphIdx, drawResourcesFiller.getMSDFResolution(), MSDFMips);
+			}
+		);
+		drawResourcesFiller.setHatchFillMSDFTextureFunction(
+			[&](HatchFillPattern pattern) -> core::smart_refctd_ptr<asset::ICPUImage>
+			{
+				return Hatch::generateHatchFillPatternMSDF(m_textRenderer.get(), pattern, drawResourcesFiller.getMSDFResolution());
+			}
+		);
+
+		uint32_t overflowSubmits = 0u;
+		drawResourcesFiller.setSubmitDrawsFunction([&](SIntendedSubmitInfo&) -> void { overflowSubmits++; });
+		// nothing gets submitted, the filler only reads the future scratch semaphore value off of it for the MSDF LRU cache
+		SIntendedSubmitInfo headlessSubmit = {};
+
+		json results;
+		results["frames"] = frameCount;
+		results["modes"] = json::array();
+
+		CPUStageProfiler::setEnabled(true);
+		for (const auto benchmarkMode : modes)
+		{
+			mode = benchmarkMode;
+			m_Camera.setSize(cameraExtents[uint32_t(mode)]);
+			m_timeElapsed = 0.0;
+			overflowSubmits = 0u;
+			const auto statsBefore = drawResourcesFiller.getHeadlessStats();
+			CPUStageProfiler::reset();
+
+			double frameMilliseconds = 0.0;
+			for (m_realFrameIx = 0u; m_realFrameIx < frameCount; m_realFrameIx++)
+			{
+				const auto frameStart = clock_t::now();
+				drawScene(headlessSubmit);
+				frameMilliseconds += std::chrono::duration<double, std::milli>(clock_t::now() - frameStart).count();
+				// pretend the frames are 60Hz so the animated modes don't depend on how long the benchmark takes
+				m_timeElapsed += 1000.0 / 60.0;
+			}
+
+			const auto stageStats = CPUStageProfiler::getStats();
+			const auto& statsAfter = drawResourcesFiller.getHeadlessStats();
+
+			json modeResult;
+			modeResult["mode"] = uint32_t(mode);
+			modeResult["total_ms"] = frameMilliseconds;
+			modeResult["ms_per_frame"] = frameMilliseconds / frameCount;
+			for (uint32_t stage = 0u; stage < uint32_t(CPUStage::COUNT); stage++)
+			{
+				const auto& stats = stageStats[stage];
+				modeResult["stages"][CPUStageProfiler::getStageName(CPUStage(stage))] = {
+					{ "ms", stats.milliseconds },
+					{ "calls", stats.calls },
+					{ "allocations", stats.allocations },
+					{ "allocated_bytes", stats.allocatedBytes },
+				};
+			}
+			// of the last frame, the previous ones got reset by `drawScene`
+			modeResult["filler"] = {
+				{ "main_objects", drawResourcesFiller.getMainObjectCount() },
+				{ "draw_objects", drawResourcesFiller.getDrawObjectCount() },
+				{ "line_styles", drawResourcesFiller.getLineStyleCount() },
+				{ "geometry_bytes", drawResourcesFiller.getCurrentGeometryBufferSize() },
+				{ "overflow_submits", overflowSubmits },
+				{ "uploaded_bytes", statsAfter.uploadedBytes - statsBefore.uploadedBytes },
+				{ "uploaded_msdfs", statsAfter.uploadedMSDFs - statsBefore.uploadedMSDFs },
+			};
+			results["modes"].push_back(modeResult);
+
+			m_logger->log("Headless benchmark, CASE_%u: %.3f ms/frame (polyline %.3f, hatch %.3f, msdf %.3f, packing %.3f ms total), %llu allocations", ILogger::ELL_PERFORMANCE,
+				uint32_t(mode), frameMilliseconds / frameCount,
+				stageStats[uint32_t(CPUStage::POLYLINE)].milliseconds, stageStats[uint32_t(CPUStage::HATCH)].milliseconds,
+				stageStats[uint32_t(CPUStage::MSDF)].milliseconds, stageStats[uint32_t(CPUStage::PACKING)].milliseconds,
+				stageStats[0].allocations + stageStats[1].allocations + stageStats[2].allocations + stageStats[3].allocations);
+		}
+		CPUStageProfiler::setEnabled(false);
+
+		std::ofstream outFile(outputPath);
+		if (!outFile)
+			return logFail("Could not open \"%s\" to write the benchmark results!", outputPath.string().c_str());
+		outFile << results.dump(4);
+		m_logger->log("Headless benchmark results written to \"%s\"", ILogger::ELL_INFO, outputPath.string().c_str());
+		return true;
+	}
+
 protected:
 	
 	void addObjects(SIntendedSubmitInfo& intendedNextSubmit)
@@ -1513,17 +1941,21 @@ protected:
 		assert(cmdbuf->getState() == video::IGPUCommandBuffer::STATE::RECORDING && cmdbuf->isResettable());
 		assert(cmdbuf->getRecordingFlags().hasFlags(video::IGPUCommandBuffer::USAGE::ONE_TIME_SUBMIT_BIT));
 
-		auto* cmdpool = cmdbuf->getPool();
-
 		drawResourcesFiller.setSubmitDrawsFunction(
 			[&](SIntendedSubmitInfo& intendedNextSubmit)
 			{
 				return submitDraws(intendedNextSubmit, true);
 			}
 		);
+		drawScene(intendedNextSubmit);
+	}
+
+	// Everything `addObjects` draws for the current `mode`, doesn't touch the device apart from CASE_7's image upload so the headless benchmark can run it too
+	void drawScene(SIntendedSubmitInfo& intendedNextSubmit)
+	{
 		drawResourcesFiller.reset();
 
-		if constexpr (mode == ExampleMode::CASE_0)
+		if (mode == ExampleMode::CASE_0)
 		{
 			LineStyleInfo style = {};
 			style.screenSpaceLineWidth = 0.0f;
@@ -2865,8 +3297,10 @@ protected:
 		}
 		else if (mode == ExampleMode::CASE_7)
 		{
-			if (m_realFrameIx == 0u)
+			if (m_realFrameIx == 0u && !m_headlessBenchmark)
 			{
+				auto* cmdbuf = m_currentRecordingCommandBufferInfo->cmdbuf;
+
 				// Load image
 				system::path m_loadCWD = "..";
 				std::string imagePath = "../../media/color_space_test/R8G8B8A8_1.png";
@@ -3231,9 +3665,219 @@ protected:
 			}
 
 		}
+		else if (mode == ExampleMode::CASE_9)
+		{
+			drawRetainedScene(intendedNextSubmit);
+		}
 		drawResourcesFiller.finalizeAllCopiesToGPU(intendedNextSubmit);
 	}
 
+	// CASE_9: a city plan of `SceneBlocksPerSide`^2 blocks, each with a building hatch and a label, with winding roads in between and a few labels driving along them.
+	// It's built once, only the objects the spatial index finds in view get packed every frame. Roads span the whole drawing so they're indexed per section.
+	void buildRetainedScene()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const float64_t sceneSize = float64_t(SceneBlocksPerSide) * SceneBlockSize;
+		const float64_t2 sceneMin = float64_t2(-sceneSize * 0.5, -sceneSize * 0.5);
+
+		m_sceneRoadStyle = {};
+		m_sceneRoadStyle.screenSpaceLineWidth = 0.0f;
+		m_sceneRoadStyle.worldSpaceLineWidth = SceneRoadWidth;
+		m_sceneRoadStyle.color = float32_t4(0.8f, 0.8f, 0.8f, 1.0f);
+		m_sceneRoadStyle.isRoadStyleFlag = true;
+
+		// ids are handed out in draw order: hatches under roads under labels, and sections of a road consecutive, so sorting a query result is all it takes to draw it
+		std::vector<SpatialIndex::AABB> bounds;
+		m_sceneObjects.clear();
+		auto addObject = [&](const SceneObjectType type, const uint32_t index, const uint32_t section, const SpatialIndex::AABB& aabb) -> void
+		{
+			m_sceneObjects.push_back({ .type = type, .index = index, .section = section });
+			bounds.push_back(aabb);
+		};
+
+		m_sceneHatches.clear();
+		for (uint32_t row = 0u; row < SceneBlocksPerSide; row++)
+		for (uint32_t column = 0u; column < SceneBlocksPerSide; column++)
+		{
+			// buildings of different sizes, set back from the roads
+			const uint32_t variation = (row * 7u + column * 13u) % 5u;
+			const float64_t setback = SceneRoadWidth * 2.0 + float64_t(variation) * SceneBlockSize * 0.05;
+			const float64_t2 blockMin = sceneMin + float64_t2(column, row) * SceneBlockSize;
+			const float64_t2 buildingMin = blockMin + float64_t2(setback, setback);
+			const float64_t2 buildingMax = blockMin + float64_t2(SceneBlockSize - setback, SceneBlockSize - setback);
+
+			CPolyline footprint;
+			std::vector<float64_t2> corners = { buildingMin, { buildingMax.x, buildingMin.y }, buildingMax, { buildingMin.x, buildingMax.y }, buildingMin };
+			footprint.addLinePoints(corners);
+			footprint.setClosed(true);
+			const float32_t shade = 0.2f + 0.1f * float32_t(variation);
+			m_sceneHatches.push_back({ .hatch = Hatch({ &footprint, 1u }, SelectedMajorAxis), .color = float32_t4(shade, shade * 0.8f, 0.4f, 1.0f) });
+			addObject(SceneObjectType::HATCH, static_cast<uint32_t>(m_sceneHatches.size()) - 1u, 0u, { footprint.getMin(), footprint.getMax() });
+		}
+
+		m_sceneRoads.clear();
+		for (uint32_t vertical = 0u; vertical < 2u; vertical++)
+		for (uint32_t roadIx = 0u; roadIx <= SceneBlocksPerSide; roadIx++)
+		{
+			CPolyline& road = m_sceneRoads.emplace_back();
+			std::vector<float64_t2> points(SceneRoadPointsPerBlock + 1u);
+			for (uint32_t block = 0u; block < SceneBlocksPerSide; block++)
+			{
+				for (uint32_t pointIx = 0u; pointIx <= SceneRoadPointsPerBlock; pointIx++)
+				{
+					const float64_t along = (float64_t(block) + float64_t(pointIx) / SceneRoadPointsPerBlock) * SceneBlockSize;
+					const float64_t across = float64_t(roadIx) * SceneBlockSize + SceneRoadWidth * std::sin(along * 0.07 + float64_t(roadIx));
+					points[pointIx] = sceneMin + (vertical ? float64_t2(across, along) : float64_t2(along, across));
+				}
+				road.addLinePoints(points);
+			}
+			road.preprocessPolylineWithStyle(m_sceneRoadStyle);
+
+			const uint32_t roadObjIx = static_cast<uint32_t>(m_sceneRoads.size()) - 1u;
+			for (uint32_t sectionIx = 0u; sectionIx < road.getSectionsCount(); sectionIx++)
+				addObject(SceneObjectType::POLYLINE_SECTION, roadObjIx, sectionIx, getSectionBounds(road, sectionIx, SceneRoadWidth * 0.5));
+		}
+
+		// labels of all the blocks and the moving ones get laid out in one batch
+		std::vector<std::string> labelTexts;
+		for (uint32_t row = 0u; row < SceneBlocksPerSide; row++)
+		for (uint32_t column = 0u; column < SceneBlocksPerSide; column++)
+			labelTexts.push_back("BLK " + std::to_string(row) + "-" + std::to_string(column));
+		for (uint32_t i = 0u; i < SceneMovingLabelCount; i++)
+			labelTexts.push_back("TRUCK " + std::to_string(i));
+		std::vector<TextLayoutCache::SLayoutRequest> requests(labelTexts.size());
+		for (uint32_t i = 0u; i < labelTexts.size(); i++)
+			requests[i] = { .face = m_font.get(), .text = labelTexts[i] };
+		std::vector<std::shared_ptr<const SingleLineText>> layouts(labelTexts.size());
+		m_textLayoutCache->layoutBatch(requests, layouts);
+
+		m_sceneLabels.clear();
+		for (uint32_t i = 0u; i < layouts.size(); i++)
+		{
+			// font units to world, so a label takes up about half its block
+			const auto layoutBounds = layouts[i]->GetAABB();
+			const float32_t scale = float32_t(SceneBlockSize * 0.5 / std::max(layoutBounds.max.x - layoutBounds.min.x, 1.0));
+			const uint32_t row = i / SceneBlocksPerSide, column = i % SceneBlocksPerSide;
+			const float64_t2 blockCenter = sceneMin + (float64_t2(column, row) + float64_t2(0.5, 0.5)) * SceneBlockSize;
+			m_sceneLabels.push_back({ .text = layouts[i], .baselineStart = blockCenter - float64_t2(SceneBlockSize * 0.25, 0.0), .scale = float32_t2(scale, scale) });
+		}
+		m_firstMovingSceneLabel = SceneBlocksPerSide * SceneBlocksPerSide;
+		m_firstMovingSceneObject = static_cast<uint32_t>(m_sceneObjects.size()) + m_firstMovingSceneLabel;
+		for (uint32_t i = 0u; i < m_sceneLabels.size(); i++)
+		{
+			if (i >= m_firstMovingSceneLabel)
+				placeMovingSceneLabel(i - m_firstMovingSceneLabel);
+			addObject(SceneObjectType::LABEL, i, 0u, getLabelBounds(m_sceneLabels[i]));
+		}
+
+		m_sceneIndex.build(bounds);
+		m_sceneBuilt = true;
+
+		const auto stats = m_sceneIndex.getStats();
+		m_logger->log("Retained scene: %u objects (%zu hatches, %zu roads, %zu labels) built and indexed in %.3f ms, %u nodes, depth %u", ILogger::ELL_PERFORMANCE,
+			stats.items, m_sceneHatches.size(), m_sceneRoads.size(), m_sceneLabels.size(),
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), stats.nodes, stats.depth);
+	}
+
+	void drawRetainedScene(SIntendedSubmitInfo& intendedNextSubmit)
+	{
+		if (!m_sceneBuilt)
+			buildRetainedScene();
+
+		// the moving labels mostly leave their leaf, so they end up in the index's delta list and stay there without forcing rebuilds
+		for (uint32_t i = 0u; i < SceneMovingLabelCount; i++)
+		{
+			placeMovingSceneLabel(i);
+			m_sceneIndex.update(m_firstMovingSceneObject + i, getLabelBounds(m_sceneLabels[m_firstMovingSceneLabel + i]));
+		}
+		m_sceneIndex.commit();
+
+		const float64_t2 viewHalfExtent = m_Camera.getBounds() * 0.5;
+		const SpatialIndex::AABB view = { m_Camera.getOrigin() - viewHalfExtent, m_Camera.getOrigin() + viewHalfExtent };
+		m_visibleSceneObjects.clear();
+		m_sceneIndex.query(view, m_visibleSceneObjects);
+		std::sort(m_visibleSceneObjects.begin(), m_visibleSceneObjects.end());
+
+		// a connector's circle extends by the line width around its joint
+		const float64_t2 connectorCullPadding = float64_t2(SceneRoadWidth, SceneRoadWidth);
+		for (uint32_t i = 0u; i < m_visibleSceneObjects.size();)
+		{
+			const SSceneObject& object = m_sceneObjects[m_visibleSceneObjects[i]];
+			if (object.type == SceneObjectType::HATCH)
+			{
+				const auto& sceneHatch = m_sceneHatches[object.index];
+				drawResourcesFiller.drawHatch(sceneHatch.hatch, sceneHatch.color, intendedNextSubmit);
+				i++;
+			}
+			else if (object.type == SceneObjectType::POLYLINE_SECTION)
+			{
+				// visible sections of the same road go out as one polyline
+				m_visibleRoadSections.clear();
+				for (; i < m_visibleSceneObjects.size(); i++)
+				{
+					const SSceneObject& section = m_sceneObjects[m_visibleSceneObjects[i]];
+					if (section.type != SceneObjectType::POLYLINE_SECTION || section.index != object.index)
+						break;
+					m_visibleRoadSections.push_back(section.section);
+				}
+				drawResourcesFiller.drawPolylineSections(m_sceneRoads[object.index], m_sceneRoadStyle, m_visibleRoadSections, view.min - connectorCullPadding, view.max + connectorCullPadding, intendedNextSubmit);
+			}
+			else
+			{
+				const auto& label = m_sceneLabels[object.index];
+				const float32_t4 color = object.index >= m_firstMovingSceneLabel ? float32_t4(1.0f, 0.6f, 0.1f, 1.0f) : float32_t4(1.0f, 1.0f, 1.0f, 1.0f);
+				label.text->Draw(drawResourcesFiller, intendedNextSubmit, m_font.get(), label.baselineStart, label.scale, 0.0f, color, 0.0f, 0.0f);
+				i++;
+			}
+		}
+	}
+
+	// drives along one of the horizontal roads, wrapping around at the edge of the drawing
+	void placeMovingSceneLabel(const uint32_t movingLabelIx)
+	{
+		const float64_t sceneSize = float64_t(SceneBlocksPerSide) * SceneBlockSize;
+		const float64_t along = std::fmod(m_timeElapsed * 0.05 + float64_t(movingLabelIx) * sceneSize / SceneMovingLabelCount, sceneSize);
+		const float64_t across = float64_t((movingLabelIx * 37u) % (SceneBlocksPerSide + 1u)) * SceneBlockSize;
+		m_sceneLabels[m_firstMovingSceneLabel + movingLabelIx].baselineStart = float64_t2(along, across + SceneRoadWidth) - float64_t2(sceneSize * 0.5, sceneSize * 0.5);
+	}
+
+	SpatialIndex::AABB getLabelBounds(const SSceneLabel& label) const
+	{
+		const auto layoutBounds = label.text->GetAABB();
+		const float64_t2 scale = float64_t2(label.scale.x, label.scale.y);
+		return { label.baselineStart + layoutBounds.min * scale, label.baselineStart + layoutBounds.max * scale };
+	}
+
+	// control points bound the curve, so beziers need no special treatment
+	static SpatialIndex::AABB getSectionBounds(const CPolylineBase& polyline, const uint32_t sectionIx, const float64_t padding)
+	{
+		SpatialIndex::AABB aabb = { float64_t2(std::numeric_limits<float64_t>::max()), float64_t2(std::numeric_limits<float64_t>::lowest()) };
+		auto addPoint = [&](const float64_t2& point) -> void
+		{
+			aabb.min = float64_t2(std::min(aabb.min.x, point.x), std::min(aabb.min.y, point.y));
+			aabb.max = float64_t2(std::max(aabb.max.x, point.x), std::max(aabb.max.y, point.y));
+		};
+		const auto& section = polyline.getSectionInfoAt(sectionIx);
+		if (section.type == ObjectType::LINE)
+		{
+			for (uint32_t i = section.index; i <= section.index + section.count; i++)
+				addPoint(polyline.getLinePointAt(i).p);
+		}
+		else if (section.type == ObjectType::QUAD_BEZIER)
+		{
+			for (uint32_t i = section.index; i < section.index + section.count; i++)
+			{
+				const auto& bezier = polyline.getQuadBezierInfoAt(i).shape;
+				addPoint(bezier.P0);
+				addPoint(bezier.P1);
+				addPoint(bezier.P2);
+			}
+		}
+		aabb.min -= float64_t2(padding, padding);
+		aabb.max += float64_t2(padding, padding);
+		return aabb;
+	}
+
 	double getScreenToWorldRatio(const float64_t3x3& viewProjectionMatrix, uint32_t2 windowSize)
 	{
 		double idx_0_0 = viewProjectionMatrix[0u][0u] * (windowSize.x / 2.0);
@@ -3248,6 +3892,10 @@ protected:
 	clock_t::time_point start;
 
 	bool fragmentShaderInterlockEnabled = false;
+	bool m_headlessBenchmark = false;
+
+	static constexpr const char* DefaultFontPath = "C:\\Windows\\Fonts\\arial.ttf";
+	static constexpr const char* SampleText = "MSDF: ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnoprstuvwxyz '1234567890-=\"!@#$%&*()_+";
 
 	core::smart_refctd_ptr<InputSystem> m_inputSystem;
 	InputSystem::ChannelReader<IMouseEventChannel> mouse;
@@ -3296,7 +3944,48 @@ protected:
 	smart_refctd_ptr<IGPUImageView> colorStorageImageView;
 	smart_refctd_ptr<TextRenderer> m_textRenderer;
 	smart_refctd_ptr<FontFace> m_font;
-	std::unique_ptr<SingleLineText> singleLineText = nullptr;
+	uint32_t m_msdfWorkerCount = 0u;
+	std::mutex m_msdfWorkerFacesMutex;
+	std::unordered_map<core::blake3_hash_t, std::vector<smart_refctd_ptr<FontFace>>> m_msdfWorkerFaces; // one copy per MSDF generation worker, keyed by the original face's hash
+	std::unique_ptr<MSDFGenerationService> m_msdfGenerationService; // declared after the fonts its workers use, so it gets joined first
+	std::unique_ptr<TextLayoutCache> m_textLayoutCache;
+
+	// CASE_9 retained scene, objects are referred to by their `SpatialIndex` id
+	enum class SceneObjectType : uint8_t
+	{
+		HATCH,
+		POLYLINE_SECTION,
+		LABEL
+	};
+	struct SSceneObject
+	{
+		SceneObjectType type;
+		uint32_t index; // into the array of its type
+		uint32_t section; // for `POLYLINE_SECTION`
+	};
+	struct SSceneHatch
+	{
+		Hatch hatch;
+		float32_t4 color;
+	};
+	struct SSceneLabel
+	{
+		std::shared_ptr<const SingleLineText> text;
+		float64_t2 baselineStart;
+		float32_t2 scale;
+	};
+	bool m_sceneBuilt = false;
+	std::vector<SSceneObject> m_sceneObjects;
+	std::vector<SSceneHatch> m_sceneHatches;
+	std::vector<CPolyline> m_sceneRoads;
+	LineStyleInfo m_sceneRoadStyle = {};
+	std::vector<SSceneLabel> m_sceneLabels;
+	uint32_t m_firstMovingSceneLabel = 0u;
+	uint32_t m_firstMovingSceneObject = 0u;
+	SpatialIndex m_sceneIndex;
+	std::vector<uint32_t> m_visibleSceneObjects;
+	std::vector<uint32_t> m_visibleRoadSections;
+	std::shared_ptr<const SingleLineText> singleLineText = nullptr;
 	
 	std::vector<std::unique_ptr<msdfgen::Shape>> m_shapeMSDFImages = {};
 
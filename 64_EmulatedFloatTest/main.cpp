@@ -9,6 +9,7 @@
 
 #include "nbl/application_templates/MonoDeviceApplication.hpp"
 #include "nbl/application_templates/MonoAssetManagerAndBuiltinResourceApplication.hpp"
+#include "CShaderCompileCache.hpp"
 
 #include "app_resources/common.hlsl"
 #include "app_resources/benchmark/common.hlsl"
@@ -44,6 +45,8 @@ public:
             return false;
         if (!asset_base_t::onAppInitialized(std::move(system)))
             return false;
+
+        m_shaderCache = std::make_unique<nbl::examples::CShaderCompileCache>(smart_refctd_ptr(m_system), sharedOutputCWD / "shader_cache");
        
         // In contrast to fences, we just need one semaphore to rule all dispatches
         return true;
@@ -65,6 +68,7 @@ public:
             EF64Benchmark benchmark(*this);
             benchmark.run();
         }
+        m_shaderCache->logStats(m_logger.get());
 
         m_keepRunning = false;
     }
@@ -78,6 +82,7 @@ public:
 private:
 
     bool m_keepRunning = true;
+    std::unique_ptr<nbl::examples::CShaderCompileCache> m_shaderCache;
 
     constexpr static inline uint32_t EmulatedFloat64TestIterations = 1000u;
     
@@ -284,7 +289,7 @@ private:
                     options.preprocessorOptions.logger = base.m_logger.get();
                     options.preprocessorOptions.includeFinder = compilerSet->getShaderCompiler(source->getContentType())->getDefaultIncludeFinder();
 
-                    auto spirv = compilerSet->compileToSPIRV(source.get(), options);
+                    auto spirv = base.m_shaderCache->compileToSPIRV(compilerSet, source.get(), options);
 
                     ILogicalDevice::SShaderCreationParameters params{};
                     params.cpushader = spirv.get();
@@ -952,7 +957,7 @@ private:
                     options.preprocessorOptions.logger = base.m_logger.get();
                     options.preprocessorOptions.includeFinder = compilerSet->getShaderCompiler(source->getContentType())->getDefaultIncludeFinder();
 
-                    auto spirv = compilerSet->compileToSPIRV(source.get(), options);
+                    auto spirv = base.m_shaderCache->compileToSPIRV(compilerSet, source.get(), options);
 
                     ILogicalDevice::SShaderCreationParameters params{};
                     params.cpushader = spirv.get();
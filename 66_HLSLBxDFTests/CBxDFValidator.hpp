@@ -0,0 +1,567 @@
+#ifndef _BXDF_TESTS_C_BXDF_VALIDATOR_HPP_INCLUDED_
+#define _BXDF_TESTS_C_BXDF_VALIDATOR_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "ParallelFor.hpp"
+
+// include after `app_resources/tests.hlsl`
+namespace nbl
+{
+namespace hlsl
+{
+
+struct SBxDFValidationParams
+{
+    // samples for each of the three tests
+    uint32_t sampleCount = 1u << 22;
+    uint32_t seed = 69u;
+    uint32_t workerCount = 0u;
+
+    // chi-square histogram over `cos(theta)` in [-1,1] (so BSDFs get both hemispheres) and `phi` in [0,2pi)
+    uint32_t thetaBins = 16u;
+    uint32_t phiBins = 32u;
+    // per axis midpoint subdivision when integrating the pdf over a bin
+    uint32_t integrationSubdivisions = 8u;
+    // bins with fewer expected samples get pooled together, the chi-square distribution is a poor approximation otherwise
+    double minExpectedBinCount = 5.0;
+    // null hypothesis (the sampling matches the pdf) gets rejected below this
+    double significanceLevel = 1e-3;
+};
+
+struct SBxDFValidationResult
+{
+    std::string name;
+
+    // property test of `TestUOffset`, every sample gets its own random view, normal and BxDF parameters
+    std::array<uint32_t, RECIPROCITY + 1> errorCounts = {};
+    uint32_t propertySamples = 0u;
+
+    // chi-square goodness of fit of the generated directions against the integrated pdf
+    double chiSquare = 0.0;
+    uint32_t degreesOfFreedom = 0u;
+    double pValue = 1.0;
+
+    // directional albedo for a fixed view, estimated with importance sampling and with uniform sphere sampling of `eval`
+    float32_t3 albedo = float32_t3(0.f, 0.f, 0.f);
+    float32_t3 albedoStdError = float32_t3(0.f, 0.f, 0.f);
+    float32_t3 uniformAlbedo = float32_t3(0.f, 0.f, 0.f);
+    float32_t3 uniformAlbedoStdError = float32_t3(0.f, 0.f, 0.f);
+
+    // million samples and million eval calls per second of wall time, over however many workers the passes ended up using
+    // (the sampling one includes generating the random numbers and binning)
+    double sampleThroughput = 0.0;
+    double evalThroughput = 0.0;
+    double milliseconds = 0.0;
+
+    bool propertiesPassed() const
+    {
+        for (uint32_t i = NOERR + 1; i < errorCounts.size(); i++)
+        if (errorCounts[i])
+            return false;
+        return true;
+    }
+    bool chiSquarePassed(const double significanceLevel) const {return pValue >= significanceLevel;}
+    // no energy gain beyond noise, and both estimators of the same integral have to agree
+    bool whiteFurnacePassed() const
+    {
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            if (albedo[c] > 1.f + 4.f * albedoStdError[c] + 1e-3f)
+                return false;
+            const float combinedError = std::sqrt(albedoStdError[c] * albedoStdError[c] + uniformAlbedoStdError[c] * uniformAlbedoStdError[c]);
+            if (std::abs(albedo[c] - uniformAlbedo[c]) > 5.f * combinedError + 1e-3f)
+                return false;
+        }
+        return true;
+    }
+};
+
+// Multi-threaded validation of a single BxDF, built on top of `TestUOffset` so that the BxDF setup is shared with the single threaded test.
+// Work gets split into shards of `ShardSize` samples, every shard seeds its own `Xoroshiro64Star` from the shard index so the results don't
+// depend on the worker count. Within a shard samples are processed in batches of `BatchSize`, the random numbers and outputs are kept as
+// SoA arrays so the RNG and the reductions over them are plain loops over contiguous floats.
+template<class BxDF, bool aniso = false>
+class CBxDFValidator
+{
+        using test_t = TestUOffset<BxDF, aniso>;
+
+        static inline constexpr uint32_t ShardSize = 1u << 14;
+        static inline constexpr uint32_t BatchSize = 256u;
+        static inline constexpr bool IsMicrofacet = is_microfacet_brdf_v<BxDF> || is_microfacet_bsdf_v<BxDF>;
+        static inline constexpr bool IsTransmissive = is_basic_bsdf_v<BxDF> || is_microfacet_bsdf_v<BxDF>;
+
+        struct SGenerated
+        {
+            sample_t s;
+            quotient_pdf_t quotientPdf;
+        };
+
+        struct SBatch
+        {
+            std::array<float, BatchSize> u[3];
+            // outputs
+            std::array<float, BatchSize> cosTheta;
+            std::array<float, BatchSize> phi;
+            std::array<float, BatchSize> pdf;
+            std::array<float, BatchSize> quotient[3];
+        };
+
+        struct SAlbedoAccumulator
+        {
+            double sum[3] = {};
+            double sumSq[3] = {};
+
+            void add(const float* const values[3], const uint32_t count)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    sum[c] += values[c][i];
+                    sumSq[c] += double(values[c][i]) * values[c][i];
+                }
+            }
+            void merge(const SAlbedoAccumulator& other)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    sum[c] += other.sum[c];
+                    sumSq[c] += other.sumSq[c];
+                }
+            }
+            void resolve(const uint32_t count, float32_t3& mean, float32_t3& stdError) const
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    const double m = sum[c] / count;
+                    const double variance = std::max(sumSq[c] / count - m * m, 0.0);
+                    mean[c] = float(m);
+                    stdError[c] = float(std::sqrt(variance / count));
+                }
+            }
+        };
+
+    public:
+        CBxDFValidator(const SBxDFValidationParams& params) : m_params(params)
+        {
+            // the estimators divide by it
+            assert(m_params.sampleCount != 0u);
+            if (m_params.workerCount == 0u)
+                m_params.workerCount = nbl::examples::getDefaultWorkerCount();
+            m_config = createStatisticalConfig();
+        }
+
+        SBxDFValidationResult run()
+        {
+            SBxDFValidationResult result;
+            result.name = m_config.name;
+
+            const auto start = std::chrono::high_resolution_clock::now();
+            runPropertyTest(result);
+            runChiSquareTest(result);
+            runWhiteFurnaceTest(result);
+            result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            return result;
+        }
+
+    private:
+        // Independent streams, `pcg32x2` decorrelates consecutive shard indices
+        Xoroshiro64Star createShardRNG(const uint32_t test, const size_t shard) const
+        {
+            return Xoroshiro64Star::construct(pcg32x2(m_params.seed ^ (test * 0x9e3779b9u) ^ (uint32_t(shard) * 0x85ebca6bu)));
+        }
+
+        size_t getShardCount() const
+        {
+            return (m_params.sampleCount + ShardSize - 1u) / ShardSize;
+        }
+
+        template<typename F>
+        void forEachBatch(const size_t shard, F&& f) const
+        {
+            const uint32_t begin = uint32_t(shard) * ShardSize;
+            const uint32_t end = std::min<uint32_t>(begin + ShardSize, m_params.sampleCount);
+            for (uint32_t batchBegin = begin; batchBegin < end; batchBegin += BatchSize)
+                f(std::min<uint32_t>(end - batchBegin, BatchSize));
+        }
+
+        // A configuration away from the degenerate corners the property test is meant to poke at: view well above the horizon and
+        // roughness high enough that a histogram of a few hundred bins resolves the lobe.
+        test_t createStatisticalConfig() const
+        {
+            auto rng = createShardRNG(~0u, 0u);
+            test_t t;
+            for (uint32_t attempt = 0u; attempt < 64u; attempt++)
+            {
+                t.init(uint32_t2(rng(), rng()));
+                if (nbl::hlsl::dot<float32_t3>(t.rc.V.direction, t.rc.N) > 0.3f)
+                    break;
+            }
+            t.rc.alpha = float32_t2(0.3f, 0.5f);
+            test_t::setupBxDF(t);
+            return t;
+        }
+
+        SGenerated generate(const test_t& t, const float32_t3 u) const
+        {
+            SGenerated retval;
+            aniso_cache cache;
+            if NBL_CONSTEXPR_FUNC (is_basic_brdf_v<BxDF>)
+                retval.s = t.bxdf.generate(t.anisointer, u.xy);
+            if NBL_CONSTEXPR_FUNC (is_microfacet_brdf_v<BxDF>)
+                retval.s = t.bxdf.generate(t.anisointer, u.xy, cache);
+            if NBL_CONSTEXPR_FUNC (is_basic_bsdf_v<BxDF>)
+                retval.s = t.bxdf.generate(t.anisointer, u);
+            if NBL_CONSTEXPR_FUNC (is_microfacet_bsdf_v<BxDF>)
+                retval.s = t.bxdf.generate(t.anisointer, u, cache);
+
+            if NBL_CONSTEXPR_FUNC (!IsMicrofacet)
+                retval.quotientPdf = t.bxdf.quotient_and_pdf(retval.s, t.isointer);
+            else if NBL_CONSTEXPR_FUNC (aniso)
+                retval.quotientPdf = t.bxdf.quotient_and_pdf(retval.s, t.anisointer, cache);
+            else
+            {
+                iso_cache isocache = (iso_cache)cache;
+                retval.quotientPdf = t.bxdf.quotient_and_pdf(retval.s, t.isointer, isocache);
+            }
+            return retval;
+        }
+
+        // pdf and `eval` (which includes the cosine) for an arbitrary outgoing direction, what the chi-square and the uniform furnace need
+        void evalDirection(const test_t& t, const float32_t3 L, float& pdf, float32_t3& value) const
+        {
+            pdf = 0.f;
+            value = float32_t3(0.f, 0.f, 0.f);
+
+            ray_dir_info_t dir;
+            dir.direction = L;
+            const sample_t s = sample_t::create(dir, nbl::hlsl::dot<float32_t3>(t.rc.V.direction, L), t.rc.T, t.rc.B, t.rc.N);
+            if NBL_CONSTEXPR_FUNC (!IsTransmissive)
+            {
+                if (s.NdotL <= 0.f)
+                    return;
+            }
+
+            if NBL_CONSTEXPR_FUNC (!IsMicrofacet)
+            {
+                pdf = t.bxdf.quotient_and_pdf(s, t.isointer).pdf;
+                value = float32_t3(t.bxdf.eval(s, t.isointer));
+            }
+            else
+            {
+                aniso_cache cache;
+                if NBL_CONSTEXPR_FUNC (IsTransmissive)
+                {
+                    float32_t3 H;
+                    if (!aniso_cache::compute(cache, t.anisointer, s, t.rc.eta, H))
+                        return;
+                }
+                else
+                    cache = aniso_cache::createForReflection(t.anisointer, s);
+
+                if NBL_CONSTEXPR_FUNC (aniso)
+                {
+                    pdf = t.bxdf.quotient_and_pdf(s, t.anisointer, cache).pdf;
+                    value = float32_t3(t.bxdf.eval(s, t.anisointer, cache));
+                }
+                else
+                {
+                    iso_cache isocache = (iso_cache)cache;
+                    pdf = t.bxdf.quotient_and_pdf(s, t.isointer, isocache).pdf;
+                    value = float32_t3(t.bxdf.eval(s, t.isointer, isocache));
+                }
+            }
+            if (!std::isfinite(pdf) || pdf < 0.f)
+                pdf = 0.f;
+        }
+
+        float32_t3 directionFromBin(const float cosTheta, const float phi) const
+        {
+            const float sinTheta = std::sqrt(std::max(1.f - cosTheta * cosTheta, 0.f));
+            return m_config.rc.T * (sinTheta * std::cos(phi)) + m_config.rc.B * (sinTheta * std::sin(phi)) + m_config.rc.N * cosTheta;
+        }
+
+        void fillUniforms(Xoroshiro64Star& rng, SBatch& batch, const uint32_t count) const
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            for (uint32_t i = 0; i < count; i++)
+                batch.u[c][i] = impl::rngFloat01(rng);
+        }
+
+        void runPropertyTest(SBxDFValidationResult& result)
+        {
+            struct SWorkerState
+            {
+                std::array<uint32_t, RECIPROCITY + 1> errorCounts = {};
+            };
+            std::vector<SWorkerState> workers(m_params.workerCount);
+
+            nbl::examples::parallelFor(getShardCount(), [&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+                {
+                    auto& worker = workers[workerIx];
+                    for (size_t shard = begin; shard < end; shard++)
+                    {
+                        auto rng = createShardRNG(0u, shard);
+                        forEachBatch(shard, [&](const uint32_t count) -> void
+                            {
+                                for (uint32_t i = 0; i < count; i++)
+                                {
+                                    test_t t = test_t::create(uint32_t2(rng(), rng()));
+                                    worker.errorCounts[t.test()]++;
+                                }
+                            }
+                        );
+                    }
+                }, m_params.workerCount, 1ull
+            );
+
+            for (const auto& worker : workers)
+            for (uint32_t i = 0; i < worker.errorCounts.size(); i++)
+                result.errorCounts[i] += worker.errorCounts[i];
+            result.propertySamples = m_params.sampleCount;
+        }
+
+        void runChiSquareTest(SBxDFValidationResult& result)
+        {
+            const uint32_t binCount = m_params.thetaBins * m_params.phiBins;
+            const float thetaStep = 2.f / m_params.thetaBins;
+            const float phiStep = 2.f * numbers::pi<float> / m_params.phiBins;
+
+            struct SWorkerState
+            {
+                std::vector<uint32_t> histogram;
+            };
+            std::vector<SWorkerState> workers(m_params.workerCount);
+            for (auto& worker : workers)
+                worker.histogram.resize(binCount, 0u);
+
+            const auto sampleStart = std::chrono::high_resolution_clock::now();
+            nbl::examples::parallelFor(getShardCount(), [&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+                {
+                    auto& worker = workers[workerIx];
+                    SBatch batch;
+                    for (size_t shard = begin; shard < end; shard++)
+                    {
+                        auto rng = createShardRNG(1u, shard);
+                        forEachBatch(shard, [&](const uint32_t count) -> void
+                            {
+                                fillUniforms(rng, batch, count);
+
+                                for (uint32_t i = 0; i < count; i++)
+                                {
+                                    const auto generated = generate(m_config, float32_t3(batch.u[0][i], batch.u[1][i], batch.u[2][i]));
+                                    const float32_t3 L = generated.s.L.direction;
+                                    batch.cosTheta[i] = nbl::hlsl::dot<float32_t3>(L, m_config.rc.N);
+                                    batch.phi[i] = std::atan2(nbl::hlsl::dot<float32_t3>(L, m_config.rc.B), nbl::hlsl::dot<float32_t3>(L, m_config.rc.T));
+                                    batch.pdf[i] = generated.quotientPdf.pdf;
+                                }
+
+                                for (uint32_t i = 0; i < count; i++)
+                                {
+                                    // samples the BxDF itself considers impossible don't count, their directions are arbitrary
+                                    if (!(batch.pdf[i] > 0.f) || !std::isfinite(batch.pdf[i]))
+                                        continue;
+                                    const float phi = batch.phi[i] < 0.f ? batch.phi[i] + 2.f * numbers::pi<float> : batch.phi[i];
+                                    const uint32_t thetaBin = std::min<uint32_t>(uint32_t((batch.cosTheta[i] + 1.f) / thetaStep), m_params.thetaBins - 1u);
+                                    const uint32_t phiBin = std::min<uint32_t>(uint32_t(phi / phiStep), m_params.phiBins - 1u);
+                                    worker.histogram[thetaBin * m_params.phiBins + phiBin]++;
+                                }
+                            }
+                        );
+                    }
+                }, m_params.workerCount, 1ull
+            );
+
+            const double sampleSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - sampleStart).count();
+            result.sampleThroughput = sampleSeconds > 0.0 ? double(m_params.sampleCount) / sampleSeconds * 1e-6 : 0.0;
+
+            std::vector<double> observed(binCount, 0.0);
+            for (const auto& worker : workers)
+            for (uint32_t i = 0; i < binCount; i++)
+                observed[i] += worker.histogram[i];
+
+            // expected counts, midpoint rule in (cos(theta),phi) where the solid angle measure is uniform
+            std::vector<double> expected(binCount, 0.0);
+            const uint32_t sub = m_params.integrationSubdivisions;
+            const auto evalStart = std::chrono::high_resolution_clock::now();
+            nbl::examples::parallelFor(binCount, [&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+                {
+                    for (size_t bin = begin; bin < end; bin++)
+                    {
+                        const uint32_t thetaBin = uint32_t(bin) / m_params.phiBins;
+                        const uint32_t phiBin = uint32_t(bin) % m_params.phiBins;
+                        double integral = 0.0;
+                        for (uint32_t j = 0; j < sub; j++)
+                        for (uint32_t k = 0; k < sub; k++)
+                        {
+                            const float cosTheta = -1.f + (thetaBin + (j + 0.5f) / sub) * thetaStep;
+                            const float phi = (phiBin + (k + 0.5f) / sub) * phiStep;
+                            float pdf;
+                            float32_t3 value;
+                            evalDirection(m_config, directionFromBin(cosTheta, phi), pdf, value);
+                            integral += pdf;
+                        }
+                        expected[bin] = integral * (thetaStep * phiStep) / (sub * sub) * m_params.sampleCount;
+                    }
+                }, m_params.workerCount
+            );
+            const double evalSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - evalStart).count();
+            result.evalThroughput = evalSeconds > 0.0 ? double(binCount) * sub * sub / evalSeconds * 1e-6 : 0.0;
+
+            // pool the low expectation bins, in order of expectation so the pooled cells stay small
+            std::vector<uint32_t> order(binCount);
+            for (uint32_t i = 0; i < binCount; i++)
+                order[i] = i;
+            std::sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) -> bool {return expected[a] < expected[b];});
+
+            double chiSquare = 0.0;
+            uint32_t cells = 0u;
+            double pooledObserved = 0.0, pooledExpected = 0.0;
+            for (const auto bin : order)
+            {
+                if (expected[bin] == 0.0)
+                {
+                    // anything landing where the pdf integrates to zero is an outright failure
+                    if (observed[bin] > 0.0)
+                    {
+                        result.chiSquare = std::numeric_limits<double>::infinity();
+                        result.pValue = 0.0;
+                        return;
+                    }
+                    continue;
+                }
+                if (expected[bin] < m_params.minExpectedBinCount)
+                {
+                    pooledObserved += observed[bin];
+                    pooledExpected += expected[bin];
+                    if (pooledExpected < m_params.minExpectedBinCount)
+                        continue;
+                    chiSquare += (pooledObserved - pooledExpected) * (pooledObserved - pooledExpected) / pooledExpected;
+                    pooledObserved = pooledExpected = 0.0;
+                }
+                else
+                    chiSquare += (observed[bin] - expected[bin]) * (observed[bin] - expected[bin]) / expected[bin];
+                cells++;
+            }
+            if (pooledExpected > 0.0)
+            {
+                chiSquare += (pooledObserved - pooledExpected) * (pooledObserved - pooledExpected) / pooledExpected;
+                cells++;
+            }
+
+            result.chiSquare = chiSquare;
+            // the total isn't fixed since samples can be discarded, but the test is against a fixed N so one dof goes away
+            result.degreesOfFreedom = cells > 1u ? cells - 1u : 1u;
+            result.pValue = chiSquarePValue(chiSquare, result.degreesOfFreedom);
+        }
+
+        void runWhiteFurnaceTest(SBxDFValidationResult& result)
+        {
+            std::vector<SAlbedoAccumulator> importance(m_params.workerCount), uniform(m_params.workerCount);
+
+            nbl::examples::parallelFor(getShardCount(), [&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+                {
+                    SBatch batch;
+                    std::array<float, BatchSize> uniformValues[3];
+                    for (size_t shard = begin; shard < end; shard++)
+                    {
+                        auto rng = createShardRNG(2u, shard);
+                        forEachBatch(shard, [&](const uint32_t count) -> void
+                            {
+                                fillUniforms(rng, batch, count);
+                                for (uint32_t i = 0; i < count; i++)
+                                {
+                                    const float32_t3 u = float32_t3(batch.u[0][i], batch.u[1][i], batch.u[2][i]);
+                                    const auto generated = generate(m_config, u);
+                                    const bool valid = generated.quotientPdf.pdf > 0.f && std::isfinite(generated.quotientPdf.pdf);
+                                    for (uint32_t c = 0; c < 3; c++)
+                                        batch.quotient[c][i] = valid ? generated.quotientPdf.quotient[c] : 0.f;
+
+                                    // same uniforms reused for the uniform sphere estimator, its a different integral estimator so correlation doesn't matter
+                                    float pdf;
+                                    float32_t3 value;
+                                    evalDirection(m_config, nbl::hlsl::normalize<float32_t3>(uniform_sphere_generate<float>(u.xy)), pdf, value);
+                                    for (uint32_t c = 0; c < 3; c++)
+                                        uniformValues[c][i] = value[c] * 4.f * numbers::pi<float>;
+                                }
+
+                                const float* const quotients[3] = {batch.quotient[0].data(), batch.quotient[1].data(), batch.quotient[2].data()};
+                                importance[workerIx].add(quotients, count);
+                                const float* const values[3] = {uniformValues[0].data(), uniformValues[1].data(), uniformValues[2].data()};
+                                uniform[workerIx].add(values, count);
+                            }
+                        );
+                    }
+                }, m_params.workerCount, 1ull
+            );
+
+            for (uint32_t i = 1u; i < m_params.workerCount; i++)
+            {
+                importance[0].merge(importance[i]);
+                uniform[0].merge(uniform[i]);
+            }
+            importance[0].resolve(m_params.sampleCount, result.albedo, result.albedoStdError);
+            uniform[0].resolve(m_params.sampleCount, result.uniformAlbedo, result.uniformAlbedoStdError);
+        }
+
+        // Q(k/2,x/2), the regularized upper incomplete gamma function
+        static double chiSquarePValue(const double chiSquare, const uint32_t degreesOfFreedom)
+        {
+            const double a = 0.5 * degreesOfFreedom;
+            const double x = 0.5 * chiSquare;
+            if (x <= 0.0)
+                return 1.0;
+            const double logPrefix = -x + a * std::log(x) - std::lgamma(a);
+            if (x < a + 1.0)
+            {
+                // series for P
+                double term = 1.0 / a, sum = term;
+                for (uint32_t n = 1u; n < 1000u; n++)
+                {
+                    term *= x / (a + n);
+                    sum += term;
+                    if (std::abs(term) < std::abs(sum) * 1e-15)
+                        break;
+                }
+                return std::clamp(1.0 - sum * std::exp(logPrefix), 0.0, 1.0);
+            }
+            // Lentz's continued fraction for Q
+            constexpr double Tiny = 1e-300;
+            double b = x + 1.0 - a;
+            double c = 1.0 / Tiny;
+            double d = 1.0 / b;
+            double h = d;
+            for (uint32_t n = 1u; n < 1000u; n++)
+            {
+                const double an = -double(n) * (n - a);
+                b += 2.0;
+                d = an * d + b;
+                if (std::abs(d) < Tiny)
+                    d = Tiny;
+                c = b + an / c;
+                if (std::abs(c) < Tiny)
+                    c = Tiny;
+                d = 1.0 / d;
+                const double delta = d * c;
+                h *= delta;
+                if (std::abs(delta - 1.0) < 1e-15)
+                    break;
+            }
+            return std::clamp(std::exp(logPrefix) * h, 0.0, 1.0);
+        }
+
+        SBxDFValidationParams m_params;
+        test_t m_config;
+};
+
+}
+}
+
+#endif
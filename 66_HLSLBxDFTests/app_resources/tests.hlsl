@@ -452,16 +452,26 @@ struct TestUOffset : TestBxDF<BxDF>
         return NOERR;
     }
 
-    static void run(uint32_t seed, NBL_REF_ARG(FailureCallback) cb)
+    // `t.rc` can be tweaked between `init` and this, the BxDF parameters are taken from it
+    static void setupBxDF(NBL_REF_ARG(this_t) t)
     {
-        uint32_t2 state = pcg32x2(seed);
-
-        this_t t;
-        t.init(state);
         if NBL_CONSTEXPR_FUNC (is_microfacet_brdf_v<BxDF> || is_microfacet_bsdf_v<BxDF>)
             t.template initBxDF<aniso>(t.rc);
         else
             t.initBxDF(t.rc);
+    }
+
+    static this_t create(uint32_t2 state)
+    {
+        this_t t;
+        t.init(state);
+        setupBxDF(t);
+        return t;
+    }
+
+    static void run(uint32_t seed, NBL_REF_ARG(FailureCallback) cb)
+    {
+        this_t t = create(pcg32x2(seed));
         
         ErrorType e = t.test();
         if (e != NOERR)
@@ -1,12 +1,15 @@
 #include <nabla.h>
 #include <iostream>
 #include <iomanip>
+#include <charconv>
+#include <string_view>
 
 #include <nbl/builtin/hlsl/cpp_compat.hlsl>
 
 using namespace nbl::hlsl;
 
 #include "app_resources/tests.hlsl"
+#include "CBxDFValidator.hpp"
 
 struct PrintFailureCallback : FailureCallback
 {
@@ -45,6 +48,31 @@ struct PrintFailureCallback : FailureCallback
     }
 };
 
+template<class BxDF, bool aniso = false>
+bool validate(const SBxDFValidationParams& params)
+{
+    const auto result = CBxDFValidator<BxDF, aniso>(params).run();
+
+    std::cout << result.name << " (" << result.milliseconds << " ms)\n";
+    std::cout << "\tthroughput: " << result.sampleThroughput << " M samples/s, " << result.evalThroughput << " M evals/s\n";
+
+    const bool properties = result.propertiesPassed();
+    std::cout << "\tproperties: " << (properties ? "PASSED" : "FAILED") << " over " << result.propertySamples << " samples";
+    for (uint32_t i = NOERR + 1; i < result.errorCounts.size(); i++)
+    if (result.errorCounts[i])
+        std::cout << ", error " << i << " x" << result.errorCounts[i];
+    std::cout << "\n";
+
+    const bool chiSquare = result.chiSquarePassed(params.significanceLevel);
+    std::cout << "\tchi-square: " << (chiSquare ? "PASSED" : "FAILED") << " chi2 = " << result.chiSquare << " dof = " << result.degreesOfFreedom << " p = " << result.pValue << "\n";
+
+    const bool furnace = result.whiteFurnacePassed();
+    std::cout << "\twhite furnace: " << (furnace ? "PASSED" : "FAILED") << " albedo = (" << result.albedo.x << ", " << result.albedo.y << ", " << result.albedo.z << ")"
+        << " uniform estimate = (" << result.uniformAlbedo.x << ", " << result.uniformAlbedo.y << ", " << result.uniformAlbedo.z << ")\n";
+
+    return properties && chiSquare && furnace;
+}
+
 int main(int argc, char** argv)
 {
     std::cout << std::fixed << std::setprecision(4);
@@ -69,5 +97,44 @@ int main(int argc, char** argv)
     TestUOffset<bxdf::transmission::SGGXDielectricBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,false>::run(state, cb);
     TestUOffset<bxdf::transmission::SGGXDielectricBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,true>::run(state, cb);
 
+    // multi-threaded statistical validation, optional first argument is the sample count per test
+    SBxDFValidationParams params;
+    params.seed = state;
+    if (argc > 1)
+    {
+        const std::string_view arg = argv[1];
+        uint32_t sampleCount = 0u;
+        const auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), sampleCount);
+        if (ec != std::errc() || ptr != arg.data() + arg.size() || sampleCount == 0u)
+        {
+            fprintf(stderr, "sample count must be a positive integer that fits in 32 bits, got \"%s\"\n", argv[1]);
+            return 1;
+        }
+        params.sampleCount = sampleCount;
+    }
+
+    // the checks are statistical and some configurations are degenerate for them (e.g. a near delta lobe against a fixed bin count),
+    // so failures get reported but don't fail the run
+    uint32_t validated = 0u, failed = 0u;
+    auto check = [&](const bool passed) -> void
+    {
+        validated++;
+        if (!passed)
+            failed++;
+    };
+    check(validate<bxdf::reflection::SLambertianBxDF<sample_t, iso_interaction, aniso_interaction, spectral_t>>(params));
+    check(validate<bxdf::reflection::SOrenNayarBxDF<sample_t, iso_interaction, aniso_interaction, spectral_t>>(params));
+    check(validate<bxdf::reflection::SBeckmannBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,false>(params));
+    check(validate<bxdf::reflection::SBeckmannBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,true>(params));
+    check(validate<bxdf::reflection::SGGXBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,false>(params));
+    check(validate<bxdf::reflection::SGGXBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,true>(params));
+
+    check(validate<bxdf::transmission::SLambertianBxDF<sample_t, iso_interaction, aniso_interaction, spectral_t>>(params));
+    check(validate<bxdf::transmission::SBeckmannDielectricBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,false>(params));
+    check(validate<bxdf::transmission::SBeckmannDielectricBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,true>(params));
+    check(validate<bxdf::transmission::SGGXDielectricBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,false>(params));
+    check(validate<bxdf::transmission::SGGXDielectricBxDF<sample_t, iso_cache, aniso_cache, spectral_t>,true>(params));
+
+    std::cout << "statistical validation: " << (validated - failed) << " of " << validated << " configurations passed\n";
     return 0;
 }
\ No newline at end of file
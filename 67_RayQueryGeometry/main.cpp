@@ -3,6 +3,8 @@
 // For conditions of distribution and use, see copyright notice in nabla.h
 
 #include "common.hpp"
+#include "AtomicFileWrite.hpp"
+#include "CCPUBVH.hpp"
 
 class RayQueryGeometryApp final : public examples::SimpleWindowedApplication, public application_templates::MonoAssetManagerAndBuiltinResourceApplication
 {
@@ -127,8 +129,11 @@ class RayQueryGeometryApp final : public examples::SimpleWindowedApplication, pu
 			auto cQueue = getComputeQueue();
 
 			// create geometry objects
+			m_runCPUBVH = std::find(argv.begin(),argv.end(),"-cpu_bvh")!=argv.end();
 			if (!createGeometries(gQueue, geometryCreator))
 				return logFail("Could not create geometries from geometry creator");
+			if (m_runCPUBVH)
+				runCPUBVH();
 
 			// create blas/tlas
 //#define TRY_BUILD_FOR_NGFX // Validation errors on the fake Acquire-Presents, TODO fix
@@ -656,6 +661,9 @@ class RayQueryGeometryApp final : public examples::SimpleWindowedApplication, pu
 						iBuffer->setContentHash(iBuffer->computeContentHash());
 					}
 				scratchObj.index = { .offset = 0, .buffer = iBuffer };
+
+				if (m_runCPUBVH)
+					gatherCPUTriangles(geom, i);
 			}
 
 			auto cmdbuf = getSingleUseCommandBufferAndBegin(pool);
@@ -1057,6 +1065,153 @@ class RayQueryGeometryApp final : public examples::SimpleWindowedApplication, pu
 			return true;
 		}
 
+		// resolves the indices and applies the same placement the TLAS instances get, so the CPU BVH holds exactly the scene the GPU traces
+		void gatherCPUTriangles(const ReferenceObjectCpu& geom, const uint32_t instanceIx)
+		{
+			const auto& vertexBinding = geom.data.bindings[0];
+			const uint32_t vertexStride = geom.data.inputParams.bindings[0].stride;
+			const uint32_t numVertices = vertexBinding.buffer->getSize() / vertexStride;
+			const auto* vertices = reinterpret_cast<const uint8_t*>(vertexBinding.buffer->getPointer()); // no offset, positions first
+
+			const bool indexed = geom.data.indexBuffer.buffer && geom.data.indexType != EIT_UNKNOWN;
+			const void* indices = indexed ? geom.data.indexBuffer.buffer->getPointer() : nullptr;
+			const uint32_t indexCount = indexed ? (geom.data.indexCount / 3 * 3) : (numVertices / 3 * 3);
+			auto getIndex = [&](const uint32_t i) -> uint32_t
+			{
+				if (!indexed)
+					return i;
+				return geom.data.indexType == EIT_16BIT ? reinterpret_cast<const uint16_t*>(indices)[i] : reinterpret_cast<const uint32_t*>(indices)[i];
+			};
+
+			const float offsetX = 5.f * instanceIx;
+			for (uint32_t i = 0; i < indexCount; i += 3)
+			{
+				examples::bvh::STriangle triangle;
+				for (uint32_t v = 0; v < 3; v++)
+				{
+					const auto* position = reinterpret_cast<const float*>(vertices + size_t(getIndex(i + v)) * vertexStride);
+					triangle.vertices[v] = { position[0] + offsetX, position[1], position[2] };
+				}
+				m_cpuBVHTriangles.push_back(triangle);
+			}
+		}
+
+		// Loads a binned SAH BVH over the scene from `localOutputCWD` (building and saving it first if it's missing or stale),
+		// then traces the initial view's primary rays through the memory mapped copy on one and on all threads.
+		void runCPUBVH()
+		{
+			using namespace examples;
+			using bvh_t = bvh::CBinnedSAHBVH;
+
+			const auto cachePath = localOutputCWD / "cpu_bvh.bin";
+			const uint64_t sourceHash = bvh_t::hashTriangles(m_cpuBVHTriangles);
+
+			smart_refctd_ptr<IFile> mappedFile;
+			auto loadMapped = [&]() -> std::optional<bvh_t::SDeserialized>
+			{
+				ISystem::future_t<smart_refctd_ptr<IFile>> future;
+				m_system->createFile(future, cachePath, bitflag(IFile::ECF_READ) | IFile::ECF_MAPPABLE);
+				if (!future.wait())
+					return std::nullopt;
+				future.acquire().move_into(mappedFile);
+				if (!mappedFile)
+					return std::nullopt;
+				// `const` so we get the read-only mapping
+				const IFile* file = mappedFile.get();
+				auto retval = bvh_t::deserialize(file->getMappedPointer(), file->getSize());
+				if (!retval || retval->sourceHash != sourceHash)
+				{
+					mappedFile = nullptr;
+					return std::nullopt;
+				}
+				return retval;
+			};
+
+			auto loaded = loadMapped();
+			if (loaded)
+				m_logger->log("CPU BVH: loaded %s, %d nodes, SAH cost %f", ILogger::ELL_INFO, cachePath.string().c_str(), static_cast<uint32_t>(loaded->view.nodes.size()), loaded->sahCost);
+			else
+			{
+				const auto start = clock_t::now();
+				const auto built = bvh_t::build(m_cpuBVHTriangles);
+				const auto buildTime = std::chrono::duration<double, std::milli>(clock_t::now() - start).count();
+				const auto view = built.getView();
+				m_logger->log("CPU BVH: built over %d triangles in %f ms, %d nodes, depth %d, SAH cost %f", ILogger::ELL_PERFORMANCE,
+					static_cast<uint32_t>(m_cpuBVHTriangles.size()), buildTime, static_cast<uint32_t>(view.nodes.size()), view.computeDepth(), view.computeSAHCost());
+
+				// through a unique temporary and a rename, so a crash or a concurrent run never leaves a truncated BVH to be mapped
+				const auto serialized = built.serialize(sourceHash);
+				const bool written = writeFileAtomically(cachePath, [&](std::ofstream& file) -> void
+					{
+						file.write(reinterpret_cast<const char*>(serialized.data()), serialized.size());
+					}
+				);
+				if (!written)
+					m_logger->log("CPU BVH: failed writing %s", ILogger::ELL_ERROR, cachePath.string().c_str());
+
+				loaded = loadMapped();
+				if (!loaded)
+				{
+					m_logger->log("CPU BVH: could not map %s back, skipping the traversal benchmark", ILogger::ELL_ERROR, cachePath.string().c_str());
+					return;
+				}
+			}
+			const auto& view = loaded->view;
+
+			// primary rays of the initial camera set up in `onAppInitialized`
+			std::vector<bvh::SRay> rays(size_t(WIN_W) * WIN_H);
+			{
+				const bvh::vec3_t position = { -5.81655884f, 2.58630896f, -4.23974705f };
+				const bvh::vec3_t target = { -0.349590302f, -0.213266611f, 0.317821503f };
+				auto normalize = [](const bvh::vec3_t& v) -> bvh::vec3_t
+				{
+					const float rcpLen = 1.f / std::sqrt(bvh::dot(v, v));
+					return { v[0] * rcpLen, v[1] * rcpLen, v[2] * rcpLen };
+				};
+				// left handed, same as `buildProjectionMatrixPerspectiveFovLH`
+				const bvh::vec3_t forward = normalize(target - position);
+				const bvh::vec3_t right = normalize(bvh::cross({ 0.f, 1.f, 0.f }, forward));
+				const bvh::vec3_t up = bvh::cross(forward, right);
+				const float tanHalfFovY = std::tan(core::radians(60.f) * 0.5f);
+				const float tanHalfFovX = tanHalfFovY * float(WIN_W) / WIN_H;
+				for (uint32_t y = 0; y < WIN_H; y++)
+				for (uint32_t x = 0; x < WIN_W; x++)
+				{
+					const float ndcX = (float(x) + 0.5f) * 2.f / WIN_W - 1.f;
+					const float ndcY = 1.f - (float(y) + 0.5f) * 2.f / WIN_H;
+					auto& ray = rays[size_t(y) * WIN_W + x];
+					ray.origin = position;
+					for (auto c = 0; c < 3; c++)
+						ray.direction[c] = forward[c] + right[c] * ndcX * tanHalfFovX + up[c] * ndcY * tanHalfFovY;
+					ray.tMin = 0.1f;
+					ray.tMax = 1000.f;
+				}
+			}
+
+			auto trace = [&](const uint32_t workerCount) -> void
+			{
+				std::atomic<uint64_t> hits = 0u;
+				const auto start = clock_t::now();
+				parallelFor(rays.size(), [&](const size_t begin, const size_t end, const uint32_t) -> void
+					{
+						uint64_t localHits = 0u;
+						for (size_t i = begin; i < end; i++)
+						if (view.intersect(rays[i]).valid())
+							localHits++;
+						hits += localHits;
+					},
+					workerCount
+				);
+				const double seconds = std::chrono::duration<double>(clock_t::now() - start).count();
+				m_logger->log("CPU BVH: %d threads traced %d rays in %f ms, %f MRays/s, %f%% hit", ILogger::ELL_PERFORMANCE,
+					workerCount, static_cast<uint32_t>(rays.size()), seconds * 1000.0, double(rays.size()) / seconds * 1e-6, double(hits.load()) * 100.0 / double(rays.size()));
+			};
+			trace(1u);
+			trace(getDefaultWorkerCount());
+		}
+
+		bool m_runCPUBVH = false;
+		core::vector<examples::bvh::STriangle> m_cpuBVHTriangles;
 
 		smart_refctd_ptr<IWindow> m_window;
 		smart_refctd_ptr<CSimpleResizeSurface<ISimpleManagedSurface::ISwapchainResources>> m_surface;
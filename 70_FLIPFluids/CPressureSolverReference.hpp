@@ -0,0 +1,449 @@
+#ifndef _FLIP_EXAMPLE_C_PRESSURE_SOLVER_REFERENCE_HPP_INCLUDED_
+#define _FLIP_EXAMPLE_C_PRESSURE_SOLVER_REFERENCE_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ParallelFor.hpp"
+
+// Same values as `CM_SOLID`, `CM_FLUID` and `CM_AIR` in `cellUtils.hlsl`
+enum E_CELL_MATERIAL : uint8_t
+{
+    ECM_SOLID = 0,
+    ECM_FLUID = 1,
+    ECM_AIR = 2
+};
+
+enum E_PRESSURE_SOLVER_MODE : uint8_t
+{
+    EPSM_JACOBI = 0,    // what `iteratePressureSystem` does, three sweeps per dispatch (`pressureSolverIterations` dispatches per substep)
+    EPSM_MULTIGRID,     // geometric multigrid V-cycles
+    EPSM_MGPCG,         // conjugate gradient preconditioned with a single V-cycle
+    EPSM_COUNT
+};
+
+inline const char* pressureSolverModeName(const E_PRESSURE_SOLVER_MODE mode)
+{
+    switch (mode)
+    {
+    case EPSM_JACOBI:
+        return "jacobi";
+    case EPSM_MULTIGRID:
+        return "multigrid";
+    case EPSM_MGPCG:
+        return "mgpcg";
+    default:
+        return "unknown";
+    }
+}
+
+// CPU implementation of exactly the same grid operations the GPU pressure solve uses, so that convergence and time-to-tolerance of
+// the different solver modes can be compared without a device. The discretization matches `calculatePressureStep`:
+// for every fluid cell `sum_{non solid neighbours}(p - p_n) * invCellSize^2 = -divergence`, air cells are Dirichlet `p=0`,
+// solid neighbours (and the outside of the grid) are Neumann which is the same as substituting the cell's own pressure.
+class CPressureSolverReference
+{
+    public:
+        using extent_t = std::array<int32_t,3>;
+
+        // `iteratePressureSystem` shrinks its shared memory tile by a cell on every side per sweep, 14^3 down to the 8^3 it writes, so one dispatch is three sweeps
+        constexpr static inline uint32_t JacobiSweepsPerDispatch = 3u;
+
+        struct SParams
+        {
+            E_PRESSURE_SOLVER_MODE mode = EPSM_MGPCG;
+            // stop once `max|residual| <= relativeTolerance * max|rhs|`
+            float relativeTolerance = 1e-4f;
+            // outer iterations, so Jacobi dispatches (`JacobiSweepsPerDispatch` sweeps each), V-cycles or CG iterations depending on the mode
+            uint32_t maxIterations = 200u;
+            uint32_t preSmoothingSweeps = 2u;
+            uint32_t postSmoothingSweeps = 2u;
+            uint32_t coarsestSmoothingSweeps = 32u;
+            // stop coarsening once any dimension gets this small
+            int32_t minCoarseExtent = 4;
+            uint32_t workerCount = 0u;
+        };
+
+        struct SResult
+        {
+            uint32_t iterations = 0u;
+            float initialResidual = 0.f;
+            float finalResidual = 0.f;
+            double milliseconds = 0.0;
+            bool converged = false;
+        };
+
+        // `material` and `divergence` are the dense grids in the same x-fastest order as the 3D textures
+        inline CPressureSolverReference(const extent_t& extent, const float invCellSize, std::span<const uint8_t> material, std::span<const float> divergence)
+        {
+            auto& finest = m_levels.emplace_back();
+            finest.init(extent,invCellSize*invCellSize);
+            std::copy(material.begin(),material.end(),finest.material.begin());
+            for (size_t i=0ull; i<finest.rhs.size(); i++)
+                finest.rhs[i] = finest.material[i]==ECM_FLUID ? -divergence[i]:0.f;
+        }
+
+        inline uint32_t getLevelCount() const {return static_cast<uint32_t>(m_levels.size());}
+        inline const extent_t& getExtent() const {return m_levels.front().extent;}
+
+        // `pressure` is used as the initial guess, so last frame's pressure can warm start the solve like on the GPU
+        inline SResult solve(const SParams& params, std::span<float> pressure)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            m_workerCount = params.workerCount ? params.workerCount:nbl::examples::getDefaultWorkerCount();
+            if (params.mode!=EPSM_JACOBI)
+                buildHierarchy(params.minCoarseExtent);
+
+            auto& finest = m_levels.front();
+            std::copy(pressure.begin(),pressure.end(),finest.pressure.begin());
+
+            SResult result;
+            const float rhsNorm = maxAbs(finest.rhs);
+            computeResidual(finest);
+            result.initialResidual = result.finalResidual = maxAbs(finest.residual);
+            const float threshold = params.relativeTolerance*rhsNorm;
+            result.converged = result.finalResidual<=threshold;
+
+            switch (params.mode)
+            {
+            case EPSM_JACOBI:
+                for (; !result.converged && result.iterations<params.maxIterations; result.iterations++)
+                {
+                    for (uint32_t sweep=0u; sweep<JacobiSweepsPerDispatch; sweep++)
+                        jacobi(finest);
+                    computeResidual(finest);
+                    result.finalResidual = maxAbs(finest.residual);
+                    result.converged = result.finalResidual<=threshold;
+                }
+                break;
+            case EPSM_MULTIGRID:
+                for (; !result.converged && result.iterations<params.maxIterations; result.iterations++)
+                {
+                    vCycle(0u,params);
+                    computeResidual(finest);
+                    result.finalResidual = maxAbs(finest.residual);
+                    result.converged = result.finalResidual<=threshold;
+                }
+                break;
+            case EPSM_MGPCG:
+                result = conjugateGradient(params,threshold,result);
+                break;
+            default:
+                break;
+            }
+
+            std::copy(finest.pressure.begin(),finest.pressure.end(),pressure.begin());
+            result.milliseconds = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+            return result;
+        }
+
+    private:
+        struct SLevel
+        {
+            inline void init(const extent_t& _extent, const float _coeff)
+            {
+                extent = _extent;
+                coeff = _coeff;
+                const size_t count = size_t(extent[0])*extent[1]*extent[2];
+                material.assign(count,ECM_SOLID);
+                pressure.assign(count,0.f);
+                rhs.assign(count,0.f);
+                residual.assign(count,0.f);
+            }
+
+            inline size_t flatIndex(const int32_t x, const int32_t y, const int32_t z) const
+            {
+                return size_t(x)+size_t(extent[0])*(size_t(y)+size_t(extent[1])*size_t(z));
+            }
+
+            // Calls `f(neighbourFlatIndex,neighbourMaterial)` for all 6 neighbours, outside of the grid is solid
+            template<typename F>
+            inline void forEachNeighbour(const int32_t x, const int32_t y, const int32_t z, F&& f) const
+            {
+                const size_t ix = flatIndex(x,y,z);
+                const size_t strides[3] = {1ull,size_t(extent[0]),size_t(extent[0])*extent[1]};
+                const int32_t coords[3] = {x,y,z};
+                for (uint32_t axis=0u; axis<3u; axis++)
+                {
+                    f(ix-strides[axis],coords[axis]>0 ? material[ix-strides[axis]]:uint8_t(ECM_SOLID));
+                    f(ix+strides[axis],coords[axis]+1<extent[axis] ? material[ix+strides[axis]]:uint8_t(ECM_SOLID));
+                }
+            }
+
+            // `diagonal` is `coeff` times the count of non-solid neighbours, `offDiagonalSum` the sum of fluid neighbours of `src`
+            inline void stencil(const int32_t x, const int32_t y, const int32_t z, const std::vector<float>& src, float& diagonal, float& offDiagonalSum) const
+            {
+                uint32_t nonSolid = 0u;
+                float sum = 0.f;
+                forEachNeighbour(x,y,z,[&](const size_t n, const uint8_t mat)->void
+                    {
+                        if (mat==ECM_SOLID)
+                            return;
+                        nonSolid++;
+                        if (mat==ECM_FLUID)
+                            sum += src[n];
+                    }
+                );
+                diagonal = coeff*float(nonSolid);
+                offDiagonalSum = coeff*sum;
+            }
+
+            extent_t extent;
+            float coeff;
+            std::vector<uint8_t> material;
+            std::vector<float> pressure, rhs, residual;
+        };
+
+        template<typename F>
+        inline void forEachSlice(const SLevel& level, F&& f) const
+        {
+            nbl::examples::parallelFor(level.extent[2],[&](const size_t begin, const size_t end, const uint32_t)->void
+                {
+                    for (int32_t z=int32_t(begin); z<int32_t(end); z++)
+                    for (int32_t y=0; y<level.extent[1]; y++)
+                    for (int32_t x=0; x<level.extent[0]; x++)
+                        f(x,y,z);
+                },m_workerCount
+            );
+        }
+
+        static inline float maxAbs(const std::vector<float>& v)
+        {
+            float retval = 0.f;
+            for (const float x : v)
+                retval = std::max(retval,std::abs(x));
+            return retval;
+        }
+
+        inline void buildHierarchy(const int32_t minCoarseExtent)
+        {
+            m_levels.resize(1ull);
+            while (true)
+            {
+                const auto& fine = m_levels.back();
+                if (std::min({fine.extent[0],fine.extent[1],fine.extent[2]})<minCoarseExtent*2)
+                    break;
+                const extent_t coarseExtent = {(fine.extent[0]+1)/2,(fine.extent[1]+1)/2,(fine.extent[2]+1)/2};
+                SLevel coarse;
+                // With piecewise constant prolongation the Galerkin operator `R A P` of the finer level has half the face coefficient
+                coarse.init(coarseExtent,fine.coeff*0.5f);
+                for (int32_t z=0; z<coarseExtent[2]; z++)
+                for (int32_t y=0; y<coarseExtent[1]; y++)
+                for (int32_t x=0; x<coarseExtent[0]; x++)
+                {
+                    // coarse cell is fluid if any child is, otherwise air wins over solid so Dirichlet boundaries don't vanish
+                    bool anyFluid = false, anyAir = false;
+                    forEachChild(fine,x,y,z,[&](const size_t child)->void
+                        {
+                            anyFluid |= fine.material[child]==ECM_FLUID;
+                            anyAir |= fine.material[child]==ECM_AIR;
+                        }
+                    );
+                    coarse.material[coarse.flatIndex(x,y,z)] = anyFluid ? ECM_FLUID:(anyAir ? ECM_AIR:ECM_SOLID);
+                }
+                m_levels.push_back(std::move(coarse));
+            }
+        }
+
+        template<typename F>
+        static inline void forEachChild(const SLevel& fine, const int32_t x, const int32_t y, const int32_t z, F&& f)
+        {
+            for (int32_t dz=0; dz<2; dz++)
+            for (int32_t dy=0; dy<2; dy++)
+            for (int32_t dx=0; dx<2; dx++)
+            {
+                const int32_t cx = x*2+dx, cy = y*2+dy, cz = z*2+dz;
+                if (cx<fine.extent[0] && cy<fine.extent[1] && cz<fine.extent[2])
+                    f(fine.flatIndex(cx,cy,cz));
+            }
+        }
+
+        inline void computeResidual(SLevel& level) const
+        {
+            forEachSlice(level,[&](const int32_t x, const int32_t y, const int32_t z)->void
+                {
+                    const size_t ix = level.flatIndex(x,y,z);
+                    if (level.material[ix]!=ECM_FLUID)
+                    {
+                        level.residual[ix] = 0.f;
+                        return;
+                    }
+                    float diagonal, offDiagonalSum;
+                    level.stencil(x,y,z,level.pressure,diagonal,offDiagonalSum);
+                    level.residual[ix] = level.rhs[ix]-(diagonal*level.pressure[ix]-offDiagonalSum);
+                }
+            );
+        }
+
+        // One sweep of the GPU's update, `p = (coeff*(sum of non-solid neighbours, solid ones replaced by p) + rhs) / (6*coeff)`
+        inline void jacobi(SLevel& level)
+        {
+            std::vector<float> next(level.pressure.size());
+            forEachSlice(level,[&](const int32_t x, const int32_t y, const int32_t z)->void
+                {
+                    const size_t ix = level.flatIndex(x,y,z);
+                    if (level.material[ix]!=ECM_FLUID)
+                    {
+                        next[ix] = 0.f;
+                        return;
+                    }
+                    float diagonal, offDiagonalSum;
+                    level.stencil(x,y,z,level.pressure,diagonal,offDiagonalSum);
+                    const float solidTerm = level.coeff*6.f-diagonal;
+                    next[ix] = (offDiagonalSum+solidTerm*level.pressure[ix]+level.rhs[ix])/(level.coeff*6.f);
+                }
+            );
+            level.pressure.swap(next);
+        }
+
+        // Red-Black Gauss-Seidel, `reverse` flips the colour order so pre and post smoothing together stay symmetric for CG
+        inline void smooth(SLevel& level, const uint32_t sweeps, const bool reverse) const
+        {
+            for (uint32_t s=0u; s<sweeps; s++)
+            for (uint32_t c=0u; c<2u; c++)
+            {
+                const int32_t colour = reverse ? int32_t(1u-c):int32_t(c);
+                forEachSlice(level,[&](const int32_t x, const int32_t y, const int32_t z)->void
+                    {
+                        if (((x+y+z)&0x1)!=colour)
+                            return;
+                        const size_t ix = level.flatIndex(x,y,z);
+                        if (level.material[ix]!=ECM_FLUID)
+                            return;
+                        float diagonal, offDiagonalSum;
+                        level.stencil(x,y,z,level.pressure,diagonal,offDiagonalSum);
+                        // fully enclosed fluid cell has no equation, leave it be
+                        if (diagonal>0.f)
+                            level.pressure[ix] = (level.rhs[ix]+offDiagonalSum)/diagonal;
+                    }
+                );
+            }
+        }
+
+        inline void vCycle(const uint32_t levelIx, const SParams& params)
+        {
+            auto& fine = m_levels[levelIx];
+            if (levelIx+1u==m_levels.size())
+            {
+                smooth(fine,params.coarsestSmoothingSweeps,false);
+                smooth(fine,params.coarsestSmoothingSweeps,true);
+                return;
+            }
+
+            smooth(fine,params.preSmoothingSweeps,false);
+            computeResidual(fine);
+
+            // restrict by averaging the children, `R = P^T/8` which is what the coarse operator's coefficient was derived with
+            auto& coarse = m_levels[levelIx+1u];
+            forEachSlice(coarse,[&](const int32_t x, const int32_t y, const int32_t z)->void
+                {
+                    const size_t ix = coarse.flatIndex(x,y,z);
+                    float sum = 0.f;
+                    forEachChild(fine,x,y,z,[&](const size_t child)->void {sum += fine.residual[child];});
+                    coarse.rhs[ix] = coarse.material[ix]==ECM_FLUID ? sum*0.125f:0.f;
+                    coarse.pressure[ix] = 0.f;
+                }
+            );
+            vCycle(levelIx+1u,params);
+
+            // piecewise constant prolongation of the correction
+            forEachSlice(coarse,[&](const int32_t x, const int32_t y, const int32_t z)->void
+                {
+                    const float correction = coarse.pressure[coarse.flatIndex(x,y,z)];
+                    forEachChild(fine,x,y,z,[&](const size_t child)->void
+                        {
+                            if (fine.material[child]==ECM_FLUID)
+                                fine.pressure[child] += correction;
+                        }
+                    );
+                }
+            );
+            smooth(fine,params.postSmoothingSweeps,true);
+        }
+
+        // Applies the V-cycle to `r` as the preconditioner, `z = M^-1 r` with a zero initial guess
+        inline void precondition(std::vector<float>& r, std::vector<float>& z, const SParams& params)
+        {
+            auto& finest = m_levels.front();
+            // borrow the storage instead of copying, `r` is given back untouched
+            finest.rhs.swap(r);
+            std::fill(finest.pressure.begin(),finest.pressure.end(),0.f);
+            vCycle(0u,params);
+            finest.rhs.swap(r);
+            z = finest.pressure;
+        }
+
+        inline double dot(const std::vector<float>& a, const std::vector<float>& b) const
+        {
+            double retval = 0.0;
+            for (size_t i=0ull; i<a.size(); i++)
+                retval += double(a[i])*double(b[i]);
+            return retval;
+        }
+
+        inline SResult conjugateGradient(const SParams& params, const float threshold, SResult result)
+        {
+            auto& finest = m_levels.front();
+            std::vector<float> x = finest.pressure;
+            std::vector<float> r = finest.residual;
+            std::vector<float> z, Ap(x.size());
+
+            precondition(r,z,params);
+            std::vector<float> p = z;
+            double rz = dot(r,z);
+            for (; !result.converged && result.iterations<params.maxIterations; result.iterations++)
+            {
+                // Ap using the finest level stencil
+                forEachSlice(finest,[&](const int32_t ix, const int32_t iy, const int32_t iz)->void
+                    {
+                        const size_t i = finest.flatIndex(ix,iy,iz);
+                        if (finest.material[i]!=ECM_FLUID)
+                        {
+                            Ap[i] = 0.f;
+                            return;
+                        }
+                        float diagonal, offDiagonalSum;
+                        finest.stencil(ix,iy,iz,p,diagonal,offDiagonalSum);
+                        Ap[i] = diagonal*p[i]-offDiagonalSum;
+                    }
+                );
+                const double pAp = dot(p,Ap);
+                if (pAp<=0.0)
+                    break;
+                const double alpha = rz/pAp;
+                float residual = 0.f;
+                for (size_t i=0ull; i<x.size(); i++)
+                {
+                    x[i] += float(alpha)*p[i];
+                    r[i] -= float(alpha)*Ap[i];
+                    residual = std::max(residual,std::abs(r[i]));
+                }
+                result.finalResidual = residual;
+                result.converged = residual<=threshold;
+                if (result.converged)
+                {
+                    result.iterations++;
+                    break;
+                }
+
+                precondition(r,z,params);
+                const double rzNext = dot(r,z);
+                const float beta = float(rzNext/rz);
+                rz = rzNext;
+                for (size_t i=0ull; i<p.size(); i++)
+                    p[i] = z[i]+beta*p[i];
+            }
+            finest.pressure = std::move(x);
+            return result;
+        }
+
+        uint32_t m_workerCount = 1u;
+        std::vector<SLevel> m_levels;
+};
+
+#endif
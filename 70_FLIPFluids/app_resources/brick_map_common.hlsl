@@ -0,0 +1,62 @@
+#ifndef _FLIP_EXAMPLE_BRICK_MAP_COMMON_HLSL
+#define _FLIP_EXAMPLE_BRICK_MAP_COMMON_HLSL
+
+#include "nbl/builtin/hlsl/cpp_compat.hlsl"
+#include "common.hlsl"
+
+// A brick is `WorkgroupGridDim^3` cells, so a workgroup of the grid passes covers exactly one brick.
+// Bricks containing particles and their 26 neighbours are "active", only those get dispatched over by the sparse passes.
+NBL_CONSTEXPR uint32_t BrickCellCount = WorkgroupGridDim * WorkgroupGridDim * WorkgroupGridDim;
+NBL_CONSTEXPR uint32_t InvalidBrickSlot = 0xffffffffu;
+// `compactActiveBricks` runs one invocation per brick, in cubes of this many bricks per side
+NBL_CONSTEXPR uint32_t CompactWorkgroupDim = 4;
+
+struct SBrickMapPushConstants
+{
+    // bumped every substep, a brick is active when its occupancy equals the current epoch so the occupancy never needs clearing
+    uint32_t epoch;
+};
+
+// Every grid pass that can run sparse takes this, `activeBricksAddress == 0` means a dense dispatch over the whole grid
+struct SBrickDispatchPushConstants
+{
+    uint64_t activeBricksAddress;
+};
+
+// Same layout as `VkDispatchIndirectCommand` so the buffer can be consumed by `dispatchIndirect` directly, `x` is the active brick count
+struct SBrickDispatchArgs
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t z;
+};
+
+#ifdef __HLSL_VERSION
+#include "nbl/builtin/hlsl/glsl_compat/core.hlsl"
+
+// 10 bits per axis is plenty, that's 8192 cells along every dimension
+inline uint32_t packBrickIdx(int32_t3 brickIdx)
+{
+    return uint32_t(brickIdx.x) | (uint32_t(brickIdx.y) << 10) | (uint32_t(brickIdx.z) << 20);
+}
+inline int32_t3 unpackBrickIdx(uint32_t packed)
+{
+    return int32_t3(packed & 0x3ffu, (packed >> 10) & 0x3ffu, packed >> 20);
+}
+
+// Brick the current workgroup works on, either straight from the dispatch or looked up in the compacted list of active bricks
+inline int32_t3 getDispatchBrickIdx(uint64_t activeBricksAddress)
+{
+    const uint32_t3 groupID = nbl::hlsl::glsl::gl_WorkGroupID();
+    if (activeBricksAddress == 0)
+        return groupID;
+    return unpackBrickIdx(vk::RawBufferLoad<uint32_t>(activeBricksAddress + groupID.x * sizeof(uint32_t)));
+}
+
+inline int32_t3 getDispatchCellIdx(uint64_t activeBricksAddress)
+{
+    return getDispatchBrickIdx(activeBricksAddress) * WorkgroupGridDim + int32_t3(nbl::hlsl::glsl::gl_LocalInvocationID());
+}
+#endif
+
+#endif
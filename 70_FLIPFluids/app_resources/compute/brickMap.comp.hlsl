@@ -0,0 +1,117 @@
+#include "../common.hlsl"
+#include "../gridUtils.hlsl"
+#include "../descriptor_bindings.hlsl"
+#include "../brick_map_common.hlsl"
+
+#include "nbl/builtin/hlsl/glsl_compat/core.hlsl"
+#include "nbl/builtin/hlsl/glsl_compat/subgroup_basic.hlsl"
+#include "nbl/builtin/hlsl/glsl_compat/subgroup_ballot.hlsl"
+
+// Both passes are dispatched densely over all the bricks once per substep after the particle counts are known,
+// the marking with one workgroup per brick and the compaction with one invocation per brick.
+
+[[vk::push_constant]] SBrickMapPushConstants pc;
+
+[[vk::binding(b_bmGridData, s_bm)]]
+cbuffer GridData
+{
+    SGridData gridData;
+};
+
+[[vk::binding(b_bmGridPCount, s_bm)]] RWTexture3D<uint> gridParticleCount;
+[[vk::binding(b_bmPres, s_bm)]] RWTexture3D<float> pressureGrid;
+[[vk::binding(b_bmOccupancy, s_bm)]] RWStructuredBuffer<uint> brickOccupancy;
+[[vk::binding(b_bmIndirection, s_bm)]] RWStructuredBuffer<uint> brickIndirection;
+[[vk::binding(b_bmActiveBricks, s_bm)]] RWStructuredBuffer<uint> activeBricks;
+[[vk::binding(b_bmDispatchArgs, s_bm)]] RWStructuredBuffer<SBrickDispatchArgs> dispatchArgs;
+
+int32_t3 getBrickExtent()
+{
+    return (gridData.gridSize.xyz + (int32_t3)(WorkgroupGridDim - 1)) / WorkgroupGridDim;
+}
+
+groupshared uint sOccupied;
+
+// Stamps the brick and all of its neighbours with the current epoch if any of its cells contains particles
+[numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
+void markActiveBricks(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const uint localIdx = nbl::hlsl::glsl::gl_LocalInvocationIndex();
+    const int32_t3 brickIdx = nbl::hlsl::glsl::gl_WorkGroupID();
+    if (localIdx == 0)
+    {
+        sOccupied = 0;
+        // nothing reads the counter until the compaction pass
+        if (all(brickIdx == (int32_t3)0))
+        {
+            dispatchArgs[0].x = 0;
+            dispatchArgs[0].y = 1;
+            dispatchArgs[0].z = 1;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    const int32_t3 cellIdx = ID;
+    if (all(cellIdx < gridData.gridSize.xyz) && gridParticleCount[cellIdx] != 0)
+        sOccupied = 1; // every writer writes the same value, no atomic needed
+    GroupMemoryBarrierWithGroupSync();
+
+    if (localIdx != 0 || sOccupied == 0)
+        return;
+
+    const int32_t3 brickExtent = getBrickExtent();
+    for (int32_t z = -1; z <= 1; z++)
+    for (int32_t y = -1; y <= 1; y++)
+    for (int32_t x = -1; x <= 1; x++)
+    {
+        const int32_t3 neighbour = brickIdx + int32_t3(x, y, z);
+        if (any(neighbour < (int32_t3)0) || any(neighbour >= brickExtent))
+            continue;
+        brickOccupancy[cellIdxToFlatIdx(neighbour, int32_t4(brickExtent, 0))] = pc.epoch;
+    }
+}
+
+// Appends the active bricks to the list the sparse passes index with their workgroup ID and updates the brick to slot indirection table.
+// Bricks which just went inactive get their pressure zeroed, the Jacobi halo and `updateVelocities` read it as the Dirichlet air value.
+[numthreads(CompactWorkgroupDim, CompactWorkgroupDim, CompactWorkgroupDim)]
+void compactActiveBricks(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const int32_t3 brickIdx = ID;
+    const int32_t3 brickExtent = getBrickExtent();
+    // no early out, every invocation needs to take part in the ballot
+    const bool inGrid = all(brickIdx < brickExtent);
+    const uint flatBrickIdx = cellIdxToFlatIdx(brickIdx, int32_t4(brickExtent, 0));
+    const bool active = inGrid && brickOccupancy[flatBrickIdx] == pc.epoch;
+
+    // one atomic per subgroup instead of one per active brick, the active invocations take consecutive slots in the order of the ballot
+    const uint32_t4 ballot = nbl::hlsl::glsl::subgroupBallot(active);
+    const uint activeCount = nbl::hlsl::glsl::subgroupBallotBitCount(ballot);
+    uint firstSlot = 0;
+    if (activeCount != 0 && nbl::hlsl::glsl::subgroupElect())
+        InterlockedAdd(dispatchArgs[0].x, activeCount, firstSlot);
+    firstSlot = nbl::hlsl::glsl::subgroupBroadcastFirst(firstSlot);
+    if (!inGrid)
+        return;
+
+    const bool wasActive = brickIndirection[flatBrickIdx] != InvalidBrickSlot;
+    uint slot = InvalidBrickSlot;
+    if (active)
+    {
+        slot = firstSlot + nbl::hlsl::glsl::subgroupBallotExclusiveBitCount(ballot);
+        activeBricks[slot] = packBrickIdx(brickIdx);
+    }
+    brickIndirection[flatBrickIdx] = slot;
+
+    // only happens on the substep the fluid leaves the brick's neighbourhood, so a single invocation looping is fine
+    if (!wasActive || active)
+        return;
+    const int32_t3 firstCell = brickIdx * WorkgroupGridDim;
+    for (int32_t z = 0; z < WorkgroupGridDim; z++)
+    for (int32_t y = 0; y < WorkgroupGridDim; y++)
+    for (int32_t x = 0; x < WorkgroupGridDim; x++)
+    {
+        const int32_t3 cellIdx = firstCell + int32_t3(x, y, z);
+        if (all(cellIdx < gridData.gridSize.xyz))
+            pressureGrid[cellIdx] = 0.f;
+    }
+}
@@ -0,0 +1,183 @@
+#include "../common.hlsl"
+#include "../gridUtils.hlsl"
+#include "../cellUtils.hlsl"
+#include "../descriptor_bindings.hlsl"
+#include "../pressure_multigrid_common.hlsl"
+
+#include "nbl/builtin/hlsl/glsl_compat/core.hlsl"
+#include "nbl/builtin/hlsl/glsl_compat/subgroup_basic.hlsl"
+#include "nbl/builtin/hlsl/glsl_compat/subgroup_arithmetic.hlsl"
+
+// Geometric multigrid V-cycle for the same system `iteratePressureSystem` relaxes with Jacobi, see `CPressureSolverReference.hpp`
+// for the CPU implementation of the exact same operations. For every fluid cell:
+//      coeff * sum_{non solid neighbours}(p - p_n) = -divergence
+// air cells are Dirichlet `p=0` and solid cells (or outside of the grid) are Neumann.
+
+[[vk::push_constant]] SPressureMultigridPushConstants pc;
+
+[[vk::binding(b_pmgGridData, s_pmg)]]
+cbuffer GridData
+{
+    SGridData gridData;
+};
+
+[[vk::binding(b_pmgCM, s_pmg)]] RWTexture3D<uint> cellMaterialGrid;
+[[vk::binding(b_pmgDiv, s_pmg)]] RWTexture3D<float> divergenceGrid;
+[[vk::binding(b_pmgPres, s_pmg)]] RWTexture3D<float> pressureGrid;
+[[vk::binding(b_pmgStats, s_pmg)]] RWStructuredBuffer<SPressureMultigridStats> stats;
+
+// TODO: make a proper accessor struct for a level once our BDA utilities support these
+uint loadMaterial(uint64_t address, int32_t3 idx, int32_t4 extent)
+{
+    // outside of the grid is solid
+    if (any(idx < (int32_t3)0) || any(idx >= extent.xyz))
+        return CM_SOLID;
+    return vk::RawBufferLoad<uint>(address + cellIdxToFlatIdx(idx, extent) * sizeof(uint));
+}
+float loadFloat(uint64_t address, int32_t3 idx, int32_t4 extent)
+{
+    return vk::RawBufferLoad<float>(address + cellIdxToFlatIdx(idx, extent) * sizeof(float));
+}
+void storeFloat(uint64_t address, int32_t3 idx, int32_t4 extent, float value)
+{
+    vk::RawBufferStore<float>(address + cellIdxToFlatIdx(idx, extent) * sizeof(float), value);
+}
+
+// `diagonal` is `coeff` times the number of non-solid neighbours, `offDiagonalSum` the weighted pressures of the fluid ones
+void stencil(int32_t3 idx, out float diagonal, out float offDiagonalSum)
+{
+    const int32_t3 offsets[6] = {
+        int32_t3(-1, 0, 0), int32_t3(1, 0, 0),
+        int32_t3(0, -1, 0), int32_t3(0, 1, 0),
+        int32_t3(0, 0, -1), int32_t3(0, 0, 1)
+    };
+
+    uint nonSolid = 0;
+    float sum = 0.f;
+    [unroll]
+    for (uint i = 0; i < 6; i++)
+    {
+        const int32_t3 n = idx + offsets[i];
+        const uint material = loadMaterial(pc.fineMaterialAddress, n, pc.fineExtent);
+        if (isSolidCell(material))
+            continue;
+        nonSolid++;
+        if (isFluidCell(material))
+            sum += loadFloat(pc.finePressureAddress, n, pc.fineExtent);
+    }
+    diagonal = pc.fineCoeff * float(nonSolid);
+    offDiagonalSum = pc.fineCoeff * sum;
+}
+
+float residual(int32_t3 idx)
+{
+    if (!isFluidCell(loadMaterial(pc.fineMaterialAddress, idx, pc.fineExtent)))
+        return 0.f;
+    float diagonal, offDiagonalSum;
+    stencil(idx, diagonal, offDiagonalSum);
+    const float pressure = loadFloat(pc.finePressureAddress, idx, pc.fineExtent);
+    return loadFloat(pc.fineRhsAddress, idx, pc.fineExtent) - (diagonal * pressure - offDiagonalSum);
+}
+
+// Copies the problem from the simulation's textures into the finest level, last substep's pressure is the initial guess
+[numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
+void gatherFinestLevel(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const int32_t3 cellIdx = ID;
+    if (all(cellIdx == (int32_t3)0))
+    {
+        stats[0].maxResidual = 0;
+        stats[0].maxRhs = 0;
+    }
+    if (any(cellIdx >= pc.fineExtent.xyz))
+        return;
+
+    const uint material = getCellMaterial(cellMaterialGrid[cellIdx]);
+    const bool fluid = isFluidCell(material);
+    vk::RawBufferStore<uint>(pc.fineMaterialAddress + cellIdxToFlatIdx(cellIdx, pc.fineExtent) * sizeof(uint), material);
+    storeFloat(pc.fineRhsAddress, cellIdx, pc.fineExtent, fluid ? -divergenceGrid[cellIdx] : 0.f);
+    storeFloat(pc.finePressureAddress, cellIdx, pc.fineExtent, fluid ? pressureGrid[cellIdx] : 0.f);
+}
+
+// One colour of a Red-Black Gauss-Seidel sweep, cells of one colour only depend on the other so there are no races
+[numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
+void smoothRedBlack(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const int32_t3 cellIdx = ID;
+    if (any(cellIdx >= pc.fineExtent.xyz) || ((cellIdx.x + cellIdx.y + cellIdx.z) & 0x1) != pc.colour)
+        return;
+    if (!isFluidCell(loadMaterial(pc.fineMaterialAddress, cellIdx, pc.fineExtent)))
+        return;
+
+    float diagonal, offDiagonalSum;
+    stencil(cellIdx, diagonal, offDiagonalSum);
+    // a fluid cell enclosed by solids has no equation
+    if (diagonal > 0.f)
+        storeFloat(pc.finePressureAddress, cellIdx, pc.fineExtent, (loadFloat(pc.fineRhsAddress, cellIdx, pc.fineExtent) + offDiagonalSum) / diagonal);
+}
+
+// One invocation per coarse cell, averages the residual of its (up to) 8 children and derives the coarse cell's material
+[numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
+void restrictResidual(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const int32_t3 coarseIdx = ID;
+    if (any(coarseIdx >= pc.coarseExtent.xyz))
+        return;
+
+    bool anyFluid = false;
+    bool anyAir = false;
+    float sum = 0.f;
+    for (int32_t z = 0; z < 2; z++)
+    for (int32_t y = 0; y < 2; y++)
+    for (int32_t x = 0; x < 2; x++)
+    {
+        const int32_t3 child = coarseIdx * 2 + int32_t3(x, y, z);
+        if (any(child >= pc.fineExtent.xyz))
+            continue;
+        const uint material = loadMaterial(pc.fineMaterialAddress, child, pc.fineExtent);
+        anyFluid = anyFluid || isFluidCell(material);
+        anyAir = anyAir || isAirCell(material);
+        sum += residual(child);
+    }
+
+    // air wins over solid so that the Dirichlet boundary doesn't disappear on coarse levels
+    const uint coarseMaterial = anyFluid ? CM_FLUID : (anyAir ? CM_AIR : CM_SOLID);
+    vk::RawBufferStore<uint>(pc.coarseMaterialAddress + cellIdxToFlatIdx(coarseIdx, pc.coarseExtent) * sizeof(uint), coarseMaterial);
+    storeFloat(pc.coarseRhsAddress, coarseIdx, pc.coarseExtent, anyFluid ? sum * 0.125f : 0.f);
+    storeFloat(pc.coarsePressureAddress, coarseIdx, pc.coarseExtent, 0.f);
+}
+
+// One invocation per fine cell, piecewise constant interpolation of the coarse correction
+[numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
+void prolongateCorrection(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const int32_t3 cellIdx = ID;
+    if (any(cellIdx >= pc.fineExtent.xyz))
+        return;
+    if (!isFluidCell(loadMaterial(pc.fineMaterialAddress, cellIdx, pc.fineExtent)))
+        return;
+
+    const float correction = loadFloat(pc.coarsePressureAddress, cellIdx / 2, pc.coarseExtent);
+    storeFloat(pc.finePressureAddress, cellIdx, pc.fineExtent, loadFloat(pc.finePressureAddress, cellIdx, pc.fineExtent) + correction);
+}
+
+// Writes the solution back for `updateVelocities` and reports the residual so the host can decide how many V-cycles the next frame needs
+[numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
+void scatterFinestLevel(uint32_t3 ID : SV_DispatchThreadID)
+{
+    const int32_t3 cellIdx = ID;
+    if (any(cellIdx >= pc.fineExtent.xyz))
+        return;
+
+    pressureGrid[cellIdx] = loadFloat(pc.finePressureAddress, cellIdx, pc.fineExtent);
+
+    // reduce within the subgroup first so only one invocation per subgroup hits the atomics,
+    // the values are non-negative floats so their bit patterns order the same way as the floats themselves
+    const uint maxResidual = nbl::hlsl::glsl::subgroupMax(asuint(abs(residual(cellIdx))));
+    const uint maxRhs = nbl::hlsl::glsl::subgroupMax(asuint(abs(loadFloat(pc.fineRhsAddress, cellIdx, pc.fineExtent))));
+    if (nbl::hlsl::glsl::subgroupElect())
+    {
+        InterlockedMax(stats[0].maxResidual, maxResidual);
+        InterlockedMax(stats[0].maxRhs, maxRhs);
+    }
+}
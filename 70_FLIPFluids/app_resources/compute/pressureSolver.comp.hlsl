@@ -2,6 +2,7 @@
 #include "../gridUtils.hlsl"
 #include "../cellUtils.hlsl"
 #include "../descriptor_bindings.hlsl"
+#include "../brick_map_common.hlsl"
 
 #include "nbl/builtin/hlsl/glsl_compat/core.hlsl"
 
@@ -12,6 +13,9 @@ struct SPressureSolverParams
     float4 coeff2; // W component is unused
 };
 
+// all of the passes here can run over only the active bricks
+[[vk::push_constant]] SBrickDispatchPushConstants brickDispatch;
+
 [[vk::binding(b_psGridData, s_ps)]]
 cbuffer GridData
 {
@@ -36,9 +40,9 @@ groupshared float sDivergence[14][14][14];
 groupshared float sPressure[14][14][14];
 
 [numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
-void calculateNegativeDivergence(uint32_t3 ID : SV_DispatchThreadID)
+void calculateNegativeDivergence()
 {
-    int3 cellIdx = ID;
+    int3 cellIdx = getDispatchCellIdx(brickDispatch.activeBricksAddress);
 
     float3 param = (float3)gridData.gridInvCellSize;
     float3 velocity;
@@ -88,9 +92,9 @@ float calculatePressureStep(int3 idx)
 }
 
 [numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
-void iteratePressureSystem(uint32_t3 ID : SV_DispatchThreadID)
+void iteratePressureSystem()
 {
-    uint3 gid = nbl::hlsl::glsl::gl_WorkGroupID();
+    int3 gid = getDispatchBrickIdx(brickDispatch.activeBricksAddress);
 
     // load shared mem
     for (uint virtualIdx = nbl::hlsl::glsl::gl_LocalInvocationIndex();
@@ -159,17 +163,16 @@ void iteratePressureSystem(uint32_t3 ID : SV_DispatchThreadID)
 
     // do 8x8x8 iteration (final) and write
     int3 lid = nbl::hlsl::glsl::gl_LocalInvocationID();
-    lid += int3(3, 3, 3);
 
-    float pressure = calculatePressureStep(lid);
-    pressureGrid[ID] = pressure;
+    float pressure = calculatePressureStep(lid + int3(3, 3, 3));
+    pressureGrid[gid * WorkgroupGridDim + lid] = pressure;
 }
 
 // TODO: why doesn't the last invocation of `iteratePressureSystem` have this step fused into it!? It would be just a simple push constant `isLastIteration` that would decide whether to run this dispatch
 [numthreads(WorkgroupGridDim, WorkgroupGridDim, WorkgroupGridDim)]
-void updateVelocities(uint32_t3 ID : SV_DispatchThreadID)
+void updateVelocities()
 {
-    int3 cellIdx = ID;
+    int3 cellIdx = getDispatchCellIdx(brickDispatch.activeBricksAddress);
 
     uint cellMaterial = cellMaterialGrid[cellIdx];
 
@@ -393,6 +393,118 @@ NBL_CONSTEXPR IGPUDescriptorSetLayout::SBinding psUpdateVelPs_bs1[] = {
 };
 #endif
 
+// brickMap
+NBL_CONSTEXPR uint32_t s_bm = 1;
+NBL_CONSTEXPR uint32_t b_bmGridData = 0;
+NBL_CONSTEXPR uint32_t b_bmGridPCount = 1;
+NBL_CONSTEXPR uint32_t b_bmPres = 2;
+NBL_CONSTEXPR uint32_t b_bmOccupancy = 3;
+NBL_CONSTEXPR uint32_t b_bmIndirection = 4;
+NBL_CONSTEXPR uint32_t b_bmActiveBricks = 5;
+NBL_CONSTEXPR uint32_t b_bmDispatchArgs = 6;
+
+#ifndef __HLSL_VERSION
+NBL_CONSTEXPR IGPUDescriptorSetLayout::SBinding bmBrickMap_bs1[] = {
+    {
+        .binding = b_bmGridData,
+        .type = asset::IDescriptor::E_TYPE::ET_UNIFORM_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_bmGridPCount,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_IMAGE,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_bmPres,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_IMAGE,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_bmOccupancy,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_bmIndirection,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_bmActiveBricks,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_bmDispatchArgs,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    }
+};
+#endif
+
+// pressureMultigrid
+NBL_CONSTEXPR uint32_t s_pmg = 1;
+NBL_CONSTEXPR uint32_t b_pmgGridData = 0;
+NBL_CONSTEXPR uint32_t b_pmgCM = 1;
+NBL_CONSTEXPR uint32_t b_pmgDiv = 2;
+NBL_CONSTEXPR uint32_t b_pmgPres = 3;
+NBL_CONSTEXPR uint32_t b_pmgStats = 4;
+
+#ifndef __HLSL_VERSION
+NBL_CONSTEXPR IGPUDescriptorSetLayout::SBinding pmgMultigrid_bs1[] = {
+    {
+        .binding = b_pmgGridData,
+        .type = asset::IDescriptor::E_TYPE::ET_UNIFORM_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_pmgCM,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_IMAGE,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_pmgDiv,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_IMAGE,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_pmgPres,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_IMAGE,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    },
+    {
+        .binding = b_pmgStats,
+        .type = asset::IDescriptor::E_TYPE::ET_STORAGE_BUFFER,
+        .createFlags = IGPUDescriptorSetLayout::SBinding::E_CREATE_FLAGS::ECF_NONE,
+        .stageFlags = asset::IShader::E_SHADER_STAGE::ESS_COMPUTE,
+        .count = 1,
+    }
+};
+#endif
+
 // advectParticles
 NBL_CONSTEXPR uint32_t s_ap = 1;
 NBL_CONSTEXPR uint32_t b_apGridData = 0;
@@ -0,0 +1,33 @@
+#ifndef _FLIP_EXAMPLE_PRESSURE_MULTIGRID_COMMON_HLSL
+#define _FLIP_EXAMPLE_PRESSURE_MULTIGRID_COMMON_HLSL
+
+#include "nbl/builtin/hlsl/cpp_compat.hlsl"
+
+// Every level of the hierarchy lives in one BDA buffer as three flat x-fastest arrays: `uint` material, `float` pressure and `float` rhs.
+// A dispatch only ever touches two adjacent levels, so the push constants carry just the fine and the coarse one.
+struct SPressureMultigridPushConstants
+{
+    int32_t4 fineExtent;        // W component is unused
+    int32_t4 coarseExtent;      // W component is unused
+
+    uint64_t fineMaterialAddress;
+    uint64_t finePressureAddress;
+    uint64_t fineRhsAddress;
+    uint64_t coarseMaterialAddress;
+    uint64_t coarsePressureAddress;
+    uint64_t coarseRhsAddress;
+
+    // `invCellSize^2` on the finest level, halved on every coarser one (Galerkin coefficient for piecewise constant prolongation)
+    float32_t fineCoeff;
+    // which Red-Black Gauss-Seidel colour to update, 0 or 1
+    uint32_t colour;
+};
+
+// Written by `scatterFinestLevel` as `asuint` of the max-norms, positive floats order the same as their bit patterns so `InterlockedMax` works
+struct SPressureMultigridStats
+{
+    uint32_t maxResidual;
+    uint32_t maxRhs;
+};
+
+#endif
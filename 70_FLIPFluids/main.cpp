@@ -4,8 +4,14 @@
 #include "SimpleWindowedApplication.hpp"
 #include "InputSystem.hpp"
 #include "CCamera.hpp"
+#include "CShaderCompileCache.hpp"
 
 #include "glm/glm/glm.hpp"
+#include "argparse/argparse.hpp"
+
+#include <bit>
+#include <random>
+
 #include <nbl/builtin/hlsl/cpp_compat.hlsl>
 #include <nbl/builtin/hlsl/cpp_compat/matrix.hlsl>
 
@@ -22,6 +28,10 @@ using namespace video;
 #include "app_resources/gridUtils.hlsl"
 #include "app_resources/render_common.hlsl"
 #include "app_resources/descriptor_bindings.hlsl"
+#include "app_resources/pressure_multigrid_common.hlsl"
+#include "app_resources/brick_map_common.hlsl"
+
+#include "CPressureSolverReference.hpp"
 
 enum SimPresets
 {
@@ -211,6 +221,55 @@ public:
 
     inline bool onAppInitialized(smart_refctd_ptr<ISystem>&& system) override
     {
+        argparse::ArgumentParser program("FLIP Fluids");
+
+        program.add_argument<std::string>("--pressure-solver")
+            .default_value(std::string(pressureSolverModeName(EPSM_JACOBI)))
+            .help("Pressure solver used by the simulation, either `jacobi` or `multigrid`");
+
+        program.add_argument("--sparse-grid")
+            .default_value(false)
+            .implicit_value(true)
+            .help("Track which 8^3 bricks are near particles and only run the pressure projection passes over those");
+
+        program.add_argument("--pressure-benchmark")
+            .default_value(false)
+            .implicit_value(true)
+            .help("Don't simulate, benchmark the CPU reference implementations of all pressure solver modes and exit");
+
+        try
+        {
+            program.parse_args({ argv.data(), argv.data() + argv.size() });
+        }
+        catch (const std::exception& err)
+        {
+            std::cerr << err.what() << std::endl << program; // NOTE: std::cerr because logger isn't initialized yet
+            return false;
+        }
+
+        {
+            const auto solver = program.get<std::string>("--pressure-solver");
+            if (solver == pressureSolverModeName(EPSM_MULTIGRID))
+                m_pressureSolverMode = EPSM_MULTIGRID;
+            else if (solver != pressureSolverModeName(EPSM_JACOBI))
+            {
+                std::cerr << "Unsupported pressure solver \"" << solver << "\" on the GPU, use `jacobi` or `multigrid`" << std::endl;
+                return false;
+            }
+        }
+
+        m_useBrickMap = program.get<bool>("--sparse-grid");
+
+        // Headless, doesn't need a device nor a window
+        if (program.get<bool>("--pressure-benchmark"))
+        {
+            m_pressureBenchmarkOnly = true;
+            if (!asset_base_t::onAppInitialized(std::move(system)))
+                return false;
+            runPressureSolverBenchmark();
+            return true;
+        }
+
         m_inputSystem = make_smart_refctd_ptr<InputSystem>(logger_opt_smart_ptr(smart_refctd_ptr(m_logger)));
 
         if (!device_base_t::onAppInitialized(std::move(system)))
@@ -218,6 +277,8 @@ public:
         if (!asset_base_t::onAppInitialized(std::move(system)))
             return false;
 
+        m_shaderCache = std::make_unique<nbl::examples::CShaderCompileCache>(smart_refctd_ptr(m_system), sharedOutputCWD / "shader_cache");
+
         // init grid params
         usePreset(CENTER_DROP);
         
@@ -676,9 +737,10 @@ public:
             }
         }
         // solve pressure system pipelines
+        const asset::SPushConstantRange brickDispatchPcRange = { .stageFlags = IShader::E_SHADER_STAGE::ESS_COMPUTE, .offset = 0, .size = sizeof(SBrickDispatchPushConstants) };
         {
             createComputePipeline(m_calcDivergencePipeline, m_calcDivergencePool, m_calcDivergenceDs, 
-                "app_resources/compute/pressureSolver.comp.hlsl", "calculateNegativeDivergence", psDivergence_bs1);
+                "app_resources/compute/pressureSolver.comp.hlsl", "calculateNegativeDivergence", psDivergence_bs1, brickDispatchPcRange);
 
             {
                 IGPUDescriptorSet::SDescriptorInfo infos[3];
@@ -713,7 +775,7 @@ public:
         }
         {
             createComputePipeline(m_iteratePressurePipeline, m_iteratePressurePool, m_iteratePressureDs,
-                "app_resources/compute/pressureSolver.comp.hlsl", "iteratePressureSystem", psIteratePressure_bs1);
+                "app_resources/compute/pressureSolver.comp.hlsl", "iteratePressureSystem", psIteratePressure_bs1, brickDispatchPcRange);
 
             {
                 IGPUDescriptorSet::SDescriptorInfo infos[5];
@@ -742,7 +804,7 @@ public:
         }
         {
             createComputePipeline(m_updateVelPsPipeline, m_updateVelPsPool, m_updateVelPsDs, 
-                "app_resources/compute/pressureSolver.comp.hlsl", "updateVelocities", psUpdateVelPs_bs1);
+                "app_resources/compute/pressureSolver.comp.hlsl", "updateVelocities", psUpdateVelPs_bs1, brickDispatchPcRange);
 
             {
                 IGPUDescriptorSet::SDescriptorInfo infos[4];
@@ -778,6 +840,10 @@ public:
                 m_device->updateDescriptorSets(std::span(writes, 5), {});
             }
         }
+        if (m_pressureSolverMode == EPSM_MULTIGRID && !initMultigridPressureSolver(createComputePipeline))
+            return logFail("Failed to initialize the multigrid pressure solver!\n");
+        if (m_useBrickMap && !initBrickMap(createComputePipeline))
+            return logFail("Failed to initialize the brick map!\n");
         {
             // advect particles pipeline
             const asset::SPushConstantRange pcRange = { .stageFlags = IShader::E_SHADER_STAGE::ESS_COMPUTE, .offset = 0, .size = 2 * sizeof(uint64_t) };
@@ -943,6 +1009,13 @@ public:
 
             initializeParticles(cmdbuf);
 
+            if (m_useBrickMap)
+            {
+                // epoch 0 is never current so all bricks start out inactive
+                cmdbuf->fillBuffer({ .offset = 0, .size = m_brickOccupancyBuffer->getSize(), .buffer = m_brickOccupancyBuffer }, 0u);
+                cmdbuf->fillBuffer({ .offset = 0, .size = m_brickIndirectionBuffer->getSize(), .buffer = m_brickIndirectionBuffer }, InvalidBrickSlot);
+            }
+
             transitionGridImageLayouts(cmdbuf);
 
             // TODO: fat pipeline barrier! The bottom one only ever protected the UBO write.
@@ -962,12 +1035,34 @@ public:
         for (uint32_t i = 0; i < m_substepsPerFrame; i++)
         {
             dispatchUpdateFluidCells(cmdbuf);			// particle to grid
+            if (m_useBrickMap)
+                dispatchUpdateBrickMap(cmdbuf);
             dispatchApplyBodyForces(cmdbuf, i == 0);	// external forces, e.g. gravity
             dispatchApplyDiffusion(cmdbuf);
             dispatchApplyPressure(cmdbuf);
             dispatchAdvection(cmdbuf);				// update/advect fluid
         }
 
+        // last substep's active brick count for the occupancy report
+        if (m_useBrickMap)
+        {
+            SMemoryBarrier memBarrier;
+            memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+            memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
+            memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COPY_BIT;
+            memBarrier.dstAccessMask = ACCESS_FLAGS::TRANSFER_READ_BIT;
+            cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+
+            const IGPUCommandBuffer::SBufferCopy region = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(SBrickDispatchArgs) };
+            cmdbuf->copyBuffer(m_brickDispatchArgsBuffer.get(), m_brickStatsBuffer.get(), 1, &region);
+
+            memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COPY_BIT;
+            memBarrier.srcAccessMask = ACCESS_FLAGS::TRANSFER_WRITE_BIT;
+            memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::HOST_BIT;
+            memBarrier.dstAccessMask = ACCESS_FLAGS::HOST_READ_BIT;
+            cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+        }
+
     // TODO: remove the compute shader generating vertices, collapse the two barriers around it into one. Need to think about next frame compute/transfer stepping on our toes.
     // The pipeline barrier shouldn't really be here and should be expressed through a subpass external dependency
         {
@@ -1111,6 +1206,11 @@ public:
                         } };
 
                         m_device->blockForSemaphores(waitInfos); // this is not solution, quick wa to not throw validation errors
+
+                        if (m_pressureSolverMode == EPSM_MULTIGRID)
+                            adaptMultigridCycleCount();
+                        if (m_useBrickMap)
+                            reportBrickMapOccupancy();
                     }
                     else
                         --m_realFrameIx;
@@ -1123,7 +1223,7 @@ public:
 
     inline bool keepRunning() override
     {
-        if (m_surface->irrecoverable())
+        if (m_pressureBenchmarkOnly || m_surface->irrecoverable())
             return false;
 
         return true;
@@ -1131,6 +1231,9 @@ public:
 
     inline bool onAppTerminated() override
     {
+        if (m_pressureBenchmarkOnly)
+            return asset_base_t::onAppTerminated();
+        m_shaderCache->logStats(m_logger.get());
         return device_base_t::onAppTerminated();
     }
 
@@ -1312,22 +1415,27 @@ public:
 
         cmdbuf->bindComputePipeline(m_calcDivergencePipeline.get());
         cmdbuf->bindDescriptorSets(nbl::asset::EPBP_COMPUTE, m_calcDivergencePipeline->getLayout(), 1, 1, &m_calcDivergenceDs.get());
-        cmdbuf->dispatch(WorkgroupCountGrid.x, WorkgroupCountGrid.y, WorkgroupCountGrid.z);
+        dispatchGridPass(cmdbuf, m_calcDivergencePipeline.get());
 
-        cmdbuf->bindComputePipeline(m_iteratePressurePipeline.get());
-        cmdbuf->bindDescriptorSets(nbl::asset::EPBP_COMPUTE, m_iteratePressurePipeline->getLayout(), 1, 1, &m_iteratePressureDs.get());
-        for (int i = 0; i < pressureSolverIterations; i++)
+        if (m_pressureSolverMode == EPSM_MULTIGRID)
+            dispatchMultigridPressureSolve(cmdbuf);
+        else
         {
+            cmdbuf->bindComputePipeline(m_iteratePressurePipeline.get());
+            cmdbuf->bindDescriptorSets(nbl::asset::EPBP_COMPUTE, m_iteratePressurePipeline->getLayout(), 1, 1, &m_iteratePressureDs.get());
+            for (int i = 0; i < pressureSolverIterations; i++)
             {
-                SMemoryBarrier memBarrier;
-                memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
-                memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
-                memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
-                memBarrier.dstAccessMask = ACCESS_FLAGS::SHADER_READ_BITS;
-                cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
-            }
+                {
+                    SMemoryBarrier memBarrier;
+                    memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+                    memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
+                    memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+                    memBarrier.dstAccessMask = ACCESS_FLAGS::SHADER_READ_BITS;
+                    cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+                }
 
-            cmdbuf->dispatch(WorkgroupCountGrid.x, WorkgroupCountGrid.y, WorkgroupCountGrid.z);
+                dispatchGridPass(cmdbuf, m_iteratePressurePipeline.get());
+            }
         }
 
         {
@@ -1341,7 +1449,445 @@ public:
 
         cmdbuf->bindComputePipeline(m_updateVelPsPipeline.get());
         cmdbuf->bindDescriptorSets(nbl::asset::EPBP_COMPUTE, m_updateVelPsPipeline->getLayout(), 1, 1, &m_updateVelPsDs.get());
+        dispatchGridPass(cmdbuf, m_updateVelPsPipeline.get());
+    }
+
+    // Dense over the whole grid, or indirect over the active bricks when the brick map is in use
+    void dispatchGridPass(IGPUCommandBuffer* cmdbuf, const IGPUComputePipeline* pipeline)
+    {
+        SBrickDispatchPushConstants pc = {};
+        if (m_useBrickMap)
+            pc.activeBricksAddress = m_activeBricksBuffer->getDeviceAddress();
+        cmdbuf->pushConstants(pipeline->getLayout(), IShader::E_SHADER_STAGE::ESS_COMPUTE, 0, sizeof(pc), &pc);
+
+        if (m_useBrickMap)
+            cmdbuf->dispatchIndirect({ .offset = 0, .buffer = m_brickDispatchArgsBuffer });
+        else
+            cmdbuf->dispatch(WorkgroupCountGrid.x, WorkgroupCountGrid.y, WorkgroupCountGrid.z);
+    }
+
+    void dispatchUpdateBrickMap(IGPUCommandBuffer* cmdbuf)
+    {
+        {
+            SMemoryBarrier memBarrier;
+            // previous substep's indirect dispatches need to be done reading the arguments before we reset them
+            memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT | PIPELINE_STAGE_FLAGS::DISPATCH_INDIRECT_COMMAND_BIT;
+            memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
+            memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+            memBarrier.dstAccessMask = ACCESS_FLAGS::SHADER_READ_BITS | ACCESS_FLAGS::SHADER_WRITE_BITS;
+            cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+        }
+
+        const SBrickMapPushConstants pc = { .epoch = ++m_brickMapEpoch };
+
+        cmdbuf->bindComputePipeline(m_markActiveBricksPipeline.get());
+        cmdbuf->pushConstants(m_markActiveBricksPipeline->getLayout(), IShader::E_SHADER_STAGE::ESS_COMPUTE, 0, sizeof(pc), &pc);
+        cmdbuf->bindDescriptorSets(nbl::asset::EPBP_COMPUTE, m_markActiveBricksPipeline->getLayout(), 1, 1, &m_brickMapDs.get());
         cmdbuf->dispatch(WorkgroupCountGrid.x, WorkgroupCountGrid.y, WorkgroupCountGrid.z);
+
+        {
+            SMemoryBarrier memBarrier;
+            memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+            memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
+            memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+            memBarrier.dstAccessMask = ACCESS_FLAGS::SHADER_READ_BITS | ACCESS_FLAGS::SHADER_WRITE_BITS;
+            cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+        }
+
+        // the descriptor set layouts of both brick map pipelines are identical, hence compatible
+        cmdbuf->bindComputePipeline(m_compactActiveBricksPipeline.get());
+        cmdbuf->pushConstants(m_compactActiveBricksPipeline->getLayout(), IShader::E_SHADER_STAGE::ESS_COMPUTE, 0, sizeof(pc), &pc);
+        {
+            const auto compactWorkgroupCount = (WorkgroupCountGrid + uint32_t3(CompactWorkgroupDim - 1)) / CompactWorkgroupDim;
+            cmdbuf->dispatch(compactWorkgroupCount.x, compactWorkgroupCount.y, compactWorkgroupCount.z);
+        }
+
+        {
+            SMemoryBarrier memBarrier;
+            memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+            memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
+            memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT | PIPELINE_STAGE_FLAGS::DISPATCH_INDIRECT_COMMAND_BIT;
+            memBarrier.dstAccessMask = ACCESS_FLAGS::SHADER_READ_BITS | ACCESS_FLAGS::INDIRECT_COMMAND_READ_BIT;
+            cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+        }
+    }
+
+    template<typename CreateComputePipelineFunc>
+    bool initBrickMap(CreateComputePipelineFunc& createComputePipeline)
+    {
+        const size_t brickCount = size_t(WorkgroupCountGrid.x) * WorkgroupCountGrid.y * WorkgroupCountGrid.z;
+
+        video::IGPUBuffer::SCreationParams params = {};
+        params.size = brickCount * sizeof(uint32_t);
+        params.usage = IGPUBuffer::EUF_STORAGE_BUFFER_BIT | IGPUBuffer::EUF_TRANSFER_DST_BIT;
+        if (!createBuffer(m_brickOccupancyBuffer, params))
+            return false;
+        params.size = brickCount * sizeof(uint32_t);
+        params.usage = IGPUBuffer::EUF_STORAGE_BUFFER_BIT | IGPUBuffer::EUF_TRANSFER_DST_BIT;
+        if (!createBuffer(m_brickIndirectionBuffer, params))
+            return false;
+        params.size = brickCount * sizeof(uint32_t);
+        params.usage = IGPUBuffer::EUF_STORAGE_BUFFER_BIT | IGPUBuffer::EUF_SHADER_DEVICE_ADDRESS_BIT;
+        if (!createBuffer(m_activeBricksBuffer, params, IDeviceMemoryAllocation::EMAF_DEVICE_ADDRESS_BIT))
+            return false;
+        params.size = sizeof(SBrickDispatchArgs);
+        params.usage = IGPUBuffer::EUF_STORAGE_BUFFER_BIT | IGPUBuffer::EUF_INDIRECT_BUFFER_BIT | IGPUBuffer::EUF_TRANSFER_SRC_BIT;
+        if (!createBuffer(m_brickDispatchArgsBuffer, params))
+            return false;
+
+        // host visible copy of the dispatch arguments
+        {
+            video::IGPUBuffer::SCreationParams statsParams = {};
+            statsParams.size = sizeof(SBrickDispatchArgs);
+            statsParams.usage = IGPUBuffer::EUF_TRANSFER_DST_BIT;
+            m_brickStatsBuffer = m_device->createBuffer(std::move(statsParams));
+            if (!m_brickStatsBuffer)
+                return false;
+
+            auto reqs = m_brickStatsBuffer->getMemoryReqs();
+            reqs.memoryTypeBits &= m_physicalDevice->getHostVisibleMemoryTypeBits();
+            m_brickStatsAllocation = m_device->allocate(reqs, m_brickStatsBuffer.get());
+            if (!m_brickStatsAllocation.isValid())
+                return false;
+            if (!m_brickStatsAllocation.memory->map({ 0ull, m_brickStatsAllocation.memory->getAllocationSize() }, IDeviceMemoryAllocation::EMCAF_READ))
+                return false;
+        }
+
+        const asset::SPushConstantRange pcRange = { .stageFlags = IShader::E_SHADER_STAGE::ESS_COMPUTE, .offset = 0, .size = sizeof(SBrickMapPushConstants) };
+        const std::string shaderPath = "app_resources/compute/brickMap.comp.hlsl";
+        createComputePipeline(m_markActiveBricksPipeline, m_brickMapPool, m_brickMapDs, shaderPath, "markActiveBricks", bmBrickMap_bs1, pcRange);
+        {
+            smart_refctd_ptr<IDescriptorPool> unusedPool;
+            smart_refctd_ptr<IGPUDescriptorSet> unusedDs;
+            createComputePipeline(m_compactActiveBricksPipeline, unusedPool, unusedDs, shaderPath, "compactActiveBricks", bmBrickMap_bs1, pcRange);
+        }
+        if (!m_markActiveBricksPipeline || !m_compactActiveBricksPipeline)
+            return false;
+
+        {
+            IGPUDescriptorSet::SDescriptorInfo infos[7];
+            infos[0].desc = smart_refctd_ptr(gridDataBuffer);
+            infos[0].info.buffer = { .offset = 0, .size = gridDataBuffer->getSize() };
+            infos[1].desc = gridParticleCountImageView;
+            infos[1].info.image.imageLayout = IImage::LAYOUT::GENERAL;
+            infos[1].info.combinedImageSampler.sampler = nullptr;
+            infos[2].desc = pressureImageView;
+            infos[2].info.image.imageLayout = IImage::LAYOUT::GENERAL;
+            infos[2].info.combinedImageSampler.sampler = nullptr;
+            infos[3].desc = smart_refctd_ptr(m_brickOccupancyBuffer);
+            infos[3].info.buffer = { .offset = 0, .size = m_brickOccupancyBuffer->getSize() };
+            infos[4].desc = smart_refctd_ptr(m_brickIndirectionBuffer);
+            infos[4].info.buffer = { .offset = 0, .size = m_brickIndirectionBuffer->getSize() };
+            infos[5].desc = smart_refctd_ptr(m_activeBricksBuffer);
+            infos[5].info.buffer = { .offset = 0, .size = m_activeBricksBuffer->getSize() };
+            infos[6].desc = smart_refctd_ptr(m_brickDispatchArgsBuffer);
+            infos[6].info.buffer = { .offset = 0, .size = m_brickDispatchArgsBuffer->getSize() };
+            IGPUDescriptorSet::SWriteDescriptorSet writes[7] = {
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmGridData, .arrayElement = 0, .count = 1, .info = &infos[0]},
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmGridPCount, .arrayElement = 0, .count = 1, .info = &infos[1]},
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmPres, .arrayElement = 0, .count = 1, .info = &infos[2]},
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmOccupancy, .arrayElement = 0, .count = 1, .info = &infos[3]},
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmIndirection, .arrayElement = 0, .count = 1, .info = &infos[4]},
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmActiveBricks, .arrayElement = 0, .count = 1, .info = &infos[5]},
+                {.dstSet = m_brickMapDs.get(), .binding = b_bmDispatchArgs, .arrayElement = 0, .count = 1, .info = &infos[6]},
+            };
+            m_device->updateDescriptorSets(std::span(writes, 7), {});
+        }
+
+        return true;
+    }
+
+    // Logs how much of the grid is actually active, i.e. how many bricks the sparse passes get to skip, and the memory actually involved.
+    // The grid textures are still allocated densely, so next to their real allocation sizes we report how much of the pressure and divergence
+    // grids the sparse passes touch and what a pool of the peak active brick count (plus the indirection table) would need instead.
+    void reportBrickMapOccupancy()
+    {
+        const auto& memory = m_brickStatsAllocation.memory;
+        if (!memory->getMemoryPropertyFlags().hasFlags(IDeviceMemoryAllocation::EMPF_HOST_COHERENT_BIT))
+        {
+            const ILogicalDevice::MappedMemoryRange range(memory.get(), 0ull, memory->getAllocationSize());
+            m_device->invalidateMappedMemoryRanges(1, &range);
+        }
+        const uint32_t activeBricks = reinterpret_cast<const SBrickDispatchArgs*>(memory->getMappedPointer())->x;
+        const uint32_t totalBricks = WorkgroupCountGrid.x * WorkgroupCountGrid.y * WorkgroupCountGrid.z;
+
+        m_brickOccupancyHistory.activeBricksSum += activeBricks;
+        m_brickOccupancyHistory.activeBricksMax = core::max(m_brickOccupancyHistory.activeBricksMax, activeBricks);
+        if (++m_brickOccupancyHistory.frames < brickMapReportInterval)
+            return;
+
+        const double averageActive = double(m_brickOccupancyHistory.activeBricksSum) / m_brickOccupancyHistory.frames;
+        m_logger->log("Brick map: %f%% of %u bricks active on average (peak %u), the sparse passes skip the rest",
+            ILogger::ELL_PERFORMANCE, 100.0 * averageActive / totalBricks, totalBricks, m_brickOccupancyHistory.activeBricksMax
+        );
+
+        auto allocationSize = [](const IGPUImageView* view) -> size_t { return view->getCreationParameters().image->getMemoryReqs().size; };
+        const size_t pressureDivergenceBytes = allocationSize(pressureImageView.get()) + allocationSize(divergenceImageView.get());
+        const size_t brickMapBytes = m_brickOccupancyBuffer->getSize() + m_brickIndirectionBuffer->getSize() + m_activeBricksBuffer->getSize() + m_brickDispatchArgsBuffer->getSize();
+        // both grids are `EF_R32_SFLOAT`
+        const size_t brickBytes = size_t(BrickCellCount) * sizeof(float) * 2u;
+        const size_t pooledBytes = size_t(m_brickOccupancyHistory.activeBricksMax) * brickBytes + m_brickIndirectionBuffer->getSize();
+        constexpr double MB = 1024.0 * 1024.0;
+        m_logger->log("Grid memory: %f MB of grid textures allocated, %f MB of those pressure and divergence, %f MB of brick map buffers. "
+            "The sparse passes touch %f MB of pressure and divergence per substep on average, a brick pool sized for the peak would take %f MB",
+            ILogger::ELL_PERFORMANCE, double(m_gridTextureBytes) / MB, double(pressureDivergenceBytes) / MB, double(brickMapBytes) / MB,
+            averageActive * double(brickBytes) / MB, double(pooledBytes) / MB
+        );
+        m_brickOccupancyHistory = {};
+    }
+
+
+    void dispatchMultigridPressureSolve(IGPUCommandBuffer* cmdbuf)
+    {
+        auto computeBarrier = [cmdbuf]() -> void
+            {
+                SMemoryBarrier memBarrier;
+                memBarrier.srcStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+                memBarrier.srcAccessMask = ACCESS_FLAGS::SHADER_WRITE_BITS;
+                memBarrier.dstStageMask = PIPELINE_STAGE_FLAGS::COMPUTE_SHADER_BIT;
+                memBarrier.dstAccessMask = ACCESS_FLAGS::SHADER_READ_BITS;
+                cmdbuf->pipelineBarrier(E_DEPENDENCY_FLAGS::EDF_NONE, {.memBarriers = {&memBarrier, 1}});
+            };
+        // `fineLevel` selects the pair of levels, `extentLevel` the one we launch an invocation per cell of
+        auto dispatch = [&](IGPUComputePipeline* pipeline, const uint32_t fineLevel, const uint32_t extentLevel, const uint32_t colour = 0u) -> void
+            {
+                computeBarrier();
+                SPressureMultigridPushConstants pc = {};
+                const auto& fine = m_multigridLevels[fineLevel];
+                pc.fineExtent = fine.extent;
+                pc.fineMaterialAddress = fine.materialAddress;
+                pc.finePressureAddress = fine.pressureAddress;
+                pc.fineRhsAddress = fine.rhsAddress;
+                pc.fineCoeff = fine.coeff;
+                pc.colour = colour;
+                if (fineLevel + 1 < m_multigridLevels.size())
+                {
+                    const auto& coarse = m_multigridLevels[fineLevel + 1];
+                    pc.coarseExtent = coarse.extent;
+                    pc.coarseMaterialAddress = coarse.materialAddress;
+                    pc.coarsePressureAddress = coarse.pressureAddress;
+                    pc.coarseRhsAddress = coarse.rhsAddress;
+                }
+                const auto& extent = m_multigridLevels[extentLevel].extent;
+                cmdbuf->bindComputePipeline(pipeline);
+                cmdbuf->pushConstants(pipeline->getLayout(), IShader::E_SHADER_STAGE::ESS_COMPUTE, 0, sizeof(pc), &pc);
+                cmdbuf->dispatch(
+                    (extent.x + WorkgroupGridDim - 1) / WorkgroupGridDim,
+                    (extent.y + WorkgroupGridDim - 1) / WorkgroupGridDim,
+                    (extent.z + WorkgroupGridDim - 1) / WorkgroupGridDim
+                );
+            };
+        // reversing the colour order on the way up keeps the V-cycle symmetric
+        auto smooth = [&](const uint32_t level, const uint32_t sweeps, const bool reverse) -> void
+            {
+                for (uint32_t i = 0; i < sweeps; i++)
+                for (uint32_t c = 0; c < 2; c++)
+                    dispatch(m_multigridSmoothPipeline.get(), level, level, reverse ? 1 - c : c);
+            };
+
+        // the descriptor set layouts of all multigrid pipelines are identical, hence compatible
+        cmdbuf->bindDescriptorSets(nbl::asset::EPBP_COMPUTE, m_multigridGatherPipeline->getLayout(), 1, 1, &m_multigridDs.get());
+        dispatch(m_multigridGatherPipeline.get(), 0, 0);
+
+        const uint32_t coarsest = m_multigridLevels.size() - 1;
+        for (uint32_t cycle = 0; cycle < m_multigridCycles; cycle++)
+        {
+            for (uint32_t level = 0; level < coarsest; level++)
+            {
+                smooth(level, multigridPreSmoothingSweeps, false);
+                dispatch(m_multigridRestrictPipeline.get(), level, level + 1);
+            }
+            smooth(coarsest, multigridCoarsestSmoothingSweeps, false);
+            smooth(coarsest, multigridCoarsestSmoothingSweeps, true);
+            for (uint32_t level = coarsest; level-- > 0;)
+            {
+                dispatch(m_multigridProlongatePipeline.get(), level, level);
+                smooth(level, multigridPostSmoothingSweeps, true);
+            }
+        }
+
+        dispatch(m_multigridScatterPipeline.get(), 0, 0);
+    }
+
+    // Residual based stopping criterion, we can't branch on the GPU's residual within a submit so we adjust the V-cycle count for the next frame
+    void adaptMultigridCycleCount()
+    {
+        const auto& memory = m_multigridStatsAllocation.memory;
+        if (!memory->getMemoryPropertyFlags().hasFlags(IDeviceMemoryAllocation::EMPF_HOST_COHERENT_BIT))
+        {
+            const ILogicalDevice::MappedMemoryRange range(memory.get(), 0ull, memory->getAllocationSize());
+            m_device->invalidateMappedMemoryRanges(1, &range);
+        }
+        const auto* stats = reinterpret_cast<const SPressureMultigridStats*>(memory->getMappedPointer());
+        const float maxResidual = std::bit_cast<float>(stats->maxResidual);
+        const float maxRhs = std::bit_cast<float>(stats->maxRhs);
+
+        if (maxResidual > multigridRelativeTolerance * maxRhs)
+            m_multigridCycles = core::min(m_multigridCycles + 1, multigridMaxCycles);
+        // some hysteresis so we don't flip-flop every frame
+        else if (maxResidual < 0.25f * multigridRelativeTolerance * maxRhs)
+            m_multigridCycles = core::max(m_multigridCycles - 1, 1u);
+    }
+
+    template<typename CreateComputePipelineFunc>
+    bool initMultigridPressureSolver(CreateComputePipelineFunc& createComputePipeline)
+    {
+        // Level hierarchy, all of it lives in one buffer
+        size_t bufferSize = 0;
+        {
+            m_multigridLevels.clear();
+            int32_t4 extent = m_gridData.gridSize;
+            float coeff = m_gridData.gridInvCellSize * m_gridData.gridInvCellSize;
+            while (true)
+            {
+                auto& level = m_multigridLevels.emplace_back();
+                level.extent = extent;
+                level.coeff = coeff;
+                // temporarily store offsets, patched with the buffer's address after allocation
+                const size_t cellCount = size_t(extent.x) * extent.y * extent.z;
+                level.materialAddress = bufferSize;
+                level.pressureAddress = level.materialAddress + cellCount * sizeof(uint32_t);
+                level.rhsAddress = level.pressureAddress + cellCount * sizeof(float);
+                bufferSize = level.rhsAddress + cellCount * sizeof(float);
+
+                if (core::min(core::min(extent.x, extent.y), extent.z) < multigridMinCoarseExtent * 2)
+                    break;
+                extent = (extent + int32_t4(1, 1, 1, 0)) / 2;
+                // Galerkin coefficient for piecewise constant prolongation, same as `CPressureSolverReference`
+                coeff *= 0.5f;
+            }
+        }
+
+        video::IGPUBuffer::SCreationParams params = {};
+        params.size = bufferSize;
+        params.usage = IGPUBuffer::EUF_STORAGE_BUFFER_BIT | IGPUBuffer::EUF_SHADER_DEVICE_ADDRESS_BIT;
+        if (!createBuffer(m_multigridLevelsBuffer, params, IDeviceMemoryAllocation::EMAF_DEVICE_ADDRESS_BIT))
+            return false;
+        const uint64_t baseAddress = m_multigridLevelsBuffer->getDeviceAddress();
+        for (auto& level : m_multigridLevels)
+        {
+            level.materialAddress += baseAddress;
+            level.pressureAddress += baseAddress;
+            level.rhsAddress += baseAddress;
+        }
+
+        // small host visible buffer the residual gets reported in
+        {
+            video::IGPUBuffer::SCreationParams statsParams = {};
+            statsParams.size = sizeof(SPressureMultigridStats);
+            statsParams.usage = IGPUBuffer::EUF_STORAGE_BUFFER_BIT;
+            m_multigridStatsBuffer = m_device->createBuffer(std::move(statsParams));
+            if (!m_multigridStatsBuffer)
+                return false;
+
+            auto reqs = m_multigridStatsBuffer->getMemoryReqs();
+            reqs.memoryTypeBits &= m_physicalDevice->getHostVisibleMemoryTypeBits();
+            m_multigridStatsAllocation = m_device->allocate(reqs, m_multigridStatsBuffer.get());
+            if (!m_multigridStatsAllocation.isValid())
+                return false;
+            if (!m_multigridStatsAllocation.memory->map({ 0ull, m_multigridStatsAllocation.memory->getAllocationSize() }, IDeviceMemoryAllocation::EMCAF_READ))
+                return false;
+        }
+
+        const asset::SPushConstantRange pcRange = { .stageFlags = IShader::E_SHADER_STAGE::ESS_COMPUTE, .offset = 0, .size = sizeof(SPressureMultigridPushConstants) };
+        const std::string shaderPath = "app_resources/compute/pressureMultigrid.comp.hlsl";
+        createComputePipeline(m_multigridGatherPipeline, m_multigridPool, m_multigridDs, shaderPath, "gatherFinestLevel", pmgMultigrid_bs1, pcRange);
+        {
+            // only the gather and scatter touch descriptors, we keep a single set for all of the multigrid pipelines
+            smart_refctd_ptr<IDescriptorPool> unusedPool;
+            smart_refctd_ptr<IGPUDescriptorSet> unusedDs;
+            createComputePipeline(m_multigridSmoothPipeline, unusedPool, unusedDs, shaderPath, "smoothRedBlack", pmgMultigrid_bs1, pcRange);
+            createComputePipeline(m_multigridRestrictPipeline, unusedPool, unusedDs, shaderPath, "restrictResidual", pmgMultigrid_bs1, pcRange);
+            createComputePipeline(m_multigridProlongatePipeline, unusedPool, unusedDs, shaderPath, "prolongateCorrection", pmgMultigrid_bs1, pcRange);
+            createComputePipeline(m_multigridScatterPipeline, unusedPool, unusedDs, shaderPath, "scatterFinestLevel", pmgMultigrid_bs1, pcRange);
+        }
+        if (!m_multigridGatherPipeline || !m_multigridSmoothPipeline || !m_multigridRestrictPipeline || !m_multigridProlongatePipeline || !m_multigridScatterPipeline)
+            return false;
+
+        {
+            IGPUDescriptorSet::SDescriptorInfo infos[5];
+            infos[0].desc = smart_refctd_ptr(gridDataBuffer);
+            infos[0].info.buffer = { .offset = 0, .size = gridDataBuffer->getSize() };
+            infos[1].desc = gridCellMaterialImageView;
+            infos[1].info.image.imageLayout = IImage::LAYOUT::GENERAL;
+            infos[1].info.combinedImageSampler.sampler = nullptr;
+            infos[2].desc = divergenceImageView;
+            infos[2].info.image.imageLayout = IImage::LAYOUT::GENERAL;
+            infos[2].info.combinedImageSampler.sampler = nullptr;
+            infos[3].desc = pressureImageView;
+            infos[3].info.image.imageLayout = IImage::LAYOUT::GENERAL;
+            infos[3].info.combinedImageSampler.sampler = nullptr;
+            infos[4].desc = smart_refctd_ptr(m_multigridStatsBuffer);
+            infos[4].info.buffer = { .offset = 0, .size = m_multigridStatsBuffer->getSize() };
+            IGPUDescriptorSet::SWriteDescriptorSet writes[5] = {
+                {.dstSet = m_multigridDs.get(), .binding = b_pmgGridData, .arrayElement = 0, .count = 1, .info = &infos[0]},
+                {.dstSet = m_multigridDs.get(), .binding = b_pmgCM, .arrayElement = 0, .count = 1, .info = &infos[1]},
+                {.dstSet = m_multigridDs.get(), .binding = b_pmgDiv, .arrayElement = 0, .count = 1, .info = &infos[2]},
+                {.dstSet = m_multigridDs.get(), .binding = b_pmgPres, .arrayElement = 0, .count = 1, .info = &infos[3]},
+                {.dstSet = m_multigridDs.get(), .binding = b_pmgStats, .arrayElement = 0, .count = 1, .info = &infos[4]},
+            };
+            m_device->updateDescriptorSets(std::span(writes, 5), {});
+        }
+
+        m_logger->log("Multigrid pressure solver with %zu levels", ILogger::ELL_INFO, m_multigridLevels.size());
+        return true;
+    }
+
+    // Compares time-to-tolerance of all the solver modes on the CPU reference, on grids of the preset's and larger sizes
+    void runPressureSolverBenchmark()
+    {
+        struct SCase
+        {
+            CPressureSolverReference::extent_t extent;
+            // fraction of the domain height filled with fluid
+            float fillHeight;
+        };
+        const SCase cases[] = {
+            {{32, 32, 32}, 0.5f},
+            {{48, 24, 24}, 0.8f},
+            {{64, 64, 64}, 0.5f},
+            {{96, 96, 96}, 0.5f}
+        };
+
+        std::mt19937 rng(0x45u);
+        std::uniform_real_distribution<float> divergenceDist(-1.f, 1.f);
+        for (const auto& testCase : cases)
+        {
+            const auto& extent = testCase.extent;
+            const size_t cellCount = size_t(extent[0]) * extent[1] * extent[2];
+            core::vector<uint8_t> material(cellCount);
+            core::vector<float> divergence(cellCount);
+            for (int32_t z = 0; z < extent[2]; z++)
+            for (int32_t y = 0; y < extent[1]; y++)
+            for (int32_t x = 0; x < extent[0]; x++)
+            {
+                const size_t ix = x + size_t(extent[0]) * (y + size_t(extent[1]) * z);
+                material[ix] = y < int32_t(testCase.fillHeight * extent[1]) ? ECM_FLUID : ECM_AIR;
+                divergence[ix] = divergenceDist(rng);
+            }
+
+            for (uint8_t mode = 0; mode < EPSM_COUNT; mode++)
+            {
+                // the stopping criterion is relative, so the cell size doesn't matter
+                CPressureSolverReference solver(extent, 1.f, material, divergence);
+                CPressureSolverReference::SParams params = {};
+                params.mode = static_cast<E_PRESSURE_SOLVER_MODE>(mode);
+                params.relativeTolerance = multigridRelativeTolerance;
+                params.maxIterations = mode == EPSM_JACOBI ? 1000 : 100;
+                params.preSmoothingSweeps = multigridPreSmoothingSweeps;
+                params.postSmoothingSweeps = multigridPostSmoothingSweeps;
+                params.coarsestSmoothingSweeps = multigridCoarsestSmoothingSweeps;
+                params.minCoarseExtent = multigridMinCoarseExtent;
+
+                core::vector<float> pressure(cellCount, 0.f);
+                const auto result = solver.solve(params, pressure);
+                m_logger->log("Pressure solve %dx%dx%d %s (%u levels): %s after %u iterations in %f ms, residual %e -> %e",
+                    result.converged ? ILogger::ELL_PERFORMANCE : ILogger::ELL_WARNING,
+                    extent[0], extent[1], extent[2], pressureSolverModeName(params.mode), mode == EPSM_JACOBI ? 1u : solver.getLevelCount(),
+                    result.converged ? "converged" : "NOT converged", result.iterations, result.milliseconds, result.initialResidual, result.finalResidual
+                );
+            }
+        }
     }
             
     void dispatchAdvection(IGPUCommandBuffer* cmdbuf)
@@ -1417,8 +1963,8 @@ private:
         assert(assets.size() == 1);
         smart_refctd_ptr<ICPUShader> shaderSrc = IAsset::castDown<ICPUShader>(assets[0]);
 
-        smart_refctd_ptr<ICPUShader> shader = shaderSrc;
-        if (entryPoint != "main")
+        // every shader goes through the shared compile cache, not just the ones with a custom entry point, so warm starts skip DXC altogether
+        smart_refctd_ptr<ICPUShader> shader;
         {
             auto compiler = make_smart_refctd_ptr<asset::CHLSLCompiler>(smart_refctd_ptr(m_system));
             CHLSLCompiler::SOptions options = {};
@@ -1428,8 +1974,8 @@ private:
             options.targetSpirvVersion = m_device->getPhysicalDevice()->getLimits().spirvVersion;
             options.spirvOptimizer = nullptr;
         #ifndef _NBL_DEBUG
-            ISPIRVOptimizer::E_OPTIMIZER_PASS optPasses = ISPIRVOptimizer::EOP_STRIP_DEBUG_INFO;
-            auto opt = make_smart_refctd_ptr<ISPIRVOptimizer>(std::span<ISPIRVOptimizer::E_OPTIMIZER_PASS>(&optPasses, 1));
+            ISPIRVOptimizer::E_OPTIMIZER_PASS optPasses[] = { ISPIRVOptimizer::EOP_STRIP_DEBUG_INFO };
+            auto opt = make_smart_refctd_ptr<ISPIRVOptimizer>(std::span<ISPIRVOptimizer::E_OPTIMIZER_PASS>(optPasses));
             options.spirvOptimizer = opt.get();
         #endif
             options.debugInfoFlags |= IShaderCompiler::E_DEBUG_INFO_FLAGS::EDIF_SOURCE_BIT;
@@ -1440,7 +1986,13 @@ private:
             std::string dxcOptionStr[] = {"-E " + entryPoint};
             options.dxcOptions = std::span(dxcOptionStr);
 
-            shader = compiler->compileToSPIRV((const char*)shaderSrc->getContent()->getPointer(), options);
+            // the cache only sees whether there's an optimizer, so its actual passes go into the key (the Nabla and DXC build it keys on itself)
+            core::vector<std::string> cacheKey = { dxcOptionStr[0] };
+        #ifndef _NBL_DEBUG
+            for (const auto pass : optPasses)
+                cacheKey.push_back("optimizer pass " + std::to_string(static_cast<uint32_t>(pass)));
+        #endif
+            shader = m_shaderCache->compileToSPIRV(compiler.get(), (const char*)shaderSrc->getContent()->getPointer(), options, cacheKey);
         }
 
         return m_device->createShader(shader.get());
@@ -1483,6 +2035,7 @@ private:
         auto imageMemReqs = image->getMemoryReqs();
         imageMemReqs.memoryTypeBits &= m_physicalDevice->getDeviceLocalMemoryTypeBits();
         m_device->allocate(imageMemReqs, image.get());
+        m_gridTextureBytes += imageMemReqs.size;
 
         if (!debugName.empty())
             image->setObjectDebugName(debugName.c_str());
@@ -1779,6 +2332,15 @@ private:
     smart_refctd_ptr<IGPUComputePipeline> m_iteratePressurePipeline;
     smart_refctd_ptr<IGPUComputePipeline> m_updateVelPsPipeline;
 
+    smart_refctd_ptr<IGPUComputePipeline> m_multigridGatherPipeline;
+    smart_refctd_ptr<IGPUComputePipeline> m_multigridSmoothPipeline;
+    smart_refctd_ptr<IGPUComputePipeline> m_multigridRestrictPipeline;
+    smart_refctd_ptr<IGPUComputePipeline> m_multigridProlongatePipeline;
+    smart_refctd_ptr<IGPUComputePipeline> m_multigridScatterPipeline;
+
+    smart_refctd_ptr<IGPUComputePipeline> m_markActiveBricksPipeline;
+    smart_refctd_ptr<IGPUComputePipeline> m_compactActiveBricksPipeline;
+
     smart_refctd_ptr<IGPUComputePipeline> m_advectParticlesPipeline;
     smart_refctd_ptr<IGPUComputePipeline> m_genParticleVerticesPipeline;
 
@@ -1810,6 +2372,10 @@ private:
     smart_refctd_ptr<IGPUDescriptorSet> m_iteratePressureDs;
     smart_refctd_ptr<video::IDescriptorPool> m_updateVelPsPool;
     smart_refctd_ptr<IGPUDescriptorSet> m_updateVelPsDs;
+    smart_refctd_ptr<video::IDescriptorPool> m_multigridPool;
+    smart_refctd_ptr<IGPUDescriptorSet> m_multigridDs;
+    smart_refctd_ptr<video::IDescriptorPool> m_brickMapPool;
+    smart_refctd_ptr<IGPUDescriptorSet> m_brickMapDs;
     
     smart_refctd_ptr<video::IDescriptorPool> m_advectParticlesPool;
     smart_refctd_ptr<IGPUDescriptorSet> m_advectParticlesDs;
@@ -1840,6 +2406,41 @@ private:
     const uint32_t diffusionIterations = 5;
     const uint32_t pressureSolverIterations = 5;
 
+    E_PRESSURE_SOLVER_MODE m_pressureSolverMode = EPSM_JACOBI;
+    bool m_pressureBenchmarkOnly = false;
+    std::unique_ptr<nbl::examples::CShaderCompileCache> m_shaderCache;
+
+    // multigrid pressure solver
+    struct SMultigridLevel
+    {
+        int32_t4 extent;
+        uint64_t materialAddress;
+        uint64_t pressureAddress;
+        uint64_t rhsAddress;
+        float coeff;
+    };
+    core::vector<SMultigridLevel> m_multigridLevels;
+    uint32_t m_multigridCycles = 2;
+    const uint32_t multigridMaxCycles = 8;
+    const uint32_t multigridPreSmoothingSweeps = 2;
+    const uint32_t multigridPostSmoothingSweeps = 2;
+    const uint32_t multigridCoarsestSmoothingSweeps = 16;
+    const int32_t multigridMinCoarseExtent = 4;
+    const float multigridRelativeTolerance = 1e-3f;
+
+    // sparse brick map
+    bool m_useBrickMap = false;
+    uint32_t m_brickMapEpoch = 0;
+    // actual allocation sizes of everything made by `createGridTexture`
+    size_t m_gridTextureBytes = 0;
+    struct SBrickOccupancyHistory
+    {
+        uint64_t activeBricksSum = 0;
+        uint32_t activeBricksMax = 0;
+        uint32_t frames = 0;
+    } m_brickOccupancyHistory;
+    const uint32_t brickMapReportInterval = 120;
+
     // buffers
     smart_refctd_ptr<IGPUBuffer> cameraBuffer;
 
@@ -1856,6 +2457,15 @@ private:
 
     smart_refctd_ptr<IGPUBuffer> gridDataBuffer;		            // SGridData
     smart_refctd_ptr<IGPUBuffer> pressureParamsBuffer;	            // SPressureSolverParams
+    smart_refctd_ptr<IGPUBuffer> m_multigridLevelsBuffer;	        // uint material, float pressure, float rhs per level
+    smart_refctd_ptr<IGPUBuffer> m_multigridStatsBuffer;	        // SPressureMultigridStats
+    IDeviceMemoryAllocator::SAllocation m_multigridStatsAllocation = {};
+    smart_refctd_ptr<IGPUBuffer> m_brickOccupancyBuffer;	        // uint epoch per brick
+    smart_refctd_ptr<IGPUBuffer> m_brickIndirectionBuffer;	        // uint slot in the active list per brick
+    smart_refctd_ptr<IGPUBuffer> m_activeBricksBuffer;	            // packed brick indices
+    smart_refctd_ptr<IGPUBuffer> m_brickDispatchArgsBuffer;	        // SBrickDispatchArgs
+    smart_refctd_ptr<IGPUBuffer> m_brickStatsBuffer;
+    IDeviceMemoryAllocator::SAllocation m_brickStatsAllocation = {};
     smart_refctd_ptr<IGPUImageView> gridParticleCountImageView;	    // uint
     smart_refctd_ptr<IGPUImageView> gridCellMaterialImageView;	    // uint, fluid or solid
 
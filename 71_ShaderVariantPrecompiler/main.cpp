@@ -0,0 +1,301 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#include "nbl/application_templates/MonoAssetManagerAndBuiltinResourceApplication.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "nlohmann/json.hpp"
+#include "argparse/argparse.hpp"
+
+#include "ParallelFor.hpp"
+#include "CShaderVariantArchive.hpp"
+
+using json = nlohmann::json;
+
+using namespace nbl;
+using namespace core;
+using namespace system;
+using namespace asset;
+
+// Compiles every permutation of `#define`s declared in a manifest (see `variants.json`) for every shader listed in it, in parallel,
+// and packs the SPIR-V into a single `CShaderVariantArchive` which the examples look their variants up in instead of compiling at startup.
+class ShaderVariantPrecompilerApp final : public application_templates::MonoAssetManagerAndBuiltinResourceApplication
+{
+		using clock_t = std::chrono::steady_clock;
+		using base_t = application_templates::MonoAssetManagerAndBuiltinResourceApplication;
+
+	public:
+		using base_t::base_t;
+
+		inline bool onAppInitialized(smart_refctd_ptr<ISystem>&& system) override
+		{
+			argparse::ArgumentParser program("Shader Variant Precompiler");
+
+			program.add_argument<std::string>("--manifest")
+				.default_value((localInputCWD/"variants.json").string())
+				.help("Path to the JSON manifest declaring the shaders and their define permutations");
+
+			program.add_argument<std::string>("--output")
+				.default_value((sharedOutputCWD/"shader_variants.nsva").string())
+				.help("Path to the archive to write, the examples look for it in their shared output directory");
+
+			program.add_argument<std::string>("--spirv-version")
+				.default_value(std::string("1.6"))
+				.help("SPIR-V version to target, the examples won't use the archive on devices which don't support it");
+
+			program.add_argument<uint32_t>("--workers")
+				.default_value(0u)
+				.scan<'u',uint32_t>()
+				.help("Number of compiler threads, 0 means one per hardware thread");
+
+			try
+			{
+				program.parse_args({ argv.data(), argv.data() + argv.size() });
+			}
+			catch (const std::exception& err)
+			{
+				std::cerr << err.what() << std::endl << program; // NOTE: std::cerr because logger isn't initialized yet
+				return false;
+			}
+
+			if (!base_t::onAppInitialized(std::move(system)))
+				return false;
+
+			const std::filesystem::path manifestPath = program.get<std::string>("--manifest");
+			const std::filesystem::path outputPath = program.get<std::string>("--output");
+			uint32_t workerCount = program.get<uint32_t>("--workers");
+			if (workerCount==0u)
+				workerCount = nbl::examples::getDefaultWorkerCount();
+
+			IShaderCompiler::E_SPIRV_VERSION spirvVersion;
+			{
+				const auto str = program.get<std::string>("--spirv-version");
+				uint32_t major = 0u, minor = 0u;
+				if (sscanf(str.c_str(),"%u.%u",&major,&minor)!=2 || major!=1u || minor>6u)
+					return logFail("Unsupported SPIR-V version \"%s\", expected 1.0 to 1.6",str.c_str());
+				spirvVersion = static_cast<IShaderCompiler::E_SPIRV_VERSION>((major<<16u)|(minor<<8u));
+			}
+
+			if (!loadManifest(manifestPath))
+				return false;
+
+			// enumerate the whole permutation space up front so the workers only have to grab the next index
+			struct SJob
+			{
+				uint32_t shaderIx;
+				std::vector<nbl::examples::CShaderVariantArchive::SDefine> defines;
+			};
+			std::vector<SJob> jobs;
+			for (uint32_t shaderIx=0u; shaderIx<m_shaders.size(); shaderIx++)
+			{
+				const auto& shader = m_shaders[shaderIx];
+				size_t permutationCount = 1ull;
+				for (const auto& define : shader.defines)
+					permutationCount *= define.values.size();
+				for (size_t permutation=0ull; permutation<permutationCount; permutation++)
+				{
+					// mixed radix decomposition, last define varies fastest
+					auto& job = jobs.emplace_back();
+					job.shaderIx = shaderIx;
+					job.defines.resize(shader.defines.size());
+					size_t remainder = permutation;
+					for (auto i=shader.defines.size(); i--; )
+					{
+						const auto& values = shader.defines[i].values;
+						job.defines[i] = {shader.defines[i].name,values[remainder%values.size()]};
+						remainder /= values.size();
+					}
+				}
+			}
+			m_logger->log("Compiling %zu variants of %zu shaders on %u threads",ILogger::ELL_INFO,jobs.size(),m_shaders.size(),workerCount);
+
+			// compilers and include finders aren't shared between threads, and every shader gets its own search paths
+			std::vector<smart_refctd_ptr<CHLSLCompiler>> compilers(workerCount);
+			std::vector<smart_refctd_ptr<IShaderCompiler::CIncludeFinder>> includeFinders(workerCount*m_shaders.size());
+			for (uint32_t workerIx=0u; workerIx<workerCount; workerIx++)
+			{
+				compilers[workerIx] = make_smart_refctd_ptr<CHLSLCompiler>(smart_refctd_ptr(m_system));
+				for (uint32_t shaderIx=0u; shaderIx<m_shaders.size(); shaderIx++)
+				{
+					auto& finder = includeFinders[workerIx*m_shaders.size()+shaderIx];
+					finder = make_smart_refctd_ptr<IShaderCompiler::CIncludeFinder>(smart_refctd_ptr(m_system));
+					for (const auto& dir : m_shaders[shaderIx].includeDirectories)
+						finder->addSearchPath(dir.string(),finder->getDefaultFileSystemLoader());
+				}
+			}
+
+			std::vector<nbl::examples::CShaderVariantArchive::SVariant> variants(jobs.size());
+			std::vector<double> compileMilliseconds(jobs.size(),0.0);
+			std::atomic<uint32_t> failures = 0u;
+			const auto wallStart = clock_t::now();
+			nbl::examples::parallelFor(jobs.size(),[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+			{
+				for (size_t jobIx=begin; jobIx<end; jobIx++)
+				{
+					const auto& job = jobs[jobIx];
+					const auto& shader = m_shaders[job.shaderIx];
+					auto& variant = variants[jobIx];
+					variant.key = nbl::examples::CShaderVariantArchive::makeKey(shader.name,job.defines);
+					variant.stage = shader.stage;
+
+					std::vector<IShaderCompiler::SMacroDefinition> macros(job.defines.size());
+					for (size_t i=0; i<macros.size(); i++)
+						macros[i] = {job.defines[i].name,job.defines[i].value};
+
+					CHLSLCompiler::SOptions options = {};
+					options.stage = shader.stage;
+					options.targetSpirvVersion = spirvVersion;
+					options.preprocessorOptions.sourceIdentifier = shader.path.string();
+					options.preprocessorOptions.logger = m_logger.get();
+					options.preprocessorOptions.includeFinder = includeFinders[workerIx*m_shaders.size()+job.shaderIx].get();
+					options.preprocessorOptions.extraDefines = macros;
+
+					const auto start = clock_t::now();
+					const auto sourceHash = nbl::examples::CShaderVariantArchive::computeSourceHash(compilers[workerIx].get(),shader.source,options);
+					auto spirv = sourceHash ? compilers[workerIx]->compileToSPIRV(shader.source.c_str(),options):nullptr;
+					compileMilliseconds[jobIx] = std::chrono::duration<double,std::milli>(clock_t::now()-start).count();
+					if (!spirv)
+					{
+						failures++;
+						continue;
+					}
+					variant.sourceHash = *sourceHash;
+					const auto* content = spirv->getContent();
+					const auto* data = reinterpret_cast<const uint8_t*>(content->getPointer());
+					variant.spirv.assign(data,data+content->getSize());
+				}
+			},workerCount,1ull);
+			const double wallMilliseconds = std::chrono::duration<double,std::milli>(clock_t::now()-wallStart).count();
+
+			double totalCompileMilliseconds = 0.0;
+			for (size_t jobIx=0; jobIx<jobs.size(); jobIx++)
+			{
+				std::string description = m_shaders[jobs[jobIx].shaderIx].name;
+				for (const auto& define : jobs[jobIx].defines)
+					description += " "+std::string(define.name)+"="+std::string(define.value);
+				if (variants[jobIx].spirv.empty())
+					m_logger->log("%s failed to compile after %.3f ms",ILogger::ELL_ERROR,description.c_str(),compileMilliseconds[jobIx]);
+				else
+					m_logger->log("%s: %.3f ms, %zu bytes of SPIR-V",ILogger::ELL_PERFORMANCE,description.c_str(),compileMilliseconds[jobIx],variants[jobIx].spirv.size());
+				totalCompileMilliseconds += compileMilliseconds[jobIx];
+			}
+			if (failures)
+				return logFail("%u of %zu variants failed to compile, not writing the archive",failures.load(),jobs.size());
+
+			uint64_t archiveSize = 0ull;
+			if (!nbl::examples::CShaderVariantArchive::write(outputPath,spirvVersion,variants,&archiveSize))
+				return logFail("Failed to write the archive to \"%s\"",outputPath.string().c_str());
+
+			m_logger->log("Compiled %zu variants in %.3f ms wall time (%.3f ms of compilation, %.2fx speedup on %u threads)",ILogger::ELL_PERFORMANCE,
+				jobs.size(),wallMilliseconds,totalCompileMilliseconds,wallMilliseconds>0.0 ? totalCompileMilliseconds/wallMilliseconds:0.0,workerCount);
+			m_logger->log("Wrote %llu bytes to \"%s\"",ILogger::ELL_PERFORMANCE,archiveSize,outputPath.string().c_str());
+			return true;
+		}
+
+		inline bool keepRunning() override
+		{
+			return false;
+		}
+
+		inline void workLoopBody() override
+		{
+		}
+
+	private:
+		struct SShader
+		{
+			std::string name;
+			std::filesystem::path path;
+			std::string source;
+			IShader::E_SHADER_STAGE stage;
+			std::vector<std::filesystem::path> includeDirectories;
+			struct SDefine
+			{
+				std::string name;
+				std::vector<std::string> values;
+			};
+			std::vector<SDefine> defines;
+		};
+
+		// paths in the manifest are relative to the manifest itself
+		inline bool loadManifest(const std::filesystem::path& manifestPath)
+		{
+			std::ifstream file(manifestPath);
+			if (!file)
+				return logFail("Failed to open the manifest \"%s\"",manifestPath.string().c_str());
+			json manifest;
+			try
+			{
+				manifest = json::parse(file);
+			}
+			catch (const json::exception& e)
+			{
+				return logFail("Failed to parse the manifest \"%s\": %s",manifestPath.string().c_str(),e.what());
+			}
+			const auto baseDir = manifestPath.parent_path();
+
+			const std::pair<std::string_view,IShader::E_SHADER_STAGE> Stages[] = {
+				{"compute",IShader::E_SHADER_STAGE::ESS_COMPUTE},
+				{"vertex",IShader::E_SHADER_STAGE::ESS_VERTEX},
+				{"fragment",IShader::E_SHADER_STAGE::ESS_FRAGMENT},
+				{"mesh",IShader::E_SHADER_STAGE::ESS_MESH},
+				{"task",IShader::E_SHADER_STAGE::ESS_TASK}
+			};
+			try
+			{
+				for (const auto& entry : manifest.at("shaders"))
+				{
+					auto& shader = m_shaders.emplace_back();
+					shader.name = entry.at("name").get<std::string>();
+					shader.path = baseDir/entry.at("path").get<std::string>();
+					const auto stage = entry.at("stage").get<std::string>();
+					const auto found = std::find_if(std::begin(Stages),std::end(Stages),[&](const auto& pair)->bool{return pair.first==stage;});
+					if (found==std::end(Stages))
+						return logFail("Shader \"%s\" has unknown stage \"%s\"",shader.name.c_str(),stage.c_str());
+					shader.stage = found->second;
+					if (entry.contains("includeDirectories"))
+					for (const auto& dir : entry["includeDirectories"])
+						shader.includeDirectories.push_back(baseDir/dir.get<std::string>());
+
+					if (entry.contains("defines"))
+					for (const auto& defineEntry : entry["defines"])
+					{
+						auto& define = shader.defines.emplace_back();
+						define.name = defineEntry.at("name").get<std::string>();
+						if (defineEntry.contains("range"))
+						{
+							// [first,last,step] inclusive, for things like workgroup sizes
+							const auto range = defineEntry["range"].get<std::vector<int64_t>>();
+							if (range.size()!=3 || range[2]<=0 || range[1]<range[0])
+								return logFail("Define \"%s\" of shader \"%s\" has an invalid range",define.name.c_str(),shader.name.c_str());
+							for (auto value=range[0]; value<=range[1]; value+=range[2])
+								define.values.push_back(std::to_string(value));
+						}
+						else for (const auto& value : defineEntry.at("values"))
+							define.values.push_back(value.is_string() ? value.get<std::string>():value.dump());
+						if (define.values.empty())
+							return logFail("Define \"%s\" of shader \"%s\" has no values",define.name.c_str(),shader.name.c_str());
+					}
+
+					std::ifstream sourceFile(shader.path);
+					if (!sourceFile)
+						return logFail("Failed to open \"%s\"",shader.path.string().c_str());
+					std::stringstream ss;
+					ss << sourceFile.rdbuf();
+					shader.source = ss.str();
+				}
+			}
+			catch (const json::exception& e)
+			{
+				return logFail("Malformed manifest \"%s\": %s",manifestPath.string().c_str(),e.what());
+			}
+			return true;
+		}
+
+		std::vector<SShader> m_shaders;
+};
+
+NBL_MAIN_FUNC(ShaderVariantPrecompilerApp)
@@ -0,0 +1,75 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_ATOMIC_FILE_WRITE_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_ATOMIC_FILE_WRITE_HPP_INCLUDED_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace nbl::examples
+{
+
+// Sibling of `path` whose name no other thread of this or any other process will pick: a random seed drawn once per process
+// (`random_device` may be deterministic on some platforms, so the startup time is mixed in), the thread and a per process counter
+inline std::filesystem::path getUniqueTemporaryPath(const std::filesystem::path& path)
+{
+	static const uint64_t processSeed = (uint64_t(std::random_device{}())<<32)^uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	static std::atomic<uint64_t> counter = 0ull;
+
+	auto tmpPath = path;
+	tmpPath += "."+std::to_string(processSeed)+"_"+std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()))+"_"+std::to_string(counter.fetch_add(1ull))+".tmp";
+	return tmpPath;
+}
+
+// Streams a file into a unique temporary next to `path` and renames it over, so neither a crash nor concurrent writers of the same file
+// (threads or processes) ever leave a truncated file under the real name, the last rename wins. The parent directory gets created if missing.
+// `writer(std::ofstream&)` may return `false` to give up, the temporary is removed whenever the file doesn't end up in place.
+template<typename Writer>
+inline bool writeFileAtomically(const std::filesystem::path& path, Writer&& writer)
+{
+	std::error_code ec;
+	if (path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path(),ec);
+
+	const auto tmpPath = getUniqueTemporaryPath(path);
+	{
+		std::ofstream file(tmpPath,std::ios::binary|std::ios::trunc);
+		if (!file)
+			return false;
+		bool written;
+		if constexpr (std::is_same_v<std::invoke_result_t<Writer,std::ofstream&>,void>)
+		{
+			writer(file);
+			written = true;
+		}
+		else
+			written = writer(file);
+		file.close();
+		if (!written || !file)
+		{
+			std::filesystem::remove(tmpPath,ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath,path,ec);
+	if (!ec)
+		return true;
+	// i.e. another process has the file mapped on Windows, its copy is just as good
+	std::filesystem::remove(tmpPath,ec);
+	return false;
+}
+
+}
+
+#endif
@@ -0,0 +1,728 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_CPU_BVH_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_CPU_BVH_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "ParallelFor.hpp"
+
+namespace nbl::examples::bvh
+{
+
+using vec3_t = std::array<float,3>;
+
+inline vec3_t operator-(const vec3_t& a, const vec3_t& b) {return {a[0]-b[0],a[1]-b[1],a[2]-b[2]};}
+inline float dot(const vec3_t& a, const vec3_t& b) {return a[0]*b[0]+a[1]*b[1]+a[2]*b[2];}
+inline vec3_t cross(const vec3_t& a, const vec3_t& b) {return {a[1]*b[2]-a[2]*b[1],a[2]*b[0]-a[0]*b[2],a[0]*b[1]-a[1]*b[0]};}
+
+struct SAABB
+{
+	inline void extend(const vec3_t& p)
+	{
+		for (auto i=0; i<3; i++)
+		{
+			minVx[i] = std::min(minVx[i],p[i]);
+			maxVx[i] = std::max(maxVx[i],p[i]);
+		}
+	}
+	inline void extend(const SAABB& other)
+	{
+		for (auto i=0; i<3; i++)
+		{
+			minVx[i] = std::min(minVx[i],other.minVx[i]);
+			maxVx[i] = std::max(maxVx[i],other.maxVx[i]);
+		}
+	}
+	inline bool valid() const {return minVx[0]<=maxVx[0] && minVx[1]<=maxVx[1] && minVx[2]<=maxVx[2];}
+	// half the surface area is all SAH needs, the factor of 2 cancels out
+	inline float halfArea() const
+	{
+		if (!valid())
+			return 0.f;
+		const vec3_t e = maxVx-minVx;
+		return e[0]*e[1]+e[1]*e[2]+e[2]*e[0];
+	}
+
+	vec3_t minVx = {std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max()};
+	vec3_t maxVx = {-std::numeric_limits<float>::max(),-std::numeric_limits<float>::max(),-std::numeric_limits<float>::max()};
+};
+
+// what the builder consumes, a plain triangle soup (index buffers need to be resolved beforehand)
+struct STriangle
+{
+	vec3_t vertices[3];
+};
+
+// 32 bytes and laid out depth first, so the first child of an inner node is always the next node and only the second one needs storing
+struct SNode
+{
+	inline bool isLeaf() const {return primCount!=0u;}
+
+	float aabbMin[3];
+	uint32_t secondChildOrFirstPrim;
+	float aabbMax[3];
+	uint32_t primCount : 30; // 0 for inner nodes
+	uint32_t splitAxis : 2;
+};
+static_assert(sizeof(SNode)==32);
+
+// Triangle with the precomputation Moller-Trumbore wants, stored in leaf order so leaves index them directly
+struct SPackedTriangle
+{
+	float v0[3];
+	uint32_t primID; // index into the triangle soup that got built
+	float edge1[3];
+	float pad0;
+	float edge2[3];
+	float pad1;
+};
+static_assert(sizeof(SPackedTriangle)==48);
+
+struct SRay
+{
+	vec3_t origin;
+	float tMin = 0.f;
+	vec3_t direction;
+	float tMax = std::numeric_limits<float>::max();
+};
+
+struct SHit
+{
+	inline bool valid() const {return primID!=InvalidPrimID;}
+
+	constexpr static inline uint32_t InvalidPrimID = ~0u;
+
+	float t = std::numeric_limits<float>::max();
+	float u = 0.f, v = 0.f;
+	uint32_t primID = InvalidPrimID;
+};
+
+struct SCostModel
+{
+	float traversal = 1.f;
+	float intersection = 1.f;
+};
+
+// Non-owning, so it can sit on top of a memory mapped file just as well as on top of a `CBinnedSAHBVH`
+class CBVHView
+{
+	public:
+		// deepest tree `intersect`'s fixed size stack can traverse, the builder never goes deeper and `deserialize` rejects anything that does
+		constexpr static inline uint32_t MaxDepth = 64u;
+
+		CBVHView() = default;
+		CBVHView(std::span<const SNode> _nodes, std::span<const SPackedTriangle> _triangles) : nodes(_nodes), triangles(_triangles) {}
+
+		inline bool empty() const {return nodes.empty();}
+
+		inline SHit intersect(const SRay& ray) const
+		{
+			SHit hit = {};
+			hit.t = ray.tMax;
+			if (empty())
+				return hit;
+
+			vec3_t invDir;
+			for (auto i=0; i<3; i++)
+				invDir[i] = 1.f/ray.direction[i]; // infinities are fine for the slab test
+
+			struct SStackEntry
+			{
+				uint32_t node;
+				float tEntry;
+			};
+			// a node at depth `d` has at most `d` far children pending
+			SStackEntry stack[MaxDepth-1u];
+			uint32_t stackSize = 0u;
+
+			float tEntry;
+			if (!intersectAABB(nodes[0],ray,invDir,hit.t,tEntry))
+				return hit;
+			uint32_t nodeIx = 0u;
+			while (true)
+			{
+				const SNode& node = nodes[nodeIx];
+				if (node.isLeaf())
+				{
+					const uint32_t end = node.secondChildOrFirstPrim+node.primCount;
+					for (uint32_t i=node.secondChildOrFirstPrim; i<end; i++)
+						intersectTriangle(triangles[i],ray,hit);
+				}
+				else
+				{
+					uint32_t near = nodeIx+1u, far = node.secondChildOrFirstPrim;
+					float tNear, tFar;
+					const bool hitNear = intersectAABB(nodes[near],ray,invDir,hit.t,tNear);
+					const bool hitFar = intersectAABB(nodes[far],ray,invDir,hit.t,tFar);
+					if (hitNear && hitFar)
+					{
+						if (tFar<tNear)
+						{
+							std::swap(near,far);
+							std::swap(tNear,tFar);
+						}
+						assert(stackSize<MaxDepth-1u);
+						stack[stackSize++] = {far,tFar};
+						nodeIx = near;
+						continue;
+					}
+					else if (hitNear || hitFar)
+					{
+						nodeIx = hitNear ? near:far;
+						continue;
+					}
+				}
+				// pop, skipping anything a closer hit has occluded since it got pushed
+				bool found = false;
+				while (stackSize)
+				{
+					const SStackEntry entry = stack[--stackSize];
+					if (entry.tEntry<=hit.t)
+					{
+						nodeIx = entry.node;
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+					break;
+			}
+			return hit;
+		}
+
+		// expected cost of a random ray hitting the root, relative to the root's surface area
+		inline float computeSAHCost(const SCostModel& costModel={}) const
+		{
+			if (empty())
+				return 0.f;
+			const float rootArea = nodeHalfArea(nodes[0]);
+			if (rootArea<=0.f)
+				return 0.f;
+			double cost = 0.0;
+			for (const auto& node : nodes)
+				cost += double(nodeHalfArea(node))*(node.isLeaf() ? costModel.intersection*float(node.primCount):costModel.traversal);
+			return float(cost/rootArea);
+		}
+
+		inline uint32_t computeDepth() const
+		{
+			if (empty())
+				return 0u;
+			return computeDepth_impl(0u);
+		}
+
+		std::span<const SNode> nodes;
+		std::span<const SPackedTriangle> triangles;
+
+	private:
+		static inline float nodeHalfArea(const SNode& node)
+		{
+			SAABB aabb;
+			std::copy_n(node.aabbMin,3,aabb.minVx.begin());
+			std::copy_n(node.aabbMax,3,aabb.maxVx.begin());
+			return aabb.halfArea();
+		}
+
+		inline uint32_t computeDepth_impl(const uint32_t nodeIx) const
+		{
+			const SNode& node = nodes[nodeIx];
+			if (node.isLeaf())
+				return 1u;
+			return 1u+std::max(computeDepth_impl(nodeIx+1u),computeDepth_impl(node.secondChildOrFirstPrim));
+		}
+
+		static inline bool intersectAABB(const SNode& node, const SRay& ray, const vec3_t& invDir, const float tMax, float& tEntry)
+		{
+			float tmin = ray.tMin, tmax = tMax;
+			for (auto i=0; i<3; i++)
+			{
+				float t0 = (node.aabbMin[i]-ray.origin[i])*invDir[i];
+				float t1 = (node.aabbMax[i]-ray.origin[i])*invDir[i];
+				if (t0>t1)
+					std::swap(t0,t1);
+				// written so that NaNs (0*inf) don't shrink the interval
+				tmin = t0>tmin ? t0:tmin;
+				tmax = t1<tmax ? t1:tmax;
+			}
+			tEntry = tmin;
+			return tmin<=tmax;
+		}
+
+		static inline void intersectTriangle(const SPackedTriangle& tri, const SRay& ray, SHit& hit)
+		{
+			const vec3_t e1 = {tri.edge1[0],tri.edge1[1],tri.edge1[2]};
+			const vec3_t e2 = {tri.edge2[0],tri.edge2[1],tri.edge2[2]};
+			const vec3_t pvec = cross(ray.direction,e2);
+			const float det = dot(e1,pvec);
+			// no backface culling, same as `TRIANGLE_FACING_CULL_DISABLE_BIT` on the instances
+			if (std::abs(det)<std::numeric_limits<float>::min())
+				return;
+			const float rcpDet = 1.f/det;
+			const vec3_t tvec = ray.origin-vec3_t{tri.v0[0],tri.v0[1],tri.v0[2]};
+			const float u = dot(tvec,pvec)*rcpDet;
+			if (u<0.f || u>1.f)
+				return;
+			const vec3_t qvec = cross(tvec,e1);
+			const float v = dot(ray.direction,qvec)*rcpDet;
+			if (v<0.f || u+v>1.f)
+				return;
+			const float t = dot(e2,qvec)*rcpDet;
+			if (t<ray.tMin || t>=hit.t)
+				return;
+			hit.t = t;
+			hit.u = u;
+			hit.v = v;
+			hit.primID = tri.primID;
+		}
+};
+
+// Builds with binned SAH over primitive centroids. Big nodes get binned in parallel and big subtrees get built on their own threads,
+// the result is flattened depth first into `SNode`s afterwards so the layout doesn't depend on how the threads got scheduled.
+class CBinnedSAHBVH
+{
+	public:
+		struct SBuildParams
+		{
+			SCostModel costModel = {};
+			uint32_t binCount = 16u;
+			// SAH may choose leaves up to this size, anything bigger always gets split
+			uint32_t maxLeafSize = 4u;
+			uint32_t workerCount = 0u;
+			// nodes with at least this many primitives get binned with `parallelFor`
+			uint32_t parallelBinningThreshold = 0x1u<<16;
+			// subtrees with at least this many primitives get spawned as a task
+			uint32_t parallelSubtreeThreshold = 0x1u<<12;
+		};
+
+		// default argument of a nested type with member initializers won't compile, hence the overload
+		static inline CBinnedSAHBVH build(std::span<const STriangle> triangles) {return build(triangles,SBuildParams{});}
+		static inline CBinnedSAHBVH build(std::span<const STriangle> triangles, const SBuildParams& params)
+		{
+			CBinnedSAHBVH retval;
+			if (triangles.empty())
+				return retval;
+
+			CBuilder builder(params,triangles);
+			auto root = builder.build();
+
+			retval.m_nodes.reserve(builder.nodeCount.load());
+			retval.flatten(*root);
+			retval.m_triangles.resize(triangles.size());
+			parallelFor(triangles.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t i=begin; i<end; i++)
+					{
+						const uint32_t primID = builder.refs[i].primID;
+						const STriangle& tri = triangles[primID];
+						auto& packed = retval.m_triangles[i];
+						const vec3_t e1 = tri.vertices[1]-tri.vertices[0];
+						const vec3_t e2 = tri.vertices[2]-tri.vertices[0];
+						std::copy_n(tri.vertices[0].begin(),3,packed.v0);
+						std::copy_n(e1.begin(),3,packed.edge1);
+						std::copy_n(e2.begin(),3,packed.edge2);
+						packed.primID = primID;
+						packed.pad0 = packed.pad1 = 0.f;
+					}
+				},
+				params.workerCount
+			);
+			return retval;
+		}
+
+		inline CBVHView getView() const {return CBVHView(m_nodes,m_triangles);}
+
+		inline const std::vector<SNode>& getNodes() const {return m_nodes;}
+		inline const std::vector<SPackedTriangle>& getTriangles() const {return m_triangles;}
+
+		//! Serialization, the blob is position independent so it can be memory mapped and used in place through `deserialize`.
+		// `sourceHash` is for the caller to tell whether a cached build still matches its input, see `hashTriangles`.
+		inline std::vector<uint8_t> serialize(const uint64_t sourceHash) const
+		{
+			SFileHeader header = {};
+			header.nodeCount = static_cast<uint32_t>(m_nodes.size());
+			header.triangleCount = static_cast<uint32_t>(m_triangles.size());
+			header.sourceHash = sourceHash;
+			header.sahCost = getView().computeSAHCost();
+
+			std::vector<uint8_t> retval(sizeof(SFileHeader)+sizeof(SNode)*m_nodes.size()+sizeof(SPackedTriangle)*m_triangles.size());
+			uint8_t* out = retval.data();
+			std::memcpy(out,&header,sizeof(header));
+			out += sizeof(header);
+			std::memcpy(out,m_nodes.data(),sizeof(SNode)*m_nodes.size());
+			out += sizeof(SNode)*m_nodes.size();
+			std::memcpy(out,m_triangles.data(),sizeof(SPackedTriangle)*m_triangles.size());
+			return retval;
+		}
+
+		struct SDeserialized
+		{
+			CBVHView view;
+			uint64_t sourceHash;
+			float sahCost;
+		};
+		// `data` needs to outlive the view and be at least 16 byte aligned (mapped files are page aligned)
+		static inline std::optional<SDeserialized> deserialize(const void* data, const size_t size)
+		{
+			if (!data || size<sizeof(SFileHeader) || (reinterpret_cast<uintptr_t>(data)&0xfu))
+				return std::nullopt;
+			SFileHeader header;
+			std::memcpy(&header,data,sizeof(header));
+			if (header.magic!=SFileHeader::Magic || header.version!=SFileHeader::Version)
+				return std::nullopt;
+			const size_t nodeBytes = sizeof(SNode)*header.nodeCount;
+			const size_t triangleBytes = sizeof(SPackedTriangle)*header.triangleCount;
+			if (size<sizeof(SFileHeader)+nodeBytes+triangleBytes)
+				return std::nullopt;
+
+			const auto* bytes = reinterpret_cast<const uint8_t*>(data)+sizeof(SFileHeader);
+			const auto* nodes = reinterpret_cast<const SNode*>(bytes);
+			const auto* triangles = reinterpret_cast<const SPackedTriangle*>(bytes+nodeBytes);
+			if (!validateTree({nodes,header.nodeCount},header.triangleCount))
+				return std::nullopt;
+			return SDeserialized{
+				.view = CBVHView({nodes,header.nodeCount},{triangles,header.triangleCount}),
+				.sourceHash = header.sourceHash,
+				.sahCost = header.sahCost
+			};
+		}
+
+		// FNV-1a over the vertex positions, enough to tell if a cached build is stale
+		static inline uint64_t hashTriangles(std::span<const STriangle> triangles)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			const auto* bytes = reinterpret_cast<const uint8_t*>(triangles.data());
+			for (size_t i=0; i<triangles.size_bytes(); i++)
+			{
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ull;
+			}
+			return hash;
+		}
+
+	private:
+		// Traversal indexes with whatever the nodes say, so a file must hold exactly what `flatten` produces: a tree laid out depth first
+		// (the preorder walk visits the nodes in storage order, each once), no deeper than `CBVHView::MaxDepth`, leaves inside the triangle array.
+		static inline bool validateTree(std::span<const SNode> nodes, const uint32_t triangleCount)
+		{
+			if (nodes.empty())
+				return triangleCount==0u;
+			struct SPending
+			{
+				uint32_t node;
+				uint32_t depth;
+			};
+			std::vector<SPending> stack = {{0u,1u}};
+			uint32_t next = 0u;
+			while (!stack.empty())
+			{
+				const auto [nodeIx,depth] = stack.back();
+				stack.pop_back();
+				if (nodeIx!=next++ || depth>CBVHView::MaxDepth)
+					return false;
+				const SNode& node = nodes[nodeIx];
+				if (node.isLeaf())
+				{
+					if (uint64_t(node.secondChildOrFirstPrim)+node.primCount>triangleCount)
+						return false;
+					continue;
+				}
+				if (node.secondChildOrFirstPrim<=nodeIx+1u || node.secondChildOrFirstPrim>=nodes.size())
+					return false;
+				stack.push_back({node.secondChildOrFirstPrim,depth+1u});
+				stack.push_back({nodeIx+1u,depth+1u});
+			}
+			return next==nodes.size();
+		}
+
+		struct SFileHeader
+		{
+			constexpr static inline uint32_t Magic = 0x4856424Eu; // "NBVH"
+			constexpr static inline uint32_t Version = 1u;
+
+			uint32_t magic = Magic;
+			uint32_t version = Version;
+			uint32_t nodeCount;
+			uint32_t triangleCount;
+			uint64_t sourceHash;
+			float sahCost;
+			uint32_t pad = 0u;
+		};
+		static_assert(sizeof(SFileHeader)%16==0);
+
+		struct STmpNode
+		{
+			SAABB aabb;
+			uint32_t begin, count;
+			uint32_t splitAxis = 0u;
+			std::unique_ptr<STmpNode> children[2];
+		};
+
+		struct SRef
+		{
+			SAABB aabb;
+			vec3_t centroid;
+			uint32_t primID;
+		};
+
+		struct CBuilder
+		{
+			struct SBin
+			{
+				SAABB aabb;
+				uint32_t count = 0u;
+			};
+
+			CBuilder(const SBuildParams& _params, std::span<const STriangle> triangles) : params(_params), refs(triangles.size())
+			{
+				if (params.workerCount==0u)
+					params.workerCount = getDefaultWorkerCount();
+				params.binCount = std::max(params.binCount,2u);
+				params.maxLeafSize = std::max(params.maxLeafSize,1u);
+				parallelFor(triangles.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+					{
+						for (size_t i=begin; i<end; i++)
+						{
+							SRef& ref = refs[i];
+							ref = {};
+							for (const auto& v : triangles[i].vertices)
+								ref.aabb.extend(v);
+							for (auto a=0; a<3; a++)
+								ref.centroid[a] = (ref.aabb.minVx[a]+ref.aabb.maxVx[a])*0.5f;
+							ref.primID = static_cast<uint32_t>(i);
+						}
+					},
+					params.workerCount
+				);
+			}
+
+			inline std::unique_ptr<STmpNode> build()
+			{
+				auto root = std::make_unique<STmpNode>();
+				root->begin = 0u;
+				root->count = static_cast<uint32_t>(refs.size());
+				nodeCount = 1u;
+				activeTasks = 1u;
+				buildRecursive(*root,1u);
+				return root;
+			}
+
+			// `depth` counts the nodes from the root to this one inclusive
+			inline void buildRecursive(STmpNode& node, const uint32_t depth)
+			{
+				// bounds of the primitives and of their centroids
+				SAABB centroidAABB;
+				{
+					auto accumulate = [&](const uint32_t begin, const uint32_t end, SAABB& aabb, SAABB& centroids) -> void
+					{
+						for (uint32_t i=begin; i<end; i++)
+						{
+							aabb.extend(refs[i].aabb);
+							centroids.extend(refs[i].centroid);
+						}
+					};
+					if (node.count>=params.parallelBinningThreshold)
+					{
+						std::vector<std::pair<SAABB,SAABB>> partial(params.workerCount);
+						parallelFor(node.count,[&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+							{
+								accumulate(node.begin+begin,node.begin+end,partial[workerIx].first,partial[workerIx].second);
+							},
+							params.workerCount
+						);
+						for (const auto& [aabb,centroids] : partial)
+						{
+							node.aabb.extend(aabb);
+							centroidAABB.extend(centroids);
+						}
+					}
+					else
+						accumulate(node.begin,node.begin+node.count,node.aabb,centroidAABB);
+				}
+
+				// degenerate input (i.e. lots of coincident or nested triangles) can make SAH peel off a few primitives at a time,
+				// past the depth traversal can handle the node has to become a leaf however big it is
+				if (node.count<=1u || depth>=CBVHView::MaxDepth)
+					return;
+
+				// find the best binned split over all axes
+				const float leafCost = params.costModel.intersection*float(node.count);
+				const float rcpParentArea = 1.f/std::max(node.aabb.halfArea(),std::numeric_limits<float>::min());
+				float bestCost = std::numeric_limits<float>::max();
+				uint32_t bestAxis = 0u, bestSplit = 0u;
+				std::vector<SBin> bins(params.binCount);
+				std::vector<float> rightCosts(params.binCount);
+				for (uint32_t axis=0u; axis<3u; axis++)
+				{
+					const float extent = centroidAABB.maxVx[axis]-centroidAABB.minVx[axis];
+					if (extent<=0.f)
+						continue;
+					binAxis(node,axis,centroidAABB.minVx[axis],float(params.binCount)/extent,bins);
+
+					// sweep from the right storing the cost contribution, then from the left evaluating every split plane
+					SAABB rightAABB;
+					uint32_t rightCount = 0u;
+					for (uint32_t b=params.binCount-1u; b>0u; b--)
+					{
+						rightAABB.extend(bins[b].aabb);
+						rightCount += bins[b].count;
+						rightCosts[b] = rightAABB.halfArea()*float(rightCount);
+					}
+					SAABB leftAABB;
+					uint32_t leftCount = 0u;
+					for (uint32_t split=1u; split<params.binCount; split++)
+					{
+						leftAABB.extend(bins[split-1u].aabb);
+						leftCount += bins[split-1u].count;
+						if (leftCount==0u || leftCount==node.count)
+							continue;
+						const float cost = params.costModel.traversal+params.costModel.intersection*(leftAABB.halfArea()*float(leftCount)+rightCosts[split])*rcpParentArea;
+						if (cost<bestCost)
+						{
+							bestCost = cost;
+							bestAxis = axis;
+							bestSplit = split;
+						}
+					}
+				}
+
+				uint32_t leftCount;
+				if (bestSplit!=0u)
+				{
+					if (bestCost>=leafCost && node.count<=params.maxLeafSize)
+						return;
+					const float scale = float(params.binCount)/(centroidAABB.maxVx[bestAxis]-centroidAABB.minVx[bestAxis]);
+					const float offset = centroidAABB.minVx[bestAxis];
+					auto* const mid = std::partition(refs.data()+node.begin,refs.data()+node.begin+node.count,[&](const SRef& ref)->bool
+						{
+							return getBin(ref.centroid[bestAxis],offset,scale)<bestSplit;
+						}
+					);
+					leftCount = static_cast<uint32_t>(mid-(refs.data()+node.begin));
+				}
+				else // all centroids coincide, SAH can't help
+				{
+					if (node.count<=params.maxLeafSize)
+						return;
+					leftCount = node.count/2u;
+				}
+
+				node.splitAxis = bestAxis;
+				for (auto c=0; c<2; c++)
+				{
+					node.children[c] = std::make_unique<STmpNode>();
+					node.children[c]->begin = c ? (node.begin+leftCount):node.begin;
+					node.children[c]->count = c ? (node.count-leftCount):leftCount;
+				}
+				nodeCount += 2u;
+
+				// the left subtree goes to another thread if it's big and there's a free worker
+				std::future<void> leftTask;
+				if (leftCount>=params.parallelSubtreeThreshold && activeTasks.fetch_add(1u)<params.workerCount)
+					leftTask = std::async(std::launch::async,[this,&node,depth]() -> void
+						{
+							buildRecursive(*node.children[0],depth+1u);
+							activeTasks--;
+						}
+					);
+				else
+				{
+					if (leftCount>=params.parallelSubtreeThreshold)
+						activeTasks--;
+					buildRecursive(*node.children[0],depth+1u);
+				}
+				buildRecursive(*node.children[1],depth+1u);
+				if (leftTask.valid())
+					leftTask.get();
+			}
+
+			inline uint32_t getBin(const float centroid, const float offset, const float scale) const
+			{
+				return std::min(static_cast<uint32_t>(std::max((centroid-offset)*scale,0.f)),params.binCount-1u);
+			}
+
+			inline void binAxis(const STmpNode& node, const uint32_t axis, const float offset, const float scale, std::vector<SBin>& bins) const
+			{
+				auto binRange = [&](const uint32_t begin, const uint32_t end, std::span<SBin> out) -> void
+				{
+					for (uint32_t i=begin; i<end; i++)
+					{
+						auto& bin = out[getBin(refs[i].centroid[axis],offset,scale)];
+						bin.aabb.extend(refs[i].aabb);
+						bin.count++;
+					}
+				};
+
+				std::fill(bins.begin(),bins.end(),SBin{});
+				if (node.count>=params.parallelBinningThreshold)
+				{
+					std::vector<SBin> partial(size_t(params.workerCount)*params.binCount);
+					parallelFor(node.count,[&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+						{
+							binRange(node.begin+begin,node.begin+end,std::span<SBin>(partial.data()+size_t(workerIx)*params.binCount,params.binCount));
+						},
+						params.workerCount
+					);
+					for (uint32_t w=0u; w<params.workerCount; w++)
+					for (uint32_t b=0u; b<params.binCount; b++)
+					{
+						bins[b].aabb.extend(partial[size_t(w)*params.binCount+b].aabb);
+						bins[b].count += partial[size_t(w)*params.binCount+b].count;
+					}
+				}
+				else
+					binRange(node.begin,node.begin+node.count,bins);
+			}
+
+			SBuildParams params;
+			std::vector<SRef> refs;
+			std::atomic<uint32_t> nodeCount = 0u;
+			std::atomic<uint32_t> activeTasks = 0u;
+		};
+
+		inline uint32_t flatten(const STmpNode& tmp)
+		{
+			const uint32_t nodeIx = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.emplace_back();
+			{
+				SNode& node = m_nodes.back();
+				std::copy_n(tmp.aabb.minVx.begin(),3,node.aabbMin);
+				std::copy_n(tmp.aabb.maxVx.begin(),3,node.aabbMax);
+				node.splitAxis = tmp.splitAxis;
+				node.primCount = 0u;
+				node.secondChildOrFirstPrim = 0u;
+			}
+			if (tmp.children[0])
+			{
+				flatten(*tmp.children[0]);
+				const uint32_t secondChild = flatten(*tmp.children[1]);
+				m_nodes[nodeIx].secondChildOrFirstPrim = secondChild;
+			}
+			else
+			{
+				m_nodes[nodeIx].primCount = tmp.count;
+				m_nodes[nodeIx].secondChildOrFirstPrim = tmp.begin;
+			}
+			return nodeIx;
+		}
+
+		std::vector<SNode> m_nodes;
+		std::vector<SPackedTriangle> m_triangles;
+};
+
+}
+
+#endif
@@ -0,0 +1,356 @@
+// Copyright (C) 2024-2024 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_CPU_FFT_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_CPU_FFT_HPP_INCLUDED_
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define _NBL_EXAMPLES_CPU_FFT_SSE_
+#include <immintrin.h>
+#endif
+
+#include "ParallelFor.hpp"
+
+namespace nbl::examples::fft
+{
+
+// Twiddles `exp(-2*pi*i*j/(2h))` for every radix-2 stage with butterfly half-span `h`, stored contiguously per stage at offset `h-1`
+// so that the butterfly loops can do vector loads instead of strided gathers. The last stage doubles as the table for real FFT unpacking.
+template<typename scalar_t>
+struct STwiddleTable
+{
+	static inline STwiddleTable create(const uint32_t log2N)
+	{
+		STwiddleTable retval;
+		retval.log2N = log2N;
+		const uint32_t N = 0x1u<<log2N;
+		retval.re.resize(N>1u ? N-1u:0u);
+		retval.im.resize(retval.re.size());
+		for (uint32_t h=1u; h<N; h<<=1u)
+		for (uint32_t j=0u; j<h; j++)
+		{
+			// compute in double and only then round, otherwise big transforms accumulate error in the last stages
+			const double angle = -std::numbers::pi*double(j)/double(h);
+			retval.re[h-1u+j] = scalar_t(std::cos(angle));
+			retval.im[h-1u+j] = scalar_t(std::sin(angle));
+		}
+		retval.bitReverse.resize(N);
+		for (uint32_t i=0u; i<N; i++)
+		{
+			uint32_t rev = 0u;
+			for (uint32_t b=0u; b<log2N; b++)
+				rev |= ((i>>b)&0x1u)<<(log2N-1u-b);
+			retval.bitReverse[i] = rev;
+		}
+		return retval;
+	}
+
+	inline uint32_t size() const {return 0x1u<<log2N;}
+
+	uint32_t log2N = 0u;
+	std::vector<scalar_t> re, im;
+	std::vector<uint32_t> bitReverse;
+};
+
+// Transforms of the same length get reused between dispatches and between axes, so build the tables once
+template<typename scalar_t>
+class CTwiddleCache
+{
+	public:
+		inline const STwiddleTable<scalar_t>& get(const uint32_t log2N)
+		{
+			std::lock_guard lock(m_mutex);
+			auto found = m_tables.find(log2N);
+			if (found==m_tables.end())
+				found = m_tables.emplace(log2N,std::make_unique<STwiddleTable<scalar_t>>(STwiddleTable<scalar_t>::create(log2N))).first;
+			return *found->second;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::map<uint32_t,std::unique_ptr<STwiddleTable<scalar_t>>> m_tables;
+};
+
+// One row of radix-2 butterflies `a' = a + w*b, b' = a - w*b`, all operands live in separate real and imaginary arrays (SoA).
+template<typename scalar_t, bool Inverse>
+inline void butterflies(scalar_t* aRe, scalar_t* aIm, scalar_t* bRe, scalar_t* bIm, const scalar_t* wRe, const scalar_t* wIm, const uint32_t count)
+{
+	uint32_t j = 0u;
+#ifdef _NBL_EXAMPLES_CPU_FFT_SSE_
+	if constexpr (std::is_same_v<scalar_t,float>)
+	{
+		for (; j+4u<=count; j+=4u)
+		{
+			const __m128 ar = _mm_loadu_ps(aRe+j), ai = _mm_loadu_ps(aIm+j);
+			const __m128 br = _mm_loadu_ps(bRe+j), bi = _mm_loadu_ps(bIm+j);
+			const __m128 wr = _mm_loadu_ps(wRe+j);
+			// inverse transform uses the conjugate twiddle
+			const __m128 wi = Inverse ? _mm_sub_ps(_mm_setzero_ps(),_mm_loadu_ps(wIm+j)):_mm_loadu_ps(wIm+j);
+			const __m128 tr = _mm_sub_ps(_mm_mul_ps(br,wr),_mm_mul_ps(bi,wi));
+			const __m128 ti = _mm_add_ps(_mm_mul_ps(br,wi),_mm_mul_ps(bi,wr));
+			_mm_storeu_ps(aRe+j,_mm_add_ps(ar,tr));
+			_mm_storeu_ps(aIm+j,_mm_add_ps(ai,ti));
+			_mm_storeu_ps(bRe+j,_mm_sub_ps(ar,tr));
+			_mm_storeu_ps(bIm+j,_mm_sub_ps(ai,ti));
+		}
+	}
+	else if constexpr (std::is_same_v<scalar_t,double>)
+	{
+		for (; j+2u<=count; j+=2u)
+		{
+			const __m128d ar = _mm_loadu_pd(aRe+j), ai = _mm_loadu_pd(aIm+j);
+			const __m128d br = _mm_loadu_pd(bRe+j), bi = _mm_loadu_pd(bIm+j);
+			const __m128d wr = _mm_loadu_pd(wRe+j);
+			const __m128d wi = Inverse ? _mm_sub_pd(_mm_setzero_pd(),_mm_loadu_pd(wIm+j)):_mm_loadu_pd(wIm+j);
+			const __m128d tr = _mm_sub_pd(_mm_mul_pd(br,wr),_mm_mul_pd(bi,wi));
+			const __m128d ti = _mm_add_pd(_mm_mul_pd(br,wi),_mm_mul_pd(bi,wr));
+			_mm_storeu_pd(aRe+j,_mm_add_pd(ar,tr));
+			_mm_storeu_pd(aIm+j,_mm_add_pd(ai,ti));
+			_mm_storeu_pd(bRe+j,_mm_sub_pd(ar,tr));
+			_mm_storeu_pd(bIm+j,_mm_sub_pd(ai,ti));
+		}
+	}
+#endif
+	for (; j<count; j++)
+	{
+		const scalar_t wr = wRe[j];
+		const scalar_t wi = Inverse ? -wIm[j]:wIm[j];
+		const scalar_t tr = bRe[j]*wr-bIm[j]*wi;
+		const scalar_t ti = bRe[j]*wi+bIm[j]*wr;
+		bRe[j] = aRe[j]-tr;
+		bIm[j] = aIm[j]-ti;
+		aRe[j] += tr;
+		aIm[j] += ti;
+	}
+}
+
+// In-place iterative decimation-in-time transform of a single SoA line, input in natural order, output in natural order.
+// Inverse transform is normalized by `1/N` so that `inverse(forward(x))==x` like the `workgroup::FFT<true,...>` counterpart.
+template<typename scalar_t, bool Inverse>
+inline void transformLine(scalar_t* re, scalar_t* im, const STwiddleTable<scalar_t>& twiddles)
+{
+	const uint32_t N = twiddles.size();
+	for (uint32_t i=0u; i<N; i++)
+	{
+		const uint32_t rev = twiddles.bitReverse[i];
+		if (i<rev)
+		{
+			std::swap(re[i],re[rev]);
+			std::swap(im[i],im[rev]);
+		}
+	}
+	for (uint32_t h=1u; h<N; h<<=1u)
+	{
+		const scalar_t* wRe = twiddles.re.data()+h-1u;
+		const scalar_t* wIm = twiddles.im.data()+h-1u;
+		for (uint32_t base=0u; base<N; base+=h<<1u)
+			butterflies<scalar_t,Inverse>(re+base,im+base,re+base+h,im+base+h,wRe,wIm,h);
+	}
+	if constexpr (Inverse)
+	{
+		const scalar_t norm = scalar_t(1)/scalar_t(N);
+		for (uint32_t i=0u; i<N; i++)
+		{
+			re[i] *= norm;
+			im[i] *= norm;
+		}
+	}
+}
+
+// Batched 1D/2D/3D complex transforms over interleaved `(re,im)` data, the same packing the GPU examples keep in their buffers.
+// Dimension 0 is the fastest varying, the batch index is the slowest. Every axis is processed as a set of independent lines which
+// get gathered into per-worker SoA scratch, transformed and scattered back, lines are distributed over the workers.
+template<typename scalar_t>
+class CCPUFFT
+{
+	public:
+		// Zero `log2Extent` means the dimension isn't there, so `{10,0,0}` is a 1D FFT of 1024 elements
+		struct SDimensions
+		{
+			inline uint32_t dimensionCount() const
+			{
+				uint32_t count = 0u;
+				for (uint32_t d=0u; d<3u; d++)
+				if (log2Extent[d])
+					count = d+1u;
+				return count;
+			}
+			inline size_t elementCount() const
+			{
+				return size_t(1ull)<<(log2Extent[0]+log2Extent[1]+log2Extent[2]);
+			}
+
+			std::array<uint32_t,3> log2Extent = {0u,0u,0u};
+		};
+
+		explicit inline CCPUFFT(const uint32_t workerCount=0u) : m_workerCount(workerCount ? workerCount:getDefaultWorkerCount()) {}
+
+		inline uint32_t getWorkerCount() const {return m_workerCount;}
+
+		// `data` must hold `batchCount*dims.elementCount()` complex numbers
+		inline void forward(scalar_t* data, const SDimensions& dims, const uint32_t batchCount=1u)
+		{
+			transform<false>(data,dims,batchCount);
+		}
+		inline void inverse(scalar_t* data, const SDimensions& dims, const uint32_t batchCount=1u)
+		{
+			transform<true>(data,dims,batchCount);
+		}
+
+		// Real to complex transform of `batchCount` signals of length `2^log2N` each, by the usual trick of packing even and odd
+		// samples as a single complex signal of half the length and untangling the spectra afterwards.
+		// Writes the `N/2+1` non-redundant complex outputs (interleaved) per signal, the rest follows from Hermitian symmetry.
+		inline void forwardReal(const scalar_t* in, scalar_t* out, const uint32_t log2N, const uint32_t batchCount=1u)
+		{
+			assert(log2N>=1u);
+			const uint32_t M = 0x1u<<(log2N-1u);
+			const auto& halfTwiddles = m_twiddles.get(log2N-1u);
+			const auto& fullTwiddles = m_twiddles.get(log2N);
+			auto& scratch = getScratch(M);
+			parallelFor(batchCount,[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+				{
+					scalar_t* re = scratch[workerIx].data();
+					scalar_t* im = re+M;
+					for (size_t b=begin; b<end; b++)
+					{
+						const scalar_t* src = in+(b<<log2N);
+						for (uint32_t n=0u; n<M; n++)
+						{
+							re[n] = src[2u*n];
+							im[n] = src[2u*n+1u];
+						}
+						transformLine<scalar_t,false>(re,im,halfTwiddles);
+						scalar_t* dst = out+b*(M+1u)*2u;
+						for (uint32_t k=0u; k<=M; k++)
+						{
+							const uint32_t kk = k&(M-1u), mk = (M-k)&(M-1u);
+							// E = (Z[k]+conj(Z[M-k]))/2, O = -i(Z[k]-conj(Z[M-k]))/2
+							const scalar_t eRe = (re[kk]+re[mk])*scalar_t(0.5), eIm = (im[kk]-im[mk])*scalar_t(0.5);
+							const scalar_t oRe = (im[kk]+im[mk])*scalar_t(0.5), oIm = (re[mk]-re[kk])*scalar_t(0.5);
+							// W_N^k, for `k==M` its just -1
+							const scalar_t wRe = k<M ? fullTwiddles.re[M-1u+k]:scalar_t(-1);
+							const scalar_t wIm = k<M ? fullTwiddles.im[M-1u+k]:scalar_t(0);
+							dst[2u*k] = eRe+wRe*oRe-wIm*oIm;
+							dst[2u*k+1u] = eIm+wRe*oIm+wIm*oRe;
+						}
+					}
+				},m_workerCount
+			);
+		}
+		// Exact inverse of `forwardReal`, reads `N/2+1` complex values per signal and writes `N` reals
+		inline void inverseReal(const scalar_t* in, scalar_t* out, const uint32_t log2N, const uint32_t batchCount=1u)
+		{
+			assert(log2N>=1u);
+			const uint32_t M = 0x1u<<(log2N-1u);
+			const auto& halfTwiddles = m_twiddles.get(log2N-1u);
+			const auto& fullTwiddles = m_twiddles.get(log2N);
+			auto& scratch = getScratch(M);
+			parallelFor(batchCount,[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+				{
+					scalar_t* re = scratch[workerIx].data();
+					scalar_t* im = re+M;
+					for (size_t b=begin; b<end; b++)
+					{
+						const scalar_t* src = in+b*(M+1u)*2u;
+						for (uint32_t k=0u; k<M; k++)
+						{
+							const scalar_t xRe = src[2u*k], xIm = src[2u*k+1u];
+							const scalar_t cRe = src[2u*(M-k)], cIm = -src[2u*(M-k)+1u];
+							const scalar_t eRe = (xRe+cRe)*scalar_t(0.5), eIm = (xIm+cIm)*scalar_t(0.5);
+							const scalar_t dRe = (xRe-cRe)*scalar_t(0.5), dIm = (xIm-cIm)*scalar_t(0.5);
+							// O = D * conj(W_N^k), then Z = E + iO
+							const scalar_t wRe = fullTwiddles.re[M-1u+k], wIm = fullTwiddles.im[M-1u+k];
+							const scalar_t oRe = dRe*wRe+dIm*wIm, oIm = dIm*wRe-dRe*wIm;
+							re[k] = eRe-oIm;
+							im[k] = eIm+oRe;
+						}
+						transformLine<scalar_t,true>(re,im,halfTwiddles);
+						scalar_t* dst = out+(b<<log2N);
+						for (uint32_t n=0u; n<M; n++)
+						{
+							dst[2u*n] = re[n];
+							dst[2u*n+1u] = im[n];
+						}
+					}
+				},m_workerCount
+			);
+		}
+
+		// The customary `5 N log2(N)` operation count of a complex radix-2 transform, used to report GFLOPS comparable with other libraries
+		static inline double flopCount(const SDimensions& dims, const uint32_t batchCount=1u)
+		{
+			const uint32_t log2Total = dims.log2Extent[0]+dims.log2Extent[1]+dims.log2Extent[2];
+			return 5.0*double(dims.elementCount())*double(log2Total)*double(batchCount);
+		}
+
+	private:
+		template<bool Inverse>
+		inline void transform(scalar_t* data, const SDimensions& dims, const uint32_t batchCount)
+		{
+			const size_t total = dims.elementCount()*batchCount;
+			size_t stride = 1ull;
+			for (uint32_t d=0u; d<dims.dimensionCount(); stride<<=dims.log2Extent[d++])
+			{
+				const uint32_t log2N = dims.log2Extent[d];
+				if (log2N==0u)
+					continue;
+				const uint32_t N = 0x1u<<log2N;
+				const auto& twiddles = m_twiddles.get(log2N);
+				auto& scratch = getScratch(N);
+				const size_t lineCount = total>>log2N;
+				parallelFor(lineCount,[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+					{
+						scalar_t* re = scratch[workerIx].data();
+						scalar_t* im = re+N;
+						for (size_t line=begin; line<end; line++)
+						{
+							// line index splits into position below the axis and the "outer" index above it
+							const size_t inner = line%stride;
+							const size_t outer = line/stride;
+							scalar_t* base = data+((outer<<log2N)*stride+inner)*2ull;
+							for (uint32_t i=0u; i<N; i++)
+							{
+								re[i] = base[i*stride*2ull];
+								im[i] = base[i*stride*2ull+1ull];
+							}
+							transformLine<scalar_t,Inverse>(re,im,twiddles);
+							for (uint32_t i=0u; i<N; i++)
+							{
+								base[i*stride*2ull] = re[i];
+								base[i*stride*2ull+1ull] = im[i];
+							}
+						}
+					},m_workerCount
+				);
+			}
+		}
+
+		// one real and one imaginary line per worker
+		inline std::vector<std::vector<scalar_t>>& getScratch(const uint32_t N)
+		{
+			m_scratch.resize(m_workerCount);
+			for (auto& s : m_scratch)
+			if (s.size()<2ull*N)
+				s.resize(2ull*N);
+			return m_scratch;
+		}
+
+		const uint32_t m_workerCount;
+		CTwiddleCache<scalar_t> m_twiddles;
+		std::vector<std::vector<scalar_t>> m_scratch;
+};
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_CPU_TRANSFORM_TREE_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_CPU_TRANSFORM_TREE_HPP_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "ParallelFor.hpp"
+
+namespace nbl::examples
+{
+
+// CPU counterpart of `scene::ITransformTree` + the global transform recompute of `ITransformTreeManager`, for scene graphs which get edited on the CPU.
+// Nodes are stored sorted by depth and within a level by their parent's position, so every level is a contiguous run whose parents are a monotonic walk
+// over the previous level, a level can be processed in parallel since all of its parents are final by then.
+// Only nodes whose relative transform changed since the last propagation, and their subtrees, get their global transform recomputed.
+// Not thread-safe, edit from one thread and call `propagate` from it, the parallelism is internal.
+class CCPUTransformTree
+{
+	public:
+		using node_t = uint32_t;
+		constexpr static inline node_t invalid_node = ~0u;
+
+		struct SPropagationStats
+		{
+			uint32_t recomputedNodes = 0u;
+			uint32_t processedLevels = 0u;
+			uint32_t skippedLevels = 0u; // levels without any dirty node or recomputed parent
+		};
+
+		inline void reserve(const uint32_t nodeCount)
+		{
+			m_parents.reserve(nodeCount);
+			m_depths.reserve(nodeCount);
+			m_nodeToPos.reserve(nodeCount);
+		}
+
+		//! `parent` has to have been added already, so the tree can never contain cycles
+		inline node_t addNode(const core::matrix3x4SIMD& relativeTransform, const node_t parent=invalid_node)
+		{
+			assert(parent==invalid_node || parent<getNodeCount());
+			const node_t node = getNodeCount();
+			m_parents.push_back(parent);
+			const uint32_t depth = parent!=invalid_node ? (m_depths[parent]+1u):0u;
+			m_depths.push_back(depth);
+			m_nodeToPos.push_back(invalid_node);
+			m_staged.push_back(relativeTransform);
+			m_levelCount = std::max(m_levelCount,depth+1u);
+			return node;
+		}
+
+		inline void setRelativeTransform(const node_t node, const core::matrix3x4SIMD& relativeTransform)
+		{
+			const auto pos = m_nodeToPos[node];
+			if (pos==invalid_node)
+			{
+				m_staged[node-m_laidOutCount] = relativeTransform;
+				return;
+			}
+			m_relative[pos] = relativeTransform;
+			if (!m_dirty[pos])
+			{
+				m_dirty[pos] = 1u;
+				m_levelDirtyCount[m_depths[node]]++;
+				m_dirtyCount++;
+			}
+		}
+
+		inline const core::matrix3x4SIMD& getRelativeTransform(const node_t node) const
+		{
+			const auto pos = m_nodeToPos[node];
+			return pos!=invalid_node ? m_relative[pos]:m_staged[node-m_laidOutCount];
+		}
+		//! Only up to date after `propagate`
+		inline const core::matrix3x4SIMD& getGlobalTransform(const node_t node) const
+		{
+			assert(m_nodeToPos[node]!=invalid_node);
+			return m_global[m_nodeToPos[node]];
+		}
+		inline node_t getParent(const node_t node) const {return m_parents[node];}
+		inline uint32_t getDepth(const node_t node) const {return m_depths[node];}
+		inline uint32_t getNodeCount() const {return static_cast<uint32_t>(m_parents.size());}
+		inline uint32_t getLevelCount() const {return m_levelCount;}
+		inline uint32_t getDirtyCount() const {return m_dirtyCount+(getNodeCount()-m_laidOutCount);}
+
+		//! Recomputes the global transforms of everything dirty and everything below it, one level at a time
+		inline SPropagationStats propagate(uint32_t workerCount=0u)
+		{
+			if (workerCount==0u)
+				workerCount = getDefaultWorkerCount();
+			if (m_laidOutCount!=getNodeCount())
+				relayout();
+
+			SPropagationStats stats = {};
+			if (m_dirtyCount==0u)
+			{
+				stats.skippedLevels = m_levelCount;
+				return stats;
+			}
+			// stamps instead of flags so nothing has to be cleared between propagations
+			m_pass++;
+
+			std::vector<uint32_t> recomputedPerWorker(workerCount);
+			bool parentLevelRecomputed = false;
+			for (uint32_t level=0u; level<m_levelCount; level++)
+			{
+				if (!parentLevelRecomputed && m_levelDirtyCount[level]==0u)
+				{
+					stats.skippedLevels++;
+					continue;
+				}
+				const uint32_t begin = m_levelOffsets[level];
+				const uint32_t end = m_levelOffsets[level+1u];
+
+				std::fill(recomputedPerWorker.begin(),recomputedPerWorker.end(),0u);
+				// don't spin up threads for the levels near the roots
+				const uint32_t levelWorkers = end-begin<ParallelLevelThreshold ? 1u:workerCount;
+				parallelFor(end-begin,[&](const size_t chunkBegin, const size_t chunkEnd, const uint32_t workerIx)->void
+				{
+					uint32_t recomputed = 0u;
+					for (uint32_t pos=begin+chunkBegin; pos<begin+chunkEnd; pos++)
+					{
+						const uint32_t parentPos = m_parentPos[pos];
+						if (parentPos==invalid_node)
+						{
+							if (!m_dirty[pos])
+								continue;
+							m_global[pos] = m_relative[pos];
+						}
+						else
+						{
+							if (!m_dirty[pos] && m_recomputedPass[parentPos]!=m_pass)
+								continue;
+							m_global[pos] = core::matrix3x4SIMD::concatenateBFollowedByA(m_global[parentPos],m_relative[pos]);
+						}
+						m_recomputedPass[pos] = m_pass;
+						m_dirty[pos] = 0u;
+						recomputed++;
+					}
+					recomputedPerWorker[workerIx] += recomputed;
+				},levelWorkers,ChunkSize);
+
+				uint32_t recomputed = 0u;
+				for (const auto count : recomputedPerWorker)
+					recomputed += count;
+				stats.recomputedNodes += recomputed;
+				stats.processedLevels++;
+				parentLevelRecomputed = recomputed!=0u;
+				m_levelDirtyCount[level] = 0u;
+			}
+			m_dirtyCount = 0u;
+			return stats;
+		}
+
+	protected:
+		// big enough to amortize the atomic chunk fetch, small enough that the dirty checks of a sparse edit don't serialize on one worker
+		constexpr static inline uint32_t ChunkSize = 1024u;
+		constexpr static inline uint32_t ParallelLevelThreshold = 4u*ChunkSize;
+
+		// Re-sorts everything into level order after nodes got added, keeps the global transforms and dirty state of the old nodes
+		inline void relayout()
+		{
+			const uint32_t nodeCount = getNodeCount();
+
+			// children lists by parent, CSR
+			std::vector<uint32_t> childOffsets(nodeCount+1u,0u);
+			for (const auto parent : m_parents)
+			if (parent!=invalid_node)
+				childOffsets[parent+1u]++;
+			for (uint32_t i=0u; i<nodeCount; i++)
+				childOffsets[i+1u] += childOffsets[i];
+			std::vector<node_t> children(childOffsets[nodeCount]);
+			{
+				auto cursor = childOffsets;
+				for (node_t node=0u; node<nodeCount; node++)
+				if (m_parents[node]!=invalid_node)
+					children[cursor[m_parents[node]]++] = node;
+			}
+
+			// breadth first, so siblings end up contiguous and ordered like their parents
+			std::vector<node_t> posToNode;
+			posToNode.reserve(nodeCount);
+			m_levelOffsets.assign(1u,0u);
+			for (node_t node=0u; node<nodeCount; node++)
+			if (m_parents[node]==invalid_node)
+				posToNode.push_back(node);
+			for (uint32_t levelBegin=0u; levelBegin<posToNode.size(); )
+			{
+				const uint32_t levelEnd = static_cast<uint32_t>(posToNode.size());
+				m_levelOffsets.push_back(levelEnd);
+				for (uint32_t pos=levelBegin; pos<levelEnd; pos++)
+				{
+					const node_t node = posToNode[pos];
+					posToNode.insert(posToNode.end(),children.begin()+childOffsets[node],children.begin()+childOffsets[node+1u]);
+				}
+				levelBegin = levelEnd;
+			}
+			assert(posToNode.size()==nodeCount && m_levelOffsets.size()==m_levelCount+1u);
+
+			std::vector<uint32_t> nodeToPos(nodeCount);
+			for (uint32_t pos=0u; pos<nodeCount; pos++)
+				nodeToPos[posToNode[pos]] = pos;
+
+			std::vector<uint32_t> parentPos(nodeCount);
+			std::vector<core::matrix3x4SIMD> relative(nodeCount), global(nodeCount);
+			std::vector<uint8_t> dirty(nodeCount);
+			m_levelDirtyCount.assign(m_levelCount,0u);
+			m_dirtyCount = 0u;
+			for (uint32_t pos=0u; pos<nodeCount; pos++)
+			{
+				const node_t node = posToNode[pos];
+				parentPos[pos] = m_parents[node]!=invalid_node ? nodeToPos[m_parents[node]]:invalid_node;
+				if (const auto oldPos=m_nodeToPos[node]; oldPos!=invalid_node)
+				{
+					relative[pos] = m_relative[oldPos];
+					global[pos] = m_global[oldPos];
+					dirty[pos] = m_dirty[oldPos];
+				}
+				else
+				{
+					relative[pos] = m_staged[node-m_laidOutCount];
+					dirty[pos] = 1u;
+				}
+				if (dirty[pos])
+				{
+					m_levelDirtyCount[m_depths[node]]++;
+					m_dirtyCount++;
+				}
+			}
+
+			m_nodeToPos = std::move(nodeToPos);
+			m_parentPos = std::move(parentPos);
+			m_relative = std::move(relative);
+			m_global = std::move(global);
+			m_dirty = std::move(dirty);
+			m_recomputedPass.assign(nodeCount,0u);
+			m_pass = 0u;
+			m_staged.clear();
+			m_laidOutCount = nodeCount;
+		}
+
+		// by node handle
+		std::vector<node_t> m_parents;
+		std::vector<uint32_t> m_depths;
+		std::vector<uint32_t> m_nodeToPos;
+		// relative transforms of the nodes added since the last `relayout`, indexed by `node-m_laidOutCount`
+		std::vector<core::matrix3x4SIMD> m_staged;
+		uint32_t m_laidOutCount = 0u;
+		// by position in level order
+		std::vector<uint32_t> m_levelOffsets = {0u};
+		std::vector<uint32_t> m_parentPos;
+		std::vector<core::matrix3x4SIMD> m_relative;
+		std::vector<core::matrix3x4SIMD> m_global;
+		std::vector<uint8_t> m_dirty;
+		std::vector<uint32_t> m_recomputedPass;
+		// by level
+		std::vector<uint32_t> m_levelDirtyCount;
+		uint32_t m_levelCount = 0u;
+		uint32_t m_dirtyCount = 0u;
+		uint32_t m_pass = 0u;
+};
+
+}
+
+#endif
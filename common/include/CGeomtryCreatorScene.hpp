@@ -5,6 +5,7 @@
 
 #include "nbl/asset/utils/CGeometryCreator.h"
 #include "SBasicViewParameters.hlsl"
+#include "CMeshOptimizer.hpp"
 #include "geometry/creator/spirv/builtin/CArchive.h"
 #include "geometry/creator/spirv/builtin/builtinResources.h"
 
@@ -104,8 +105,8 @@ public:
 
 	using this_t = ResourceBuilder<withAssetConverter>;
 
-	ResourceBuilder(nbl::video::IUtilities* const _utilities, nbl::video::IGPUCommandBuffer* const _commandBuffer, nbl::system::ILogger* const _logger, const nbl::asset::IGeometryCreator* const _geometryCreator)
-		: utilities(_utilities), commandBuffer(_commandBuffer), logger(_logger), geometries(_geometryCreator)
+	ResourceBuilder(nbl::video::IUtilities* const _utilities, nbl::video::IGPUCommandBuffer* const _commandBuffer, nbl::system::ILogger* const _logger, const nbl::asset::IGeometryCreator* const _geometryCreator, const bool _optimizeMeshes = true, const bool _optimizeOverdraw = false)
+		: utilities(_utilities), commandBuffer(_commandBuffer), logger(_logger), geometries(_geometryCreator), optimizeMeshes(_optimizeMeshes), optimizeOverdraw(_optimizeOverdraw)
 	{
 		assert(utilities);
 		assert(logger);
@@ -138,6 +139,7 @@ public:
 			functor_t(std::bind(&this_t::createRenderpass, this)),
 			functor_t(std::bind(&this_t::createFramebufferAttachments, this)),
 			functor_t(std::bind(&this_t::createShaders, this)),
+			functor_t(std::bind(&this_t::optimizeGeometries, this)),
 			functor_t(std::bind(&this_t::createGeometries, this)),
 			functor_t(std::bind(&this_t::createViewParametersUboBuffer, this)),
 			functor_t(std::bind(&this_t::createDescriptorSet, this))
@@ -807,6 +809,80 @@ private:
 		return true;
 	}
 
+	// reorders the CPU index and vertex buffers in place before anything gets uploaded or hashed
+	bool optimizeGeometries()
+	{
+		EXPOSE_NABLA_NAMESPACES();
+
+		if (!optimizeMeshes)
+			return true;
+
+		for (const auto& geometry : geometries.objects)
+		{
+			const auto& data = geometry.data;
+			auto* const iBuffer = data.indexBuffer.buffer.get();
+			if (data.assemblyParams.primitiveType != EPT_TRIANGLE_LIST || !iBuffer || data.indexType == EIT_UNKNOWN)
+				continue;
+
+			// every per vertex binding has to be permuted the same way, bindings aliasing the same memory only once
+			struct SVertexStream
+			{
+				uint8_t* data;
+				uint32_t stride;
+			};
+			core::vector<SVertexStream> streams;
+			uint32_t vertexCount = ~0u;
+			bool missingBuffer = false;
+			for (uint32_t binding = 0u; binding < ICPUMeshBuffer::MAX_ATTR_BUF_BINDING_COUNT; binding++)
+			{
+				if (!(data.inputParams.enabledBindingFlags & (0x1u << binding)) || data.inputParams.bindings[binding].inputRate != EVIR_PER_VERTEX)
+					continue;
+				auto* const buffer = data.bindings[binding].buffer.get();
+				const uint32_t stride = data.inputParams.bindings[binding].stride;
+				if (!buffer || stride == 0u)
+				{
+					missingBuffer = true;
+					break;
+				}
+				uint8_t* const streamData = reinterpret_cast<uint8_t*>(buffer->getPointer()) + data.bindings[binding].offset;
+				vertexCount = std::min<uint32_t>(vertexCount, static_cast<uint32_t>((buffer->getSize() - data.bindings[binding].offset) / stride));
+				if (std::find_if(streams.begin(), streams.end(), [streamData](const SVertexStream& other) { return other.data == streamData; }) == streams.end())
+					streams.push_back({ streamData, stride });
+			}
+			const uint32_t positionBinding = data.inputParams.attributes[0].binding;
+			if (missingBuffer || streams.empty() || !(data.inputParams.enabledBindingFlags & (0x1u << positionBinding)) || !data.bindings[positionBinding].buffer)
+				continue;
+			const uint8_t* const positions = reinterpret_cast<const uint8_t*>(data.bindings[positionBinding].buffer->getPointer()) + data.bindings[positionBinding].offset + data.inputParams.attributes[0].relativeOffset;
+			const uint32_t positionStride = data.inputParams.bindings[positionBinding].stride;
+			void* const indexData = reinterpret_cast<uint8_t*>(iBuffer->getPointer()) + data.indexBuffer.offset;
+
+			std::vector<uint32_t> indices(data.indexCount);
+			if (data.indexType == EIT_16BIT)
+				std::copy_n(reinterpret_cast<const uint16_t*>(indexData), indices.size(), indices.begin());
+			else
+				std::copy_n(reinterpret_cast<const uint32_t*>(indexData), indices.size(), indices.begin());
+
+			using optimizer_t = nbl::examples::CMeshOptimizer;
+			const auto before = optimizer_t::analyzeVertexCache(indices, vertexCount);
+			const auto clusters = optimizer_t::optimizeVertexCache(indices, vertexCount);
+			if (optimizeOverdraw)
+				optimizer_t::optimizeOverdraw(indices, clusters, positions, positionStride);
+			const auto remap = optimizer_t::optimizeVertexFetch(indices, vertexCount);
+			for (const auto& stream : streams)
+				optimizer_t::remapVertices(stream.data, stream.stride, remap);
+			const auto after = optimizer_t::analyzeVertexCache(indices, vertexCount);
+
+			if (data.indexType == EIT_16BIT)
+				std::transform(indices.begin(), indices.end(), reinterpret_cast<uint16_t*>(indexData), [](const uint32_t index) { return static_cast<uint16_t>(index); });
+			else
+				std::copy(indices.begin(), indices.end(), reinterpret_cast<uint32_t*>(indexData));
+
+			logger->log("[%s] ACMR %f -> %f, ATVR %f -> %f", ILogger::ELL_PERFORMANCE, geometry.meta.name.data(), before.acmr, after.acmr, before.atvr, after.atvr);
+		}
+
+		return true;
+	}
+
 	bool createGeometries()
 	{
 		EXPOSE_NABLA_NAMESPACES();
@@ -1092,6 +1168,9 @@ private:
 	nbl::video::IGPUCommandBuffer* const commandBuffer;
 	nbl::system::ILogger* const logger;
 	GeometriesCpu geometries;
+	const bool optimizeMeshes;
+	// trades a little of the vertex cache efficiency for drawing outward facing clusters first, only pays off with expensive fragment shaders
+	const bool optimizeOverdraw;
 };
 
 #undef TYPES_IMPL_BOILERPLATE
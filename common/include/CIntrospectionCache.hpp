@@ -0,0 +1,344 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_INTROSPECTION_CACHE_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_INTROSPECTION_CACHE_HPP_INCLUDED_
+
+#include <nabla.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AtomicFileWrite.hpp"
+#include "CShaderCompileCache.hpp"
+
+namespace nbl::examples
+{
+
+// On-disk cache of what `CSPIRVIntrospector` derives from SPIR-V: the approximate pipeline layout of a single stage and the outcome of merging
+// several stages' introspections into one layout. Keyed by the hash of the SPIR-V (and entry point) and the Nabla build so it sits naturally next to `CShaderCompileCache`,
+// a warm run gets the SPIR-V from there and the layout from here without ever compiling with debug info or running reflection.
+class CIntrospectionCache
+{
+	public:
+		struct SStats
+		{
+			uint32_t hits = 0u;
+			uint32_t misses = 0u;
+			double introspectMilliseconds = 0.0; // spent introspecting and deriving layouts for the misses
+			double lookupMilliseconds = 0.0; // spent reading and rebuilding layouts for the hits
+		};
+
+		struct SMergeResult
+		{
+			bool merged = false;
+			// only if `merged`
+			core::smart_refctd_ptr<asset::ICPUPipelineLayout> layout;
+		};
+
+		inline CIntrospectionCache(core::smart_refctd_ptr<system::ISystem>&& system, const std::filesystem::path& directory) : m_system(std::move(system)), m_directory(directory)
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(m_directory,ec);
+		}
+
+		static inline core::blake3_hash_t hashStage(const asset::ICPUShader* spirv, const std::string_view entryPoint)
+		{
+			core::blake3_hasher hasher;
+			const auto* content = spirv->getContent();
+			const uint64_t size = content->getSize();
+			hasher.update(&size,sizeof(size));
+			hasher.update(content->getPointer(),size);
+			const auto stage = spirv->getStage();
+			hasher.update(&stage,sizeof(stage));
+			hasher.update(entryPoint.data(),entryPoint.size());
+			return static_cast<core::blake3_hash_t>(hasher);
+		}
+
+		//! Same as `CSPIRVIntrospector::createApproximateComputePipelineFromIntrospection` but only introspects on a miss
+		inline core::smart_refctd_ptr<asset::ICPUComputePipeline> createApproximateComputePipeline(asset::CSPIRVIntrospector& introspector, const asset::ICPUShader::SSpecInfo& specInfo, system::ILogger* logger=nullptr)
+		{
+			const auto stage = hashStage(specInfo.shader,specInfo.entryPoint);
+			const auto key = hashKeys(ComputePipelineTag,{&stage,1});
+			const auto path = getPath(key,".layout");
+
+			const auto lookupStart = clock_t::now();
+			if (SMergeResult cached; load(path,cached) && cached.layout)
+			{
+				asset::ICPUComputePipeline::SCreationParams params = {};
+				params.layout = cached.layout.get();
+				params.shader = specInfo;
+				auto pipeline = asset::ICPUComputePipeline::create(params);
+				m_hits++;
+				addTo(m_lookupMilliseconds,milliseconds(clock_t::now()-lookupStart));
+				return pipeline;
+			}
+
+			const auto introspectStart = clock_t::now();
+			auto pipeline = introspector.createApproximateComputePipelineFromIntrospection(specInfo);
+			m_misses++;
+			addTo(m_introspectMilliseconds,milliseconds(clock_t::now()-introspectStart));
+			if (pipeline)
+				store(path,true,pipeline->getLayout());
+			else if (logger)
+				logger->log("Failed to create an approximate compute pipeline from introspection of \"%s\"",system::ILogger::ELL_ERROR,specInfo.shader->getFilepathHint().c_str());
+			return pipeline;
+		}
+
+		//! Merges the introspections of `stages` in order like repeated `CSPIRVIntrospector::CPipelineIntrospectionData::merge` calls, `merged` is only true if all of them succeed.
+		// `introspect(i)` has to return the `const CStageIntrospectionData*` of the i-th stage and only gets called on a miss, so callers can defer their reflection.
+		template<typename Introspect>
+		inline SMergeResult merge(std::span<const core::blake3_hash_t> stages, Introspect&& introspect)
+		{
+			const auto key = hashKeys(MergeTag,stages);
+			const auto path = getPath(key,".merge");
+
+			SMergeResult retval = {};
+			const auto lookupStart = clock_t::now();
+			if (load(path,retval))
+			{
+				m_hits++;
+				addTo(m_lookupMilliseconds,milliseconds(clock_t::now()-lookupStart));
+				return retval;
+			}
+
+			const auto introspectStart = clock_t::now();
+			auto pipelineData = core::make_smart_refctd_ptr<asset::CSPIRVIntrospector::CPipelineIntrospectionData>();
+			core::smart_refctd_ptr<const asset::CSPIRVIntrospector::CStageIntrospectionData> last;
+			retval.merged = !stages.empty();
+			for (size_t i=0; i<stages.size() && retval.merged; i++)
+			{
+				last = core::smart_refctd_ptr<const asset::CSPIRVIntrospector::CStageIntrospectionData>(introspect(i));
+				retval.merged = last && pipelineData->merge(last.get());
+			}
+			if (retval.merged)
+				retval.layout = pipelineData->createApproximatePipelineLayoutFromIntrospection(last);
+			m_misses++;
+			addTo(m_introspectMilliseconds,milliseconds(clock_t::now()-introspectStart));
+			// a failed merge is a result worth caching too, unless reflection itself failed
+			if (last)
+				store(path,retval.merged,retval.layout.get());
+			return retval;
+		}
+
+		inline SStats getStats() const
+		{
+			SStats retval = {};
+			retval.hits = m_hits.load();
+			retval.misses = m_misses.load();
+			retval.introspectMilliseconds = m_introspectMilliseconds.load();
+			retval.lookupMilliseconds = m_lookupMilliseconds.load();
+			return retval;
+		}
+
+		inline void logStats(system::ILogger* logger) const
+		{
+			const auto stats = getStats();
+			logger->log("Introspection cache \"%s\": %u hits, %u misses, %.3f ms introspecting, %.3f ms looking up",system::ILogger::ELL_PERFORMANCE,
+				m_directory.string().c_str(),stats.hits,stats.misses,stats.introspectMilliseconds,stats.lookupMilliseconds);
+		}
+
+	protected:
+		using clock_t = std::chrono::steady_clock;
+		using binding_t = asset::ICPUDescriptorSetLayout::SBinding;
+
+		constexpr static inline uint32_t ComputePipelineTag = 0u;
+		constexpr static inline uint32_t MergeTag = 1u;
+
+		struct SFileHeader
+		{
+			constexpr static inline uint32_t Magic = 0x544e494eu; // "NINT"
+			constexpr static inline uint32_t Version = 1u;
+
+			uint32_t magic = Magic;
+			uint32_t version = Version;
+			uint32_t merged = 0u;
+			uint32_t bindingCount = 0u;
+			uint32_t pushConstantCount = 0u;
+			uint32_t pad = 0u;
+		};
+		struct SBinding
+		{
+			uint32_t set;
+			uint32_t binding;
+			uint32_t type;
+			uint32_t createFlags;
+			uint32_t stageFlags;
+			uint32_t count;
+		};
+		struct SPushConstantRange
+		{
+			uint32_t stageFlags;
+			uint32_t offset;
+			uint32_t size;
+		};
+
+		static inline double milliseconds(const clock_t::duration duration)
+		{
+			return std::chrono::duration<double,std::milli>(duration).count();
+		}
+		static inline void addTo(std::atomic<double>& target, const double value)
+		{
+			double expected = target.load();
+			while (!target.compare_exchange_weak(expected,expected+value)) {}
+		}
+
+		static inline core::blake3_hash_t hashKeys(const uint32_t tag, std::span<const core::blake3_hash_t> stages)
+		{
+			core::blake3_hasher hasher;
+			const uint32_t version = SFileHeader::Version;
+			hasher.update(&version,sizeof(version));
+			// the introspector is part of Nabla, so a different build of it may well derive different layouts from the same SPIR-V
+			const auto& build = CShaderCompileCache::getBuildFingerprint();
+			hasher.update(&build,sizeof(build));
+			hasher.update(&tag,sizeof(tag));
+			for (const auto& stage : stages)
+				hasher.update(stage.data,sizeof(stage.data));
+			return static_cast<core::blake3_hash_t>(hasher);
+		}
+
+		inline std::filesystem::path getPath(const core::blake3_hash_t& key, const char* extension) const
+		{
+			constexpr char Digits[] = "0123456789abcdef";
+			std::string name;
+			name.reserve(sizeof(key.data)*2u+8u);
+			for (const auto byte : key.data)
+			{
+				name += Digits[byte>>4];
+				name += Digits[byte&0xfu];
+			}
+			name += extension;
+			return m_directory/name;
+		}
+
+		inline bool load(const std::filesystem::path& path, SMergeResult& out) const
+		{
+			std::error_code ec;
+			if (!std::filesystem::exists(path,ec))
+				return false;
+
+			core::smart_refctd_ptr<const system::IFile> file;
+			{
+				system::ISystem::future_t<core::smart_refctd_ptr<system::IFile>> future;
+				m_system->createFile(future,path,system::IFile::ECF_READ|system::IFile::ECF_MAPPABLE);
+				if (auto lock=future.acquire(); lock)
+					file = *lock;
+			}
+			if (!file || !file->getMappedPointer() || file->getSize()<sizeof(SFileHeader))
+				return false;
+
+			const auto* data = reinterpret_cast<const uint8_t*>(file->getMappedPointer());
+			SFileHeader header;
+			memcpy(&header,data,sizeof(header));
+			if (header.magic!=SFileHeader::Magic || header.version!=SFileHeader::Version)
+				return false;
+			if (sizeof(SFileHeader)+header.bindingCount*sizeof(SBinding)+header.pushConstantCount*sizeof(SPushConstantRange)!=file->getSize())
+				return false;
+
+			out.merged = header.merged;
+			out.layout = nullptr;
+			if (!out.merged)
+				return true;
+
+			std::vector<SBinding> bindings(header.bindingCount);
+			memcpy(bindings.data(),data+sizeof(SFileHeader),bindings.size()*sizeof(SBinding));
+			std::vector<asset::SPushConstantRange> pushConstants(header.pushConstantCount);
+			for (uint32_t i=0u; i<header.pushConstantCount; i++)
+			{
+				SPushConstantRange range;
+				memcpy(&range,data+sizeof(SFileHeader)+bindings.size()*sizeof(SBinding)+i*sizeof(SPushConstantRange),sizeof(range));
+				pushConstants[i].stageFlags = static_cast<asset::IShader::E_SHADER_STAGE>(range.stageFlags);
+				pushConstants[i].offset = range.offset;
+				pushConstants[i].size = range.size;
+			}
+
+			core::smart_refctd_ptr<asset::ICPUDescriptorSetLayout> dsLayouts[asset::ICPUPipelineLayout::DESCRIPTOR_SET_COUNT];
+			for (uint32_t set=0u; set<asset::ICPUPipelineLayout::DESCRIPTOR_SET_COUNT; set++)
+			{
+				std::vector<binding_t> setBindings;
+				for (const auto& binding : bindings)
+				if (binding.set==set)
+				{
+					setBindings.push_back({
+						.binding = binding.binding,
+						.type = static_cast<asset::IDescriptor::E_TYPE>(binding.type),
+						.createFlags = static_cast<binding_t::E_CREATE_FLAGS>(binding.createFlags),
+						.stageFlags = static_cast<asset::IShader::E_SHADER_STAGE>(binding.stageFlags),
+						.count = binding.count,
+						.immutableSamplers = nullptr
+					});
+				}
+				if (!setBindings.empty())
+					dsLayouts[set] = core::make_smart_refctd_ptr<asset::ICPUDescriptorSetLayout>(setBindings.data(),setBindings.data()+setBindings.size());
+			}
+			out.layout = core::make_smart_refctd_ptr<asset::ICPUPipelineLayout>(std::span<const asset::SPushConstantRange>(pushConstants),
+				std::move(dsLayouts[0]),std::move(dsLayouts[1]),std::move(dsLayouts[2]),std::move(dsLayouts[3]));
+			return bool(out.layout);
+		}
+
+		// Through a unique temporary like `CShaderCompileCache::store`
+		inline bool store(const std::filesystem::path& path, const bool merged, const asset::ICPUPipelineLayout* layout) const
+		{
+			std::vector<SBinding> bindings;
+			std::vector<SPushConstantRange> pushConstants;
+			if (merged && layout)
+			{
+				using redirect_t = asset::ICPUDescriptorSetLayout::CBindingRedirect;
+				for (uint32_t set=0u; set<asset::ICPUPipelineLayout::DESCRIPTOR_SET_COUNT; set++)
+				{
+					const auto* dsLayout = layout->getDescriptorSetLayout(set);
+					if (!dsLayout)
+						continue;
+					for (uint32_t type=0u; type<static_cast<uint32_t>(asset::IDescriptor::E_TYPE::ET_COUNT); type++)
+					{
+						const auto& redirect = dsLayout->getDescriptorRedirect(static_cast<asset::IDescriptor::E_TYPE>(type));
+						for (uint32_t i=0u; i<redirect.getBindingCount(); i++)
+						{
+							const redirect_t::storage_range_index_t index = {i};
+							bindings.push_back({
+								.set = set,
+								.binding = redirect.getBinding(index).data,
+								.type = type,
+								.createFlags = static_cast<uint32_t>(redirect.getCreateFlags(index).value),
+								.stageFlags = static_cast<uint32_t>(redirect.getStageFlags(index).value),
+								.count = redirect.getCount(index)
+							});
+						}
+					}
+				}
+				for (const auto& range : layout->getPushConstantRanges())
+					pushConstants.push_back({static_cast<uint32_t>(range.stageFlags.value),range.offset,range.size});
+			}
+
+			SFileHeader header = {};
+			header.merged = merged && layout;
+			header.bindingCount = static_cast<uint32_t>(bindings.size());
+			header.pushConstantCount = static_cast<uint32_t>(pushConstants.size());
+
+			return writeFileAtomically(path,[&](std::ofstream& file)->void
+			{
+				file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+				file.write(reinterpret_cast<const char*>(bindings.data()),bindings.size()*sizeof(SBinding));
+				file.write(reinterpret_cast<const char*>(pushConstants.data()),pushConstants.size()*sizeof(SPushConstantRange));
+			});
+		}
+
+		core::smart_refctd_ptr<system::ISystem> m_system;
+		std::filesystem::path m_directory;
+
+		std::atomic<uint32_t> m_hits = 0u;
+		std::atomic<uint32_t> m_misses = 0u;
+		std::atomic<double> m_introspectMilliseconds = 0.0;
+		std::atomic<double> m_lookupMilliseconds = 0.0;
+};
+
+}
+
+#endif
@@ -0,0 +1,289 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_KEYFRAME_ANIMATION_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_KEYFRAME_ANIMATION_HPP_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ParallelFor.hpp"
+#include "CCPUTransformTree.hpp"
+
+namespace nbl::examples::animation
+{
+
+// glTF animation channel semantics, `target` is an index into whatever set of nodes the clip gets instanced onto (joints of a skeleton, nodes of a scene)
+enum class EPath : uint8_t
+{
+	TRANSLATION,
+	ROTATION, // quaternion as xyzw
+	SCALE
+};
+enum class EInterpolation : uint8_t
+{
+	STEP,
+	LINEAR, // slerp for rotations
+	CUBIC_SPLINE // glTF Hermite, three values per key: in-tangent, value, out-tangent
+};
+
+// One glTF animation. The keys of all channels are packed as SoA: one array of timestamps and one array of `vectorSIMDf` values
+// (xyz or quaternion xyzw), so sampling a channel streams over two dense arrays and interpolates a whole vector per SIMD op.
+class CAnimationClip
+{
+	public:
+		struct SChannel
+		{
+			uint32_t target;
+			EPath path;
+			EInterpolation interpolation;
+			uint32_t keyOffset; // into `getTimestamps()`
+			uint32_t valueOffset; // into `getValues()`
+			uint32_t keyCount;
+		};
+
+		//! `times` must be ascending, for `CUBIC_SPLINE` there have to be three `values` per key
+		inline bool addChannel(const uint32_t target, const EPath path, const EInterpolation interpolation, std::span<const float> times, std::span<const core::vectorSIMDf> values)
+		{
+			const size_t valuesPerKey = interpolation==EInterpolation::CUBIC_SPLINE ? 3ull:1ull;
+			if (times.empty() || values.size()!=times.size()*valuesPerKey || !std::is_sorted(times.begin(),times.end()))
+				return false;
+
+			auto& channel = m_channels.emplace_back();
+			channel.target = target;
+			channel.path = path;
+			channel.interpolation = interpolation;
+			channel.keyOffset = static_cast<uint32_t>(m_times.size());
+			channel.valueOffset = static_cast<uint32_t>(m_values.size());
+			channel.keyCount = static_cast<uint32_t>(times.size());
+			m_times.insert(m_times.end(),times.begin(),times.end());
+			m_values.insert(m_values.end(),values.begin(),values.end());
+
+			m_duration = std::max(m_duration,times.back());
+			if (std::find(m_targets.begin(),m_targets.end(),target)==m_targets.end())
+				m_targets.push_back(target);
+			m_targetCount = std::max(m_targetCount,target+1u);
+			return true;
+		}
+
+		inline std::span<const SChannel> getChannels() const {return m_channels;}
+		inline std::span<const float> getTimestamps() const {return m_times;}
+		// one per key, except for `CUBIC_SPLINE` channels which have three: in-tangent, value, out-tangent
+		inline std::span<const core::vectorSIMDf> getValues() const {return m_values;}
+		// distinct targets of all channels
+		inline std::span<const uint32_t> getTargets() const {return m_targets;}
+		inline uint32_t getTargetCount() const {return m_targetCount;}
+		inline float getDuration() const {return m_duration;}
+
+	protected:
+		std::vector<SChannel> m_channels;
+		std::vector<float> m_times;
+		std::vector<core::vectorSIMDf> m_values;
+		std::vector<uint32_t> m_targets;
+		uint32_t m_targetCount = 0u;
+		float m_duration = 0.f;
+};
+
+// Plays clips back onto ranges of nodes and produces their local (relative) transforms, every instance remembers the last key
+// it sampled per channel so forward playback finds the next key in O(1) instead of a binary search.
+// Instances get evaluated in parallel, so two instances must not target the same nodes.
+class CAnimationRuntime
+{
+	public:
+		using instance_t = uint32_t;
+
+		struct SPose
+		{
+			core::vectorSIMDf translation = core::vectorSIMDf(0.f,0.f,0.f,0.f);
+			core::vectorSIMDf rotation = core::vectorSIMDf(0.f,0.f,0.f,1.f);
+			core::vectorSIMDf scale = core::vectorSIMDf(1.f,1.f,1.f,0.f);
+		};
+
+		inline CAnimationRuntime(const uint32_t nodeCount) : m_poses(nodeCount), m_localTransforms(nodeCount) {}
+
+		//! Pose a node holds for the paths no channel animates
+		inline void setRestPose(const uint32_t node, const SPose& pose) {m_poses[node] = pose;}
+
+		//! Channel target `i` of `clip` drives node `firstNode+i`
+		inline instance_t addInstance(const CAnimationClip* clip, const uint32_t firstNode, const float startTime=0.f, const float speed=1.f, const bool loop=true)
+		{
+			assert(firstNode+clip->getTargetCount()<=m_poses.size());
+			auto& instance = m_instances.emplace_back();
+			instance.clip = clip;
+			instance.firstNode = firstNode;
+			instance.time = startTime;
+			instance.speed = speed;
+			instance.loop = loop;
+			instance.cursorOffset = static_cast<uint32_t>(m_cursors.size());
+			m_cursors.resize(m_cursors.size()+clip->getChannels().size(),0u);
+			return static_cast<instance_t>(m_instances.size()-1ull);
+		}
+
+		inline void setTime(const instance_t instance, const float time) {m_instances[instance].time = time;}
+		inline uint32_t getInstanceCount() const {return static_cast<uint32_t>(m_instances.size());}
+
+		//! Advances every instance's clock and samples all channels, then composes the local transform of every animated node
+		inline void evaluate(const float dt, const uint32_t workerCount=0u)
+		{
+			parallelFor(m_instances.size(),[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+			{
+				for (size_t i=begin; i<end; i++)
+					evaluateInstance(m_instances[i],dt);
+			},workerCount,InstancesPerChunk);
+		}
+
+		inline const core::matrix3x4SIMD& getLocalTransform(const uint32_t node) const {return m_localTransforms[node];}
+		inline const SPose& getPose(const uint32_t node) const {return m_poses[node];}
+
+		//! Pushes the animated nodes into a transform tree whose node `i` corresponds to our node `i+treeNodeOffset`, single threaded since the tree isn't
+		inline void apply(CCPUTransformTree& tree, const uint32_t treeNodeOffset=0u) const
+		{
+			for (const auto& instance : m_instances)
+			for (const auto target : instance.clip->getTargets())
+			{
+				const uint32_t node = instance.firstNode+target;
+				tree.setRelativeTransform(node+treeNodeOffset,m_localTransforms[node]);
+			}
+		}
+
+		// exposed for anyone sampling a single channel, `cursor` is the key the previous sample of this channel landed on
+		static inline core::vectorSIMDf sample(const CAnimationClip& clip, const CAnimationClip::SChannel& channel, const float time, uint32_t& cursor)
+		{
+			const float* times = clip.getTimestamps().data()+channel.keyOffset;
+			const uint32_t stride = channel.interpolation==EInterpolation::CUBIC_SPLINE ? 3u:1u;
+			// skip the first in-tangent, so the value of key `k` is at `k*stride`
+			const core::vectorSIMDf* values = clip.getValues().data()+channel.valueOffset+stride/2u;
+			const uint32_t lastKey = channel.keyCount-1u;
+			if (lastKey==0u || time<=times[0])
+				return values[0];
+			if (time>=times[lastKey])
+				return values[lastKey*stride];
+
+			const uint32_t k = findKey(times,channel.keyCount,time,cursor);
+			const auto& v0 = values[k*stride];
+			const auto& v1 = values[(k+1u)*stride];
+			const float keyDelta = times[k+1u]-times[k];
+			const float s = (time-times[k])/keyDelta;
+			switch (channel.interpolation)
+			{
+				case EInterpolation::STEP:
+					return v0;
+				case EInterpolation::LINEAR:
+					if (channel.path==EPath::ROTATION)
+						return slerp(v0,v1,s);
+					return v0+(v1-v0)*s;
+				default:
+				{
+					const float s2 = s*s;
+					const float s3 = s2*s;
+					const auto& outTangent = values[k*3u+1u];
+					const auto& inTangent = values[k*3u+2u];
+					auto retval = v0*(2.f*s3-3.f*s2+1.f)+outTangent*((s3-2.f*s2+s)*keyDelta)+v1*(3.f*s2-2.f*s3)+inTangent*((s3-s2)*keyDelta);
+					if (channel.path==EPath::ROTATION)
+						retval = core::normalize(retval);
+					return retval;
+				}
+			}
+		}
+
+	protected:
+		// few channels per instance in typical rigs, so chunks of instances rather than single ones keep the atomic off the profile
+		constexpr static inline size_t InstancesPerChunk = 16ull;
+
+		struct SInstance
+		{
+			const CAnimationClip* clip;
+			uint32_t firstNode;
+			uint32_t cursorOffset;
+			float time;
+			float speed;
+			bool loop;
+		};
+
+		static inline uint32_t findKey(const float* times, const uint32_t keyCount, const float time, uint32_t& cursor)
+		{
+			// playback mostly moves forward by less than a key per frame
+			if (cursor+1u<keyCount && times[cursor]<=time)
+			{
+				if (time<times[cursor+1u])
+					return cursor;
+				if (cursor+2u<keyCount && time<times[cursor+2u])
+					return ++cursor;
+			}
+			const auto* found = std::upper_bound(times,times+keyCount,time);
+			cursor = std::min(static_cast<uint32_t>(std::max<ptrdiff_t>(found-times-1,0)),keyCount-2u);
+			return cursor;
+		}
+
+		static inline core::vectorSIMDf slerp(const core::vectorSIMDf& q0, core::vectorSIMDf q1, const float t)
+		{
+			float cosTheta = core::dot(q0,q1).x;
+			// take the short way around
+			if (cosTheta<0.f)
+			{
+				q1 = q1*-1.f;
+				cosTheta = -cosTheta;
+			}
+			// nlerp when the angle is too small for the sine ratio to be stable
+			if (cosTheta>0.9995f)
+				return core::normalize(q0+(q1-q0)*t);
+			const float theta = std::acos(cosTheta);
+			const float rcpSinTheta = 1.f/std::sin(theta);
+			return q0*(std::sin((1.f-t)*theta)*rcpSinTheta)+q1*(std::sin(t*theta)*rcpSinTheta);
+		}
+
+		inline void evaluateInstance(SInstance& instance, const float dt)
+		{
+			const auto& clip = *instance.clip;
+			const float duration = clip.getDuration();
+			instance.time += dt*instance.speed;
+			if (instance.loop && duration>0.f)
+			{
+				instance.time = std::fmod(instance.time,duration);
+				if (instance.time<0.f)
+					instance.time += duration;
+			}
+
+			const auto channels = clip.getChannels();
+			uint32_t* cursors = m_cursors.data()+instance.cursorOffset;
+			for (size_t c=0; c<channels.size(); c++)
+			{
+				const auto& channel = channels[c];
+				const auto value = sample(clip,channel,instance.time,cursors[c]);
+				auto& pose = m_poses[instance.firstNode+channel.target];
+				switch (channel.path)
+				{
+					case EPath::TRANSLATION:
+						pose.translation = value;
+						break;
+					case EPath::ROTATION:
+						pose.rotation = value;
+						break;
+					default:
+						pose.scale = value;
+						break;
+				}
+			}
+			for (const auto target : clip.getTargets())
+			{
+				const uint32_t node = instance.firstNode+target;
+				const auto& pose = m_poses[node];
+				m_localTransforms[node].setScaleRotationAndTranslation(pose.scale,core::quaternion(pose.rotation.x,pose.rotation.y,pose.rotation.z,pose.rotation.w),pose.translation);
+			}
+		}
+
+		std::vector<SInstance> m_instances;
+		std::vector<uint32_t> m_cursors;
+		std::vector<SPose> m_poses;
+		std::vector<core::matrix3x4SIMD> m_localTransforms;
+};
+
+}
+
+#endif
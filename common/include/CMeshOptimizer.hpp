@@ -0,0 +1,384 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_MESH_OPTIMIZER_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_MESH_OPTIMIZER_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "ParallelFor.hpp"
+
+namespace nbl::examples
+{
+
+// Index and vertex order optimizations for indexed triangle lists, all of them keep the set of triangles and their winding intact.
+// - `optimizeVertexCache` reorders triangles for post-transform cache hits (Tipsify, Sander et al. 2007), big meshes get split into vertex range chunks optimized in parallel
+// - `optimizeOverdraw` sorts the clusters the cache optimization left behind so outward facing ones draw first, trading a little cache efficiency
+// - `optimizeVertexFetch` renumbers vertices in order of first use so the vertex fetches walk memory linearly
+class CMeshOptimizer
+{
+	public:
+		// the usual FIFO size to simulate, real hardware differs but the rankings rarely do
+		constexpr static inline uint32_t DefaultCacheSize = 16u;
+
+		struct SCacheStats
+		{
+			// Average Cache Miss Ratio, transformed vertices per triangle (0.5 is the limit for big regular grids, 3 is no reuse at all)
+			float acmr = 0.f;
+			// Average Transformed to Vertex Ratio, transformed vertices per referenced vertex (1 is optimal)
+			float atvr = 0.f;
+		};
+		static inline SCacheStats analyzeVertexCache(std::span<const uint32_t> indices, const uint32_t vertexCount, const uint32_t cacheSize=DefaultCacheSize)
+		{
+			SCacheStats retval;
+			const size_t triangleCount = indices.size()/3u;
+			if (triangleCount==0u)
+				return retval;
+
+			// FIFO simulated with timestamps, a vertex is in the cache if it got inserted less than `cacheSize` insertions ago
+			std::vector<uint32_t> insertedAt(vertexCount,0u);
+			std::vector<bool> referenced(vertexCount,false);
+			uint32_t timestamp = cacheSize+1u, misses = 0u, referencedCount = 0u;
+			for (size_t i=0u; i<triangleCount*3u; i++)
+			{
+				const uint32_t v = indices[i];
+				if (timestamp-insertedAt[v]>cacheSize)
+				{
+					insertedAt[v] = timestamp++;
+					misses++;
+				}
+				if (!referenced[v])
+				{
+					referenced[v] = true;
+					referencedCount++;
+				}
+			}
+			retval.acmr = float(misses)/float(triangleCount);
+			retval.atvr = float(misses)/float(std::max(referencedCount,1u));
+			return retval;
+		}
+
+		// Stable sort of the triangles into `chunkCount` buckets by their smallest vertex index, vertices that are close in the buffer tend to be close on
+		// the surface (that's how generators and most exporters emit them) while the triangle order can be anything, so the chunks can be processed independently.
+		// `bucketed` receives the reordered `indices` and must be as large, returns the offsets (in triangles) of the chunks, a last one being the triangle count.
+		static inline std::vector<uint32_t> bucketTrianglesByVertexRange(std::span<const uint32_t> indices, const uint32_t vertexCount, const uint32_t chunkCount, std::span<uint32_t> bucketed)
+		{
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size()/3u);
+			assert(chunkCount!=0u && bucketed.size()>=size_t(triangleCount)*3u);
+			std::vector<uint32_t> chunkOffsets(chunkCount+1u,0u);
+			const uint32_t verticesPerChunk = std::max((vertexCount+chunkCount-1u)/chunkCount,1u);
+			std::vector<uint32_t> triangleChunk(triangleCount);
+			for (uint32_t t=0u; t<triangleCount; t++)
+			{
+				const uint32_t minVertex = std::min({indices[t*3u+0u],indices[t*3u+1u],indices[t*3u+2u]});
+				triangleChunk[t] = std::min(minVertex/verticesPerChunk,chunkCount-1u);
+				chunkOffsets[triangleChunk[t]+1u]++;
+			}
+			for (uint32_t c=0u; c<chunkCount; c++)
+				chunkOffsets[c+1u] += chunkOffsets[c];
+			std::vector<uint32_t> cursor(chunkOffsets.begin(),chunkOffsets.end()-1);
+			for (uint32_t t=0u; t<triangleCount; t++)
+				std::copy_n(indices.begin()+size_t(t)*3u,3u,bucketed.begin()+size_t(cursor[triangleChunk[t]]++)*3u);
+			return chunkOffsets;
+		}
+
+		struct SVertexCacheParams
+		{
+			uint32_t cacheSize = DefaultCacheSize;
+			uint32_t workerCount = 0u;
+			// meshes bigger than this get split into chunks of about this many triangles, optimized independently
+			uint32_t chunkTriangleCount = 0x1u<<16;
+		};
+		// Reorders the triangles in `indices` in place, returns the offsets (in triangles) where Tipsify had to restart, a last one being the triangle count.
+		// Those are natural cluster boundaries for `optimizeOverdraw`.
+		static inline std::vector<uint32_t> optimizeVertexCache(std::span<uint32_t> indices, const uint32_t vertexCount) {return optimizeVertexCache(indices,vertexCount,SVertexCacheParams{});}
+		static inline std::vector<uint32_t> optimizeVertexCache(std::span<uint32_t> indices, const uint32_t vertexCount, const SVertexCacheParams& params)
+		{
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size()/3u);
+			if (triangleCount==0u)
+				return {};
+
+			const uint32_t chunkSize = std::max(params.chunkTriangleCount,1u);
+			const uint32_t chunkCount = (triangleCount+chunkSize-1u)/chunkSize;
+			if (chunkCount==1u)
+				return tipsify(indices.subspan(0u,size_t(triangleCount)*3u),vertexCount,params.cacheSize);
+
+			std::vector<uint32_t> chunkOffsets;
+			{
+				std::vector<uint32_t> bucketed(size_t(triangleCount)*3u);
+				chunkOffsets = bucketTrianglesByVertexRange(indices.subspan(0u,size_t(triangleCount)*3u),vertexCount,chunkCount,bucketed);
+				std::copy(bucketed.begin(),bucketed.end(),indices.begin());
+			}
+
+			// each chunk compacts the vertices it references so its scratch stays small
+			std::vector<std::vector<uint32_t>> chunkClusters(chunkCount);
+			parallelFor(chunkCount,[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					std::vector<uint32_t> localVertices;
+					for (size_t chunk=begin; chunk<end; chunk++)
+					{
+						const uint32_t firstTriangle = chunkOffsets[chunk];
+						const uint32_t chunkTriangles = chunkOffsets[chunk+1u]-firstTriangle;
+						if (chunkTriangles==0u)
+							continue;
+						auto chunkIndices = indices.subspan(size_t(firstTriangle)*3u,size_t(chunkTriangles)*3u);
+
+						localVertices.assign(chunkIndices.begin(),chunkIndices.end());
+						std::sort(localVertices.begin(),localVertices.end());
+						localVertices.erase(std::unique(localVertices.begin(),localVertices.end()),localVertices.end());
+						for (auto& index : chunkIndices)
+							index = static_cast<uint32_t>(std::lower_bound(localVertices.begin(),localVertices.end(),index)-localVertices.begin());
+
+						auto clusters = tipsify(chunkIndices,static_cast<uint32_t>(localVertices.size()),params.cacheSize);
+						for (auto& index : chunkIndices)
+							index = localVertices[index];
+						for (auto& offset : clusters)
+							offset += firstTriangle;
+						chunkClusters[chunk] = std::move(clusters);
+					}
+				},
+				params.workerCount,1u
+			);
+
+			std::vector<uint32_t> retval;
+			for (const auto& clusters : chunkClusters)
+				retval.insert(retval.end(),clusters.begin(),clusters.end());
+			return retval;
+		}
+
+		// Sorts the clusters (ranges of triangles ending at the offsets returned by `optimizeVertexCache`) by how much they face away from the mesh's center,
+		// so that on average the outer surfaces get drawn first and occlude what's behind them. Clusters smaller than `minClusterTriangles` get merged with
+		// the next one, as every cluster boundary costs cache misses. `positions` are the XYZ floats of each vertex, `positionStride` bytes apart.
+		static inline void optimizeOverdraw(std::span<uint32_t> indices, std::span<const uint32_t> clusterEnds, const void* positions, const size_t positionStride, const uint32_t minClusterTriangles=64u)
+		{
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size()/3u);
+			if (triangleCount==0u || clusterEnds.size()<2u)
+				return;
+
+			auto getPosition = [&](const uint32_t v) -> std::array<float,3>
+			{
+				std::array<float,3> retval;
+				std::memcpy(retval.data(),reinterpret_cast<const uint8_t*>(positions)+size_t(v)*positionStride,sizeof(retval));
+				return retval;
+			};
+
+			struct SCluster
+			{
+				uint32_t begin, end;
+				float sortKey;
+			};
+			std::vector<SCluster> clusters;
+			{
+				uint32_t begin = 0u;
+				for (const uint32_t end : clusterEnds)
+				if (end-begin>=minClusterTriangles || end==triangleCount)
+				{
+					clusters.push_back({begin,end,0.f});
+					begin = end;
+				}
+			}
+			if (clusters.size()<2u)
+				return;
+
+			// area weighted centroid of the whole mesh
+			std::array<double,3> meshCentroid = {};
+			double meshArea = 0.0;
+			std::vector<std::array<float,7>> clusterMoments(clusters.size()); // area weighted centroid, area weighted normal, area
+			for (size_t c=0u; c<clusters.size(); c++)
+			{
+				auto& moments = clusterMoments[c];
+				moments.fill(0.f);
+				for (uint32_t t=clusters[c].begin; t<clusters[c].end; t++)
+				{
+					const auto p0 = getPosition(indices[t*3u+0u]);
+					const auto p1 = getPosition(indices[t*3u+1u]);
+					const auto p2 = getPosition(indices[t*3u+2u]);
+					const std::array<float,3> e0 = {p1[0]-p0[0],p1[1]-p0[1],p1[2]-p0[2]};
+					const std::array<float,3> e1 = {p2[0]-p0[0],p2[1]-p0[1],p2[2]-p0[2]};
+					// the cross product's length is twice the area, the factor cancels out
+					const std::array<float,3> n = {e0[1]*e1[2]-e0[2]*e1[1],e0[2]*e1[0]-e0[0]*e1[2],e0[0]*e1[1]-e0[1]*e1[0]};
+					const float area = std::sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+					for (auto i=0; i<3; i++)
+					{
+						moments[i] += (p0[i]+p1[i]+p2[i])*area/3.f;
+						moments[3+i] += n[i];
+					}
+					moments[6] += area;
+				}
+				for (auto i=0; i<3; i++)
+					meshCentroid[i] += moments[i];
+				meshArea += moments[6];
+			}
+			if (meshArea<=0.0)
+				return;
+			for (auto& coord : meshCentroid)
+				coord /= meshArea;
+
+			for (size_t c=0u; c<clusters.size(); c++)
+			{
+				const auto& moments = clusterMoments[c];
+				if (moments[6]<=0.f)
+					continue;
+				float key = 0.f;
+				for (auto i=0; i<3; i++)
+					key += (moments[i]/moments[6]-float(meshCentroid[i]))*moments[3+i];
+				clusters[c].sortKey = key/moments[6];
+			}
+			std::stable_sort(clusters.begin(),clusters.end(),[](const SCluster& lhs, const SCluster& rhs)->bool{return lhs.sortKey>rhs.sortKey;});
+
+			std::vector<uint32_t> sorted;
+			sorted.reserve(indices.size());
+			for (const auto& cluster : clusters)
+				sorted.insert(sorted.end(),indices.begin()+size_t(cluster.begin)*3u,indices.begin()+size_t(cluster.end)*3u);
+			std::copy(sorted.begin(),sorted.end(),indices.begin());
+		}
+
+		// Renumbers the vertices in order of first use and rewrites `indices`, returns the old to new mapping.
+		// Unreferenced vertices keep their relative order after all the referenced ones so the vertex count doesn't change.
+		static inline std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, const uint32_t vertexCount, const uint32_t workerCount=0u)
+		{
+			constexpr uint32_t Unassigned = ~0u;
+			std::vector<uint32_t> remap(vertexCount,Unassigned);
+			uint32_t next = 0u;
+			for (const uint32_t index : indices)
+			if (remap[index]==Unassigned)
+				remap[index] = next++;
+			for (auto& newIx : remap)
+			if (newIx==Unassigned)
+				newIx = next++;
+
+			parallelFor(indices.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t i=begin; i<end; i++)
+						indices[i] = remap[indices[i]];
+				},
+				workerCount
+			);
+			return remap;
+		}
+
+		// moves every `stride` byte vertex of `vertices` to where `remap` says, in place
+		static inline void remapVertices(void* vertices, const size_t stride, std::span<const uint32_t> remap, const uint32_t workerCount=0u)
+		{
+			std::vector<uint8_t> original(remap.size()*stride);
+			std::memcpy(original.data(),vertices,original.size());
+			parallelFor(remap.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t v=begin; v<end; v++)
+						std::memcpy(reinterpret_cast<uint8_t*>(vertices)+size_t(remap[v])*stride,original.data()+v*stride,stride);
+				},
+				workerCount
+			);
+		}
+
+	private:
+		// Tipsify, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" by Sander, Nehab and Barczak.
+		// Fans around vertices, picking the next fanning vertex among the last triangles' vertices by how long they'll still be in the cache.
+		static inline std::vector<uint32_t> tipsify(std::span<uint32_t> indices, const uint32_t vertexCount, const uint32_t cacheSize)
+		{
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size()/3u);
+
+			// vertex to triangle adjacency in CSR form
+			std::vector<uint32_t> liveTriangles(vertexCount,0u);
+			for (const uint32_t index : indices)
+				liveTriangles[index]++;
+			std::vector<uint32_t> adjacencyOffsets(vertexCount+1u,0u);
+			for (uint32_t v=0u; v<vertexCount; v++)
+				adjacencyOffsets[v+1u] = adjacencyOffsets[v]+liveTriangles[v];
+			std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+			{
+				std::vector<uint32_t> cursor(adjacencyOffsets.begin(),adjacencyOffsets.end()-1);
+				for (uint32_t t=0u; t<triangleCount; t++)
+				for (uint32_t c=0u; c<3u; c++)
+					adjacency[cursor[indices[t*3u+c]]++] = t;
+			}
+
+			std::vector<uint32_t> cacheTimestamp(vertexCount,0u);
+			std::vector<bool> emitted(triangleCount,false);
+			std::vector<uint32_t> deadEnds;
+			std::vector<uint32_t> candidates;
+			std::vector<uint32_t> output;
+			output.reserve(indices.size());
+			std::vector<uint32_t> clusterEnds;
+
+			uint32_t timestamp = cacheSize+1u;
+			uint32_t scanCursor = 0u;
+			auto skipDeadEnd = [&]() -> uint32_t
+			{
+				while (!deadEnds.empty())
+				{
+					const uint32_t d = deadEnds.back();
+					deadEnds.pop_back();
+					if (liveTriangles[d])
+						return d;
+				}
+				for (; scanCursor<vertexCount; scanCursor++)
+				if (liveTriangles[scanCursor])
+					return scanCursor;
+				return ~0u;
+			};
+
+			uint32_t fanning = skipDeadEnd();
+			while (fanning!=~0u)
+			{
+				candidates.clear();
+				for (uint32_t a=adjacencyOffsets[fanning]; a<adjacencyOffsets[fanning+1u]; a++)
+				{
+					const uint32_t t = adjacency[a];
+					if (emitted[t])
+						continue;
+					emitted[t] = true;
+					for (uint32_t c=0u; c<3u; c++)
+					{
+						const uint32_t v = indices[t*3u+c];
+						output.push_back(v);
+						deadEnds.push_back(v);
+						candidates.push_back(v);
+						liveTriangles[v]--;
+						if (timestamp-cacheTimestamp[v]>cacheSize)
+							cacheTimestamp[v] = timestamp++;
+					}
+				}
+
+				// prefer the candidate that will still be in the cache after its remaining triangles get emitted and that entered it earliest
+				uint32_t next = ~0u;
+				int64_t bestPriority = -1;
+				for (const uint32_t v : candidates)
+				{
+					if (!liveTriangles[v])
+						continue;
+					int64_t priority = 0;
+					const int64_t age = int64_t(timestamp)-int64_t(cacheTimestamp[v]);
+					if (age+2*int64_t(liveTriangles[v])<=int64_t(cacheSize))
+						priority = age;
+					if (priority>bestPriority)
+					{
+						bestPriority = priority;
+						next = v;
+					}
+				}
+				if (next==~0u)
+				{
+					next = skipDeadEnd();
+					clusterEnds.push_back(static_cast<uint32_t>(output.size()/3u));
+				}
+				fanning = next;
+			}
+			assert(output.size()==indices.size());
+			std::copy(output.begin(),output.end(),indices.begin());
+			if (clusterEnds.empty() || clusterEnds.back()!=triangleCount)
+				clusterEnds.push_back(triangleCount);
+			return clusterEnds;
+		}
+};
+
+}
+
+#endif
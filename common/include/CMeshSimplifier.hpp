@@ -0,0 +1,801 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_MESH_SIMPLIFIER_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_MESH_SIMPLIFIER_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "AtomicFileWrite.hpp"
+#include "ParallelFor.hpp"
+
+namespace nbl::examples
+{
+
+// Quadric error metric edge collapse simplification and LoD chain generation.
+// Only the index buffer gets simplified, every level of a chain keeps referencing the original vertex buffer so LoDs can share it.
+class CMeshSimplifier
+{
+	public:
+		struct SMesh
+		{
+			std::span<const uint32_t> indices; // triangle list
+			const void* positions; // XYZ floats
+			size_t positionStride;
+			uint32_t vertexCount;
+		};
+
+		struct SSimplifyParams
+		{
+			// vertices on open borders never move, otherwise holes open up
+			bool lockBorders = true;
+			uint32_t workerCount = 0u;
+		};
+
+		//! Collapses edges in order of increasing quadric error until `targetIndexCount` is reached or the next collapse would exceed `targetError`.
+		// The quadric error is an area weighted RMS of plane distances, so it only estimates how far the surface moved and isn't a bound,
+		// `measureDeviation` gives the real distance. Vertices sharing a position with another (UV or normal seams) are never collapsed so
+		// attributes don't tear. Returns the new index list, the quadric error of the worst collapse goes into `outError`.
+		static inline std::vector<uint32_t> simplify(const SMesh& mesh, const size_t targetIndexCount, const float targetError, float* outError=nullptr)
+		{
+			return simplify(mesh,targetIndexCount,targetError,SSimplifyParams{},outError);
+		}
+		static inline std::vector<uint32_t> simplify(const SMesh& mesh, const size_t targetIndexCount, const float targetError, const SSimplifyParams& params, float* outError=nullptr)
+		{
+			std::vector<uint32_t> indices(mesh.indices.begin(),mesh.indices.begin()+mesh.indices.size()/3u*3u);
+			if (outError)
+				*outError = 0.f;
+			if (indices.size()<=targetIndexCount)
+				return indices;
+
+			const uint32_t vertexCount = mesh.vertexCount;
+			std::vector<vec3_t> positions(vertexCount);
+			for (uint32_t v=0u; v<vertexCount; v++)
+				std::memcpy(positions[v].data(),reinterpret_cast<const uint8_t*>(mesh.positions)+size_t(v)*mesh.positionStride,sizeof(vec3_t));
+
+			const std::vector<bool> locked = findLockedVertices(indices,positions,params.lockBorders);
+			std::vector<SQuadric> quadrics = computeQuadrics(indices,positions,params.workerCount);
+
+			const double maxCost = double(targetError)*double(targetError);
+			double reachedCost = 0.0;
+			std::vector<uint32_t> adjacencyOffsets, adjacency;
+			std::vector<SEdge> edges;
+			std::vector<uint8_t> touched(vertexCount);
+			std::vector<uint32_t> remap(vertexCount);
+			while (indices.size()>targetIndexCount)
+			{
+				const size_t triangleCount = indices.size()/3u;
+				buildAdjacency(indices,vertexCount,adjacencyOffsets,adjacency);
+
+				// every edge once, with the cheaper of its two collapse directions
+				edges.clear();
+				edges.reserve(indices.size());
+				for (size_t t=0u; t<triangleCount; t++)
+				for (uint32_t c=0u; c<3u; c++)
+				{
+					const uint32_t a = indices[t*3u+c];
+					const uint32_t b = indices[t*3u+(c+1u)%3u];
+					if (a<b || !hasEdge(indices,adjacencyOffsets,adjacency,b,a)) // interior edges show up twice
+						edges.push_back({a,b,0.0});
+				}
+				parallelFor(edges.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+					{
+						for (size_t e=begin; e<end; e++)
+						{
+							auto& edge = edges[e];
+							const double costAB = locked[edge.from] ? std::numeric_limits<double>::infinity():collapseCost(quadrics[edge.from],quadrics[edge.to],positions[edge.to]);
+							const double costBA = locked[edge.to] ? std::numeric_limits<double>::infinity():collapseCost(quadrics[edge.from],quadrics[edge.to],positions[edge.from]);
+							if (costBA<costAB)
+								std::swap(edge.from,edge.to);
+							edge.cost = std::min(costAB,costBA);
+						}
+					},
+					params.workerCount
+				);
+				edges.erase(std::remove_if(edges.begin(),edges.end(),[maxCost](const SEdge& e)->bool{return !(e.cost<=maxCost);}),edges.end());
+				if (edges.empty())
+					break;
+				std::sort(edges.begin(),edges.end(),[](const SEdge& lhs, const SEdge& rhs)->bool{return lhs.cost<rhs.cost;});
+
+				// Apply the cheapest independent collapses, a collapse freezes the 1-ring of the vertex that moves for the rest of the pass
+				// so the flip test below never runs against stale adjacency. Every collapse of an interior edge removes 2 triangles.
+				std::fill(touched.begin(),touched.end(),0u);
+				for (uint32_t v=0u; v<vertexCount; v++)
+					remap[v] = v;
+				const size_t trianglesToRemove = (indices.size()-targetIndexCount+2u)/3u;
+				size_t removed = 0u;
+				for (const auto& edge : edges)
+				{
+					if (removed>=trianglesToRemove)
+						break;
+					if (touched[edge.from] || touched[edge.to])
+						continue;
+					if (flipsTriangles(indices,adjacencyOffsets,adjacency,positions,edge.from,edge.to))
+						continue;
+					remap[edge.from] = edge.to;
+					quadrics[edge.to] += quadrics[edge.from];
+					reachedCost = std::max(reachedCost,edge.cost);
+					for (uint32_t a=adjacencyOffsets[edge.from]; a<adjacencyOffsets[edge.from+1u]; a++)
+					{
+						const uint32_t t = adjacency[a];
+						bool degenerate = false;
+						for (uint32_t c=0u; c<3u; c++)
+						{
+							touched[indices[t*3u+c]] = 1u;
+							degenerate = degenerate || indices[t*3u+c]==edge.to;
+						}
+						if (degenerate)
+							removed++;
+					}
+				}
+				if (removed==0u)
+					break;
+
+				// rewrite and drop the triangles that collapsed
+				size_t outIx = 0u;
+				for (size_t t=0u; t<triangleCount; t++)
+				{
+					const uint32_t a = remap[indices[t*3u+0u]];
+					const uint32_t b = remap[indices[t*3u+1u]];
+					const uint32_t c = remap[indices[t*3u+2u]];
+					if (a==b || b==c || c==a)
+						continue;
+					indices[outIx++] = a;
+					indices[outIx++] = b;
+					indices[outIx++] = c;
+				}
+				indices.resize(outIx);
+			}
+			if (outError)
+				*outError = static_cast<float>(std::sqrt(reachedCost));
+			return indices;
+		}
+
+		struct SLevel
+		{
+			std::vector<uint32_t> indices;
+			// largest object space distance between this level's surface and the original one, see `measureDeviation`
+			float error;
+		};
+		struct SChainParams
+		{
+			uint32_t maxLevels = 8u;
+			// each level aims for this fraction of the previous one's triangles
+			float reduction = 0.5f;
+			// relative to the diagonal of the mesh's bounding box, levels stop when they would go over it
+			float maxRelativeError = 0.05f;
+			uint32_t minTriangleCount = 32u;
+			// a level that can't get rid of at least this fraction of the previous one's triangles ends the chain
+			float minReduction = 0.1f;
+			SSimplifyParams simplify = {};
+		};
+
+		//! Level 0 is the input, then every level gets simplified from the one before
+		static inline std::vector<SLevel> buildChain(const SMesh& mesh)
+		{
+			return buildChain(mesh,SChainParams{});
+		}
+		static inline std::vector<SLevel> buildChain(const SMesh& mesh, const SChainParams& params)
+		{
+			std::vector<SLevel> chain;
+			chain.push_back({std::vector<uint32_t>(mesh.indices.begin(),mesh.indices.begin()+mesh.indices.size()/3u*3u),0.f});
+			const float maxError = computeExtent(mesh)*params.maxRelativeError;
+			while (chain.size()<params.maxLevels)
+			{
+				const auto& prev = chain.back();
+				const size_t prevTriangles = prev.indices.size()/3u;
+				if (prevTriangles<=params.minTriangleCount || prev.error>=maxError)
+					break;
+				const size_t targetTriangles = std::max<size_t>(size_t(float(prevTriangles)*params.reduction),params.minTriangleCount);
+				SMesh prevMesh = mesh;
+				prevMesh.indices = prev.indices;
+				// the quadric error only steers the collapses, the level gets measured against the original afterwards
+				auto indices = simplify(prevMesh,targetTriangles*3u,maxError-prev.error,params.simplify);
+				if (float(indices.size()/3u)>float(prevTriangles)*(1.f-params.minReduction))
+					break;
+				const float error = std::max(measureDeviation(mesh,indices,params.simplify.workerCount),prev.error);
+				if (error>maxError)
+					break;
+				chain.push_back({std::move(indices),error});
+			}
+			return chain;
+		}
+
+		//! For thousands of small meshes parallelizing over meshes beats parallelizing inside each simplification
+		static inline std::vector<std::vector<SLevel>> buildChains(std::span<const SMesh> meshes, const SChainParams& params, const uint32_t workerCount=0u)
+		{
+			std::vector<std::vector<SLevel>> retval(meshes.size());
+			SChainParams perMesh = params;
+			perMesh.simplify.workerCount = 1u;
+			parallelFor(meshes.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t m=begin; m<end; m++)
+						retval[m] = buildChain(meshes[m],perMesh);
+				},
+				workerCount,1u
+			);
+			return retval;
+		}
+
+		//! Symmetric Hausdorff distance between the surfaces of `mesh` and `simplified` (which indexes the same vertices), sampled at the vertices,
+		// edge midpoints and centroids of the triangles of both. Both directions are needed, removed detail only shows up from the original's
+		// side and big flat triangles cutting across a curved surface only from the simplified one's.
+		static inline float measureDeviation(const SMesh& mesh, std::span<const uint32_t> simplified, const uint32_t workerCount=0u)
+		{
+			std::vector<vec3_t> positions(mesh.vertexCount);
+			for (uint32_t v=0u; v<mesh.vertexCount; v++)
+				std::memcpy(positions[v].data(),reinterpret_cast<const uint8_t*>(mesh.positions)+size_t(v)*mesh.positionStride,sizeof(vec3_t));
+			const std::span<const uint32_t> original(mesh.indices.data(),mesh.indices.size()/3u*3u);
+			simplified = simplified.first(simplified.size()/3u*3u);
+			if (original.empty() || simplified.empty())
+				return 0.f;
+
+			// the simplified mesh only references the original's vertices, so both grids can span the original's bounds and all samples lie inside
+			vec3_t minVx, maxVx;
+			minVx.fill(std::numeric_limits<float>::infinity());
+			maxVx.fill(-std::numeric_limits<float>::infinity());
+			for (const uint32_t v : original)
+			for (auto c=0; c<3; c++)
+			{
+				minVx[c] = std::min(minVx[c],positions[v][c]);
+				maxVx[c] = std::max(maxVx[c],positions[v][c]);
+			}
+			const CTriangleGrid originalGrid(original,positions,minVx,maxVx);
+			const CTriangleGrid simplifiedGrid(simplified,positions,minVx,maxVx);
+			auto oneSided = [&](std::span<const uint32_t> from, const CTriangleGrid& to) -> float
+			{
+				// a vertex gets sampled by the first triangle using it, an edge by the triangle going along it in increasing index order
+				// (the other one of an interior edge goes the other way), only the midpoints of some border edges get skipped that way
+				std::vector<uint32_t> vertexOwner(positions.size(),~0u);
+				for (size_t i=from.size(); i-->0u;)
+					vertexOwner[from[i]] = static_cast<uint32_t>(i/3u);
+				std::vector<float> workerMax(workerCount ? workerCount:getDefaultWorkerCount(),0.f);
+				parallelFor(from.size()/3u,[&](const size_t begin, const size_t end, const uint32_t workerIx) -> void
+					{
+						float maxDistance = 0.f;
+						for (size_t t=begin; t<end; t++)
+						{
+							const uint32_t* tri = from.data()+t*3u;
+							for (uint32_t c=0u; c<3u; c++)
+							{
+								const vec3_t& a = positions[tri[c]];
+								if (vertexOwner[tri[c]]==t)
+									maxDistance = std::max(maxDistance,to.distance(a));
+								if (tri[c]<tri[(c+1u)%3u])
+								{
+									const vec3_t& b = positions[tri[(c+1u)%3u]];
+									maxDistance = std::max(maxDistance,to.distance({(a[0]+b[0])*0.5f,(a[1]+b[1])*0.5f,(a[2]+b[2])*0.5f}));
+								}
+							}
+							const vec3_t& a = positions[tri[0]];
+							const vec3_t& b = positions[tri[1]];
+							const vec3_t& c = positions[tri[2]];
+							maxDistance = std::max(maxDistance,to.distance({(a[0]+b[0]+c[0])/3.f,(a[1]+b[1]+c[1])/3.f,(a[2]+b[2]+c[2])/3.f}));
+						}
+						workerMax[workerIx] = std::max(workerMax[workerIx],maxDistance);
+					},
+					static_cast<uint32_t>(workerMax.size())
+				);
+				return *std::max_element(workerMax.begin(),workerMax.end());
+			};
+			return std::max(oneSided(original,simplifiedGrid),oneSided(simplified,originalGrid));
+		}
+
+		//! Picks the coarsest level whose error projects to at most `maxPixelError` pixels, `pixelsPerUnit` is the projection's
+		// scale at unit distance, `screenHeight/(2*tan(fovY/2))` for a perspective camera.
+		static inline uint32_t selectLevel(std::span<const SLevel> chain, const float distance, const float pixelsPerUnit, const float maxPixelError)
+		{
+			for (uint32_t level=static_cast<uint32_t>(chain.size()); level-->1u;)
+			if (chain[level].error*pixelsPerUnit<=maxPixelError*distance)
+				return level;
+			return 0u;
+		}
+
+		//! Hashes everything `buildChain` depends on, the key for `CChainCache`
+		static inline uint64_t hashMesh(const SMesh& mesh, const SChainParams& params)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			auto update = [&hash](const void* data, const size_t size) -> void
+			{
+				const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+				for (size_t i=0u; i<size; i++)
+				{
+					hash ^= bytes[i];
+					hash *= 0x100000001b3ull;
+				}
+			};
+			update(mesh.indices.data(),mesh.indices.size_bytes());
+			for (uint32_t v=0u; v<mesh.vertexCount; v++)
+				update(reinterpret_cast<const uint8_t*>(mesh.positions)+size_t(v)*mesh.positionStride,sizeof(vec3_t));
+			const float paramValues[] = {float(params.maxLevels),params.reduction,params.maxRelativeError,float(params.minTriangleCount),params.minReduction,params.simplify.lockBorders ? 1.f:0.f};
+			update(paramValues,sizeof(paramValues));
+			return hash;
+		}
+
+		// One file per mesh content hash, so loading a scene full of already seen meshes never simplifies anything.
+		class CChainCache
+		{
+			public:
+				inline CChainCache(const std::filesystem::path& directory) : m_directory(directory)
+				{
+					std::error_code ec;
+					std::filesystem::create_directories(m_directory,ec);
+				}
+
+				inline std::optional<std::vector<SLevel>> load(const uint64_t key) const
+				{
+					std::ifstream file(getPath(key),std::ios::binary);
+					if (!file)
+						return std::nullopt;
+					SFileHeader header = {};
+					if (!file.read(reinterpret_cast<char*>(&header),sizeof(header)) || header.magic!=SFileHeader::Magic || header.version!=SFileHeader::Version || header.key!=key)
+						return std::nullopt;
+					std::vector<SLevel> chain(header.levelCount);
+					for (auto& level : chain)
+					{
+						uint32_t indexCount = 0u;
+						if (!file.read(reinterpret_cast<char*>(&indexCount),sizeof(indexCount)) || !file.read(reinterpret_cast<char*>(&level.error),sizeof(level.error)))
+							return std::nullopt;
+						level.indices.resize(indexCount);
+						if (!file.read(reinterpret_cast<char*>(level.indices.data()),sizeof(uint32_t)*indexCount))
+							return std::nullopt;
+					}
+					return chain;
+				}
+
+				// goes through a unique temporary so concurrent writers of the same key (other processes, or duplicate meshes in one `getOrBuild`)
+				// and crashes never leave a truncated file under the real name
+				inline bool store(const uint64_t key, std::span<const SLevel> chain) const
+				{
+					return writeFileAtomically(getPath(key),[&](std::ofstream& file)->void
+					{
+						SFileHeader header = {};
+						header.levelCount = static_cast<uint32_t>(chain.size());
+						header.key = key;
+						file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+						for (const auto& level : chain)
+						{
+							const uint32_t indexCount = static_cast<uint32_t>(level.indices.size());
+							file.write(reinterpret_cast<const char*>(&indexCount),sizeof(indexCount));
+							file.write(reinterpret_cast<const char*>(&level.error),sizeof(level.error));
+							file.write(reinterpret_cast<const char*>(level.indices.data()),sizeof(uint32_t)*indexCount);
+						}
+					});
+				}
+
+				//! Loads every chain it can and builds the rest in parallel (saving them), `hits` counts the meshes that came from disk
+				inline std::vector<std::vector<SLevel>> getOrBuild(std::span<const SMesh> meshes, const SChainParams& params, const uint32_t workerCount=0u, uint32_t* hits=nullptr) const
+				{
+					std::vector<std::vector<SLevel>> retval(meshes.size());
+					std::vector<uint8_t> hit(meshes.size());
+					parallelFor(meshes.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+						{
+							SChainParams perMesh = params;
+							perMesh.simplify.workerCount = 1u;
+							for (size_t m=begin; m<end; m++)
+							{
+								const uint64_t key = hashMesh(meshes[m],params);
+								if (auto cached=load(key); cached)
+								{
+									retval[m] = std::move(*cached);
+									hit[m] = 1u;
+									continue;
+								}
+								retval[m] = buildChain(meshes[m],perMesh);
+								store(key,retval[m]);
+							}
+						},
+						workerCount,1u
+					);
+					if (hits)
+						*hits = static_cast<uint32_t>(std::count(hit.begin(),hit.end(),1u));
+					return retval;
+				}
+
+			private:
+				struct SFileHeader
+				{
+					constexpr static inline uint32_t Magic = 0x444f4c4eu; // "NLOD"
+					constexpr static inline uint32_t Version = 2u;
+
+					uint32_t magic = Magic;
+					uint32_t version = Version;
+					uint32_t levelCount = 0u;
+					uint32_t pad = 0u;
+					uint64_t key = 0ull;
+				};
+
+				inline std::filesystem::path getPath(const uint64_t key) const
+				{
+					constexpr char HexDigits[] = "0123456789abcdef";
+					std::string name(16u,'0');
+					for (uint32_t i=0u; i<16u; i++)
+						name[15u-i] = HexDigits[(key>>(i*4u))&0xfu];
+					return m_directory/(name+".lod");
+				}
+
+				std::filesystem::path m_directory;
+		};
+
+	private:
+		using vec3_t = std::array<float,3>;
+
+		// symmetric 4x4 plane quadric, weighted by triangle area and normalized by the total weight when evaluated
+		struct SQuadric
+		{
+			inline SQuadric& operator+=(const SQuadric& other)
+			{
+				for (uint32_t i=0u; i<10u; i++)
+					q[i] += other.q[i];
+				weight += other.weight;
+				return *this;
+			}
+
+			// a^2, ab, ac, ad, b^2, bc, bd, c^2, cd, d^2
+			double q[10] = {};
+			double weight = 0.0;
+		};
+		struct SEdge
+		{
+			uint32_t from, to;
+			double cost;
+		};
+
+		// Uniform grid over the triangles' bounding boxes for closest point queries, cells are about as big as the triangles.
+		// Queries need to lie within `[minVx,maxVx]`, which has to contain the triangles.
+		class CTriangleGrid
+		{
+			public:
+				inline CTriangleGrid(std::span<const uint32_t> indices, std::span<const vec3_t> positions, const vec3_t& minVx, const vec3_t& maxVx) : m_indices(indices), m_positions(positions), m_min(minVx)
+				{
+					const size_t triangleCount = indices.size()/3u;
+					const float extent = std::max({maxVx[0]-m_min[0],maxVx[1]-m_min[1],maxVx[2]-m_min[2]});
+					// surfaces only fill a fraction of the cells, so size them after the triangles rather than their count (which only caps the cell count)
+					double triangleExtentSum = 0.0;
+					for (size_t t=0u; t<triangleCount; t++)
+					for (auto c=0; c<3; c++)
+					{
+						const float a = positions[indices[t*3u+0u]][c], b = positions[indices[t*3u+1u]][c], d = positions[indices[t*3u+2u]][c];
+						triangleExtentSum += std::max({a,b,d})-std::min({a,b,d});
+					}
+					m_cellSize = std::max(float(triangleExtentSum/double(triangleCount*3u)),extent/std::cbrt(float(triangleCount)*8.f));
+					if (!(m_cellSize>0.f))
+						m_cellSize = 1.f;
+					for (auto c=0; c<3; c++)
+						m_resolution[c] = static_cast<int32_t>((maxVx[c]-m_min[c])/m_cellSize)+1;
+
+					// counting sort of the triangles into every cell their bounding box touches
+					m_cellOffsets.assign(size_t(m_resolution[0])*m_resolution[1]*m_resolution[2]+1u,0u);
+					auto forEachCell = [&](const size_t t, auto f) -> void
+					{
+						std::array<int32_t,3> lo, hi;
+						for (auto c=0; c<3; c++)
+						{
+							const float a = positions[indices[t*3u+0u]][c], b = positions[indices[t*3u+1u]][c], d = positions[indices[t*3u+2u]][c];
+							lo[c] = cellCoord(std::min({a,b,d}),c);
+							hi[c] = cellCoord(std::max({a,b,d}),c);
+						}
+						for (int32_t z=lo[2]; z<=hi[2]; z++)
+						for (int32_t y=lo[1]; y<=hi[1]; y++)
+						for (int32_t x=lo[0]; x<=hi[0]; x++)
+							f(flatCell(x,y,z));
+					};
+					for (size_t t=0u; t<triangleCount; t++)
+						forEachCell(t,[&](const size_t cell)->void{m_cellOffsets[cell+1u]++;});
+					for (size_t i=1u; i<m_cellOffsets.size(); i++)
+						m_cellOffsets[i] += m_cellOffsets[i-1u];
+					m_cellTriangles.resize(m_cellOffsets.back());
+					std::vector<uint32_t> cursor(m_cellOffsets.begin(),m_cellOffsets.end()-1);
+					for (size_t t=0u; t<triangleCount; t++)
+						forEachCell(t,[&](const size_t cell)->void{m_cellTriangles[cursor[cell]++] = static_cast<uint32_t>(t);});
+				}
+
+				// visits shells of cells around `p` until none of the remaining ones can be closer than what was found
+				inline float distance(const vec3_t& p) const
+				{
+					const std::array<int32_t,3> center = {cellCoord(p[0],0),cellCoord(p[1],1),cellCoord(p[2],2)};
+					const int32_t maxRing = std::max({m_resolution[0],m_resolution[1],m_resolution[2]});
+					float bestSq = std::numeric_limits<float>::infinity();
+					for (int32_t ring=0; ring<=maxRing; ring++)
+					{
+						// the shell lies outside the cube of cells the previous shells covered, so it's at least as far as that cube's closest face
+						if (ring>0)
+						{
+							float shellDistance = std::numeric_limits<float>::infinity();
+							for (auto c=0; c<3; c++)
+							{
+								const float lo = m_min[c]+float(center[c]-ring+1)*m_cellSize;
+								shellDistance = std::min({shellDistance,p[c]-lo,lo+float(2*ring-1)*m_cellSize-p[c]});
+							}
+							if (shellDistance*shellDistance>=bestSq)
+								break;
+						}
+						for (int32_t z=center[2]-ring; z<=center[2]+ring; z++)
+						for (int32_t y=center[1]-ring; y<=center[1]+ring; y++)
+						for (int32_t x=center[0]-ring; x<=center[0]+ring; x++)
+						{
+							if (std::max({std::abs(x-center[0]),std::abs(y-center[1]),std::abs(z-center[2])})!=ring)
+								continue;
+							if (x<0 || y<0 || z<0 || x>=m_resolution[0] || y>=m_resolution[1] || z>=m_resolution[2])
+								continue;
+							if (distanceSqToCell(p,{x,y,z})>=bestSq)
+								continue;
+							const size_t cell = flatCell(x,y,z);
+							for (uint32_t i=m_cellOffsets[cell]; i<m_cellOffsets[cell+1u]; i++)
+							{
+								const uint32_t t = m_cellTriangles[i];
+								bestSq = std::min(bestSq,distanceSqToTriangle(p,m_positions[m_indices[t*3u+0u]],m_positions[m_indices[t*3u+1u]],m_positions[m_indices[t*3u+2u]]));
+							}
+						}
+					}
+					return std::sqrt(bestSq);
+				}
+
+			private:
+				inline int32_t cellCoord(const float x, const int32_t axis) const
+				{
+					return std::clamp(static_cast<int32_t>((x-m_min[axis])/m_cellSize),0,m_resolution[axis]-1);
+				}
+				inline size_t flatCell(const int32_t x, const int32_t y, const int32_t z) const
+				{
+					return (size_t(z)*m_resolution[1]+y)*m_resolution[0]+x;
+				}
+				inline float distanceSqToCell(const vec3_t& p, const std::array<int32_t,3>& cell) const
+				{
+					float retval = 0.f;
+					for (auto c=0; c<3; c++)
+					{
+						const float lo = m_min[c]+float(cell[c])*m_cellSize;
+						const float d = std::max({lo-p[c],p[c]-lo-m_cellSize,0.f});
+						retval += d*d;
+					}
+					return retval;
+				}
+
+				std::span<const uint32_t> m_indices;
+				std::span<const vec3_t> m_positions;
+				vec3_t m_min;
+				float m_cellSize;
+				std::array<int32_t,3> m_resolution;
+				std::vector<uint32_t> m_cellOffsets;
+				std::vector<uint32_t> m_cellTriangles;
+		};
+
+		// closest point on a triangle by the Voronoi region it falls into, Real-Time Collision Detection 5.1.5
+		static inline float distanceSqToTriangle(const vec3_t& p, const vec3_t& a, const vec3_t& b, const vec3_t& c)
+		{
+			auto sub = [](const vec3_t& x, const vec3_t& y) -> vec3_t {return {x[0]-y[0],x[1]-y[1],x[2]-y[2]};};
+			auto dot = [](const vec3_t& x, const vec3_t& y) -> float {return x[0]*y[0]+x[1]*y[1]+x[2]*y[2];};
+			auto distanceSq = [&](const vec3_t& q) -> float {const vec3_t d = sub(p,q); return dot(d,d);};
+			auto along = [](const vec3_t& o, const vec3_t& x, const float s, const vec3_t& y, const float t) -> vec3_t
+			{
+				return {o[0]+x[0]*s+y[0]*t,o[1]+x[1]*s+y[1]*t,o[2]+x[2]*s+y[2]*t};
+			};
+
+			const vec3_t ab = sub(b,a), ac = sub(c,a), ap = sub(p,a);
+			const float d1 = dot(ab,ap), d2 = dot(ac,ap);
+			if (d1<=0.f && d2<=0.f)
+				return distanceSq(a);
+			const vec3_t bp = sub(p,b);
+			const float d3 = dot(ab,bp), d4 = dot(ac,bp);
+			if (d3>=0.f && d4<=d3)
+				return distanceSq(b);
+			const float vc = d1*d4-d3*d2;
+			if (vc<=0.f && d1>=0.f && d3<=0.f)
+				return distanceSq(along(a,ab,d1/(d1-d3),ac,0.f));
+			const vec3_t cp = sub(p,c);
+			const float d5 = dot(ab,cp), d6 = dot(ac,cp);
+			if (d6>=0.f && d5<=d6)
+				return distanceSq(c);
+			const float vb = d5*d2-d1*d6;
+			if (vb<=0.f && d2>=0.f && d6<=0.f)
+				return distanceSq(along(a,ab,0.f,ac,d2/(d2-d6)));
+			const float va = d3*d6-d5*d4;
+			if (va<=0.f && (d4-d3)>=0.f && (d5-d6)>=0.f)
+			{
+				const float w = (d4-d3)/((d4-d3)+(d5-d6));
+				return distanceSq(along(b,sub(c,b),w,ab,0.f));
+			}
+			const float denom = va+vb+vc;
+			if (!(denom>0.f)) // degenerate, the vertices were already covered above
+				return std::min({distanceSq(a),distanceSq(b),distanceSq(c)});
+			return distanceSq(along(a,ab,vb/denom,ac,vc/denom));
+		}
+
+		static inline float computeExtent(const SMesh& mesh)
+		{
+			vec3_t minVx, maxVx;
+			minVx.fill(std::numeric_limits<float>::infinity());
+			maxVx.fill(-std::numeric_limits<float>::infinity());
+			for (const uint32_t v : mesh.indices)
+			{
+				vec3_t p;
+				std::memcpy(p.data(),reinterpret_cast<const uint8_t*>(mesh.positions)+size_t(v)*mesh.positionStride,sizeof(p));
+				for (auto c=0; c<3; c++)
+				{
+					minVx[c] = std::min(minVx[c],p[c]);
+					maxVx[c] = std::max(maxVx[c],p[c]);
+				}
+			}
+			if (mesh.indices.empty())
+				return 0.f;
+			const float dx = maxVx[0]-minVx[0], dy = maxVx[1]-minVx[1], dz = maxVx[2]-minVx[2];
+			return std::sqrt(dx*dx+dy*dy+dz*dz);
+		}
+
+		static inline double collapseCost(const SQuadric& a, const SQuadric& b, const vec3_t& p)
+		{
+			const double x = p[0], y = p[1], z = p[2];
+			double cost = 0.0;
+			for (const SQuadric* quadric : {&a,&b})
+			{
+				const double* q = quadric->q;
+				cost += q[0]*x*x+2.0*q[1]*x*y+2.0*q[2]*x*z+2.0*q[3]*x+q[4]*y*y+2.0*q[5]*y*z+2.0*q[6]*y+q[7]*z*z+2.0*q[8]*z+q[9];
+			}
+			const double weight = a.weight+b.weight;
+			return weight>0.0 ? std::max(cost/weight,0.0):0.0;
+		}
+
+		static inline vec3_t triangleNormal(const vec3_t& a, const vec3_t& b, const vec3_t& c)
+		{
+			const vec3_t e0 = {b[0]-a[0],b[1]-a[1],b[2]-a[2]};
+			const vec3_t e1 = {c[0]-a[0],c[1]-a[1],c[2]-a[2]};
+			return {e0[1]*e1[2]-e0[2]*e1[1],e0[2]*e1[0]-e0[0]*e1[2],e0[0]*e1[1]-e0[1]*e1[0]};
+		}
+
+		// vertices on seams (another vertex has the same position) and, optionally, open borders
+		static inline std::vector<bool> findLockedVertices(std::span<const uint32_t> indices, std::span<const vec3_t> positions, const bool lockBorders)
+		{
+			const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+			std::vector<uint32_t> sorted(vertexCount);
+			for (uint32_t v=0u; v<vertexCount; v++)
+				sorted[v] = v;
+			auto lessPosition = [&](const uint32_t lhs, const uint32_t rhs) -> bool
+			{
+				return std::memcmp(positions[lhs].data(),positions[rhs].data(),sizeof(vec3_t))<0;
+			};
+			std::sort(sorted.begin(),sorted.end(),lessPosition);
+			std::vector<uint32_t> positionID(vertexCount);
+			std::vector<bool> locked(vertexCount,false);
+			for (uint32_t i=0u, id=0u; i<vertexCount; id++)
+			{
+				uint32_t j = i+1u;
+				while (j<vertexCount && !lessPosition(sorted[i],sorted[j]))
+					j++;
+				for (uint32_t k=i; k<j; k++)
+				{
+					positionID[sorted[k]] = id;
+					locked[sorted[k]] = j-i>1u;
+				}
+				i = j;
+			}
+			if (lockBorders)
+			{
+				// an edge is on a border if its reverse doesn't exist, compare welded positions so seams don't count
+				std::vector<uint64_t> directed;
+				directed.reserve(indices.size());
+				for (size_t t=0u; t<indices.size()/3u; t++)
+				for (uint32_t c=0u; c<3u; c++)
+					directed.push_back((uint64_t(positionID[indices[t*3u+c]])<<32)|positionID[indices[t*3u+(c+1u)%3u]]);
+				std::vector<uint64_t> sortedDirected = directed;
+				std::sort(sortedDirected.begin(),sortedDirected.end());
+				for (size_t t=0u; t<indices.size()/3u; t++)
+				for (uint32_t c=0u; c<3u; c++)
+				{
+					const uint64_t edge = directed[t*3u+c];
+					const uint64_t reverse = (edge<<32)|(edge>>32);
+					if (!std::binary_search(sortedDirected.begin(),sortedDirected.end(),reverse))
+					{
+						locked[indices[t*3u+c]] = true;
+						locked[indices[t*3u+(c+1u)%3u]] = true;
+					}
+				}
+			}
+			return locked;
+		}
+
+		static inline std::vector<SQuadric> computeQuadrics(std::span<const uint32_t> indices, std::span<const vec3_t> positions, const uint32_t workerCount)
+		{
+			const size_t triangleCount = indices.size()/3u;
+			std::vector<SQuadric> triangleQuadrics(triangleCount);
+			parallelFor(triangleCount,[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t t=begin; t<end; t++)
+					{
+						const vec3_t& p0 = positions[indices[t*3u+0u]];
+						const vec3_t n = triangleNormal(p0,positions[indices[t*3u+1u]],positions[indices[t*3u+2u]]);
+						const double len = std::sqrt(double(n[0])*n[0]+double(n[1])*n[1]+double(n[2])*n[2]);
+						if (len<=0.0)
+							continue;
+						const double a = n[0]/len, b = n[1]/len, c = n[2]/len;
+						const double d = -(a*p0[0]+b*p0[1]+c*p0[2]);
+						const double area = len*0.5;
+						auto& q = triangleQuadrics[t];
+						const double plane[4] = {a,b,c,d};
+						for (uint32_t i=0u, k=0u; i<4u; i++)
+						for (uint32_t j=i; j<4u; j++)
+							q.q[k++] = plane[i]*plane[j]*area;
+						q.weight = area;
+					}
+				},
+				workerCount
+			);
+			// gather instead of scatter so the vertices can go wide without atomics
+			std::vector<uint32_t> adjacencyOffsets, adjacency;
+			buildAdjacency(indices,static_cast<uint32_t>(positions.size()),adjacencyOffsets,adjacency);
+			std::vector<SQuadric> retval(positions.size());
+			parallelFor(positions.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t v=begin; v<end; v++)
+					for (uint32_t a=adjacencyOffsets[v]; a<adjacencyOffsets[v+1u]; a++)
+						retval[v] += triangleQuadrics[adjacency[a]];
+				},
+				workerCount
+			);
+			return retval;
+		}
+
+		static inline void buildAdjacency(std::span<const uint32_t> indices, const uint32_t vertexCount, std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency)
+		{
+			offsets.assign(vertexCount+1u,0u);
+			for (const uint32_t v : indices)
+				offsets[v+1u]++;
+			for (uint32_t v=0u; v<vertexCount; v++)
+				offsets[v+1u] += offsets[v];
+			adjacency.resize(indices.size());
+			std::vector<uint32_t> cursor(offsets.begin(),offsets.end()-1);
+			for (size_t i=0u; i<indices.size(); i++)
+				adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i/3u);
+		}
+
+		// whether some triangle has the directed edge `a->b`
+		static inline bool hasEdge(std::span<const uint32_t> indices, std::span<const uint32_t> offsets, std::span<const uint32_t> adjacency, const uint32_t a, const uint32_t b)
+		{
+			for (uint32_t i=offsets[a]; i<offsets[a+1u]; i++)
+			{
+				const uint32_t t = adjacency[i];
+				for (uint32_t c=0u; c<3u; c++)
+				if (indices[t*3u+c]==a && indices[t*3u+(c+1u)%3u]==b)
+					return true;
+			}
+			return false;
+		}
+
+		// moving `from` onto `to` must not turn any of the surviving triangles around `from` over
+		static inline bool flipsTriangles(std::span<const uint32_t> indices, std::span<const uint32_t> offsets, std::span<const uint32_t> adjacency, std::span<const vec3_t> positions, const uint32_t from, const uint32_t to)
+		{
+			for (uint32_t i=offsets[from]; i<offsets[from+1u]; i++)
+			{
+				const uint32_t t = adjacency[i];
+				const uint32_t* tri = indices.data()+t*3u;
+				if (tri[0]==to || tri[1]==to || tri[2]==to)
+					continue; // collapses away
+				vec3_t moved[3];
+				for (uint32_t c=0u; c<3u; c++)
+					moved[c] = positions[tri[c]==from ? to:tri[c]];
+				const vec3_t before = triangleNormal(positions[tri[0]],positions[tri[1]],positions[tri[2]]);
+				const vec3_t after = triangleNormal(moved[0],moved[1],moved[2]);
+				// also rejects collapses that produce slivers with no area
+				const float dp = before[0]*after[0]+before[1]*after[1]+before[2]*after[2];
+				const float lenProduct = std::sqrt((before[0]*before[0]+before[1]*before[1]+before[2]*before[2])*(after[0]*after[0]+after[1]*after[1]+after[2]*after[2]));
+				if (!(dp>lenProduct*0.25f))
+					return true;
+			}
+			return false;
+		}
+};
+
+}
+
+#endif
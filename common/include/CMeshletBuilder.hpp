@@ -0,0 +1,517 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_MESHLET_BUILDER_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_MESHLET_BUILDER_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "CMeshOptimizer.hpp"
+#include "ParallelFor.hpp"
+
+namespace nbl::examples
+{
+
+// Splits indexed triangle lists into clusters small enough for mesh shaders and cluster culling.
+// Clusters reference at most `MaxVertices` vertices of the original vertex buffer and address them with 8 bit local indices.
+class CMeshletBuilder
+{
+	public:
+		constexpr static inline uint32_t MaxVertices = 64u;
+		// 124 and not 128 so that the 8 bit triangle list of a full cluster fits in 372 bytes, a multiple of 4 (common mesh shader output limit)
+		constexpr static inline uint32_t MaxTriangles = 124u;
+
+		struct SMeshlet
+		{
+			uint32_t vertexOffset; // into `SMeshlets::vertices`
+			uint32_t triangleOffset; // into `SMeshlets::triangles`, in triangles
+			uint32_t vertexCount;
+			uint32_t triangleCount;
+		};
+
+		// Everything cluster culling needs, in world units if the positions were
+		struct SBounds
+		{
+			// bounding sphere for frustum and occlusion culling
+			float center[3];
+			float radius;
+			float aabbMin[3];
+			// normal cone for backface culling, the cluster is backfacing if `dot(normalize(coneApex-cameraPosition),coneAxis)>=coneCutoff`
+			float coneCutoff;
+			float aabbMax[3];
+			float pad;
+			float coneApex[3];
+			float pad1;
+			float coneAxis[3];
+			float pad2;
+		};
+
+		struct SMeshlets
+		{
+			std::vector<SMeshlet> meshlets;
+			std::vector<SBounds> bounds;
+			// global vertex indices, `SMeshlet::vertexCount` per meshlet
+			std::vector<uint32_t> vertices;
+			// local vertex indices, three per triangle
+			std::vector<std::array<uint8_t,3>> triangles;
+		};
+
+		struct SBuildParams
+		{
+			uint32_t maxVertices = MaxVertices;
+			uint32_t maxTriangles = MaxTriangles;
+			uint32_t workerCount = 0u;
+			// meshes bigger than this get split into chunks of about this many triangles which get clustered independently
+			uint32_t chunkTriangleCount = 0x1u<<15;
+		};
+
+		//! `indices` are a triangle list, `positions` the XYZ floats of each vertex `positionStride` bytes apart.
+		// Clusters grow greedily through shared vertices, so a vertex cache optimized index order (see `CMeshOptimizer`) gives better filled clusters.
+		static inline SMeshlets build(std::span<const uint32_t> indices, const void* positions, const size_t positionStride, const uint32_t vertexCount)
+		{
+			return build(indices,positions,positionStride,vertexCount,SBuildParams{});
+		}
+		static inline SMeshlets build(std::span<const uint32_t> indices, const void* positions, const size_t positionStride, const uint32_t vertexCount, const SBuildParams& params)
+		{
+			SBuildParams validated = params;
+			validated.maxVertices = std::clamp(params.maxVertices,3u,255u); // 0xff marks vertices not in the cluster
+			validated.maxTriangles = std::clamp(params.maxTriangles,1u,512u);
+
+			SMeshlets retval;
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size()/3u);
+			if (triangleCount==0u)
+				return retval;
+
+			// same vertex range bucketing as `CMeshOptimizer::optimizeVertexCache`, chunks keep the relative order of their triangles
+			const uint32_t chunkSize = std::max(validated.chunkTriangleCount,validated.maxTriangles);
+			const uint32_t chunkCount = (triangleCount+chunkSize-1u)/chunkSize;
+			std::vector<uint32_t> chunkOffsets = {0u,triangleCount};
+			std::vector<uint32_t> bucketed;
+			std::span<const uint32_t> chunkedIndices = indices.subspan(0u,size_t(triangleCount)*3u);
+			if (chunkCount>1u)
+			{
+				bucketed.resize(size_t(triangleCount)*3u);
+				chunkOffsets = CMeshOptimizer::bucketTrianglesByVertexRange(chunkedIndices,vertexCount,chunkCount,bucketed);
+				chunkedIndices = bucketed;
+			}
+
+			std::vector<SMeshlets> chunkMeshlets(chunkCount);
+			parallelFor(chunkCount,[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t chunk=begin; chunk<end; chunk++)
+					{
+						const uint32_t firstTriangle = chunkOffsets[chunk];
+						const uint32_t chunkTriangles = chunkOffsets[chunk+1u]-firstTriangle;
+						if (chunkTriangles)
+							chunkMeshlets[chunk] = buildChunk(chunkedIndices.subspan(size_t(firstTriangle)*3u,size_t(chunkTriangles)*3u),positions,positionStride,validated);
+					}
+				},
+				validated.workerCount,1u
+			);
+
+			// concatenate, rebasing the offsets
+			{
+				size_t meshletCount = 0u, vertexRefCount = 0u, localTriangleCount = 0u;
+				for (const auto& chunk : chunkMeshlets)
+				{
+					meshletCount += chunk.meshlets.size();
+					vertexRefCount += chunk.vertices.size();
+					localTriangleCount += chunk.triangles.size();
+				}
+				retval.meshlets.reserve(meshletCount);
+				retval.vertices.reserve(vertexRefCount);
+				retval.triangles.reserve(localTriangleCount);
+				for (const auto& chunk : chunkMeshlets)
+				{
+					const uint32_t vertexBase = static_cast<uint32_t>(retval.vertices.size());
+					const uint32_t triangleBase = static_cast<uint32_t>(retval.triangles.size());
+					for (auto meshlet : chunk.meshlets)
+					{
+						meshlet.vertexOffset += vertexBase;
+						meshlet.triangleOffset += triangleBase;
+						retval.meshlets.push_back(meshlet);
+					}
+					retval.vertices.insert(retval.vertices.end(),chunk.vertices.begin(),chunk.vertices.end());
+					retval.triangles.insert(retval.triangles.end(),chunk.triangles.begin(),chunk.triangles.end());
+				}
+			}
+
+			retval.bounds.resize(retval.meshlets.size());
+			parallelFor(retval.meshlets.size(),[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t m=begin; m<end; m++)
+						retval.bounds[m] = computeBounds(retval,retval.meshlets[m],positions,positionStride);
+				},
+				validated.workerCount
+			);
+			return retval;
+		}
+
+		// the CPU side of the cone test in `SBounds`, for when the culling isn't done on the GPU
+		static inline bool isBackfacing(const SBounds& bounds, const float cameraPosition[3])
+		{
+			if (bounds.coneCutoff>=1.f)
+				return false;
+			float dir[3], len2 = 0.f;
+			for (auto i=0; i<3; i++)
+			{
+				dir[i] = bounds.coneApex[i]-cameraPosition[i];
+				len2 += dir[i]*dir[i];
+			}
+			if (len2<=0.f)
+				return false;
+			const float rcpLen = 1.f/std::sqrt(len2);
+			return (dir[0]*bounds.coneAxis[0]+dir[1]*bounds.coneAxis[1]+dir[2]*bounds.coneAxis[2])*rcpLen>=bounds.coneCutoff;
+		}
+
+	private:
+		using vec3_t = std::array<float,3>;
+
+		static inline vec3_t getPosition(const void* positions, const size_t stride, const uint32_t v)
+		{
+			vec3_t retval;
+			std::memcpy(retval.data(),reinterpret_cast<const uint8_t*>(positions)+size_t(v)*stride,sizeof(retval));
+			return retval;
+		}
+
+		// Greedy growth: the next triangle is the one adjacent to the current cluster that adds the fewest new vertices, ties broken by how enclosed it is and then distance to the cluster's centroid.
+		// When nothing adjacent fits, the cluster gets closed and the next one is seeded right next to it, or at the first triangle not emitted yet.
+		static inline SMeshlets buildChunk(std::span<const uint32_t> indices, const void* positions, const size_t positionStride, const SBuildParams& params)
+		{
+			SMeshlets retval;
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size()/3u);
+
+			// compact the vertices so all the per vertex scratch is chunk sized
+			std::vector<uint32_t> globalVertices(indices.begin(),indices.end());
+			std::sort(globalVertices.begin(),globalVertices.end());
+			globalVertices.erase(std::unique(globalVertices.begin(),globalVertices.end()),globalVertices.end());
+			const uint32_t vertexCount = static_cast<uint32_t>(globalVertices.size());
+			std::vector<uint32_t> local(indices.size());
+			for (size_t i=0u; i<indices.size(); i++)
+				local[i] = static_cast<uint32_t>(std::lower_bound(globalVertices.begin(),globalVertices.end(),indices[i])-globalVertices.begin());
+
+			std::vector<uint32_t> adjacencyOffsets(vertexCount+1u,0u);
+			for (const uint32_t v : local)
+				adjacencyOffsets[v+1u]++;
+			for (uint32_t v=0u; v<vertexCount; v++)
+				adjacencyOffsets[v+1u] += adjacencyOffsets[v];
+			std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+			{
+				std::vector<uint32_t> cursor(adjacencyOffsets.begin(),adjacencyOffsets.end()-1);
+				for (uint32_t t=0u; t<triangleCount; t++)
+				for (uint32_t c=0u; c<3u; c++)
+					adjacency[cursor[local[t*3u+c]]++] = t;
+			}
+
+			std::vector<vec3_t> vertexPositions(vertexCount);
+			for (uint32_t v=0u; v<vertexCount; v++)
+				vertexPositions[v] = getPosition(positions,positionStride,globalVertices[v]);
+			std::vector<vec3_t> triangleCentroids(triangleCount);
+			for (uint32_t t=0u; t<triangleCount; t++)
+			for (auto c=0; c<3; c++)
+				triangleCentroids[t][c] = (vertexPositions[local[t*3u+0u]][c]+vertexPositions[local[t*3u+1u]][c]+vertexPositions[local[t*3u+2u]][c])*(1.f/3.f);
+
+			constexpr uint8_t NotInMeshlet = 0xffu;
+			std::vector<uint8_t> meshletLocalIx(vertexCount,NotInMeshlet);
+			std::vector<uint32_t> liveTriangles(vertexCount);
+			for (uint32_t v=0u; v<vertexCount; v++)
+				liveTriangles[v] = adjacencyOffsets[v+1u]-adjacencyOffsets[v];
+			std::vector<bool> emitted(triangleCount,false);
+			std::vector<uint32_t> meshletVertices;
+			meshletVertices.reserve(params.maxVertices);
+			uint32_t meshletTriangles = 0u;
+			uint32_t scanCursor = 0u;
+
+			auto newVertexCount = [&](const uint32_t t) -> uint32_t
+			{
+				uint32_t retval = 0u;
+				for (uint32_t c=0u; c<3u; c++)
+				if (meshletLocalIx[local[t*3u+c]]==NotInMeshlet)
+					retval++;
+				return retval;
+			};
+			auto flush = [&]() -> void
+			{
+				if (meshletTriangles==0u)
+					return;
+				SMeshlet meshlet;
+				meshlet.vertexOffset = static_cast<uint32_t>(retval.vertices.size());
+				meshlet.triangleOffset = static_cast<uint32_t>(retval.triangles.size())-meshletTriangles;
+				meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+				meshlet.triangleCount = meshletTriangles;
+				retval.meshlets.push_back(meshlet);
+				for (const uint32_t v : meshletVertices)
+				{
+					retval.vertices.push_back(globalVertices[v]);
+					meshletLocalIx[v] = NotInMeshlet;
+				}
+				meshletVertices.clear();
+				meshletTriangles = 0u;
+			};
+			auto emit = [&](const uint32_t t) -> void
+			{
+				std::array<uint8_t,3> triangle;
+				for (uint32_t c=0u; c<3u; c++)
+				{
+					const uint32_t v = local[t*3u+c];
+					if (meshletLocalIx[v]==NotInMeshlet)
+					{
+						meshletLocalIx[v] = static_cast<uint8_t>(meshletVertices.size());
+						meshletVertices.push_back(v);
+					}
+					triangle[c] = meshletLocalIx[v];
+				}
+				retval.triangles.push_back(triangle);
+				for (uint32_t c=0u; c<3u; c++)
+					liveTriangles[local[t*3u+c]]--;
+				emitted[t] = true;
+				meshletTriangles++;
+			};
+
+			// triangles whose vertices have few unemitted triangles left are on the border of the emitted region, taking them first avoids leaving islands behind
+			auto liveScore = [&](const uint32_t t) -> uint32_t
+			{
+				return liveTriangles[local[t*3u+0u]]+liveTriangles[local[t*3u+1u]]+liveTriangles[local[t*3u+2u]];
+			};
+
+			// seed the next cluster with the most enclosed triangle next to the current one
+			auto findSeed = [&]() -> uint32_t
+			{
+				uint32_t seed = ~0u, seedLive = ~0u;
+				for (const uint32_t v : meshletVertices)
+				for (uint32_t a=adjacencyOffsets[v]; a<adjacencyOffsets[v+1u]; a++)
+				{
+					const uint32_t t = adjacency[a];
+					if (emitted[t])
+						continue;
+					const uint32_t live = liveScore(t);
+					if (live<seedLive)
+					{
+						seedLive = live;
+						seed = t;
+					}
+				}
+				return seed;
+			};
+
+			uint32_t remaining = triangleCount;
+			uint32_t lastTriangle = ~0u, seed = ~0u;
+			while (remaining)
+			{
+				if (meshletVertices.empty())
+				{
+					if (seed==~0u)
+					{
+						while (emitted[scanCursor])
+							scanCursor++;
+						seed = scanCursor;
+					}
+					emit(seed);
+					lastTriangle = seed;
+					seed = ~0u;
+					remaining--;
+					continue;
+				}
+
+				vec3_t meshletCentroid = {0.f,0.f,0.f};
+				for (const uint32_t v : meshletVertices)
+				for (auto c=0; c<3; c++)
+					meshletCentroid[c] += vertexPositions[v][c];
+				for (auto& c : meshletCentroid)
+					c /= float(std::max<size_t>(meshletVertices.size(),1u));
+
+				uint32_t best = ~0u, bestNew = 4u, bestLive = ~0u;
+				float bestDistance = std::numeric_limits<float>::infinity();
+				auto consider = [&](const uint32_t v) -> void
+				{
+					for (uint32_t a=adjacencyOffsets[v]; a<adjacencyOffsets[v+1u]; a++)
+					{
+						const uint32_t t = adjacency[a];
+						if (emitted[t])
+							continue;
+						const uint32_t extra = newVertexCount(t);
+						if (extra>bestNew)
+							continue;
+						const uint32_t live = liveScore(t);
+						if (extra==bestNew && live>bestLive)
+							continue;
+						float distance = 0.f;
+						for (auto c=0; c<3; c++)
+						{
+							const float d = triangleCentroids[t][c]-meshletCentroid[c];
+							distance += d*d;
+						}
+						if (extra<bestNew || live<bestLive || distance<bestDistance)
+						{
+							bestNew = extra;
+							bestLive = live;
+							bestDistance = distance;
+							best = t;
+						}
+					}
+				};
+				// the neighbours of the last triangle are nearly always the best candidates, only look at the whole cluster when they ran out
+				if (lastTriangle!=~0u)
+				for (uint32_t c=0u; c<3u; c++)
+					consider(local[lastTriangle*3u+c]);
+				if (best==~0u || meshletVertices.size()+bestNew>params.maxVertices)
+				for (const uint32_t v : meshletVertices)
+					consider(v);
+				if (best==~0u || meshletVertices.size()+bestNew>params.maxVertices)
+				{
+					seed = findSeed();
+					flush();
+					continue;
+				}
+				emit(best);
+				lastTriangle = best;
+				remaining--;
+				if (meshletTriangles==params.maxTriangles || meshletVertices.size()+1u>params.maxVertices)
+				{
+					seed = findSeed();
+					flush();
+				}
+			}
+			flush();
+			return retval;
+		}
+
+		static inline SBounds computeBounds(const SMeshlets& meshlets, const SMeshlet& meshlet, const void* positions, const size_t stride)
+		{
+			SBounds retval = {};
+			std::array<vec3_t,MaxVertices*4u> scratch; // generous, `maxVertices` is clamped to 255
+			const uint32_t vertexCount = meshlet.vertexCount;
+			for (uint32_t i=0u; i<vertexCount; i++)
+				scratch[i] = getPosition(positions,stride,meshlets.vertices[meshlet.vertexOffset+i]);
+
+			// AABB
+			vec3_t aabbMin = scratch[0], aabbMax = scratch[0];
+			for (uint32_t i=1u; i<vertexCount; i++)
+			for (auto c=0; c<3; c++)
+			{
+				aabbMin[c] = std::min(aabbMin[c],scratch[i][c]);
+				aabbMax[c] = std::max(aabbMax[c],scratch[i][c]);
+			}
+
+			// Ritter's sphere, seeded with the most distant pair along the axis of largest spread
+			vec3_t center;
+			float radius;
+			{
+				uint32_t minIx[3] = {0u,0u,0u}, maxIx[3] = {0u,0u,0u};
+				for (uint32_t i=1u; i<vertexCount; i++)
+				for (auto c=0; c<3; c++)
+				{
+					if (scratch[i][c]<scratch[minIx[c]][c])
+						minIx[c] = i;
+					if (scratch[i][c]>scratch[maxIx[c]][c])
+						maxIx[c] = i;
+				}
+				auto distance2 = [](const vec3_t& a, const vec3_t& b) -> float
+				{
+					const float dx = a[0]-b[0], dy = a[1]-b[1], dz = a[2]-b[2];
+					return dx*dx+dy*dy+dz*dz;
+				};
+				uint32_t axis = 0u;
+				for (uint32_t c=1u; c<3u; c++)
+				if (distance2(scratch[minIx[c]],scratch[maxIx[c]])>distance2(scratch[minIx[axis]],scratch[maxIx[axis]]))
+					axis = c;
+				const vec3_t& p0 = scratch[minIx[axis]];
+				const vec3_t& p1 = scratch[maxIx[axis]];
+				for (auto c=0; c<3; c++)
+					center[c] = (p0[c]+p1[c])*0.5f;
+				radius = std::sqrt(distance2(p0,p1))*0.5f;
+				for (uint32_t i=0u; i<vertexCount; i++)
+				{
+					const float d2 = distance2(scratch[i],center);
+					if (d2>radius*radius)
+					{
+						const float d = std::sqrt(d2);
+						const float newRadius = (radius+d)*0.5f;
+						const float k = (newRadius-radius)/d;
+						radius = newRadius;
+						for (auto c=0; c<3; c++)
+							center[c] += (scratch[i][c]-center[c])*k;
+					}
+				}
+			}
+
+			// normal cone, axis is the average of the unit triangle normals
+			std::array<vec3_t,MaxTriangles*5u> normals; // generous, `maxTriangles` is clamped to 512
+			vec3_t axis = {0.f,0.f,0.f};
+			uint32_t validNormals = 0u;
+			for (uint32_t t=0u; t<meshlet.triangleCount; t++)
+			{
+				const auto& triangle = meshlets.triangles[meshlet.triangleOffset+t];
+				const vec3_t& a = scratch[triangle[0]];
+				const vec3_t& b = scratch[triangle[1]];
+				const vec3_t& c = scratch[triangle[2]];
+				const vec3_t e0 = {b[0]-a[0],b[1]-a[1],b[2]-a[2]};
+				const vec3_t e1 = {c[0]-a[0],c[1]-a[1],c[2]-a[2]};
+				vec3_t n = {e0[1]*e1[2]-e0[2]*e1[1],e0[2]*e1[0]-e0[0]*e1[2],e0[0]*e1[1]-e0[1]*e1[0]};
+				const float len = std::sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+				if (len<=0.f)
+					continue; // degenerate triangles can't face anywhere
+				for (auto i=0; i<3; i++)
+				{
+					n[i] /= len;
+					axis[i] += n[i];
+				}
+				normals[validNormals++] = n;
+			}
+			float coneCutoff = 1.f;
+			vec3_t apex = center;
+			const float axisLen = std::sqrt(axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2]);
+			if (validNormals && axisLen>0.f)
+			{
+				for (auto& c : axis)
+					c /= axisLen;
+				float minDot = 1.f;
+				for (uint32_t i=0u; i<validNormals; i++)
+					minDot = std::min(minDot,normals[i][0]*axis[0]+normals[i][1]*axis[1]+normals[i][2]*axis[2]);
+				// a cone wider than a hemisphere can never be entirely backfacing
+				if (minDot>0.f)
+				{
+					// move the apex back along the axis until every triangle's plane is in front of it, then the test is conservative for any camera position
+					float maxT = 0.f;
+					for (uint32_t t=0u; t<meshlet.triangleCount; t++)
+					{
+						const auto& triangle = meshlets.triangles[meshlet.triangleOffset+t];
+						const vec3_t& a = scratch[triangle[0]];
+						const vec3_t& b = scratch[triangle[1]];
+						const vec3_t& c = scratch[triangle[2]];
+						const vec3_t e0 = {b[0]-a[0],b[1]-a[1],b[2]-a[2]};
+						const vec3_t e1 = {c[0]-a[0],c[1]-a[1],c[2]-a[2]};
+						const vec3_t n = {e0[1]*e1[2]-e0[2]*e1[1],e0[2]*e1[0]-e0[0]*e1[2],e0[0]*e1[1]-e0[1]*e1[0]};
+						const float dn = axis[0]*n[0]+axis[1]*n[1]+axis[2]*n[2];
+						if (dn<=0.f)
+							continue;
+						const float dc = (center[0]-a[0])*n[0]+(center[1]-a[1])*n[1]+(center[2]-a[2])*n[2];
+						maxT = std::max(maxT,dc/dn);
+					}
+					for (auto i=0; i<3; i++)
+						apex[i] = center[i]-axis[i]*maxT;
+					coneCutoff = std::sqrt(1.f-minDot*minDot);
+				}
+			}
+
+			std::copy_n(center.begin(),3,retval.center);
+			retval.radius = radius;
+			std::copy_n(aabbMin.begin(),3,retval.aabbMin);
+			std::copy_n(aabbMax.begin(),3,retval.aabbMax);
+			std::copy_n(apex.begin(),3,retval.coneApex);
+			std::copy_n(axis.begin(),3,retval.coneAxis);
+			retval.coneCutoff = coneCutoff;
+			return retval;
+		}
+};
+
+}
+
+#endif
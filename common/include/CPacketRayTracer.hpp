@@ -0,0 +1,483 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_PACKET_RAY_TRACER_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_PACKET_RAY_TRACER_HPP_INCLUDED_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX512F__)
+#define _NBL_EXAMPLES_PACKET_AVX512_
+#include <immintrin.h>
+#elif defined(__AVX__)
+#define _NBL_EXAMPLES_PACKET_AVX_
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define _NBL_EXAMPLES_PACKET_SSE_
+#include <immintrin.h>
+#endif
+
+#include "ParallelFor.hpp"
+
+namespace nbl::examples::packet
+{
+
+// Widest float vector the target was compiled for, 16 lanes with AVX-512, 8 with AVX(2), 4 with SSE or the portable fallback
+// (30_ComputeShaderPathTracer picks it with the `NBL_30_PACKET_ISA` CMake option)
+#if defined(_NBL_EXAMPLES_PACKET_AVX512_)
+struct SMaskPacket
+{
+	__mmask16 value;
+
+	inline SMaskPacket operator&(const SMaskPacket other) const {return {static_cast<__mmask16>(value&other.value)};}
+};
+struct SFloatPacket
+{
+	constexpr static inline uint32_t Width = 16u;
+
+	static inline SFloatPacket broadcast(const float v) {return {_mm512_set1_ps(v)};}
+	static inline SFloatPacket load(const float* v) {return {_mm512_loadu_ps(v)};}
+	inline void store(float* out) const {_mm512_storeu_ps(out,value);}
+
+	inline SFloatPacket operator+(const SFloatPacket other) const {return {_mm512_add_ps(value,other.value)};}
+	inline SFloatPacket operator-(const SFloatPacket other) const {return {_mm512_sub_ps(value,other.value)};}
+	inline SFloatPacket operator*(const SFloatPacket other) const {return {_mm512_mul_ps(value,other.value)};}
+	inline SFloatPacket operator/(const SFloatPacket other) const {return {_mm512_div_ps(value,other.value)};}
+	inline SFloatPacket operator-() const {return {_mm512_sub_ps(_mm512_setzero_ps(),value)};}
+	// ordered and non-signalling, so NaNs compare false just like in the shaders
+	inline SMaskPacket operator>(const SFloatPacket other) const {return {_mm512_cmp_ps_mask(value,other.value,_CMP_GT_OQ)};}
+	inline SMaskPacket operator<(const SFloatPacket other) const {return {_mm512_cmp_ps_mask(value,other.value,_CMP_LT_OQ)};}
+	inline SMaskPacket operator>=(const SFloatPacket other) const {return {_mm512_cmp_ps_mask(value,other.value,_CMP_GE_OQ)};}
+	inline SMaskPacket operator<=(const SFloatPacket other) const {return {_mm512_cmp_ps_mask(value,other.value,_CMP_LE_OQ)};}
+
+	__m512 value;
+};
+inline SFloatPacket sqrt(const SFloatPacket v) {return {_mm512_sqrt_ps(v.value)};}
+inline SFloatPacket select(const SMaskPacket m, const SFloatPacket a, const SFloatPacket b) {return {_mm512_mask_blend_ps(m.value,b.value,a.value)};}
+#elif defined(_NBL_EXAMPLES_PACKET_AVX_)
+struct SMaskPacket
+{
+	__m256 value;
+
+	inline SMaskPacket operator&(const SMaskPacket other) const {return {_mm256_and_ps(value,other.value)};}
+};
+struct SFloatPacket
+{
+	constexpr static inline uint32_t Width = 8u;
+
+	static inline SFloatPacket broadcast(const float v) {return {_mm256_set1_ps(v)};}
+	static inline SFloatPacket load(const float* v) {return {_mm256_loadu_ps(v)};}
+	inline void store(float* out) const {_mm256_storeu_ps(out,value);}
+
+	inline SFloatPacket operator+(const SFloatPacket other) const {return {_mm256_add_ps(value,other.value)};}
+	inline SFloatPacket operator-(const SFloatPacket other) const {return {_mm256_sub_ps(value,other.value)};}
+	inline SFloatPacket operator*(const SFloatPacket other) const {return {_mm256_mul_ps(value,other.value)};}
+	inline SFloatPacket operator/(const SFloatPacket other) const {return {_mm256_div_ps(value,other.value)};}
+	inline SFloatPacket operator-() const {return {_mm256_sub_ps(_mm256_setzero_ps(),value)};}
+	inline SMaskPacket operator>(const SFloatPacket other) const {return {_mm256_cmp_ps(value,other.value,_CMP_GT_OQ)};}
+	inline SMaskPacket operator<(const SFloatPacket other) const {return {_mm256_cmp_ps(value,other.value,_CMP_LT_OQ)};}
+	inline SMaskPacket operator>=(const SFloatPacket other) const {return {_mm256_cmp_ps(value,other.value,_CMP_GE_OQ)};}
+	inline SMaskPacket operator<=(const SFloatPacket other) const {return {_mm256_cmp_ps(value,other.value,_CMP_LE_OQ)};}
+
+	__m256 value;
+};
+inline SFloatPacket sqrt(const SFloatPacket v) {return {_mm256_sqrt_ps(v.value)};}
+inline SFloatPacket select(const SMaskPacket m, const SFloatPacket a, const SFloatPacket b) {return {_mm256_blendv_ps(b.value,a.value,m.value)};}
+#elif defined(_NBL_EXAMPLES_PACKET_SSE_)
+struct SMaskPacket
+{
+	__m128 value;
+
+	inline SMaskPacket operator&(const SMaskPacket other) const {return {_mm_and_ps(value,other.value)};}
+};
+struct SFloatPacket
+{
+	constexpr static inline uint32_t Width = 4u;
+
+	static inline SFloatPacket broadcast(const float v) {return {_mm_set1_ps(v)};}
+	static inline SFloatPacket load(const float* v) {return {_mm_loadu_ps(v)};}
+	inline void store(float* out) const {_mm_storeu_ps(out,value);}
+
+	inline SFloatPacket operator+(const SFloatPacket other) const {return {_mm_add_ps(value,other.value)};}
+	inline SFloatPacket operator-(const SFloatPacket other) const {return {_mm_sub_ps(value,other.value)};}
+	inline SFloatPacket operator*(const SFloatPacket other) const {return {_mm_mul_ps(value,other.value)};}
+	inline SFloatPacket operator/(const SFloatPacket other) const {return {_mm_div_ps(value,other.value)};}
+	inline SFloatPacket operator-() const {return {_mm_sub_ps(_mm_setzero_ps(),value)};}
+	// the `cmp*_ps` are all ordered, NaN lanes come out false
+	inline SMaskPacket operator>(const SFloatPacket other) const {return {_mm_cmpgt_ps(value,other.value)};}
+	inline SMaskPacket operator<(const SFloatPacket other) const {return {_mm_cmplt_ps(value,other.value)};}
+	inline SMaskPacket operator>=(const SFloatPacket other) const {return {_mm_cmpge_ps(value,other.value)};}
+	inline SMaskPacket operator<=(const SFloatPacket other) const {return {_mm_cmple_ps(value,other.value)};}
+
+	__m128 value;
+};
+inline SFloatPacket sqrt(const SFloatPacket v) {return {_mm_sqrt_ps(v.value)};}
+// SSE4.1 would have `blendv`, but the baseline doesn't
+inline SFloatPacket select(const SMaskPacket m, const SFloatPacket a, const SFloatPacket b) {return {_mm_or_ps(_mm_and_ps(m.value,a.value),_mm_andnot_ps(m.value,b.value))};}
+#else
+struct SMaskPacket
+{
+	std::array<bool,4> value;
+
+	inline SMaskPacket operator&(const SMaskPacket other) const
+	{
+		SMaskPacket retval;
+		for (uint32_t i=0u; i<value.size(); i++)
+			retval.value[i] = value[i]&&other.value[i];
+		return retval;
+	}
+};
+struct SFloatPacket
+{
+	constexpr static inline uint32_t Width = 4u;
+
+	static inline SFloatPacket broadcast(const float v) {SFloatPacket retval; retval.value.fill(v); return retval;}
+	static inline SFloatPacket load(const float* v) {SFloatPacket retval; std::copy_n(v,Width,retval.value.begin()); return retval;}
+	inline void store(float* out) const {std::copy_n(value.begin(),Width,out);}
+
+	inline SFloatPacket operator+(const SFloatPacket other) const {return apply(other,[](const float a, const float b)->float{return a+b;});}
+	inline SFloatPacket operator-(const SFloatPacket other) const {return apply(other,[](const float a, const float b)->float{return a-b;});}
+	inline SFloatPacket operator*(const SFloatPacket other) const {return apply(other,[](const float a, const float b)->float{return a*b;});}
+	inline SFloatPacket operator/(const SFloatPacket other) const {return apply(other,[](const float a, const float b)->float{return a/b;});}
+	inline SFloatPacket operator-() const {return broadcast(0.f)-*this;}
+	inline SMaskPacket operator>(const SFloatPacket other) const {return compare(other,[](const float a, const float b)->bool{return a>b;});}
+	inline SMaskPacket operator<(const SFloatPacket other) const {return compare(other,[](const float a, const float b)->bool{return a<b;});}
+	inline SMaskPacket operator>=(const SFloatPacket other) const {return compare(other,[](const float a, const float b)->bool{return a>=b;});}
+	inline SMaskPacket operator<=(const SFloatPacket other) const {return compare(other,[](const float a, const float b)->bool{return a<=b;});}
+
+	std::array<float,Width> value;
+
+	private:
+		template<typename F>
+		inline SFloatPacket apply(const SFloatPacket other, F&& f) const
+		{
+			SFloatPacket retval;
+			for (uint32_t i=0u; i<Width; i++)
+				retval.value[i] = f(value[i],other.value[i]);
+			return retval;
+		}
+		template<typename F>
+		inline SMaskPacket compare(const SFloatPacket other, F&& f) const
+		{
+			SMaskPacket retval;
+			for (uint32_t i=0u; i<Width; i++)
+				retval.value[i] = f(value[i],other.value[i]);
+			return retval;
+		}
+};
+inline SFloatPacket sqrt(const SFloatPacket v)
+{
+	SFloatPacket retval;
+	for (uint32_t i=0u; i<SFloatPacket::Width; i++)
+		retval.value[i] = std::sqrt(v.value[i]);
+	return retval;
+}
+inline SFloatPacket select(const SMaskPacket m, const SFloatPacket a, const SFloatPacket b)
+{
+	SFloatPacket retval;
+	for (uint32_t i=0u; i<SFloatPacket::Width; i++)
+		retval.value[i] = m.value[i] ? a.value[i]:b.value[i];
+	return retval;
+}
+#endif
+
+// the scalar reference goes through the same templates as the packets, one lane at a time
+inline float broadcast(const float v, float) {return v;}
+inline SFloatPacket broadcast(const float v, SFloatPacket) {return SFloatPacket::broadcast(v);}
+inline float sqrt(const float v) {return std::sqrt(v);}
+inline float select(const bool m, const float a, const float b) {return m ? a:b;}
+inline bool maskAnd(const bool a, const bool b) {return a&&b;}
+inline SMaskPacket maskAnd(const SMaskPacket a, const SMaskPacket b) {return a&b;}
+
+template<typename F>
+struct SVec3
+{
+	inline SVec3 operator+(const SVec3& other) const {return {x+other.x,y+other.y,z+other.z};}
+	inline SVec3 operator-(const SVec3& other) const {return {x-other.x,y-other.y,z-other.z};}
+	inline SVec3 operator*(const F s) const {return {x*s,y*s,z*s};}
+
+	F x, y, z;
+};
+template<typename F>
+inline F dot(const SVec3<F>& a, const SVec3<F>& b) {return a.x*b.x+a.y*b.y+a.z*b.z;}
+template<typename F>
+inline SVec3<F> cross(const SVec3<F>& a, const SVec3<F>& b) {return {a.y*b.z-a.z*b.y,a.z*b.x-a.x*b.z,a.x*b.y-a.y*b.x};}
+
+// Structure of Arrays so a packet loop streams through each attribute
+struct SScene
+{
+	enum E_LIGHT_GEOMETRY : uint8_t
+	{
+		ELG_SPHERE,
+		ELG_TRIANGLE,
+		ELG_RECTANGLE,
+		ELG_COUNT
+	};
+	// Same scenes as the `litBy*.comp` path tracers of examples 30 and 42, keep in sync with their `common.glsl`
+	static inline SScene create(const E_LIGHT_GEOMETRY lightGeometry)
+	{
+		SScene retval;
+		auto addSphere = [&](const std::array<float,3> position, const float radius) -> void
+		{
+			for (auto i=0; i<3; i++)
+				retval.spherePosition[i].push_back(position[i]);
+			retval.sphereRadius2.push_back(radius*radius);
+		};
+		addSphere({0.0f,-100.5f,-1.0f},100.0f);
+		addSphere({2.0f,0.0f,-1.0f},0.5f);
+		addSphere({0.0f,0.0f,-1.0f},0.5f);
+		addSphere({-2.0f,0.0f,-1.0f},0.5f);
+		addSphere({2.0f,0.0f,1.0f},0.5f);
+		addSphere({0.0f,0.0f,1.0f},0.5f);
+		addSphere({-2.0f,0.0f,1.0f},0.5f);
+		addSphere({0.5f,1.0f,0.5f},0.5f);
+		switch (lightGeometry)
+		{
+			case ELG_SPHERE:
+				addSphere({-1.5f,1.5f,0.0f},0.3f);
+				break;
+			case ELG_TRIANGLE:
+			{
+				// the shader scales the vertices by 10 at runtime, do the same rounding
+				std::array<float,3> vertices[3] = {{-1.8f,0.35f,0.3f},{-1.2f,0.35f,0.0f},{-1.5f,0.8f,-0.3f}};
+				for (auto& vertex : vertices)
+				for (auto& coord : vertex)
+					coord *= 10.f;
+				for (auto i=0; i<3; i++)
+				{
+					retval.triangleVertex0[i].push_back(vertices[0][i]);
+					retval.triangleEdge0[i].push_back(vertices[1][i]-vertices[0][i]);
+					retval.triangleEdge1[i].push_back(vertices[2][i]-vertices[0][i]);
+				}
+				break;
+			}
+			case ELG_RECTANGLE:
+			{
+				auto normalize = [](const std::array<float,3> v) -> std::array<float,3>
+				{
+					const float len = std::sqrt(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]);
+					return {v[0]/len,v[1]/len,v[2]/len};
+				};
+				const auto edge0 = normalize({2.f,0.f,-1.f});
+				const auto edge1 = normalize({2.f,-5.f,4.f});
+				const std::array<float,3> offset = {-3.8f,0.35f,1.3f};
+				for (auto i=0; i<3; i++)
+				{
+					retval.rectangleOffset[i].push_back(offset[i]);
+					retval.rectangleEdge0[i].push_back(edge0[i]*7.f);
+					retval.rectangleEdge1[i].push_back(edge1[i]*0.1f);
+				}
+				break;
+			}
+			default:
+				break;
+		}
+		return retval;
+	}
+
+	inline uint32_t getSphereCount() const {return static_cast<uint32_t>(sphereRadius2.size());}
+	inline uint32_t getTriangleCount() const {return static_cast<uint32_t>(triangleVertex0[0].size());}
+	inline uint32_t getRectangleCount() const {return static_cast<uint32_t>(rectangleOffset[0].size());}
+
+	std::array<std::vector<float>,3> spherePosition;
+	std::vector<float> sphereRadius2;
+	// the edges get computed once here, the shaders do it per intersection (which produces the same bits)
+	std::array<std::vector<float>,3> triangleVertex0, triangleEdge0, triangleEdge1;
+	std::array<std::vector<float>,3> rectangleOffset, rectangleEdge0, rectangleEdge1;
+};
+
+// Closest hit against everything in `scene`, object IDs are numbered like the shaders' `traceRay` (spheres first, then the one extra shape kind).
+// Every function is a line by line copy of its `common.glsl` counterpart so the operation order and therefore the rounding are the same,
+// `F` is either `float` for the scalar reference or `SFloatPacket`. IDs are carried as floats which is exact for any sane scene size.
+template<typename F>
+inline void traceRay(const SScene& scene, const SVec3<F>& origin, const SVec3<F>& direction, F& intersectionT, F& objectID)
+{
+	const F zero = broadcast(0.f,F{});
+	const F one = broadcast(1.f,F{});
+	auto closest = [&](const F t, const uint32_t id) -> void
+	{
+		const auto closerIntersection = maskAnd(t>zero,t<intersectionT);
+		intersectionT = select(closerIntersection,t,intersectionT);
+		objectID = select(closerIntersection,broadcast(float(id),F{}),objectID);
+	};
+
+	const uint32_t sphereCount = scene.getSphereCount();
+	for (uint32_t i=0u; i<sphereCount; i++)
+	{
+		const SVec3<F> position = {broadcast(scene.spherePosition[0][i],F{}),broadcast(scene.spherePosition[1][i],F{}),broadcast(scene.spherePosition[2][i],F{})};
+		const F radius2 = broadcast(scene.sphereRadius2[i],F{});
+
+		const SVec3<F> relOrigin = origin-position;
+		const F relOriginLen2 = dot(relOrigin,relOrigin);
+
+		const F dirDotRelOrigin = dot(direction,relOrigin);
+		const F det = radius2-relOriginLen2+dirDotRelOrigin*dirDotRelOrigin;
+
+		// speculative math just like the shader, a miss is a NaN which fails every comparison
+		const F detsqrt = sqrt(det);
+		closest(-dirDotRelOrigin+select(relOriginLen2>radius2,-detsqrt,detsqrt),i);
+	}
+
+	const float NaN = std::numeric_limits<float>::quiet_NaN();
+	uint32_t id = sphereCount;
+	for (uint32_t i=0u; i<scene.getTriangleCount(); i++,id++)
+	{
+		const SVec3<F> vertex0 = {broadcast(scene.triangleVertex0[0][i],F{}),broadcast(scene.triangleVertex0[1][i],F{}),broadcast(scene.triangleVertex0[2][i],F{})};
+		const SVec3<F> edge0 = {broadcast(scene.triangleEdge0[0][i],F{}),broadcast(scene.triangleEdge0[1][i],F{}),broadcast(scene.triangleEdge0[2][i],F{})};
+		const SVec3<F> edge1 = {broadcast(scene.triangleEdge1[0][i],F{}),broadcast(scene.triangleEdge1[1][i],F{}),broadcast(scene.triangleEdge1[2][i],F{})};
+
+		const SVec3<F> h = cross(direction,edge1);
+		const F a = dot(edge0,h);
+		const SVec3<F> relOrigin = origin-vertex0;
+		const F u = dot(relOrigin,h)/a;
+		const SVec3<F> q = cross(relOrigin,edge0);
+		const F v = dot(direction,q)/a;
+		const F t = dot(edge1,q)/a;
+
+		const auto intersection = maskAnd(maskAnd(t>zero,u>=zero),maskAnd(v>=zero,(u+v)<=one));
+		closest(select(intersection,t,broadcast(NaN,F{})),id);
+	}
+	for (uint32_t i=0u; i<scene.getRectangleCount(); i++,id++)
+	{
+		const SVec3<F> offset = {broadcast(scene.rectangleOffset[0][i],F{}),broadcast(scene.rectangleOffset[1][i],F{}),broadcast(scene.rectangleOffset[2][i],F{})};
+		const SVec3<F> edge0 = {broadcast(scene.rectangleEdge0[0][i],F{}),broadcast(scene.rectangleEdge0[1][i],F{}),broadcast(scene.rectangleEdge0[2][i],F{})};
+		const SVec3<F> edge1 = {broadcast(scene.rectangleEdge1[0][i],F{}),broadcast(scene.rectangleEdge1[1][i],F{}),broadcast(scene.rectangleEdge1[2][i],F{})};
+
+		const SVec3<F> h = cross(direction,edge1);
+		const F a = dot(edge0,h);
+		const SVec3<F> relOrigin = origin-offset;
+		const F u = dot(relOrigin,h)/a;
+		const SVec3<F> q = cross(relOrigin,edge0);
+		const F v = dot(direction,q)/a;
+		const F t = dot(edge1,q)/a;
+
+		const auto intersection = maskAnd(maskAnd(maskAnd(t>zero,u>=zero),maskAnd(v>=zero,u<=one)),v<=one);
+		closest(select(intersection,t,broadcast(NaN,F{})),id);
+	}
+}
+
+// What the primary rays of a path tracer dispatch see, distance and object ID per pixel (-1 and FLT_MAX on a miss)
+struct SPrimaryHitImage
+{
+	inline bool operator==(const SPrimaryHitImage& other) const
+	{
+		// bitwise on purpose, we want to catch rounding differences too
+		return width==other.width && height==other.height &&
+			std::memcmp(intersectionT.data(),other.intersectionT.data(),intersectionT.size()*sizeof(float))==0 &&
+			objectID==other.objectID;
+	}
+
+	uint32_t width = 0u, height = 0u;
+	std::vector<float> intersectionT;
+	std::vector<int32_t> objectID;
+};
+
+// Multithreaded tiled renderer of `SPrimaryHitImage`s, with the same raygen as the path tracers minus the stochastic reconstruction filter.
+// `Packets=false` traces one ray at a time and is the reference the packet path must match bit for bit. That holds as long as the compiler
+// isn't allowed to contract the scalar math into FMAs (MSVC's default `/fp:precise` doesn't, GCC and Clang need `-ffp-contract=off` which users of this header have to set on their target).
+class CReferenceRenderer
+{
+	public:
+		constexpr static inline uint32_t TileSize = 32u;
+
+		// `invMVP` is the row major 4x4 matrix the path tracers get as a push constant
+		template<bool Packets>
+		static inline SPrimaryHitImage render(const SScene& scene, const std::array<float,16>& invMVP, const uint32_t width, const uint32_t height, const uint32_t workerCount=0u)
+		{
+			SPrimaryHitImage retval;
+			retval.width = width;
+			retval.height = height;
+			retval.intersectionT.resize(size_t(width)*height);
+			retval.objectID.resize(size_t(width)*height);
+
+			const uint32_t tilesX = (width+TileSize-1u)/TileSize;
+			const uint32_t tilesY = (height+TileSize-1u)/TileSize;
+			parallelFor(size_t(tilesX)*tilesY,[&](const size_t begin, const size_t end, const uint32_t) -> void
+				{
+					for (size_t tile=begin; tile<end; tile++)
+					{
+						const uint32_t tileX = static_cast<uint32_t>(tile%tilesX)*TileSize;
+						const uint32_t tileY = static_cast<uint32_t>(tile/tilesX)*TileSize;
+						const uint32_t tileEndX = std::min(tileX+TileSize,width);
+						const uint32_t tileEndY = std::min(tileY+TileSize,height);
+						for (uint32_t y=tileY; y<tileEndY; y++)
+						{
+							if constexpr (Packets)
+							{
+								for (uint32_t x=tileX; x<tileEndX; x+=SFloatPacket::Width)
+									renderPacket(scene,invMVP,retval,x,y,std::min(SFloatPacket::Width,tileEndX-x));
+							}
+							else
+							{
+								for (uint32_t x=tileX; x<tileEndX; x++)
+								{
+									float t, id;
+									tracePixel<float>(scene,invMVP,width,height,float(x),float(y),t,id);
+									store(retval,size_t(y)*width+x,t,id);
+								}
+							}
+						}
+					}
+				},
+				workerCount
+			);
+			return retval;
+		}
+
+	private:
+		template<typename F>
+		static inline void tracePixel(const SScene& scene, const std::array<float,16>& invMVP, const uint32_t width, const uint32_t height, const F x, const F y, F& intersectionT, F& objectID)
+		{
+			const F one = broadcast(1.f,F{});
+			// texCoord with the flip, then NDC, exactly as the shader writes it
+			const F texCoordX = x/broadcast(float(width),F{});
+			const F texCoordY = one-y/broadcast(float(height),F{});
+			const F ndcX = texCoordX*broadcast(2.f,F{})+broadcast(-1.f,F{});
+			const F ndcY = texCoordY*broadcast(-2.f,F{})+one;
+			auto unproject = [&](const F z) -> SVec3<F>
+			{
+				F tmp[4];
+				for (auto r=0; r<4; r++)
+					tmp[r] = broadcast(invMVP[r*4+0],F{})*ndcX+broadcast(invMVP[r*4+1],F{})*ndcY+broadcast(invMVP[r*4+2],F{})*z+broadcast(invMVP[r*4+3],F{});
+				return {tmp[0]/tmp[3],tmp[1]/tmp[3],tmp[2]/tmp[3]};
+			};
+			const SVec3<F> camPos = unproject(broadcast(0.f,F{}));
+			SVec3<F> direction = unproject(one)-camPos;
+			direction = direction*(one/sqrt(dot(direction,direction)));
+
+			intersectionT = broadcast(std::numeric_limits<float>::max(),F{});
+			objectID = broadcast(-1.f,F{});
+			traceRay(scene,camPos,direction,intersectionT,objectID);
+		}
+
+		static inline void renderPacket(const SScene& scene, const std::array<float,16>& invMVP, SPrimaryHitImage& image, const uint32_t x, const uint32_t y, const uint32_t activeLanes)
+		{
+			alignas(64) float lanesX[SFloatPacket::Width];
+			for (uint32_t i=0u; i<SFloatPacket::Width; i++)
+				lanesX[i] = float(x+i); // lanes past the edge trace garbage which never gets stored
+			SFloatPacket t, id;
+			tracePixel(scene,invMVP,image.width,image.height,SFloatPacket::load(lanesX),SFloatPacket::broadcast(float(y)),t,id);
+
+			alignas(64) float outT[SFloatPacket::Width], outID[SFloatPacket::Width];
+			t.store(outT);
+			id.store(outID);
+			for (uint32_t i=0u; i<activeLanes; i++)
+				store(image,size_t(y)*image.width+x+i,outT[i],outID[i]);
+		}
+
+		static inline void store(SPrimaryHitImage& image, const size_t pixel, const float t, const float id)
+		{
+			image.intersectionT[pixel] = t;
+			image.objectID[pixel] = static_cast<int32_t>(id);
+		}
+};
+
+}
+
+#endif
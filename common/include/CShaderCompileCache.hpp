@@ -0,0 +1,278 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_SHADER_COMPILE_CACHE_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_SHADER_COMPILE_CACHE_HPP_INCLUDED_
+
+#include <nabla.h>
+#if __has_include("nbl/git/info.h")
+#include "nbl/git/info.h"
+#define _NBL_EXAMPLES_SHADER_COMPILE_CACHE_HAS_GIT_INFO_
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "AtomicFileWrite.hpp"
+
+namespace nbl::examples
+{
+
+// Content addressed on-disk cache of HLSL/GLSL to SPIR-V compilations, meant to be shared by all examples (point them all at the same directory).
+// The key is a hash of the preprocessed source (so every `#include`d file's contents and the defines are in it) together with the compiler options and the Nabla build,
+// every key gets its own file so lookups are a single memory mapped read and concurrent processes only ever race on whole-file renames.
+// Unlike `IShaderCompiler::CCache` nothing has to be loaded or written back as a whole, and a stale include can never produce a false hit.
+class CShaderCompileCache
+{
+	public:
+		struct SStats
+		{
+			uint32_t hits = 0u;
+			uint32_t misses = 0u;
+			double compileMilliseconds = 0.0; // spent compiling the misses
+			double lookupMilliseconds = 0.0; // spent preprocessing and reading, hits and misses alike
+			double savedMilliseconds = 0.0; // what the hits took to compile originally, minus what looking them up took
+		};
+
+		inline CShaderCompileCache(core::smart_refctd_ptr<system::ISystem>&& system, const std::filesystem::path& directory) : m_system(std::move(system)), m_directory(directory)
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(m_directory,ec);
+		}
+
+		//! Drop-in for `CCompilerSet::compileToSPIRV`, `source` must not be SPIR-V already
+		inline core::smart_refctd_ptr<asset::ICPUShader> compileToSPIRV(asset::CCompilerSet* compilerSet, const asset::ICPUShader* source, const asset::IShaderCompiler::SCompilerOptions& options)
+		{
+			const auto* compiler = compilerSet->getShaderCompiler(source->getContentType());
+			if (!compiler)
+				return nullptr;
+			const auto* content = source->getContent();
+			const std::string_view code(reinterpret_cast<const char*>(content->getPointer()),strnlen(reinterpret_cast<const char*>(content->getPointer()),content->getSize()));
+			return compileToSPIRV(compiler,code,options);
+		}
+
+		//! Drop-in for `IShaderCompiler::compileToSPIRV`. Options the base `SCompilerOptions` doesn't carry (i.e. `CHLSLCompiler::SOptions::dxcOptions`)
+		// have to be passed in `extraKey`, same goes for the SPIR-V optimizer's passes since only whether there is one gets hashed.
+		inline core::smart_refctd_ptr<asset::ICPUShader> compileToSPIRV(const asset::IShaderCompiler* compiler, const std::string_view code, const asset::IShaderCompiler::SCompilerOptions& options, std::span<const std::string> extraKey={})
+		{
+			const auto lookupStart = clock_t::now();
+
+			auto stage = options.stage;
+			const std::string preprocessed = compiler->preprocessShader(std::string(code),stage,options.preprocessorOptions);
+			if (preprocessed.empty())
+				return nullptr;
+			const auto key = computeKey(compiler->getCodeContentType(),preprocessed,stage,options,extraKey,getBuildFingerprint());
+			const auto path = getPath(key);
+
+			const std::string filepathHint(options.preprocessorOptions.sourceIdentifier);
+			double originalCompileMilliseconds = 0.0;
+			if (auto cached=load(path,filepathHint,originalCompileMilliseconds); cached)
+			{
+				const double lookup = milliseconds(clock_t::now()-lookupStart);
+				m_hits++;
+				addTo(m_lookupMilliseconds,lookup);
+				addTo(m_savedMilliseconds,originalCompileMilliseconds-lookup);
+				return cached;
+			}
+			addTo(m_lookupMilliseconds,milliseconds(clock_t::now()-lookupStart));
+
+			// compile the original, not the preprocessed code, so diagnostics still point at the right files and lines
+			const auto compileStart = clock_t::now();
+			auto spirv = compiler->compileToSPIRV(std::string(code).c_str(),options);
+			const double compile = milliseconds(clock_t::now()-compileStart);
+			m_misses++;
+			addTo(m_compileMilliseconds,compile);
+			if (spirv)
+				store(path,spirv.get(),compile);
+			return spirv;
+		}
+
+		inline SStats getStats() const
+		{
+			SStats retval = {};
+			retval.hits = m_hits.load();
+			retval.misses = m_misses.load();
+			retval.compileMilliseconds = m_compileMilliseconds.load();
+			retval.lookupMilliseconds = m_lookupMilliseconds.load();
+			retval.savedMilliseconds = m_savedMilliseconds.load();
+			return retval;
+		}
+
+		inline void logStats(system::ILogger* logger) const
+		{
+			const auto stats = getStats();
+			logger->log("Shader compile cache \"%s\": %u hits, %u misses, %.3f ms compiling, %.3f ms looking up, %.3f ms saved",system::ILogger::ELL_PERFORMANCE,
+				m_directory.string().c_str(),stats.hits,stats.misses,stats.compileMilliseconds,stats.lookupMilliseconds,stats.savedMilliseconds);
+		}
+
+		inline const std::filesystem::path& getDirectory() const {return m_directory;}
+
+		//! Identifies the build of Nabla and the DXC bundled with it (glslang gets built as part of Nabla), everything cached from SPIR-V or from compiling it should be keyed on it.
+		//! Neither compiler reports a version and DXC stamps a constant generator word into its SPIR-V, so the commits the SDK was built from are what we go by.
+		//! When those are unknown or have uncommitted changes on top, when this header got compiled goes in too, so hacking on a compiler locally still invalidates.
+		static inline const core::blake3_hash_t& getBuildFingerprint()
+		{
+			static const core::blake3_hash_t fingerprint = []() -> core::blake3_hash_t
+			{
+				core::blake3_hasher hasher;
+				auto hashString = [&hasher](const std::string_view str) -> void
+				{
+					const uint64_t size = str.size();
+					hasher.update(&size,sizeof(size));
+					hasher.update(str.data(),size);
+				};
+				bool exact = false;
+#ifdef _NBL_EXAMPLES_SHADER_COMPILE_CACHE_HAS_GIT_INFO_
+				exact = true;
+				for (const auto repo : {gtml::E_GIT_REPO_META::EGRM_NABLA,gtml::E_GIT_REPO_META::EGRM_DXC})
+				{
+					const auto& info = gtml::getGitInfo(repo);
+					hashString(info.commitHash);
+					exact = exact && info.isPopulated.value_or(false) && !info.hasUncommittedChanges.value_or(true);
+				}
+#endif
+				if (!exact)
+					hashString(__DATE__ " " __TIME__);
+				return static_cast<core::blake3_hash_t>(hasher);
+			}();
+			return fingerprint;
+		}
+
+	protected:
+		using clock_t = std::chrono::steady_clock;
+
+		struct SFileHeader
+		{
+			constexpr static inline uint32_t Magic = 0x5650534eu; // "NSPV"
+			constexpr static inline uint32_t Version = 2u;
+
+			uint32_t magic = Magic;
+			uint32_t version = Version;
+			uint32_t stage = 0u;
+			uint32_t pad = 0u;
+			uint64_t compileMicroseconds = 0ull;
+			uint64_t spirvSize = 0ull;
+		};
+
+		static inline double milliseconds(const clock_t::duration duration)
+		{
+			return std::chrono::duration<double,std::milli>(duration).count();
+		}
+		static inline void addTo(std::atomic<double>& target, const double value)
+		{
+			double expected = target.load();
+			while (!target.compare_exchange_weak(expected,expected+value)) {}
+		}
+
+		static inline core::blake3_hash_t computeKey(const asset::IShader::E_CONTENT_TYPE contentType, const std::string_view preprocessed, const asset::IShader::E_SHADER_STAGE stage,
+			const asset::IShaderCompiler::SCompilerOptions& options, std::span<const std::string> extraKey, const core::blake3_hash_t& buildFingerprint)
+		{
+			core::blake3_hasher hasher;
+			auto hashString = [&hasher](const std::string_view str) -> void
+			{
+				const uint64_t size = str.size();
+				hasher.update(&size,sizeof(size));
+				hasher.update(str.data(),size);
+			};
+			const uint32_t version = SFileHeader::Version;
+			hasher.update(&version,sizeof(version));
+			hasher.update(&buildFingerprint,sizeof(buildFingerprint));
+			hasher.update(&contentType,sizeof(contentType));
+			hashString(preprocessed);
+			hasher.update(&stage,sizeof(stage));
+			hasher.update(&options.targetSpirvVersion,sizeof(options.targetSpirvVersion));
+			const auto debugInfoFlags = options.debugInfoFlags.value;
+			hasher.update(&debugInfoFlags,sizeof(debugInfoFlags));
+			const bool optimized = options.spirvOptimizer;
+			hasher.update(&optimized,sizeof(optimized));
+			// already expanded in `preprocessed` but cheap, and a define the source doesn't use yet could still change the DXC invocation
+			for (const auto& define : options.preprocessorOptions.extraDefines)
+			{
+				hashString(define.identifier);
+				hashString(define.definition);
+			}
+			for (const auto& str : extraKey)
+				hashString(str);
+			return static_cast<core::blake3_hash_t>(hasher);
+		}
+
+		inline std::filesystem::path getPath(const core::blake3_hash_t& key) const
+		{
+			constexpr char Digits[] = "0123456789abcdef";
+			std::string name;
+			name.reserve(sizeof(key.data)*2u+4u);
+			for (const auto byte : key.data)
+			{
+				name += Digits[byte>>4];
+				name += Digits[byte&0xfu];
+			}
+			name += ".spv";
+			return m_directory/name;
+		}
+
+		inline core::smart_refctd_ptr<asset::ICPUShader> load(const std::filesystem::path& path, const std::string& filepathHint, double& outCompileMilliseconds) const
+		{
+			std::error_code ec;
+			if (!std::filesystem::exists(path,ec))
+				return nullptr;
+
+			core::smart_refctd_ptr<const system::IFile> file;
+			{
+				system::ISystem::future_t<core::smart_refctd_ptr<system::IFile>> future;
+				m_system->createFile(future,path,system::IFile::ECF_READ|system::IFile::ECF_MAPPABLE);
+				if (auto lock=future.acquire(); lock)
+					file = *lock;
+			}
+			// const so we get the read-only mapping
+			if (!file || !file->getMappedPointer() || file->getSize()<sizeof(SFileHeader))
+				return nullptr;
+
+			const auto* data = reinterpret_cast<const uint8_t*>(file->getMappedPointer());
+			SFileHeader header;
+			memcpy(&header,data,sizeof(header));
+			if (header.magic!=SFileHeader::Magic || header.version!=SFileHeader::Version || sizeof(SFileHeader)+header.spirvSize!=file->getSize())
+				return nullptr;
+
+			auto spirv = asset::ICPUBuffer::create({header.spirvSize});
+			memcpy(spirv->getPointer(),data+sizeof(SFileHeader),header.spirvSize);
+			outCompileMilliseconds = double(header.compileMicroseconds)/1000.0;
+			return core::make_smart_refctd_ptr<asset::ICPUShader>(std::move(spirv),static_cast<asset::IShader::E_SHADER_STAGE>(header.stage),asset::IShader::E_CONTENT_TYPE::ECT_SPIRV,std::string(filepathHint));
+		}
+
+		// Goes through a unique temporary, so concurrent processes compiling the same shader never see a truncated file,
+		// whoever renames last wins and both wrote the same bytes anyway
+		inline bool store(const std::filesystem::path& path, const asset::ICPUShader* spirv, const double compileMilliseconds) const
+		{
+			const auto* content = spirv->getContent();
+			SFileHeader header = {};
+			header.stage = static_cast<uint32_t>(spirv->getStage());
+			header.compileMicroseconds = static_cast<uint64_t>(compileMilliseconds*1000.0);
+			header.spirvSize = content->getSize();
+
+			return writeFileAtomically(path,[&](std::ofstream& file)->void
+			{
+				file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+				file.write(reinterpret_cast<const char*>(content->getPointer()),content->getSize());
+			});
+		}
+
+		core::smart_refctd_ptr<system::ISystem> m_system;
+		std::filesystem::path m_directory;
+
+		std::atomic<uint32_t> m_hits = 0u;
+		std::atomic<uint32_t> m_misses = 0u;
+		std::atomic<double> m_compileMilliseconds = 0.0;
+		std::atomic<double> m_lookupMilliseconds = 0.0;
+		std::atomic<double> m_savedMilliseconds = 0.0;
+
+};
+
+}
+
+#endif
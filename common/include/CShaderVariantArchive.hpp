@@ -0,0 +1,273 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_SHADER_VARIANT_ARCHIVE_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_SHADER_VARIANT_ARCHIVE_HPP_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AtomicFileWrite.hpp"
+
+namespace nbl::examples
+{
+
+// Packed, indexed archive of precompiled SPIR-V shader variants, written by `71_ShaderVariantPrecompiler`.
+// A variant is identified by a shader name (chosen in the precompiler's manifest, not a path) and the `#define`s it was compiled with,
+// the examples look their variants up instead of string-injecting the defines and compiling at runtime, and fall back to compiling on a miss.
+// Every variant carries a hash of its preprocessed source and compile options, so after a shader or one of its includes changes the stale SPIR-V gets rejected.
+class CShaderVariantArchive
+{
+	public:
+		struct SDefine
+		{
+			std::string_view name;
+			std::string_view value;
+		};
+
+		struct SVariant
+		{
+			std::string key; // from `makeKey`
+			asset::IShader::E_SHADER_STAGE stage;
+			core::blake3_hash_t sourceHash; // from `computeSourceHash`
+			std::vector<uint8_t> spirv;
+		};
+
+		// Canonical, order independent, so the examples don't need to list defines in the same order as the manifest
+		static inline std::string makeKey(const std::string_view shaderName, std::span<const SDefine> defines)
+		{
+			std::vector<SDefine> sorted(defines.begin(),defines.end());
+			std::sort(sorted.begin(),sorted.end(),[](const SDefine& lhs, const SDefine& rhs)->bool{return lhs.name<rhs.name;});
+			std::string key(shaderName);
+			for (const auto& define : sorted)
+			{
+				key += '\n';
+				key += define.name;
+				key += '=';
+				key += define.value;
+			}
+			return key;
+		}
+
+		// Hashes what a variant got compiled from: the preprocessed source (so the contents of every `#include`d file and the defines) and the compile options.
+		// `#line` directives are skipped, they carry the source identifier which is a real path in the precompiler but a virtual one in the examples.
+		// Only whether there's a SPIR-V optimizer gets hashed, not its passes, the precompiler doesn't use one.
+		static inline core::blake3_hash_t computeSourceHash(const std::string_view preprocessed, const asset::IShader::E_SHADER_STAGE stage, const asset::IShaderCompiler::SCompilerOptions& options)
+		{
+			core::blake3_hasher hasher;
+			for (size_t lineBegin=0ull; lineBegin<preprocessed.size(); )
+			{
+				const size_t lineEnd = std::min(preprocessed.find('\n',lineBegin),preprocessed.size());
+				const auto line = preprocessed.substr(lineBegin,lineEnd-lineBegin);
+				if (!line.starts_with("#line"))
+				{
+					hasher.update(line.data(),line.size());
+					hasher.update("\n",1ull);
+				}
+				lineBegin = lineEnd+1ull;
+			}
+			hasher.update(&stage,sizeof(stage));
+			hasher.update(&options.targetSpirvVersion,sizeof(options.targetSpirvVersion));
+			const auto debugInfoFlags = options.debugInfoFlags.value;
+			hasher.update(&debugInfoFlags,sizeof(debugInfoFlags));
+			const bool optimized = options.spirvOptimizer;
+			hasher.update(&optimized,sizeof(optimized));
+			return static_cast<core::blake3_hash_t>(hasher);
+		}
+
+		//! Preprocesses `code` with `options` first, empty if that fails
+		static inline std::optional<core::blake3_hash_t> computeSourceHash(const asset::IShaderCompiler* compiler, const std::string_view code, const asset::IShaderCompiler::SCompilerOptions& options)
+		{
+			auto stage = options.stage;
+			const std::string preprocessed = compiler->preprocessShader(std::string(code),stage,options.preprocessorOptions);
+			if (preprocessed.empty())
+				return std::nullopt;
+			return computeSourceHash(preprocessed,stage,options);
+		}
+
+		//! Maps the archive, returns nullptr if it doesn't exist or isn't one
+		static inline std::unique_ptr<CShaderVariantArchive> open(system::ISystem* system, const std::filesystem::path& path)
+		{
+			std::error_code ec;
+			if (!std::filesystem::exists(path,ec))
+				return nullptr;
+
+			core::smart_refctd_ptr<const system::IFile> file;
+			{
+				system::ISystem::future_t<core::smart_refctd_ptr<system::IFile>> future;
+				system->createFile(future,path,system::IFile::ECF_READ|system::IFile::ECF_MAPPABLE);
+				if (auto lock=future.acquire(); lock)
+					file = *lock;
+			}
+			if (!file || !file->getMappedPointer() || file->getSize()<sizeof(SHeader))
+				return nullptr;
+
+			const auto* data = reinterpret_cast<const uint8_t*>(file->getMappedPointer());
+			SHeader header;
+			memcpy(&header,data,sizeof(header));
+			if (header.magic!=SHeader::Magic || header.version!=SHeader::Version || header.fileSize!=file->getSize())
+				return nullptr;
+			if (sizeof(SHeader)+header.variantCount*sizeof(SIndexEntry)>header.fileSize)
+				return nullptr;
+
+			return std::unique_ptr<CShaderVariantArchive>(new CShaderVariantArchive(std::move(file),header));
+		}
+
+		//! Returns the SPIR-V of the variant or nullptr if the archive doesn't have it, or only has one compiled from something else than `sourceHash` says.
+		//! `outStale` tells the two apart so the caller can warn that the archive needs regenerating.
+		inline core::smart_refctd_ptr<asset::ICPUShader> find(const std::string_view shaderName, std::span<const SDefine> defines, const core::blake3_hash_t& sourceHash, bool* outStale=nullptr) const
+		{
+			if (outStale)
+				*outStale = false;
+
+			const std::string key = makeKey(shaderName,defines);
+			const uint64_t hash = hashKey(key);
+
+			const auto* entries = getEntries();
+			const auto* end = entries+m_header.variantCount;
+			for (auto* it=std::lower_bound(entries,end,hash,[](const SIndexEntry& entry, const uint64_t h)->bool{return entry.keyHash<h;}); it!=end && it->keyHash==hash; it++)
+			{
+				if (getData()+it->keyOffset+it->keyLength>getData()+m_header.fileSize || getData()+it->spirvOffset+it->spirvSize>getData()+m_header.fileSize)
+					return nullptr;
+				if (std::string_view(reinterpret_cast<const char*>(getData()+it->keyOffset),it->keyLength)!=key)
+					continue;
+				if (it->sourceHash!=sourceHash)
+				{
+					if (outStale)
+						*outStale = true;
+					return nullptr;
+				}
+
+				auto spirv = asset::ICPUBuffer::create({it->spirvSize});
+				memcpy(spirv->getPointer(),getData()+it->spirvOffset,it->spirvSize);
+				return core::make_smart_refctd_ptr<asset::ICPUShader>(std::move(spirv),static_cast<asset::IShader::E_SHADER_STAGE>(it->stage),asset::IShader::E_CONTENT_TYPE::ECT_SPIRV,std::string(shaderName));
+			}
+			return nullptr;
+		}
+
+		inline uint32_t getVariantCount() const {return m_header.variantCount;}
+		// variants are only usable on devices supporting at least this SPIR-V version
+		inline asset::IShaderCompiler::E_SPIRV_VERSION getSpirvVersion() const {return static_cast<asset::IShaderCompiler::E_SPIRV_VERSION>(m_header.spirvVersion);}
+
+		//! Packs `variants` into a new archive at `path`, written through a unique temporary so a running example never maps half an archive
+		static inline bool write(const std::filesystem::path& path, const asset::IShaderCompiler::E_SPIRV_VERSION spirvVersion, std::span<const SVariant> variants, uint64_t* outFileSize=nullptr)
+		{
+			SHeader header = {};
+			header.spirvVersion = static_cast<uint32_t>(spirvVersion);
+			header.variantCount = static_cast<uint32_t>(variants.size());
+
+			std::vector<SIndexEntry> entries(variants.size());
+			uint64_t offset = sizeof(SHeader)+sizeof(SIndexEntry)*variants.size();
+			for (size_t i=0; i<variants.size(); i++)
+			{
+				entries[i].keyHash = hashKey(variants[i].key);
+				entries[i].keyOffset = offset;
+				entries[i].keyLength = static_cast<uint32_t>(variants[i].key.size());
+				entries[i].stage = static_cast<uint32_t>(variants[i].stage);
+				entries[i].sourceHash = variants[i].sourceHash;
+				offset += variants[i].key.size();
+			}
+			// SPIR-V is a stream of words, keep it aligned so it could be used in place
+			offset = (offset+3ull)&~3ull;
+			for (size_t i=0; i<variants.size(); i++)
+			{
+				entries[i].spirvOffset = offset;
+				entries[i].spirvSize = variants[i].spirv.size();
+				offset += (variants[i].spirv.size()+3ull)&~3ull;
+			}
+			header.fileSize = offset;
+
+			std::vector<uint32_t> order(variants.size());
+			for (uint32_t i=0u; i<order.size(); i++)
+				order[i] = i;
+			std::sort(order.begin(),order.end(),[&](const uint32_t lhs, const uint32_t rhs)->bool{return entries[lhs].keyHash<entries[rhs].keyHash;});
+
+			const bool written = writeFileAtomically(path,[&](std::ofstream& file)->void
+			{
+				file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+				for (const auto i : order)
+					file.write(reinterpret_cast<const char*>(&entries[i]),sizeof(SIndexEntry));
+				uint64_t written = sizeof(SHeader)+sizeof(SIndexEntry)*variants.size();
+				const char zeros[4] = {};
+				auto padTo = [&](const uint64_t target) -> void
+				{
+					file.write(zeros,target-written);
+					written = target;
+				};
+				for (const auto& variant : variants)
+				{
+					file.write(variant.key.data(),variant.key.size());
+					written += variant.key.size();
+				}
+				for (size_t i=0; i<variants.size(); i++)
+				{
+					padTo(entries[i].spirvOffset);
+					file.write(reinterpret_cast<const char*>(variants[i].spirv.data()),variants[i].spirv.size());
+					written += variants[i].spirv.size();
+				}
+				padTo(header.fileSize);
+			});
+			if (!written)
+				return false;
+			if (outFileSize)
+				*outFileSize = header.fileSize;
+			return true;
+		}
+
+	protected:
+		struct SHeader
+		{
+			constexpr static inline uint32_t Magic = 0x4156534eu; // "NSVA"
+			constexpr static inline uint32_t Version = 2u;
+
+			uint32_t magic = Magic;
+			uint32_t version = Version;
+			uint32_t spirvVersion = 0u;
+			uint32_t variantCount = 0u;
+			uint64_t fileSize = 0ull;
+		};
+		// sorted by `keyHash`
+		struct SIndexEntry
+		{
+			uint64_t keyHash;
+			uint64_t keyOffset;
+			uint64_t spirvOffset;
+			uint64_t spirvSize;
+			uint32_t keyLength;
+			uint32_t stage;
+			core::blake3_hash_t sourceHash;
+		};
+
+		inline CShaderVariantArchive(core::smart_refctd_ptr<const system::IFile>&& file, const SHeader& header) : m_file(std::move(file)), m_header(header) {}
+
+		static inline uint64_t hashKey(const std::string_view key)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for (const char c : key)
+			{
+				hash ^= static_cast<uint8_t>(c);
+				hash *= 0x100000001b3ull;
+			}
+			return hash;
+		}
+
+		inline const uint8_t* getData() const {return reinterpret_cast<const uint8_t*>(m_file->getMappedPointer());}
+		inline const SIndexEntry* getEntries() const {return reinterpret_cast<const SIndexEntry*>(getData()+sizeof(SHeader));}
+
+		core::smart_refctd_ptr<const system::IFile> m_file;
+		SHeader m_header;
+};
+
+}
+
+#endif
@@ -0,0 +1,214 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_C_STREAMING_BUFFER_TELEMETRY_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_C_STREAMING_BUFFER_TELEMETRY_HPP_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+
+namespace nbl::examples
+{
+
+// Stands between a `StreamingTransientDataBufferMT` (or anything with the same `multi_allocate`/`multi_deallocate` interface) and its user
+// to measure how full it gets, how long allocations wait, how many bytes sit in deferred frees whose semaphore hasn't signalled yet and how often
+// an allocation can't be satisfied right away. Byte counts are of the requested sizes, alignment padding isn't visible from the outside.
+// Deferred frees are tracked by latching a tiny object alongside them, the buffer drops it exactly when the free actually happens.
+template<class StreamingBuffer>
+class CStreamingBufferTelemetry
+{
+	public:
+		using size_type = typename StreamingBuffer::size_type;
+		using value_type = typename StreamingBuffer::value_type;
+
+		struct SStats
+		{
+			inline double getFillLevel() const {return totalBytes ? double(inUseBytes)/double(totalBytes):0.0;}
+			inline double getPeakFillLevel() const {return totalBytes ? double(peakInUseBytes)/double(totalBytes):0.0;}
+			inline double getAverageWaitMs() const {return failedAllocations ? double(waitNs)*1e-6/double(failedAllocations):0.0;}
+
+			size_t totalBytes = 0ull;
+			// allocated and not freed yet, including what's in `deferredFreeBytes`
+			size_t inUseBytes = 0ull;
+			size_t peakInUseBytes = 0ull;
+			// handed to `multi_deallocate` but still waiting on their semaphore
+			size_t deferredFreeBytes = 0ull;
+			uint32_t deferredFrees = 0u;
+			uint64_t allocations = 0ull;
+			// calls which couldn't allocate everything without waiting for a deferred free
+			uint64_t failedAllocations = 0ull;
+			uint64_t waitNs = 0ull;
+			uint64_t maxWaitNs = 0ull;
+		};
+
+		inline CStreamingBufferTelemetry(StreamingBuffer* buffer) : m_buffer(buffer) {}
+
+		inline StreamingBuffer* getBuffer() const {return m_buffer;}
+
+		//! Same semantics as the buffer's, `offsets` need to be primed with `invalid_value`. Tries once without blocking first so a wait gets counted as a failure.
+		template<class Clock=std::chrono::steady_clock>
+		inline size_type multi_allocate(const std::chrono::time_point<Clock>& maxWaitPoint, const uint32_t count, value_type* offsets, const size_type* sizes, const size_type* alignments)
+		{
+			size_type unallocated = m_buffer->multi_allocate(Clock::now(),count,offsets,sizes,alignments);
+			if (unallocated)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				unallocated = m_buffer->multi_allocate(maxWaitPoint,count,offsets,sizes,alignments);
+				const uint64_t waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+				m_failedAllocations++;
+				m_waitNs += waited;
+				atomicMax(m_maxWaitNs,waited);
+			}
+			m_allocations++;
+
+			size_t allocated = 0ull;
+			for (uint32_t i=0u; i<count; i++)
+			if (offsets[i]!=StreamingBuffer::invalid_value)
+				allocated += sizes[i];
+			atomicMax(m_peakInUseBytes,m_inUseBytes+=allocated);
+			return unallocated;
+		}
+
+		//! Latches the free like the buffer does, `objectsToDrop` (one per allocation or null) still get dropped when it happens.
+		//! The telemetry has to outlive all the frees it latched, so `cull_frees` till there's none left before destroying it.
+		template<typename T=core::IReferenceCounted>
+		inline void multi_deallocate(const uint32_t count, const value_type* offsets, const size_type* sizes, const video::ISemaphore::SWaitInfo& futureWait, T* const* objectsToDrop=nullptr)
+		{
+			core::vector<core::smart_refctd_ptr<CDeferredFree>> trackers(count);
+			core::vector<core::IReferenceCounted*> trackerPtrs(count);
+			size_t deferredBytes = 0ull;
+			for (uint32_t i=0u; i<count; i++)
+			{
+				const size_t bytes = offsets[i]!=StreamingBuffer::invalid_value ? sizes[i]:0ull;
+				deferredBytes += bytes;
+				trackers[i] = core::make_smart_refctd_ptr<CDeferredFree>(this,bytes,core::smart_refctd_ptr<core::IReferenceCounted>(objectsToDrop ? static_cast<core::IReferenceCounted*>(objectsToDrop[i]):nullptr));
+				trackerPtrs[i] = trackers[i].get();
+			}
+			m_deferredFreeBytes += deferredBytes;
+			m_deferredFrees += count;
+			m_buffer->multi_deallocate(count,offsets,sizes,futureWait,trackerPtrs.data());
+		}
+
+		inline SStats getStats() const
+		{
+			SStats stats = {};
+			stats.totalBytes = m_buffer->get_total_size();
+			stats.inUseBytes = m_inUseBytes;
+			stats.peakInUseBytes = m_peakInUseBytes;
+			stats.deferredFreeBytes = m_deferredFreeBytes;
+			stats.deferredFrees = m_deferredFrees;
+			stats.allocations = m_allocations;
+			stats.failedAllocations = m_failedAllocations;
+			stats.waitNs = m_waitNs;
+			stats.maxWaitNs = m_maxWaitNs;
+			return stats;
+		}
+
+		inline void logStats(system::ILogger* logger, const char* name) const
+		{
+			const auto stats = getStats();
+			logger->log("%s streaming buffer: %.1f%% full (peak %.1f%%), %zu bytes in %u deferred frees, %llu of %llu allocations waited for %.3f ms on average (%.3f ms max)",system::ILogger::ELL_PERFORMANCE,
+				name,stats.getFillLevel()*100.0,stats.getPeakFillLevel()*100.0,stats.deferredFreeBytes,stats.deferredFrees,static_cast<unsigned long long>(stats.failedAllocations),static_cast<unsigned long long>(stats.allocations),stats.getAverageWaitMs(),double(stats.maxWaitNs)*1e-6);
+		}
+
+	protected:
+		// dropped by the buffer when the latched free executes, drops the user's object before counting the bytes as free
+		class CDeferredFree final : public core::IReferenceCounted
+		{
+			public:
+				inline CDeferredFree(CStreamingBufferTelemetry* owner, const size_t bytes, core::smart_refctd_ptr<core::IReferenceCounted>&& objectToDrop)
+					: m_owner(owner), m_bytes(bytes), m_objectToDrop(std::move(objectToDrop)) {}
+
+			protected:
+				inline ~CDeferredFree()
+				{
+					m_objectToDrop = nullptr;
+					m_owner->m_inUseBytes -= m_bytes;
+					m_owner->m_deferredFreeBytes -= m_bytes;
+					m_owner->m_deferredFrees--;
+				}
+
+				CStreamingBufferTelemetry* const m_owner;
+				const size_t m_bytes;
+				core::smart_refctd_ptr<core::IReferenceCounted> m_objectToDrop;
+		};
+
+		template<typename T>
+		static inline void atomicMax(std::atomic<T>& target, const T value)
+		{
+			for (T old=target.load(); old<value && !target.compare_exchange_weak(old,value); ) {}
+		}
+
+		StreamingBuffer* const m_buffer;
+		std::atomic<size_t> m_inUseBytes = 0ull;
+		std::atomic<size_t> m_peakInUseBytes = 0ull;
+		std::atomic<size_t> m_deferredFreeBytes = 0ull;
+		std::atomic<uint32_t> m_deferredFrees = 0u;
+		std::atomic<uint64_t> m_allocations = 0ull;
+		std::atomic<uint64_t> m_failedAllocations = 0ull;
+		std::atomic<uint64_t> m_waitNs = 0ull;
+		std::atomic<uint64_t> m_maxWaitNs = 0ull;
+};
+
+// Sizes jobs which suballocate from one or more streaming buffers so that the buffers hover around a target occupancy: a job takes as much of the
+// pending work as the headroom below the target allows, so when frees lag behind the jobs get smaller instead of blocking in `multi_allocate`,
+// and when there's room several requests get batched into one bigger dispatch.
+class CAdaptiveBatchSizer
+{
+	public:
+		struct SBufferUsage
+		{
+			size_t totalBytes;
+			// should include deferred frees, those bytes can't be handed out either
+			size_t inUseBytes;
+			size_t bytesPerElement;
+		};
+
+		inline CAdaptiveBatchSizer(const float targetOccupancy, const uint32_t minBatch, const uint32_t maxBatch)
+			: m_targetOccupancy(targetOccupancy), m_minBatch(minBatch), m_maxBatch(maxBatch) {}
+
+		//! How many of the `pending` elements the next job should process, never more than `pending`
+		inline uint32_t next(const uint64_t pending, std::initializer_list<SBufferUsage> buffers)
+		{
+			uint64_t headroom = m_maxBatch;
+			for (const auto& buffer : buffers)
+			{
+				const size_t target = static_cast<size_t>(double(buffer.totalBytes)*m_targetOccupancy);
+				const size_t free = target>buffer.inUseBytes ? (target-buffer.inUseBytes):0ull;
+				headroom = std::min<uint64_t>(headroom,free/buffer.bytesPerElement);
+			}
+			// below the minimum we'd rather wait a little than flood the queue with tiny dispatches
+			if (headroom<m_minBatch)
+				m_throttled++;
+			const uint64_t batch = std::min(std::max<uint64_t>(headroom,m_minBatch),pending);
+			if (batch<pending)
+				m_split++;
+			m_batches++;
+			m_elements += batch;
+			return static_cast<uint32_t>(batch);
+		}
+
+		inline void logStats(system::ILogger* logger) const
+		{
+			logger->log("Adaptive batching at %.0f%% target occupancy: %llu jobs of %.0f elements on average, %llu left work pending, %llu throttled to the minimum size",system::ILogger::ELL_PERFORMANCE,
+				m_targetOccupancy*100.0,static_cast<unsigned long long>(m_batches),m_batches ? double(m_elements)/double(m_batches):0.0,static_cast<unsigned long long>(m_split),static_cast<unsigned long long>(m_throttled));
+		}
+
+	protected:
+		const double m_targetOccupancy;
+		const uint32_t m_minBatch;
+		const uint32_t m_maxBatch;
+		uint64_t m_batches = 0ull;
+		uint64_t m_elements = 0ull;
+		uint64_t m_split = 0ull;
+		uint64_t m_throttled = 0ull;
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+// Copyright (C) 2024-2024 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_PARALLEL_FOR_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_PARALLEL_FOR_HPP_INCLUDED_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace nbl::examples
+{
+
+// How many workers the CPU paths of the examples should use when the user doesn't say otherwise
+inline uint32_t getDefaultWorkerCount()
+{
+	return std::max(std::thread::hardware_concurrency(),1u);
+}
+
+// Splits `[0,count)` into chunks of `grainSize` and hands them out dynamically (atomic counter) to `workerCount` threads,
+// the calling thread participates as worker 0 so a single worker never spawns anything.
+// The functor gets called as `f(begin,end,workerIx)` so it can index per-worker scratch memory without any locking.
+template<typename F>
+inline void parallelFor(const size_t count, F&& f, uint32_t workerCount=0u, size_t grainSize=0ull)
+{
+	if (count==0ull)
+		return;
+	if (workerCount==0u)
+		workerCount = getDefaultWorkerCount();
+	if (grainSize==0ull) // aim for a few chunks per worker so stragglers can get balanced out
+		grainSize = std::max<size_t>((count+workerCount*4ull-1ull)/(workerCount*4ull),1ull);
+	const size_t chunkCount = (count+grainSize-1ull)/grainSize;
+	workerCount = static_cast<uint32_t>(std::min<size_t>(workerCount,chunkCount));
+
+	std::atomic<size_t> nextChunk = 0ull;
+	auto work = [&](const uint32_t workerIx) -> void
+	{
+		for (size_t chunk=nextChunk++; chunk<chunkCount; chunk=nextChunk++)
+		{
+			const size_t begin = chunk*grainSize;
+			f(begin,std::min(begin+grainSize,count),workerIx);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workerCount-1u);
+	for (uint32_t i=1u; i<workerCount; i++)
+		threads.emplace_back(work,i);
+	work(0u);
+	for (auto& thread : threads)
+		thread.join();
+}
+
+}
+
+#endif
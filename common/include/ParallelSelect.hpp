@@ -0,0 +1,102 @@
+// Copyright (C) 2024-2025 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _NBL_EXAMPLES_COMMON_PARALLEL_SELECT_HPP_INCLUDED_
+#define _NBL_EXAMPLES_COMMON_PARALLEL_SELECT_HPP_INCLUDED_
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "ParallelFor.hpp"
+
+namespace nbl::examples
+{
+
+// Maps 32bit scalars onto `uint32_t` keys which sort the same way, so selection can work on the bits (NaNs not supported)
+template<typename T>
+struct radix_select_key
+{
+	static_assert(sizeof(T)==sizeof(uint32_t) && (std::is_integral_v<T> || std::is_same_v<T,float>));
+
+	static inline uint32_t encode(const T value)
+	{
+		const uint32_t bits = std::bit_cast<uint32_t>(value);
+		if constexpr (std::is_same_v<T,float>) // negative floats sort backwards
+			return bits^((bits>>31u) ? 0xffffffffu:0x80000000u);
+		else if constexpr (std::is_signed_v<T>)
+			return bits^0x80000000u;
+		else
+			return bits;
+	}
+	static inline T decode(const uint32_t key)
+	{
+		if constexpr (std::is_same_v<T,float>)
+			return std::bit_cast<T>(key^((key>>31u) ? 0x80000000u:0xffffffffu));
+		else if constexpr (std::is_signed_v<T>)
+			return std::bit_cast<T>(key^0x80000000u);
+		else
+			return std::bit_cast<T>(key);
+	}
+};
+
+// Returns the value `std::nth_element` would place at `data[n]`, but without reordering anything. Radix select over the key bits, most significant digit first:
+// every pass histograms the digit of all elements which share the prefix found so far in parallel, then picks the bucket the `n`-th element falls into.
+// Three read-only passes over the data no matter the distribution, unlike quick-select which is serial and takes more passes on unlucky pivots.
+template<typename T>
+inline T parallelNthElement(std::span<const T> data, size_t n, uint32_t workerCount=0u)
+{
+	using key_t = radix_select_key<T>;
+	assert(n<data.size());
+
+	// below this the threads cost more than they save
+	constexpr size_t ParallelThreshold = 0x1ull<<16;
+	if (workerCount==0u)
+		workerCount = getDefaultWorkerCount();
+	if (data.size()<ParallelThreshold)
+		workerCount = 1u;
+
+	constexpr uint32_t DigitBits[3] = {11u,11u,10u};
+	constexpr uint32_t MaxBucketCount = 0x1u<<DigitBits[0];
+	std::vector<size_t> histograms(size_t(workerCount)*MaxBucketCount);
+	uint32_t prefix = 0u, prefixMask = 0u, shift = 32u;
+	for (const auto digitBits : DigitBits)
+	{
+		shift -= digitBits;
+		const uint32_t digitMask = (0x1u<<digitBits)-1u;
+		std::fill(histograms.begin(),histograms.end(),0ull);
+		parallelFor(data.size(),[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+		{
+			size_t* histogram = histograms.data()+size_t(workerIx)*MaxBucketCount;
+			for (size_t i=begin; i<end; i++)
+			{
+				const uint32_t key = key_t::encode(data[i]);
+				if ((key&prefixMask)==prefix)
+					histogram[(key>>shift)&digitMask]++;
+			}
+		},workerCount);
+
+		// find the bucket holding the `n`-th of the remaining candidates
+		uint32_t bucket = 0u;
+		for (; bucket<digitMask; bucket++)
+		{
+			size_t count = 0ull;
+			for (uint32_t w=0u; w<workerCount; w++)
+				count += histograms[size_t(w)*MaxBucketCount+bucket];
+			if (n<count)
+				break;
+			n -= count;
+		}
+		prefix |= bucket<<shift;
+		prefixMask |= digitMask<<shift;
+	}
+	return key_t::decode(prefix);
+}
+
+}
+
+#endif
@@ -8,6 +8,11 @@
 #include "../common/CommonAPI.h"
 #include "CCamera.hpp"
 
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
 #include <btBulletDynamicsCommon.h>
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 
@@ -29,6 +34,7 @@ class CInstancedMotionState : public ext::Bullet3::IMotionStateBase
 			: ext::Bullet3::IMotionStateBase(ext::Bullet3::convertMatrixSIMD(start_mat)), m_correctionMatrix(ext::Bullet3::convertMatrixSIMD(correction_mat)), m_instancePool(instancePool), m_objectID(objectID), m_instanceID(instanceID)
 		{
 			m_cachedMat = m_startWorldTrans * m_correctionMatrix.inverse();
+			m_published = start_mat;
 		}
 
 		inline ~CInstancedMotionState()
@@ -42,26 +48,215 @@ class CInstancedMotionState : public ext::Bullet3::IMotionStateBase
 
 		inline virtual void setWorldTransform(const btTransform& worldTrans) override
 		{
-			// TODO: protect agains simulation "substeps" somehow (redundant update sets)
 			m_cachedMat = worldTrans;
+			s_setCount++;
+			// every substep sets the transform again, only mark the body once and publish the last one
+			if (!m_dirty)
+			{
+				m_dirty = true;
+				s_dirty.push_back(this);
+			}
+		}
 
-			s_updateAddresses.push_back(m_objectID);
-			s_updateData.push_back(ext::Bullet3::convertbtTransform(m_cachedMat * m_correctionMatrix));
+		//! Appends the transform for upload if it differs from the last one published, clears the dirty mark
+		inline bool publish(core::vector<uint32_t>& addresses, core::vector<core::matrix3x4SIMD>& transforms)
+		{
+			m_dirty = false;
+			const auto transform = ext::Bullet3::convertbtTransform(m_cachedMat * m_correctionMatrix);
+			if (memcmp(&transform, &m_published, sizeof(transform)) == 0)
+				return false;
+			m_published = transform;
+			addresses.push_back(m_objectID);
+			transforms.push_back(transform);
+			return true;
 		}
 
 		inline auto getInstancePool() const {return m_instancePool;}
 		inline auto getObjectID() const {return m_objectID;}
 		inline auto getInstanceID() const {return m_instanceID;}
 
-		static core::vector<uint32_t> s_updateAddresses;
-		static core::vector<core::matrix3x4SIMD> s_updateData;
+		// only touched by whichever thread steps the world
+		static core::vector<CInstancedMotionState*> s_dirty;
+		static uint64_t s_setCount;
 	protected:
 		btTransform m_cachedMat;
+		core::matrix3x4SIMD m_published;
 		uint32_t m_objectID,m_instanceID;
 		const void* m_instancePool;
+		bool m_dirty = false;
+};
+core::vector<CInstancedMotionState*> CInstancedMotionState::s_dirty;
+uint64_t CInstancedMotionState::s_setCount = 0ull;
+
+// Steps a world on a worker thread at a fixed timestep, so the simulation only depends on the number of substeps taken and not on the frame times,
+// while the main thread records and submits the frame. The transforms of the bodies that moved get collected into one of two output buffers,
+// the main thread reads the other one, so the upload of a step's results never races the next step.
+class CPhysicsStepper
+{
+	public:
+		static constexpr btScalar FixedTimeStep = btScalar(1) / btScalar(60);
+		static constexpr int MaxSubSteps = 4;
+
+		struct SOutput
+		{
+			// object pool addresses and transforms of the bodies whose transform changed
+			core::vector<uint32_t> addresses;
+			core::vector<core::matrix3x4SIMD> transforms;
+			uint32_t substeps = 0u;
+			uint64_t transformSets = 0ull; // what the old path would have uploaded, one per body per substep
+			double seconds = 0.0;
+
+			inline size_t getTransferSize() const { return addresses.size() * (sizeof(uint32_t) + sizeof(core::matrix3x4SIMD)); }
+		};
+
+		CPhysicsStepper(btDynamicsWorld* world) : m_world(world), m_thread(&CPhysicsStepper::threadMain, this) {}
+		~CPhysicsStepper()
+		{
+			wait();
+			{
+				std::lock_guard lock(m_mutex);
+				m_quit = true;
+			}
+			m_kicked.notify_one();
+			m_thread.join();
+		}
+
+		//! Starts simulating `dt` seconds, the world and its bodies mustn't be touched until `wait` returns
+		inline void kick(const double dt)
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				assert(!m_busy);
+				m_dt = dt;
+				m_busy = true;
+			}
+			m_kicked.notify_one();
+		}
+
+		//! Waits for the step in flight, its output stays valid until the next call, empty if nothing got kicked since the last call
+		inline const SOutput& wait()
+		{
+			std::unique_lock lock(m_mutex);
+			m_done.wait(lock, [this]() -> bool { return !m_busy; });
+			if (m_fresh)
+			{
+				m_front ^= 1u;
+				m_fresh = false;
+			}
+			else
+				m_outputs[m_front] = {};
+			return m_outputs[m_front];
+		}
+
+	protected:
+		inline void threadMain()
+		{
+			std::unique_lock lock(m_mutex);
+			while (true)
+			{
+				m_kicked.wait(lock, [this]() -> bool { return m_quit || m_busy; });
+				if (m_quit)
+					return;
+				const double dt = m_dt;
+				auto& output = m_outputs[m_front ^ 1u];
+				lock.unlock();
+				step(dt, output);
+				lock.lock();
+				m_busy = false;
+				m_fresh = true;
+				m_done.notify_all();
+			}
+		}
+
+		inline void step(const double dt, SOutput& output)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			output.addresses.clear();
+			output.transforms.clear();
+			const uint64_t setsBefore = CInstancedMotionState::s_setCount;
+			output.substeps = m_world->stepSimulation(btScalar(dt), MaxSubSteps, FixedTimeStep);
+			output.transformSets = CInstancedMotionState::s_setCount - setsBefore;
+			for (auto* motionState : CInstancedMotionState::s_dirty)
+				motionState->publish(output.addresses, output.transforms);
+			CInstancedMotionState::s_dirty.clear();
+			output.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		btDynamicsWorld* m_world;
+		SOutput m_outputs[2];
+		uint32_t m_front = 0u;
+		double m_dt = 0.0;
+		bool m_busy = false;
+		bool m_fresh = false;
+		bool m_quit = false;
+		std::mutex m_mutex;
+		std::condition_variable m_kicked, m_done;
+		std::thread m_thread;
 };
-core::vector<uint32_t> CInstancedMotionState::s_updateAddresses;
-core::vector<core::matrix3x4SIMD> CInstancedMotionState::s_updateData;
+
+// Headless throughput of `CPhysicsStepper`, a grid of sphere stacks falls onto a plate and gets stepped in 30Hz frames of two 60Hz substeps
+static void benchmarkPhysicsStepping(system::ILogger* logger, const uint32_t bodyCount)
+{
+	auto world = ext::Bullet3::CPhysicsWorld::create();
+	world->getWorld()->setGravity(btVector3(0, -5, 0));
+
+	ext::Bullet3::CPhysicsWorld::RigidBodyData plateData;
+	plateData.mass = 0.0f;
+	plateData.shape = world->createbtObject<btBoxShape>(btVector3(64, 1, 64));
+	plateData.trans = core::matrix3x4SIMD().setTranslation(core::vectorSIMDf(0.0, -1.0, 0.0));
+	auto* plate = world->createRigidBody(plateData);
+	world->bindRigidBody(plate);
+
+	ext::Bullet3::CPhysicsWorld::RigidBodyData sphereData;
+	sphereData.mass = 1.0f;
+	sphereData.shape = world->createbtObject<btSphereShape>(0.5);
+	{
+		btVector3 inertia;
+		sphereData.shape->calculateLocalInertia(sphereData.mass, inertia);
+		sphereData.inertia = ext::Bullet3::frombtVec3(inertia);
+	}
+	constexpr uint32_t GridSide = 48u;
+	core::vector<btRigidBody*> bodies(bodyCount);
+	for (uint32_t i = 0u; i < bodyCount; i++)
+	{
+		const uint32_t column = i % (GridSide * GridSide);
+		sphereData.trans = core::matrix3x4SIMD().setTranslation(core::vectorSIMDf(float(column % GridSide) * 1.25f - 30.f, 1.f + float(i / (GridSide * GridSide)) * 1.5f, float(column / GridSide) * 1.25f - 30.f));
+		bodies[i] = world->createRigidBody(sphereData);
+		world->bindRigidBody<CInstancedMotionState>(bodies[i], nullptr, i, i, sphereData.trans, core::matrix3x4SIMD());
+	}
+
+	constexpr uint32_t FrameCount = 600u;
+	uint64_t substeps = 0ull, uploaded = 0ull, transformSets = 0ull;
+	double stepSeconds = 0.0;
+	size_t transferred = 0ull;
+	{
+		CPhysicsStepper stepper(world->getWorld());
+		for (uint32_t frame = 0u; frame < FrameCount; frame++)
+		{
+			stepper.kick(1.0 / 30.0);
+			const auto& output = stepper.wait();
+			substeps += output.substeps;
+			uploaded += output.addresses.size();
+			transformSets += output.transformSets;
+			transferred += output.getTransferSize();
+			stepSeconds += output.seconds;
+		}
+	}
+	constexpr size_t BytesPerUpdate = sizeof(uint32_t) + sizeof(core::matrix3x4SIMD);
+	logger->log("Physics stepping benchmark: %u bodies, %llu substeps, %.2f M bodies simulated/s, %.1f KiB transferred per frame (%.1f KiB when uploading every substep's set)", system::ILogger::ELL_PERFORMANCE,
+		bodyCount, substeps, double(bodyCount) * double(substeps) / stepSeconds * 1e-6, double(transferred) / double(FrameCount) / 1024.0, double(transformSets * BytesPerUpdate) / double(FrameCount) / 1024.0);
+	logger->log("%.1f%% of the bodies uploaded per frame on average", system::ILogger::ELL_PERFORMANCE, 100.0 * double(uploaded) / double(FrameCount) / double(bodyCount));
+
+	for (auto* body : bodies)
+	{
+		world->unbindRigidBody(body);
+		world->deleteRigidBody(body);
+	}
+	world->unbindRigidBody(plate, false);
+	world->deleteRigidBody(plate);
+	world->deletebtObject(plateData.shape);
+	world->deletebtObject(sphereData.shape);
+}
 
 class BulletSampleApp : public ApplicationBase
 {
@@ -78,6 +273,9 @@ public:
 
 	static constexpr uint64_t MAX_TIMEOUT = 99999999999999ull;
 	static constexpr uint32_t TransformPropertyID = 1u;
+	// runs `benchmarkPhysicsStepping` before the demo starts
+	static constexpr bool BenchmarkPhysicsStepping = false;
+	static constexpr uint32_t BenchmarkBodyCount = 8192u;
 
 	enum E_OBJECT
 	{
@@ -127,6 +325,7 @@ public:
 	double m_dtList[MaxFramesToAverage] = { 0.0 };
 
 	core::smart_refctd_ptr<ext::Bullet3::CPhysicsWorld> m_world = nullptr;
+	std::unique_ptr<CPhysicsStepper> m_physics = nullptr;
 	btRigidBody* m_basePlateBody = nullptr;
 	ext::Bullet3::CPhysicsWorld::RigidBodyData m_basePlateRigidBodyData;
 	core::smart_refctd_ptr<object_property_pool_t> m_objectPool;
@@ -276,6 +475,9 @@ public:
 		for (uint32_t i = 0u; i < FRAMES_IN_FLIGHT; i++)
 			logicalDevice->createCommandBuffers(computeCommandPool[i].get(), video::IGPUCommandBuffer::EL_PRIMARY, 1, propXferCmdbuf+i);
 
+		if constexpr (BenchmarkPhysicsStepping)
+			benchmarkPhysicsStepping(logger.get(), BenchmarkBodyCount);
+
 		// Physics Setup
 		m_world = ext::Bullet3::CPhysicsWorld::create();
 		m_world->getWorld()->setGravity(btVector3(0, -5, 0));
@@ -697,6 +899,9 @@ public:
 
 		double dt = 0;
 
+		// all bodies are in, from now on the world only gets touched between `m_physics->wait()` and `m_physics->kick()`
+		m_physics = std::make_unique<CPhysicsStepper>(m_world->getWorld());
+
 		// Camera 
 		core::vectorSIMDf cameraPosition(0, 5, -10);
 		core::matrix4SIMD proj = core::matrix4SIMD::buildProjectionMatrixPerspectiveFovRH(core::radians(60.0f), float(WIN_W) / WIN_H, 0.01f, 500.0f);
@@ -708,6 +913,8 @@ public:
 
 	void onAppTerminated_impl() override
 	{
+		m_physics = nullptr;
+
 		m_world->unbindRigidBody(m_basePlateBody, false);
 		m_world->deleteRigidBody(m_basePlateBody);
 		m_world->deletebtObject(m_basePlateRigidBodyData.shape);
@@ -806,25 +1013,23 @@ public:
 			const asset::E_PIPELINE_STAGE_FLAGS* stagesToWaitForPerSemaphore = &CommonAPI::DefaultSubmitWaitStage;
 			// Update instances buffer 
 			{
-				// Update Physics (TODO: fixed timestep)
-				m_world->getWorld()->stepSimulation(m_dt);
+				// Physics got stepped since the end of last frame, only the bodies which moved are in the output
+				const auto& physicsOutput = m_physics->wait();
 
 				video::CPropertyPoolHandler::UpStreamingRequest request;
 				request.setFromPool(m_objectPool.get(), TransformPropertyID);
 				request.fill = false;
-				request.elementCount = CInstancedMotionState::s_updateAddresses.size();
+				request.elementCount = physicsOutput.addresses.size();
 				request.source.device2device = false;
-				request.source.data = CInstancedMotionState::s_updateData.data();
+				request.source.data = physicsOutput.transforms.data();
 				request.srcAddresses = nullptr;
-				request.dstAddresses = CInstancedMotionState::s_updateAddresses.data();
+				request.dstAddresses = physicsOutput.addresses.data();
 				// TODO: why does the very first update set matrices to identity?
 				auto* pRequests = &request;
 				const auto leftoverDWORDs = propertyPoolHandler->transferProperties(
 					utilities->getDefaultUpStreamingBuffer(), cb.get(), fence.get(), queues[CommonAPI::InitOutput::EQT_GRAPHICS], scratch,
 					pRequests, 1u, waitSemaphoreCount, semaphoresToWait, stagesToWaitForPerSemaphore, logger.get()
 				);
-				CInstancedMotionState::s_updateAddresses.clear();
-				CInstancedMotionState::s_updateData.clear();
 			}
 			// erase, done after update to avoid having a situation where we update stuff we just erased (also erase moves data items around)
 			{
@@ -869,6 +1074,8 @@ public:
 					);
 				}
 			}
+			// world is done being modified for this frame, step it while the frame gets recorded and rendered
+			m_physics->kick(m_dt * 0.001);
 			// last barrier is always to vertex and compute stages
 			memBarrier.dstAccessMask |= asset::EAF_VERTEX_ATTRIBUTE_READ_BIT;
 			cb->pipelineBarrier(
@@ -0,0 +1,407 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _C_MITSUBA_MESH_CACHE_H_INCLUDED_
+#define _C_MITSUBA_MESH_CACHE_H_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "AtomicFileWrite.hpp"
+#include "ParallelFor.hpp"
+
+// The Mitsuba loader parses the scene XML and then loads every `obj`, `ply` and `serialized` shape it references one after the other.
+// This finds those mesh files up front, loads them on a pool of workers and puts them into the asset manager's cache, so the Mitsuba loader's
+// own `getAsset` calls become cache hits. The geometry of every loaded file also gets written to a binary cache keyed by a hash of the file's
+// contents, which gets memory mapped instead of running the mesh loader (and its normal quantization) on the next load of a scene using that file.
+class CMitsubaMeshCache
+{
+	public:
+		struct SStats
+		{
+			uint32_t meshFiles = 0u;
+			uint32_t cacheHits = 0u;
+			uint32_t failed = 0u;
+			double seconds = 0.0;
+		};
+
+		CMitsubaMeshCache(const std::filesystem::path& cacheDir) : m_cacheDir(cacheDir) {}
+
+		//! `params.workingDirectory` has to be the directory of the XML, same as for the `getAsset` of the scene itself
+		SStats prefetch(nbl::asset::IAssetManager* assetManager, nbl::system::ISystem* system, const std::string& xmlFilename, const nbl::asset::IAssetLoader::SAssetLoadParams& params, const uint32_t workerCount=0u) const
+		{
+			using namespace nbl;
+			const auto start = std::chrono::steady_clock::now();
+			SStats stats = {};
+
+			std::vector<uint8_t> xml;
+			if (!readFile(system,params.workingDirectory/xmlFilename,xml))
+				return stats;
+			const auto meshFiles = findMeshFiles(std::string_view(reinterpret_cast<const char*>(xml.data()),xml.size()));
+			stats.meshFiles = static_cast<uint32_t>(meshFiles.size());
+
+			std::vector<asset::SAssetBundle> fromCache(meshFiles.size());
+			std::atomic<uint32_t> cacheHits = 0u, failed = 0u;
+			nbl::examples::parallelFor(meshFiles.size(),[&](const size_t begin, const size_t end, const uint32_t workerIx)->void
+			{
+				std::vector<uint8_t> contents;
+				for (size_t i=begin; i<end; i++)
+				{
+					const auto path = params.workingDirectory/meshFiles[i];
+					if (!readFile(system,path,contents))
+					{
+						failed++;
+						continue;
+					}
+					const auto cachePath = m_cacheDir/(hashToString(hashContents(meshFiles[i],contents))+".nmsh");
+					if (fromCache[i]=load(system,cachePath); !fromCache[i].getContents().empty())
+					{
+						cacheHits++;
+						continue;
+					}
+					// same filename and working directory as the Mitsuba loader will use, so the asset manager caches it under the same key
+					auto bundle = assetManager->getAsset(meshFiles[i],params);
+					if (bundle.getContents().empty())
+					{
+						failed++;
+						continue;
+					}
+					store(cachePath,bundle);
+				}
+			},workerCount,1ull);
+
+			for (size_t i=0; i<meshFiles.size(); i++)
+			if (!fromCache[i].getContents().empty())
+			{
+				fromCache[i].setNewCacheKey((params.workingDirectory/meshFiles[i]).string());
+				assetManager->insertAssetIntoCache(fromCache[i]);
+			}
+
+			stats.cacheHits = cacheHits;
+			stats.failed = failed;
+			stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+			return stats;
+		}
+
+	protected:
+		constexpr static inline uint32_t MaxBindings = nbl::asset::ICPUMeshBuffer::MAX_ATTR_BUF_BINDING_COUNT;
+		constexpr static inline uint32_t InvalidBuffer = ~0u;
+
+		struct SHeader
+		{
+			constexpr static inline uint32_t Magic = 0x43534d4eu; // "NMSC"
+			constexpr static inline uint32_t Version = 1u;
+
+			uint32_t magic = Magic;
+			uint32_t version = Version;
+			uint32_t meshCount = 0u;
+			uint32_t meshBufferCount = 0u;
+			uint32_t bufferCount = 0u;
+			uint32_t padding = 0u;
+			uint64_t fileSize = 0ull;
+		};
+		struct SBufferEntry
+		{
+			uint64_t offset;
+			uint64_t size;
+		};
+		struct SMeshEntry
+		{
+			uint32_t firstMeshBuffer;
+			uint32_t meshBufferCount;
+			float aabb[6];
+		};
+		// only what the Mitsuba loader keeps, it replaces the pipelines and descriptor sets with its own
+		struct SMeshBufferEntry
+		{
+			nbl::asset::SVertexInputParams vertexInput;
+			nbl::asset::SPrimitiveAssemblyParams primitiveAssembly;
+			uint64_t vertexBufferOffsets[MaxBindings];
+			uint32_t vertexBuffers[MaxBindings];
+			uint64_t indexBufferOffset;
+			uint32_t indexBuffer;
+			uint32_t indexType;
+			uint32_t indexCount;
+			int32_t baseVertex;
+			uint32_t instanceCount;
+			uint32_t positionAttribute;
+			uint32_t normalAttribute;
+			float aabb[6];
+		};
+		static_assert(std::is_trivially_copyable_v<SMeshBufferEntry>);
+
+		static bool readFile(nbl::system::ISystem* system, const nbl::system::path& path, std::vector<uint8_t>& contents)
+		{
+			using namespace nbl;
+			system::ISystem::future_t<core::smart_refctd_ptr<system::IFile>> future;
+			system->createFile(future,path,system::IFile::ECF_READ);
+			auto file = future.get();
+			if (!file)
+				return false;
+			contents.resize(file->getSize());
+			system::IFile::success_t success;
+			file->read(success,contents.data(),0ull,contents.size());
+			return bool(success);
+		}
+
+		// Just enough of an XML scan to find `<shape type="obj|ply|serialized">` and their `<string name="filename" value="..."/>`,
+		// anything it misses (e.g. shapes in `<include>`d files) just doesn't get prefetched and the Mitsuba loader loads it itself
+		static std::vector<std::string> findMeshFiles(const std::string_view xml)
+		{
+			std::vector<std::string> files;
+			constexpr auto npos = std::string_view::npos;
+			for (size_t shape=xml.find("<shape"); shape!=npos; shape=xml.find("<shape",shape+1ull))
+			{
+				const size_t tagEnd = xml.find('>',shape);
+				const size_t shapeEnd = xml.find("</shape",shape);
+				if (tagEnd==npos || shapeEnd==npos)
+					break;
+				const auto type = getAttribute(xml.substr(shape,tagEnd-shape),"type");
+				if (type!="obj" && type!="ply" && type!="serialized")
+					continue;
+				for (size_t element=xml.find("<string",tagEnd); element<shapeEnd; element=xml.find("<string",element+1ull))
+				{
+					const auto tag = xml.substr(element,xml.find('>',element)-element);
+					if (getAttribute(tag,"name")!="filename")
+						continue;
+					const std::string filename(getAttribute(tag,"value"));
+					if (!filename.empty() && std::find(files.begin(),files.end(),filename)==files.end())
+						files.push_back(filename);
+					break;
+				}
+			}
+			return files;
+		}
+		static std::string_view getAttribute(const std::string_view tag, const std::string_view name)
+		{
+			constexpr auto npos = std::string_view::npos;
+			for (size_t pos=tag.find(name); pos!=npos; pos=tag.find(name,pos+1ull))
+			{
+				if (pos==0ull || !std::isspace(static_cast<unsigned char>(tag[pos-1ull])))
+					continue;
+				size_t quote = tag.find_first_not_of(" \t\r\n",pos+name.size());
+				if (quote==npos || tag[quote]!='=')
+					continue;
+				quote = tag.find_first_not_of(" \t\r\n",quote+1ull);
+				if (quote==npos || (tag[quote]!='"' && tag[quote]!='\''))
+					continue;
+				const size_t end = tag.find(tag[quote],quote+1ull);
+				if (end==npos)
+					break;
+				return tag.substr(quote+1ull,end-quote-1ull);
+			}
+			return {};
+		}
+
+		// the extension (which picks the loader) and the contents
+		static nbl::core::blake3_hash_t hashContents(const std::string_view filename, const std::vector<uint8_t>& contents)
+		{
+			nbl::core::blake3_hasher hasher;
+			const auto extension = std::filesystem::path(filename).extension().string();
+			const uint64_t extensionLength = extension.size();
+			hasher.update(&extensionLength,sizeof(extensionLength));
+			hasher.update(extension.data(),extension.size());
+			hasher.update(contents.data(),contents.size());
+			return static_cast<nbl::core::blake3_hash_t>(hasher);
+		}
+		static std::string hashToString(const nbl::core::blake3_hash_t& hash)
+		{
+			constexpr char Digits[] = "0123456789abcdef";
+			std::string str;
+			str.reserve(sizeof(hash.data)*2u);
+			for (const auto byte : hash.data)
+			{
+				str += Digits[byte>>4];
+				str += Digits[byte&0xfu];
+			}
+			return str;
+		}
+
+		static void writeAABB(float* out, const nbl::core::aabbox3df& aabb)
+		{
+			out[0] = aabb.MinEdge.X; out[1] = aabb.MinEdge.Y; out[2] = aabb.MinEdge.Z;
+			out[3] = aabb.MaxEdge.X; out[4] = aabb.MaxEdge.Y; out[5] = aabb.MaxEdge.Z;
+		}
+		static nbl::core::aabbox3df readAABB(const float* in)
+		{
+			return nbl::core::aabbox3df(in[0],in[1],in[2],in[3],in[4],in[5]);
+		}
+
+		//! Returns an empty bundle on a miss or if the cache file is invalid
+		static nbl::asset::SAssetBundle load(nbl::system::ISystem* system, const std::filesystem::path& path)
+		{
+			using namespace nbl;
+			std::error_code ec;
+			if (!std::filesystem::exists(path,ec))
+				return {};
+
+			system::ISystem::future_t<core::smart_refctd_ptr<system::IFile>> future;
+			system->createFile(future,path,core::bitflag(system::IFile::ECF_READ)|system::IFile::ECF_MAPPABLE);
+			const auto file = future.get();
+			if (!file || !file->getMappedPointer() || file->getSize()<sizeof(SHeader))
+				return {};
+			const auto* data = reinterpret_cast<const uint8_t*>(file->getMappedPointer());
+
+			SHeader header;
+			memcpy(&header,data,sizeof(header));
+			const uint64_t tablesSize = sizeof(SHeader)+header.bufferCount*sizeof(SBufferEntry)+header.meshCount*sizeof(SMeshEntry)+header.meshBufferCount*sizeof(SMeshBufferEntry);
+			if (header.magic!=SHeader::Magic || header.version!=SHeader::Version || header.fileSize!=file->getSize() || tablesSize>header.fileSize)
+				return {};
+			const auto* bufferEntries = reinterpret_cast<const SBufferEntry*>(data+sizeof(SHeader));
+			const auto* meshEntries = reinterpret_cast<const SMeshEntry*>(bufferEntries+header.bufferCount);
+			const auto* meshBufferEntries = reinterpret_cast<const SMeshBufferEntry*>(meshEntries+header.meshCount);
+
+			// copied out of the mapping, the loaders are free to modify the buffers
+			core::vector<core::smart_refctd_ptr<asset::ICPUBuffer>> buffers(header.bufferCount);
+			for (uint32_t i=0u; i<header.bufferCount; i++)
+			{
+				const auto& entry = bufferEntries[i];
+				if (entry.offset+entry.size>header.fileSize)
+					return {};
+				buffers[i] = core::make_smart_refctd_ptr<asset::ICPUBuffer>(entry.size);
+				memcpy(buffers[i]->getPointer(),data+entry.offset,entry.size);
+			}
+			auto getBinding = [&buffers](const uint32_t buffer, const uint64_t offset) -> asset::SBufferBinding<asset::ICPUBuffer>
+			{
+				if (buffer>=buffers.size())
+					return {};
+				return {offset,buffers[buffer]};
+			};
+
+			core::vector<core::smart_refctd_ptr<asset::IAsset>> meshes(header.meshCount);
+			for (uint32_t i=0u; i<header.meshCount; i++)
+			{
+				const auto& meshEntry = meshEntries[i];
+				if (meshEntry.firstMeshBuffer+meshEntry.meshBufferCount>header.meshBufferCount)
+					return {};
+				auto mesh = core::make_smart_refctd_ptr<asset::ICPUMesh>();
+				for (uint32_t j=0u; j<meshEntry.meshBufferCount; j++)
+				{
+					const auto& entry = meshBufferEntries[meshEntry.firstMeshBuffer+j];
+					asset::SBufferBinding<asset::ICPUBuffer> bindings[MaxBindings];
+					for (uint32_t b=0u; b<MaxBindings; b++)
+						bindings[b] = getBinding(entry.vertexBuffers[b],entry.vertexBufferOffsets[b]);
+					//creating pipeline just to forward vtx and primitive params
+					auto pipeline = core::make_smart_refctd_ptr<asset::ICPURenderpassIndependentPipeline>(
+						nullptr,nullptr,nullptr,
+						entry.vertexInput,
+						asset::SBlendParams(),
+						entry.primitiveAssembly,
+						asset::SRasterizationParams()
+					);
+					auto mb = core::make_smart_refctd_ptr<asset::ICPUMeshBuffer>(nullptr,nullptr,bindings,getBinding(entry.indexBuffer,entry.indexBufferOffset));
+					mb->setPipeline(std::move(pipeline));
+					mb->setIndexType(static_cast<asset::E_INDEX_TYPE>(entry.indexType));
+					mb->setIndexCount(entry.indexCount);
+					mb->setBaseVertex(entry.baseVertex);
+					mb->setInstanceCount(entry.instanceCount);
+					mb->setPositionAttributeIx(entry.positionAttribute);
+					mb->setNormalAttributeIx(entry.normalAttribute);
+					mb->setBoundingBox(readAABB(entry.aabb));
+					mesh->getMeshBufferVector().push_back(std::move(mb));
+				}
+				mesh->setBoundingBox(readAABB(meshEntry.aabb));
+				meshes[i] = std::move(mesh);
+			}
+			return asset::SAssetBundle(nullptr,meshes);
+		}
+
+		//! Skips bundles with anything else than meshes in them. Two writers of the same path can happen (files with identical contents in one
+		//! `prefetch`, or another run), so every one writes its own uniquely named temporary and renames it over, readers never see half a file.
+		static bool store(const std::filesystem::path& path, const nbl::asset::SAssetBundle& bundle)
+		{
+			using namespace nbl;
+			SHeader header = {};
+			std::vector<const asset::ICPUBuffer*> buffers;
+			std::vector<SBufferEntry> bufferEntries;
+			std::vector<SMeshEntry> meshEntries;
+			std::vector<SMeshBufferEntry> meshBufferEntries;
+			// vertex attributes mostly share one buffer, store it once
+			auto getBufferIx = [&](const asset::ICPUBuffer* buffer) -> uint32_t
+			{
+				if (!buffer)
+					return InvalidBuffer;
+				const auto found = std::find(buffers.begin(),buffers.end(),buffer);
+				if (found!=buffers.end())
+					return static_cast<uint32_t>(found-buffers.begin());
+				buffers.push_back(buffer);
+				return static_cast<uint32_t>(buffers.size()-1ull);
+			};
+
+			for (const auto& asset : bundle.getContents())
+			{
+				if (asset->getAssetType()!=asset::IAsset::ET_MESH)
+					return false;
+				const auto* mesh = static_cast<const asset::ICPUMesh*>(asset.get());
+				auto& meshEntry = meshEntries.emplace_back();
+				meshEntry.firstMeshBuffer = static_cast<uint32_t>(meshBufferEntries.size());
+				writeAABB(meshEntry.aabb,mesh->getBoundingBox());
+				for (const auto* mb : mesh->getMeshBuffers())
+				{
+					SMeshBufferEntry entry;
+					memset(&entry,0,sizeof(entry));
+					entry.vertexInput = mb->getPipeline()->getVertexInputParams();
+					entry.primitiveAssembly = mb->getPipeline()->getPrimitiveAssemblyParams();
+					for (uint32_t b=0u; b<MaxBindings; b++)
+					{
+						const auto& binding = mb->getVertexBufferBindings()[b];
+						entry.vertexBuffers[b] = getBufferIx(binding.buffer.get());
+						entry.vertexBufferOffsets[b] = binding.offset;
+					}
+					const auto& indexBinding = mb->getIndexBufferBinding();
+					entry.indexBuffer = getBufferIx(indexBinding.buffer.get());
+					entry.indexBufferOffset = indexBinding.offset;
+					entry.indexType = mb->getIndexType();
+					entry.indexCount = mb->getIndexCount();
+					entry.baseVertex = mb->getBaseVertex();
+					entry.instanceCount = mb->getInstanceCount();
+					entry.positionAttribute = mb->getPositionAttributeIx();
+					entry.normalAttribute = mb->getNormalAttributeIx();
+					writeAABB(entry.aabb,mb->getBoundingBox());
+					meshBufferEntries.push_back(entry);
+				}
+				meshEntry.meshBufferCount = static_cast<uint32_t>(meshBufferEntries.size())-meshEntry.firstMeshBuffer;
+			}
+			header.meshCount = static_cast<uint32_t>(meshEntries.size());
+			header.meshBufferCount = static_cast<uint32_t>(meshBufferEntries.size());
+			header.bufferCount = static_cast<uint32_t>(buffers.size());
+
+			uint64_t offset = sizeof(SHeader)+buffers.size()*sizeof(SBufferEntry)+meshEntries.size()*sizeof(SMeshEntry)+meshBufferEntries.size()*sizeof(SMeshBufferEntry);
+			for (const auto* buffer : buffers)
+			{
+				offset = (offset+15ull)&~15ull;
+				bufferEntries.push_back({offset,buffer->getSize()});
+				offset += buffer->getSize();
+			}
+			header.fileSize = offset;
+
+			return nbl::examples::writeFileAtomically(path,[&](std::ofstream& file)->void
+			{
+				file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+				file.write(reinterpret_cast<const char*>(bufferEntries.data()),bufferEntries.size()*sizeof(SBufferEntry));
+				file.write(reinterpret_cast<const char*>(meshEntries.data()),meshEntries.size()*sizeof(SMeshEntry));
+				file.write(reinterpret_cast<const char*>(meshBufferEntries.data()),meshBufferEntries.size()*sizeof(SMeshBufferEntry));
+				const char zeros[16] = {};
+				for (size_t i=0; i<buffers.size(); i++)
+				{
+					file.write(zeros,bufferEntries[i].offset-static_cast<uint64_t>(file.tellp()));
+					file.write(reinterpret_cast<const char*>(buffers[i]->getPointer()),buffers[i]->getSize());
+				}
+			});
+		}
+
+		std::filesystem::path m_cacheDir;
+};
+
+#endif
@@ -13,6 +13,8 @@
 #include "../3rdparty/portable-file-dialogs/portable-file-dialogs.h"
 #include "nbl/ext/MitsubaLoader/CMitsubaLoader.h"
 
+#include "CMitsubaMeshCache.h"
+
 #define USE_ENVMAP
 
 using namespace nbl;
@@ -385,16 +387,23 @@ public:
 				parentPath = flist[chosen].fullName.parent_path();
 			}
 
+			const auto loadStart = std::chrono::steady_clock::now();
 			//! read cache results -- speeds up mesh generation
 			qnc->loadCacheFromFile<asset::EF_A2B10G10R10_SNORM_PACK32>(system.get(), "../../tmp/normalCache101010.sse");
-			//! load the mitsuba scene
 			asset::IAssetLoader::SAssetLoadParams loadParams;
 			loadParams.workingDirectory = "resources" / parentPath;
 			loadParams.logger = logger.get();
+			//! load the meshes the scene references in parallel, from the mesh cache when their files didn't change
+			const auto meshCacheStats = CMitsubaMeshCache("../../tmp/mitsubaMeshCache").prefetch(assetManager.get(), system.get(), filePath, loadParams);
+			//! load the mitsuba scene
 			meshes = assetManager->getAsset(filePath, loadParams);
 			assert(!meshes.getContents().empty());
 			//! cache results -- speeds up mesh generation on second run
 			qnc->saveCacheToFile<asset::EF_A2B10G10R10_SNORM_PACK32>(system.get(), "../../tmp/normalCache101010.sse");
+			const double loadMilliseconds = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-loadStart).count();
+			logger->log("Loaded %s in %.1f ms (%s), %u/%u mesh files from the mesh cache, %.1f ms of it prefetching meshes", system::ILogger::ELL_PERFORMANCE,
+				filePath.c_str(), loadMilliseconds, meshCacheStats.meshFiles!=0u && meshCacheStats.cacheHits==meshCacheStats.meshFiles ? "warm":"cold",
+				meshCacheStats.cacheHits, meshCacheStats.meshFiles, meshCacheStats.seconds*1000.0);
 
 			auto contents = meshes.getContents();
 			assert(contents.begin() < contents.end());
@@ -0,0 +1,534 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+#ifndef _C_VIRTUAL_TEXTURE_TILE_CACHE_H_INCLUDED_
+#define _C_VIRTUAL_TEXTURE_TILE_CACHE_H_INCLUDED_
+
+#include <nabla.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AtomicFileWrite.hpp"
+
+// Textures cut into the same padded pages `ICPUVirtualTexture` uses, stored as one file of tiles so pages can be streamed in on demand
+// instead of the whole texture set having to fit into the physical storage at load time.
+// Every mip level at least a page large gets its own tiles, all smaller levels (the mip tail) share a single tile.
+class CVirtualTextureTileFile
+{
+	public:
+		struct STextureSource
+		{
+			// power of two square with a full mip chain, like `ICPUVirtualTexture::createPoTPaddedSquareImageWithMipLevels` makes them
+			const nbl::asset::ICPUImage* image;
+			nbl::asset::ISampler::E_TEXTURE_CLAMP uwrap;
+			nbl::asset::ISampler::E_TEXTURE_CLAMP vwrap;
+		};
+
+		static inline uint64_t makePageKey(const uint32_t texture, const uint32_t mip, const uint32_t x, const uint32_t y)
+		{
+			return (uint64_t(texture)<<32)|(uint64_t(mip)<<24)|(uint64_t(y)<<12)|uint64_t(x);
+		}
+
+		//! Returns nullptr if the file doesn't exist or isn't a tile file
+		static std::unique_ptr<CVirtualTextureTileFile> open(nbl::system::ISystem* system, const std::filesystem::path& path)
+		{
+			using namespace nbl;
+			std::error_code ec;
+			if (!std::filesystem::exists(path,ec))
+				return nullptr;
+
+			system::ISystem::future_t<core::smart_refctd_ptr<system::IFile>> future;
+			system->createFile(future,path,core::bitflag(system::IFile::ECF_READ)|system::IFile::ECF_MAPPABLE);
+			auto file = future.get();
+			if (!file || !file->getMappedPointer() || file->getSize()<sizeof(SHeader))
+				return nullptr;
+
+			SHeader header;
+			memcpy(&header,file->getMappedPointer(),sizeof(header));
+			if (header.magic!=SHeader::Magic || header.version!=SHeader::Version || header.fileSize!=file->getSize() || sizeof(SHeader)+header.textureCount*sizeof(STextureEntry)>header.fileSize)
+				return nullptr;
+			return std::unique_ptr<CVirtualTextureTileFile>(new CVirtualTextureTileFile(std::move(file),header));
+		}
+
+		//! Cuts `textures` into tiles of `1<<pageSizeLog2` texels plus `padding` on every side, the padding gets filled according to the wrap modes.
+		//! Block compressed textures aren't supported, their index still gets an (empty) entry so page keys match the `textures` order.
+		static bool write(const std::filesystem::path& path, const uint32_t pageSizeLog2, const uint32_t padding, const std::vector<STextureSource>& textures, uint64_t* outFileSize=nullptr)
+		{
+			using namespace nbl;
+			SHeader header = {};
+			header.pageSizeLog2 = pageSizeLog2;
+			header.padding = padding;
+			header.textureCount = static_cast<uint32_t>(textures.size());
+			const uint32_t pageSize = 1u<<pageSizeLog2;
+			const uint32_t tileDim = pageSize+2u*padding;
+
+			std::vector<STextureEntry> entries(textures.size());
+			uint64_t offset = sizeof(SHeader)+sizeof(STextureEntry)*textures.size();
+			for (size_t i=0; i<textures.size(); i++)
+			{
+				const auto& params = textures[i].image->getCreationParameters();
+				auto& entry = entries[i];
+				if (asset::isBlockCompressionFormat(params.format))
+					continue;
+				entry.texelBytes = asset::getTexelOrBlockBytesize(params.format);
+				entry.dim = params.extent.width;
+				entry.mipCount = params.mipLevels;
+				entry.tileBytes = tileDim*tileDim*entry.texelBytes;
+				entry.firstTileOffset = offset = (offset+15ull)&~15ull;
+				entry.tileCount = entry.getTileCount(pageSizeLog2);
+				offset += uint64_t(entry.tileCount)*entry.tileBytes;
+				header.maxTileBytes = std::max(header.maxTileBytes,entry.tileBytes);
+			}
+			header.fileSize = offset;
+
+			const bool written = nbl::examples::writeFileAtomically(path,[&](std::ofstream& file)->void
+			{
+				file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+				file.write(reinterpret_cast<const char*>(entries.data()),sizeof(STextureEntry)*entries.size());
+
+				std::vector<uint8_t> mip, tile;
+				for (size_t i=0; i<textures.size(); i++)
+				{
+					const auto& entry = entries[i];
+					if (entry.tileCount==0u)
+						continue;
+					const char zeros[16] = {};
+					file.write(zeros,entry.firstTileOffset-static_cast<uint64_t>(file.tellp()));
+
+					const uint32_t tailLevel = entry.getTailLevel(pageSizeLog2);
+					tile.assign(entry.tileBytes,0u);
+					for (uint32_t level=0u; level<entry.mipCount; level++)
+					{
+						const uint32_t dim = std::max(entry.dim>>level,1u);
+						gatherMip(textures[i].image,level,entry.texelBytes,dim,mip);
+						if (level<tailLevel)
+						{
+							for (uint32_t py=0u; py<dim/pageSize; py++)
+							for (uint32_t px=0u; px<dim/pageSize; px++)
+							{
+								for (uint32_t ty=0u; ty<tileDim; ty++)
+								{
+									const uint32_t sy = wrap(int32_t(py*pageSize+ty)-int32_t(padding),dim,textures[i].vwrap);
+									for (uint32_t tx=0u; tx<tileDim; tx++)
+									{
+										const uint32_t sx = wrap(int32_t(px*pageSize+tx)-int32_t(padding),dim,textures[i].uwrap);
+										memcpy(tile.data()+(ty*tileDim+tx)*entry.texelBytes,mip.data()+(sy*dim+sx)*entry.texelBytes,entry.texelBytes);
+									}
+								}
+								file.write(reinterpret_cast<const char*>(tile.data()),tile.size());
+							}
+							continue;
+						}
+						// mip tail, every level where `getMipTailOrigin` finds it again, its gutter filled according to the wrap modes like the page padding
+						if (level==tailLevel)
+							std::fill(tile.begin(),tile.end(),0u);
+						const auto [x0,y0] = getMipTailOrigin(pageSizeLog2,padding,level-tailLevel);
+						const int32_t gutter = static_cast<int32_t>(getMipTailGutter(pageSizeLog2,padding));
+						for (int32_t y=-gutter; y<int32_t(dim)+gutter; y++)
+						{
+							const uint32_t sy = wrap(y,dim,textures[i].vwrap);
+							for (int32_t x=-gutter; x<int32_t(dim)+gutter; x++)
+							{
+								const uint32_t sx = wrap(x,dim,textures[i].uwrap);
+								memcpy(tile.data()+((y0+y)*tileDim+x0+x)*entry.texelBytes,mip.data()+(sy*dim+sx)*entry.texelBytes,entry.texelBytes);
+							}
+						}
+					}
+					if (tailLevel<entry.mipCount)
+						file.write(reinterpret_cast<const char*>(tile.data()),tile.size());
+				}
+			});
+			if (!written)
+				return false;
+			if (outFileSize)
+				*outFileSize = header.fileSize;
+			return true;
+		}
+
+		// Texels around every mip tail level, so bilinear and anisotropic taps at a level's edge read its own wrapped texels instead of the neighbouring level.
+		// As wide as the page padding, narrowed until the layout of `getMipTailOrigin` fits into one tile.
+		static inline uint32_t getMipTailGutter(const uint32_t pageSizeLog2, const uint32_t padding)
+		{
+			const uint32_t pageSize = 1u<<pageSizeLog2;
+			const uint32_t tileDim = pageSize+2u*padding;
+			for (uint32_t gutter=padding; gutter; gutter--)
+			{
+				uint32_t columnHeight = 0u;
+				for (uint32_t tailIx=1u; tailIx<pageSizeLog2; tailIx++)
+					columnHeight += (pageSize>>(tailIx+1u))+2u*gutter;
+				if (pageSize/2u+pageSize/4u+4u*gutter<=tileDim && columnHeight<=tileDim)
+					return gutter;
+			}
+			return 0u;
+		}
+		// Position of texel (0,0) of a mip tail level inside the tail tile: the first tail level (at most half a page) in the top left corner,
+		// the smaller ones stacked in a column to its right, every one with its gutter around it
+		static inline std::pair<uint32_t,uint32_t> getMipTailOrigin(const uint32_t pageSizeLog2, const uint32_t padding, const uint32_t tailIx)
+		{
+			const uint32_t pageSize = 1u<<pageSizeLog2;
+			const uint32_t gutter = getMipTailGutter(pageSizeLog2,padding);
+			if (tailIx==0u)
+				return {gutter,gutter};
+			uint32_t y = 0u;
+			for (uint32_t i=1u; i<tailIx; i++)
+				y += (pageSize>>(i+1u))+2u*gutter;
+			return {pageSize/2u+3u*gutter,y+gutter};
+		}
+
+		inline uint32_t getTextureCount() const {return m_header.textureCount;}
+		inline uint32_t getPageSizeLog2() const {return m_header.pageSizeLog2;}
+		inline uint32_t getMaxTileBytes() const {return m_header.maxTileBytes;}
+		inline uint32_t getMipCount(const uint32_t texture) const {return getEntry(texture).mipCount;}
+		inline uint32_t getTailLevel(const uint32_t texture) const {return getEntry(texture).getTailLevel(m_header.pageSizeLog2);}
+		// pages along one side of a mip level, 1 for the mip tail
+		inline uint32_t getPagesPerDim(const uint32_t texture, const uint32_t mip) const
+		{
+			const auto& entry = getEntry(texture);
+			return mip<entry.getTailLevel(m_header.pageSizeLog2) ? (entry.dim>>(mip+m_header.pageSizeLog2)):1u;
+		}
+		inline uint32_t getTileCount() const
+		{
+			uint32_t count = 0u;
+			for (uint32_t i=0u; i<m_header.textureCount; i++)
+				count += getEntry(i).tileCount;
+			return count;
+		}
+
+		//! Pointer into the mapped file, nullptr for pages which don't exist
+		inline const uint8_t* getTile(const uint64_t pageKey, uint32_t* outBytes=nullptr) const
+		{
+			const uint32_t texture = static_cast<uint32_t>(pageKey>>32);
+			const uint32_t mip = static_cast<uint32_t>(pageKey>>24)&0xffu;
+			if (texture>=m_header.textureCount)
+				return nullptr;
+			const auto& entry = getEntry(texture);
+			if (mip>=entry.mipCount)
+				return nullptr;
+			const uint32_t tile = entry.getTileIndex(m_header.pageSizeLog2,mip,static_cast<uint32_t>(pageKey)&0xfffu,static_cast<uint32_t>(pageKey>>12)&0xfffu);
+			const uint64_t offset = entry.firstTileOffset+uint64_t(tile)*entry.tileBytes;
+			if (tile>=entry.tileCount || offset+entry.tileBytes>m_header.fileSize)
+				return nullptr;
+			if (outBytes)
+				*outBytes = entry.tileBytes;
+			return reinterpret_cast<const uint8_t*>(m_file->getMappedPointer())+offset;
+		}
+
+	protected:
+		struct SHeader
+		{
+			constexpr static inline uint32_t Magic = 0x5454564eu; // "NVTT"
+			constexpr static inline uint32_t Version = 2u;
+
+			uint32_t magic = Magic;
+			uint32_t version = Version;
+			uint32_t pageSizeLog2 = 0u;
+			uint32_t padding = 0u;
+			uint32_t textureCount = 0u;
+			uint32_t maxTileBytes = 0u;
+			uint64_t fileSize = 0ull;
+		};
+		struct STextureEntry
+		{
+			uint64_t firstTileOffset = 0ull;
+			uint32_t dim = 0u;
+			uint32_t texelBytes = 0u;
+			uint32_t mipCount = 0u;
+			uint32_t tileBytes = 0u;
+			uint32_t tileCount = 0u;
+			uint32_t padding = 0u;
+
+			inline uint32_t getTailLevel(const uint32_t pageSizeLog2) const
+			{
+				const uint32_t dimLog2 = nbl::core::findMSB(dim);
+				return std::min(dimLog2>=pageSizeLog2 ? (dimLog2-pageSizeLog2+1u):0u,mipCount);
+			}
+			inline uint32_t getTileCount(const uint32_t pageSizeLog2) const
+			{
+				const uint32_t tailLevel = getTailLevel(pageSizeLog2);
+				return getTileIndex(pageSizeLog2,tailLevel,0u,0u)+(tailLevel<mipCount ? 1u:0u);
+			}
+			// tiles are stored mip by mip, row major within a mip, the tail tile last
+			inline uint32_t getTileIndex(const uint32_t pageSizeLog2, const uint32_t mip, const uint32_t x, const uint32_t y) const
+			{
+				const uint32_t tailLevel = getTailLevel(pageSizeLog2);
+				uint32_t index = 0u;
+				for (uint32_t level=0u; level<std::min(mip,tailLevel); level++)
+				{
+					const uint32_t pagesPerDim = dim>>(level+pageSizeLog2);
+					index += pagesPerDim*pagesPerDim;
+				}
+				if (mip>=tailLevel)
+					return index;
+				return index+y*(dim>>(mip+pageSizeLog2))+x;
+			}
+		};
+
+		CVirtualTextureTileFile(nbl::core::smart_refctd_ptr<nbl::system::IFile>&& file, const SHeader& header) : m_file(std::move(file)), m_header(header) {}
+
+		inline const STextureEntry& getEntry(const uint32_t texture) const
+		{
+			return reinterpret_cast<const STextureEntry*>(reinterpret_cast<const uint8_t*>(m_file->getMappedPointer())+sizeof(SHeader))[texture];
+		}
+
+		static uint32_t wrap(const int32_t coord, const uint32_t dim, const nbl::asset::ISampler::E_TEXTURE_CLAMP mode)
+		{
+			const int32_t size = static_cast<int32_t>(dim);
+			switch (mode)
+			{
+				case nbl::asset::ISampler::ETC_REPEAT:
+					return static_cast<uint32_t>(((coord%size)+size)%size);
+				case nbl::asset::ISampler::ETC_MIRROR:
+				{
+					const int32_t period = ((coord%(2*size))+2*size)%(2*size);
+					return static_cast<uint32_t>(period<size ? period:(2*size-1-period));
+				}
+				default:
+					return static_cast<uint32_t>(std::clamp(coord,0,size-1));
+			}
+		}
+
+		// dense copy of a mip level's first layer, whatever the layout of its regions
+		static void gatherMip(const nbl::asset::ICPUImage* image, const uint32_t level, const uint32_t texelBytes, const uint32_t dim, std::vector<uint8_t>& out)
+		{
+			out.assign(size_t(dim)*dim*texelBytes,0u);
+			const auto* src = reinterpret_cast<const uint8_t*>(image->getBuffer()->getPointer());
+			for (const auto& region : image->getRegions(level))
+			{
+				if (region.imageSubresource.baseArrayLayer!=0u || region.imageOffset.x+region.imageExtent.width>dim || region.imageOffset.y+region.imageExtent.height>dim)
+					continue;
+				const uint32_t rowLength = region.bufferRowLength ? region.bufferRowLength:region.imageExtent.width;
+				for (uint32_t y=0u; y<region.imageExtent.height; y++)
+					memcpy(out.data()+(size_t(region.imageOffset.y+y)*dim+region.imageOffset.x)*texelBytes,src+region.bufferOffset+size_t(y)*rowLength*texelBytes,size_t(region.imageExtent.width)*texelBytes);
+			}
+		}
+
+		nbl::core::smart_refctd_ptr<nbl::system::IFile> m_file;
+		SHeader m_header;
+};
+
+// CPU side of a streamed virtual texture: a page table from page keys to slots of a fixed size physical pool, LRU eviction,
+// and loader threads which fetch the tiles of missing pages from a `CVirtualTextureTileFile` while the frame goes on.
+// `request` and `update` must be called from the same thread, `update` hands out the pages that became resident so they can be copied
+// into the GPU's physical storage, the slot indices are stable until the page gets evicted.
+class CVirtualTexturePageCache
+{
+	public:
+		constexpr static inline uint32_t InvalidSlot = ~0u;
+
+		struct SStats
+		{
+			uint64_t requests = 0ull;
+			uint64_t hits = 0ull;
+			uint64_t faults = 0ull; // misses on pages which weren't already being loaded
+			uint64_t evictions = 0ull;
+			double totalFaultLatency = 0.0;
+			double maxFaultLatency = 0.0;
+
+			inline double getHitRate() const {return requests ? double(hits)/double(requests):0.0;}
+			inline double getAverageFaultLatency() const {return faults ? totalFaultLatency/double(faults):0.0;}
+		};
+
+		struct SResidentPage
+		{
+			uint64_t pageKey;
+			uint32_t slot;
+		};
+
+		CVirtualTexturePageCache(const CVirtualTextureTileFile* tileFile, const uint32_t slotCount, const uint32_t loaderCount=1u) :
+			m_tileFile(tileFile), m_slotBytes(tileFile->getMaxTileBytes()), m_slots(slotCount), m_physical(size_t(slotCount)*m_slotBytes)
+		{
+			for (uint32_t i=0u; i<slotCount; i++)
+				m_freeSlots.push_back(slotCount-1u-i);
+			for (uint32_t i=0u; i<std::max(loaderCount,1u); i++)
+				m_loaders.emplace_back(&CVirtualTexturePageCache::loaderMain,this);
+		}
+		~CVirtualTexturePageCache()
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				m_stop = true;
+			}
+			m_queued.notify_all();
+			for (auto& loader : m_loaders)
+				loader.join();
+		}
+
+		//! Slot of the page if it's resident, otherwise queues it up for loading (once) and returns `InvalidSlot`, the caller is expected to fall back to a coarser mip
+		inline uint32_t request(const uint64_t pageKey)
+		{
+			m_stats.requests++;
+			if (const auto found=m_pageTable.find(pageKey); found!=m_pageTable.end())
+			{
+				m_stats.hits++;
+				touch(found->second);
+				return found->second;
+			}
+			if (m_inFlight.emplace(pageKey,clock_t::now()).second)
+			{
+				m_stats.faults++;
+				{
+					std::lock_guard lock(m_mutex);
+					m_queue.push_back(pageKey);
+				}
+				m_queued.notify_one();
+			}
+			return InvalidSlot;
+		}
+
+		//! Makes the pages whose tiles finished loading resident, evicting the least recently used ones when the pool is full
+		inline void update(std::vector<SResidentPage>& outResident)
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				std::swap(m_loaded,m_loadedSwap);
+			}
+			const auto now = clock_t::now();
+			for (auto& loaded : m_loadedSwap)
+			{
+				const auto inFlight = m_inFlight.find(loaded.pageKey);
+				const double latency = std::chrono::duration<double>(now-inFlight->second).count();
+				m_stats.totalFaultLatency += latency;
+				m_stats.maxFaultLatency = std::max(m_stats.maxFaultLatency,latency);
+				m_inFlight.erase(inFlight);
+				if (loaded.data.empty())
+					continue;
+
+				const uint32_t slot = allocateSlot();
+				if (slot==InvalidSlot)
+					continue;
+				memcpy(m_physical.data()+size_t(slot)*m_slotBytes,loaded.data.data(),loaded.data.size());
+				m_slots[slot].pageKey = loaded.pageKey;
+				m_pageTable.emplace(loaded.pageKey,slot);
+				pushFront(slot);
+				outResident.push_back({loaded.pageKey,slot});
+			}
+			m_loadedSwap.clear();
+		}
+
+		inline const uint8_t* getSlotData(const uint32_t slot) const {return m_physical.data()+size_t(slot)*m_slotBytes;}
+		inline uint32_t getSlotCount() const {return static_cast<uint32_t>(m_slots.size());}
+		inline uint32_t getResidentCount() const {return static_cast<uint32_t>(m_pageTable.size());}
+		inline const SStats& getStats() const {return m_stats;}
+
+		inline void logStats(nbl::system::ILogger* logger) const
+		{
+			logger->log("Virtual texture page cache: %u/%u slots resident, %llu requests, %.2f%% hit rate, %llu page faults, %llu evictions, fault latency %.3f ms average %.3f ms max",nbl::system::ILogger::ELL_PERFORMANCE,
+				getResidentCount(),getSlotCount(),m_stats.requests,m_stats.getHitRate()*100.0,m_stats.faults,m_stats.evictions,m_stats.getAverageFaultLatency()*1000.0,m_stats.maxFaultLatency*1000.0);
+		}
+
+	protected:
+		using clock_t = std::chrono::steady_clock;
+
+		struct SSlot
+		{
+			uint64_t pageKey = 0ull;
+			uint32_t prev = InvalidSlot;
+			uint32_t next = InvalidSlot;
+		};
+		struct SLoadedTile
+		{
+			uint64_t pageKey;
+			std::vector<uint8_t> data; // empty if the tile file doesn't have the page
+		};
+
+		inline void loaderMain()
+		{
+			while (true)
+			{
+				uint64_t pageKey;
+				{
+					std::unique_lock lock(m_mutex);
+					m_queued.wait(lock,[this]()->bool{return m_stop || !m_queue.empty();});
+					if (m_stop)
+						return;
+					pageKey = m_queue.front();
+					m_queue.pop_front();
+				}
+				// the copy out of the mapping is where the IO happens, the page faults of the mapping block this thread rather than the frame
+				SLoadedTile loaded = {pageKey,{}};
+				uint32_t bytes = 0u;
+				if (const auto* tile=m_tileFile->getTile(pageKey,&bytes); tile)
+					loaded.data.assign(tile,tile+bytes);
+				std::lock_guard lock(m_mutex);
+				m_loaded.push_back(std::move(loaded));
+			}
+		}
+
+		inline uint32_t allocateSlot()
+		{
+			if (!m_freeSlots.empty())
+			{
+				const uint32_t slot = m_freeSlots.back();
+				m_freeSlots.pop_back();
+				return slot;
+			}
+			const uint32_t slot = m_lruTail;
+			if (slot==InvalidSlot)
+				return InvalidSlot;
+			unlink(slot);
+			m_pageTable.erase(m_slots[slot].pageKey);
+			m_stats.evictions++;
+			return slot;
+		}
+
+		// intrusive doubly linked list over the slots, most recently used at the head
+		inline void unlink(const uint32_t slot)
+		{
+			auto& node = m_slots[slot];
+			(node.prev!=InvalidSlot ? m_slots[node.prev].next:m_lruHead) = node.next;
+			(node.next!=InvalidSlot ? m_slots[node.next].prev:m_lruTail) = node.prev;
+			node.prev = node.next = InvalidSlot;
+		}
+		inline void pushFront(const uint32_t slot)
+		{
+			auto& node = m_slots[slot];
+			node.prev = InvalidSlot;
+			node.next = m_lruHead;
+			if (m_lruHead!=InvalidSlot)
+				m_slots[m_lruHead].prev = slot;
+			m_lruHead = slot;
+			if (m_lruTail==InvalidSlot)
+				m_lruTail = slot;
+		}
+		inline void touch(const uint32_t slot)
+		{
+			if (slot==m_lruHead)
+				return;
+			unlink(slot);
+			pushFront(slot);
+		}
+
+		const CVirtualTextureTileFile* m_tileFile;
+		const uint32_t m_slotBytes;
+		// only touched by the thread calling `request` and `update`
+		std::vector<SSlot> m_slots;
+		std::vector<uint8_t> m_physical;
+		std::vector<uint32_t> m_freeSlots;
+		std::unordered_map<uint64_t,uint32_t> m_pageTable;
+		std::unordered_map<uint64_t,clock_t::time_point> m_inFlight;
+		std::vector<SLoadedTile> m_loadedSwap;
+		uint32_t m_lruHead = InvalidSlot;
+		uint32_t m_lruTail = InvalidSlot;
+		SStats m_stats;
+		// shared with the loaders
+		std::mutex m_mutex;
+		std::condition_variable m_queued;
+		std::deque<uint64_t> m_queue;
+		std::vector<SLoadedTile> m_loaded;
+		bool m_stop = false;
+		std::vector<std::thread> m_loaders;
+};
+
+#endif
@@ -11,6 +11,9 @@
 #include "CCamera.hpp"
 #include "../common/CommonAPI.h"
 
+#include <random>
+#include "CVirtualTextureTileCache.h"
+
 using namespace nbl;
 using namespace core;
 
@@ -131,6 +134,8 @@ constexpr uint32_t PAGE_SZ_LOG2 = 7u;
 constexpr uint32_t TILES_PER_DIM_LOG2 = 4u;
 constexpr uint32_t PAGE_PADDING = 8u;
 constexpr uint32_t MAX_ALLOCATABLE_TEX_SZ_LOG2 = 12u; //4096
+// pre-tiles the loaded textures and streams them through a page cache smaller than the texture set, see `benchmarkPageStreaming`
+constexpr bool BENCHMARK_PAGE_STREAMING = false;
 
 constexpr uint32_t VT_SET = 0u;
 constexpr uint32_t PGTAB_BINDING = 0u;
@@ -166,6 +171,69 @@ STextureData getTextureData(core::vector<commit_t>& _out_commits, const asset::I
     return addr;
 }
 
+// Streams the pages of all the VT textures through a CPU page cache with a quarter of their tiles worth of physical slots, driven by a synthetic
+// request stream that drifts across the textures and mostly asks for fine mips, like a camera flying through the scene would
+void benchmarkPageStreaming(system::ISystem* system, system::ILogger* logger, const core::vector<commit_t>& commits, const std::filesystem::path& tileFilePath)
+{
+    using clock_t = std::chrono::steady_clock;
+    std::vector<CVirtualTextureTileFile::STextureSource> sources;
+    for (const auto& cm : commits)
+        sources.push_back({ cm.texture.get(), cm.uwrap, cm.vwrap });
+
+    const auto tilingStart = clock_t::now();
+    uint64_t fileSize = 0ull;
+    if (!CVirtualTextureTileFile::write(tileFilePath, PAGE_SZ_LOG2, PAGE_PADDING, sources, &fileSize))
+    {
+        logger->log("Failed to write the tile file %s", system::ILogger::ELL_ERROR, tileFilePath.string().c_str());
+        return;
+    }
+    const double tilingSeconds = std::chrono::duration<double>(clock_t::now() - tilingStart).count();
+    auto tileFile = CVirtualTextureTileFile::open(system, tileFilePath);
+    if (!tileFile)
+        return;
+    const uint32_t tileCount = tileFile->getTileCount();
+    logger->log("Pre-tiled %u textures into %u tiles (%.1f MiB) in %.2f s", system::ILogger::ELL_PERFORMANCE, tileFile->getTextureCount(), tileCount, double(fileSize) / double(1u << 20u), tilingSeconds);
+
+    constexpr uint32_t FrameCount = 600u;
+    constexpr uint32_t RequestsPerFrame = 1024u;
+    constexpr uint32_t VisibleTextures = 8u;
+    CVirtualTexturePageCache cache(tileFile.get(), std::max(tileCount / 4u, 16u), 2u);
+    std::vector<CVirtualTexturePageCache::SResidentPage> resident;
+    std::mt19937 rng(0x20u);
+    std::geometric_distribution<uint32_t> mipDist(0.5);
+    std::normal_distribution<float> spread(0.f, 0.125f);
+    const uint32_t textureCount = tileFile->getTextureCount();
+    uint64_t uploads = 0ull;
+    for (uint32_t frame = 0u; frame < FrameCount; frame++)
+    {
+        const float phase = float(frame) / float(FrameCount);
+        for (uint32_t r = 0u; r < RequestsPerFrame; r++)
+        {
+            const uint32_t texture = (frame / 16u + rng() % VisibleTextures) % textureCount;
+            const uint32_t mipCount = tileFile->getMipCount(texture);
+            if (mipCount == 0u)
+                continue;
+            const uint32_t mip = std::min(mipDist(rng), std::min(tileFile->getTailLevel(texture), mipCount - 1u));
+            const uint32_t pagesPerDim = tileFile->getPagesPerDim(texture, mip);
+            auto coord = [&]() -> uint32_t
+            {
+                const float uv = phase + spread(rng);
+                return static_cast<uint32_t>((uv - std::floor(uv)) * float(pagesPerDim)) % pagesPerDim;
+            };
+            const uint32_t x = coord();
+            const uint32_t y = coord();
+            cache.request(CVirtualTextureTileFile::makePageKey(texture, mip, x, y));
+        }
+        resident.clear();
+        cache.update(resident);
+        uploads += resident.size();
+        // stand in for the rest of the frame, the loaders work meanwhile
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    logger->log("Streamed %llu page uploads over %u frames", system::ILogger::ELL_PERFORMANCE, uploads, FrameCount);
+    cache.logStats(logger);
+}
+
 constexpr uint32_t TEX_OF_INTEREST_CNT = 6u;
 #include "nbl/nblpack.h"
 struct SPushConstants
@@ -512,6 +580,9 @@ APP_CONSTRUCTOR(MegaTextureApp)
         }
         assert(pipelineMetadata);
 
+        if constexpr (BENCHMARK_PAGE_STREAMING)
+            benchmarkPageStreaming(system.get(), logger.get(), vt_commits, "../../tmp/megatexture.tiles");
+
         core::smart_refctd_ptr<asset::ICPUDescriptorSetLayout> ds0layout;
         {
             auto sizes = vt->getDSlayoutBindings(nullptr, nullptr);